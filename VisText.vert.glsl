@@ -3,7 +3,17 @@
 
 uniform mat4 m_matrix;
 uniform mat4 v_matrix;
-uniform mat4 p_matrix;
+
+// Projection and lighting. These are the same for every model in a frame, so Visual
+// uploads them once per frame in a uniform buffer (see morph/gl/uniforms.h).
+layout(std140) uniform morph_frame
+{
+    highp mat4 p_matrix;         // projection matrix
+    highp vec3 light_colour;     // Colour for both ambient and diffuse. Probably white.
+    highp float ambient_intensity;
+    highp vec3 diffuse_position; // Positioned light
+    highp float diffuse_intensity;
+};
 
 layout(location = 0) in vec4 position; // Attrib location 0 is vertex position
 layout(location = 1) in vec4 vnormal;  // Attrib location 1 is vertex normal
@@ -11,10 +11,16 @@ in VERTEX
 // diffuse_intensity to 0. That means I have just one shader for objects and it's easy
 // to change the lighting.
 
-uniform vec3 light_colour;       // Colour for both ambient and diffuse. Probably white.
-uniform float ambient_intensity; // Ambient intensity
-uniform vec3 diffuse_position;   // Positioned light
-uniform float diffuse_intensity; // Diffuse light intensity
+// Projection and lighting. These are the same for every model in a frame, so Visual
+// uploads them once per frame in a uniform buffer (see morph/gl/uniforms.h).
+layout(std140) uniform morph_frame
+{
+    highp mat4 p_matrix;         // projection matrix
+    highp vec3 light_colour;     // Colour for both ambient and diffuse. Probably white.
+    highp float ambient_intensity;
+    highp vec3 diffuse_position; // Positioned light
+    highp float diffuse_intensity;
+};
 
 //uniform mat4 lv_matrix; // 'light' scene view matrix
 //uniform mat4 p_matrix; // projection matrix
@@ -7,10 +7,20 @@
 //uniform mat4 vp_matrix; // sceneview-projection matrix
 uniform mat4 m_matrix; // model matrix
 uniform mat4 v_matrix; // scene view matrix
-uniform mat4 p_matrix; // projection matrix
 // alpha - to make a model see-through
 uniform float alpha;
 
+// Projection and lighting. These are the same for every model in a frame, so Visual
+// uploads them once per frame in a uniform buffer (see morph/gl/uniforms.h).
+layout(std140) uniform morph_frame
+{
+    highp mat4 p_matrix;         // projection matrix
+    highp vec3 light_colour;     // Colour for both ambient and diffuse. Probably white.
+    highp float ambient_intensity;
+    highp vec3 diffuse_position; // Positioned light
+    highp float diffuse_intensity;
+};
+
 layout(location = 0) in vec4 position; // Attrib location 0
 layout(location = 1) in vec4 normalin; // Attrib location 1
 layout(location = 2) in vec3 color;    // Attrib location 2
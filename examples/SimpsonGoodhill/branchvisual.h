@@ -41,8 +41,11 @@ public:
     void initializeVertices()
     {
         // For each branch, draw lines for the path history and a sphere for teh current
-        // location, with a second colour for the EphA expression.
-        for (auto b : *this->branches) {
+        // location, with a second colour for the EphA expression. The branches are
+        // independent, so their geometry is generated in parallel.
+        auto branch_geometry = [this](morph::VisualModelChunk<>& chunk, std::size_t bi)
+        {
+            const branch<Flt>& b = (*this->branches)[bi];
             // Colour comes from target location.
             std::array<float, 3> clr = { b.tz[0], b.tz[1], 0 };
             std::array<float, 3> clr2 = { 0, 0, this->EphA_scale.transform_one(b.EphA) };
@@ -54,12 +57,22 @@ public:
                 last[1] = b.path[i-1][1];
                 cur[0] = b.path[i][0];
                 cur[1] = b.path[i][1];
-                this->computeFlatLineRnd (this->idx, last, cur, this->uz, clr, this->linewidth, 0.0f, true, false);
+                chunk.computeFlatLineRnd (chunk.idx, last, cur, this->uz, clr, this->linewidth, 0.0f, true, false);
             }
             // Finally, a sphere at the last location. Tune number of rings (second last
             // arg) in sphere to change size of clr2 disc at top
-            this->computeSphere (this->idx, cur, clr, clr2, this->radiusFixed, 14, 12);
-        }
+            chunk.computeSphere (chunk.idx, cur, clr, clr2, this->radiusFixed, 14, 12);
+        };
+        // How many vertices and indices will branch_geometry create for branch bi?
+        auto branch_counts = [this](std::size_t bi)
+        {
+            std::size_t nlines = (*this->branches)[bi].path.size();
+            nlines = nlines > 0 ? nlines - 1 : 0;
+            return std::array<std::size_t, 2>{
+                nlines * flatlinernd_num_vertices (true, false) + sphere_num_vertices (14, 12),
+                nlines * flatlinernd_num_indices (true, false) + sphere_num_indices (14, 12) };
+        };
+        this->compute_parallel (this->branches->size(), branch_geometry, branch_counts);
     }
 
     //! Set this->radiusFixed, then re-compute vertices.
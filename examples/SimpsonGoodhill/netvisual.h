@@ -37,10 +37,16 @@ public:
 
     void initializeVertices()
     {
-        // Spheres at the net vertices
-        for (unsigned int i = 0; i < this->locations->p.size(); ++i) {
-            this->computeSphere (this->idx, this->locations->p[i], this->locations->clr[i], this->radiusFixed, 14, 12);
-        }
+        // Spheres at the net vertices, generated in parallel
+        this->compute_parallel (this->locations->p.size(),
+                                [this](morph::VisualModelChunk<>& chunk, std::size_t i)
+                                {
+                                    chunk.computeSphere (chunk.idx, this->locations->p[i], this->locations->clr[i], this->radiusFixed, 14, 12);
+                                },
+                                [](std::size_t)
+                                {
+                                    return std::array<std::size_t, 2>{ sphere_num_vertices (14, 12), sphere_num_indices (14, 12) };
+                                });
         // Connections
         for (auto c : this->locations->c) {
             morph::vec<Flt, 3> c1 = this->locations->p[c[0]];
@@ -0,0 +1,88 @@
+/*
+ * Show the results of a compute shader in a morph::Visual with no copies to the CPU. The
+ * compute shader writes an interference pattern of two moving sources into an SSBO; a
+ * CartGridSSBOVisual draws it straight from the SSBO, colouring (and raising) each vertex in
+ * its vertex shader. Every 100 frames the colour range is found on the GPU with
+ * morph::gl::reduce, which reads back just two floats.
+ */
+
+#include <morph/Visual.h>
+#include <morph/CartGrid.h>
+#include <morph/CartGridSSBOVisual.h>
+#include <morph/gl/compute_shaderprog.h>
+#include <morph/gl/ssbo.h>
+#include <morph/gl/reduce.h>
+#include <morph/vvec.h>
+#include <iostream>
+
+static constexpr int glver = morph::gl::version_4_5;
+
+// The height of the pattern at each CartGrid element, whose coordinates are in xy
+const char* compute_src = "#version 450\n"
+    "layout (local_size_x = 256) in;\n"
+    "layout (std430, binding = 1) readonly buffer XYBlock { vec2 xy[]; };\n"
+    "layout (std430, binding = 2) buffer DataBlock { float data[]; };\n"
+    "uniform uint n;\n"
+    "uniform float t;\n"
+    "void main()\n"
+    "{\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if (i >= n) { return; }\n"
+    "    vec2 s1 = vec2(0.3 * cos (0.5 * t), 0.3 * sin (0.5 * t));\n"
+    "    float d1 = distance (xy[i], s1);\n"
+    "    float d2 = distance (xy[i], -s1);\n"
+    "    data[i] = sin (40.0 * d1 - 3.0 * t) / (1.0 + 5.0 * d1) + sin (40.0 * d2 - 3.0 * t) / (1.0 + 5.0 * d2);\n"
+    "}\n";
+
+int main()
+{
+    morph::Visual<glver> v (1024, 768, "Compute shader results drawn from an SSBO");
+    v.lightingEffects();
+
+    morph::CartGrid cg (0.005f, 0.005f, 1.0f, 1.0f);
+    cg.setBoundaryOnOuterEdge();
+    const unsigned int n = cg.num();
+
+    // The element coordinates go to the GPU once
+    morph::vvec<morph::vec<float, 2>> xy (n);
+    for (unsigned int i = 0; i < n; ++i) { xy[i] = { cg.d_x[i], cg.d_y[i] }; }
+    unsigned int xy_name = 0;
+    morph::gl::setup_ssbo (1, xy_name, xy);
+    // The data exist only on the GPU
+    unsigned int data_name = 0;
+    morph::gl::setup_ssbo (2, data_name, morph::vvec<float> (n, 0.0f));
+
+    morph::gl::compute_shaderprog<glver> prog;
+    prog.load_shaders ({ { GL_COMPUTE_SHADER, "", compute_src, 0 } });
+    morph::gl::reduce<glver> red;
+    red.init();
+
+    auto gv = std::make_unique<morph::CartGridSSBOVisual<glver>> (&cg, morph::vec<float>{ 0.0f, 0.0f, 0.0f });
+    v.bindmodel (gv);
+    gv->setBuffer (data_name);
+    gv->cm.setType (morph::ColourMapType::Twilight);
+    gv->zScale.setParams (0.05f, 0.0f);
+    gv->finalize();
+    auto gvp = v.addVisualModel (gv);
+
+    float t = 0.0f;
+    unsigned int frame = 0;
+    while (v.readyToFinish == false) {
+        prog.use();
+        prog.set_uniform ("n", n);
+        prog.set_uniform ("t", t);
+        prog.dispatch ((n + 255) / 256, 1, 1);
+        if (frame++ % 100 == 0) {
+            morph::range<float> r = red.minmax (data_name, n);
+            gvp->colourScale.compute_autoscale (r.min, r.max);
+            std::cout << "Data range: " << r << std::endl;
+        }
+        v.poll();
+        v.render();
+        t += 0.02f;
+    }
+
+    glDeleteBuffers (1, &xy_name);
+    glDeleteBuffers (1, &data_name);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * A simulation that runs in its own thread, publishing snapshots of its state, while the
+ * main thread renders the latest snapshot at its own rate. The simulation never waits for
+ * the graphics; frames it publishes faster than they can be shown are dropped.
+ */
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <morph/Visual.h>
+#include <morph/GridVisual.h>
+#include <morph/Grid.h>
+#include <morph/TripleBuffer.h>
+
+int main()
+{
+    morph::Visual v(1600, 1000, "A simulation in its own thread");
+
+    constexpr unsigned int Nside = 150;
+    constexpr morph::vec<float, 2> grid_spacing = {0.01f, 0.01f};
+    morph::Grid grid(Nside, Nside, grid_spacing, {0.0f, 0.0f}, morph::GridDomainWrap::Both);
+
+    // The simulation publishes copies of its state into the snapshots. Sizing the three slots
+    // up front means that publishing never allocates.
+    morph::TripleBuffer<std::vector<float>> snapshots (std::vector<float>(grid.n, 0.0f));
+    snapshots.publish();
+
+    auto gv = std::make_unique<morph::GridVisual<float>>(&grid, morph::vec<float>({-0.75f, -0.75f, 0.0f}));
+    v.bindmodel (gv);
+    gv->gridVisMode = morph::GridVisMode::Pixels;
+    gv->cm.setType (morph::ColourMapType::Twilight);
+    gv->colourScale.compute_autoscale (-1.0f, 1.0f);
+    // The model only ever reads the reader's (front) slot, never the simulation's own array
+    snapshots.fetch();
+    gv->setScalarData (&snapshots.front());
+    gv->finalize();
+    auto gvp = v.addVisualModel (gv);
+
+    // The simulation: a damped wave on a periodic grid, driven at two points.
+    std::atomic<bool> running = true;
+    std::thread sim ([&grid, &snapshots, &running]() {
+        morph::vvec<float> u (grid.n, 0.0f);
+        morph::vvec<float> u_prev (grid.n, 0.0f);
+        morph::vvec<float> u_next (grid.n, 0.0f);
+        const int w = static_cast<int>(grid.get_w());
+        const int h = static_cast<int>(grid.get_h());
+        const int src1 = (h / 3) * w + w / 4;
+        const int src2 = (2 * h / 3) * w + 3 * w / 4;
+        for (unsigned long long step = 0; running; ++step) {
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    int i = y * w + x;
+                    float lap = u[y * w + (x + 1) % w] + u[y * w + (x + w - 1) % w]
+                    + u[((y + 1) % h) * w + x] + u[((y + h - 1) % h) * w + x] - 4.0f * u[i];
+                    u_next[i] = 0.999f * (2.0f * u[i] - u_prev[i] + 0.2f * lap);
+                }
+            }
+            u_next[src1] = std::sin (0.05f * step);
+            u_next[src2] = std::sin (0.07f * step);
+            u_prev.swap (u);
+            u.swap (u_next);
+            // Publishing is a copy into a free slot. It never waits for the renderer.
+            snapshots.publish (u);
+        }
+    });
+
+    // Render on the main thread until the window is closed
+    v.render_loop ([gvp, &snapshots]() { gvp->updateFrom (snapshots); }, []() { return true; });
+
+    running = false;
+    sim.join();
+
+    std::cout << "The simulation published " << snapshots.published() << " frames, of which "
+              << snapshots.dropped() << " were dropped\n";
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * Render the HDF5 logs of HexGrid simulations (such as those written by the RD_Base
+ * examples) to PNG image sequences, with no window. For making figures and movies from saved
+ * runs on machines with no display, such as the nodes of a compute cluster.
+ *
+ * Each log directory should contain the HexGrid (hexgrid.bin, as written by
+ * HexGrid::saveCompact or by RD_Base::savePositions, or hexgrid.h5, as written by
+ * HexGrid::save) and one file per frame (dat_00000.h5, dat_00100.h5, and so on),
+ * each holding one or more datasets over the hexes. Every dataset is shown side by side in a
+ * scene that is built once per run; each frame then just updates the models' data.
+ *
+ * The frames of all the runs are shared between several worker processes, each with its own
+ * headless OpenGL context, so that on a CPU-only node (on which Mesa renders with llvmpipe)
+ * all the cores can be used.
+ *
+ * Usage:
+ *   hdf_render [options] logdir [logdir ...]
+ *
+ * Options:
+ *   -d /A        A dataset to show (repeat for more). Default: /A
+ *   -o outdir    Where to write the images. Default: into each logdir
+ *   -j N         The number of worker processes. Default: the number of cores
+ *   -s W H       Image size in pixels. Default: 1024 768
+ *   -r min max   A fixed colour range for all the frames. Default: autoscale each frame
+ *   -z zscale    Scale the data into the z direction. Default: 0 (flat)
+ *   -p prefix    The frame file name prefix. Default: dat_
+ *   -m samples   Multisample the images. Default: 4
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define HEXGRID_COMPILE_LOAD_AND_SAVE 1
+#define OWNED_MODE 1
+namespace morph { using win_t = void; }
+#include <morph/gl/headless.h>
+#include <morph/Visual.h>
+#include <morph/HexGrid.h>
+#include <morph/HexGridVisual.h>
+#include <morph/HdfData.h>
+#include <morph/tools.h>
+#include <morph/vec.h>
+#include <morph/mathconst.h>
+
+struct options
+{
+    std::vector<std::string> logdirs;
+    std::vector<std::string> datasets;
+    std::string outdir = "";
+    std::string prefix = "dat_";
+    unsigned int jobs = std::max (1U, std::thread::hardware_concurrency());
+    int width = 1024;
+    int height = 768;
+    int samples = 4;
+    bool fixed_range = false;
+    float range_min = 0.0f;
+    float range_max = 1.0f;
+    float zscale = 0.0f;
+};
+
+// One image to make
+struct frame_job
+{
+    std::size_t run = 0;
+    std::string h5file;
+    std::string pngfile;
+};
+
+// Find the frames in each log directory, in order
+std::vector<frame_job> find_frames (const options& o)
+{
+    std::vector<frame_job> frames;
+    for (std::size_t r = 0; r < o.logdirs.size(); ++r) {
+        std::vector<std::string> files;
+        morph::Tools::readDirectoryTree (files, o.logdirs[r]);
+        std::vector<std::string> names;
+        for (auto f : files) {
+            if (f.find ('/') == std::string::npos && f.rfind (o.prefix, 0) == 0
+                && f.size() > 3 && f.compare (f.size() - 3, 3, ".h5") == 0) {
+                names.push_back (f);
+            }
+        }
+        std::sort (names.begin(), names.end());
+
+        std::string outdir = o.outdir.empty() ? o.logdirs[r] : o.outdir;
+        std::string runname = "";
+        if (!o.outdir.empty() && o.logdirs.size() > 1) {
+            std::vector<std::string> pth = morph::Tools::stringToVector (o.logdirs[r], "/");
+            while (!pth.empty() && pth.back().empty()) { pth.pop_back(); }
+            runname = (pth.empty() ? std::to_string (r) : pth.back()) + "_";
+        }
+        for (auto n : names) {
+            std::string stem = n.substr (0, n.size() - 3);
+            frames.push_back ({ r, o.logdirs[r] + "/" + n, outdir + "/" + runname + stem + ".png" });
+        }
+    }
+    return frames;
+}
+
+// Render every n_workers'th frame, starting at frame worker. Returns the number of failures.
+int render_frames (const options& o, const std::vector<frame_job>& frames,
+                   const unsigned int worker, const unsigned int n_workers)
+{
+    int failures = 0;
+    morph::gl::headless<> ctx (o.width, o.height, o.samples);
+
+    // The scene, which persists for all the frames of one run
+    std::unique_ptr<morph::HexGrid> hg;
+    std::unique_ptr<morph::Visual<>> v;
+    std::vector<morph::HexGridVisual<float>*> models;
+    std::vector<std::vector<float>> data (o.datasets.size());
+    std::size_t current_run = o.logdirs.size();
+
+    for (std::size_t fi = worker; fi < frames.size(); fi += n_workers) {
+        const frame_job& job = frames[fi];
+        try {
+            if (job.run != current_run) {
+                models.clear();
+                v.reset();
+                const std::string compact = o.logdirs[job.run] + "/hexgrid.bin";
+                if (::access (compact.c_str(), R_OK) == 0) {
+                    hg = std::make_unique<morph::HexGrid>();
+                    hg->loadCompact (compact);
+                } else {
+                    hg = std::make_unique<morph::HexGrid> (o.logdirs[job.run] + "/hexgrid.h5");
+                }
+
+                v = std::make_unique<morph::Visual<>>();
+                v->set_winsize (o.width, o.height);
+                v->init (nullptr);
+                // Fit the models into the view
+                const float spacing = 1.1f * hg->width();
+                const float scene_w = spacing * o.datasets.size();
+                // Each label sits below its grid, so make room for it above and below (the view is centred)
+                const float label_size = 0.05f * hg->width();
+                const float label_y = -0.5f * hg->depth() - 2.0f * label_size;
+                const float scene_h = 1.1f * 2.0f * -label_y;
+                const float aspect = static_cast<float>(o.width) / static_cast<float>(o.height);
+                const float tan_half_fov = std::tan (v->fov * morph::mathconst<float>::pi / 360.0f);
+                v->setSceneTransZ (-std::max (scene_w / aspect, scene_h) / (2.0f * tan_half_fov));
+
+                for (std::size_t d = 0; d < o.datasets.size(); ++d) {
+                    morph::vec<float> offset = { (d + 0.5f) * spacing - 0.5f * scene_w, 0.0f, 0.0f };
+                    auto hgv = std::make_unique<morph::HexGridVisual<float>> (hg.get(), offset);
+                    v->bindmodel (hgv);
+                    hgv->name = o.datasets[d];
+                    hgv->zScale.setParams (o.zscale, 0.0f);
+                    if (o.fixed_range) { hgv->colourScale.compute_autoscale (o.range_min, o.range_max); }
+                    hgv->cm.setType (morph::ColourMapType::Plasma);
+                    hgv->addLabel (o.datasets[d], { -0.5f * hg->width(), label_y, 0.0f },
+                                   morph::TextFeatures (label_size));
+                    // The data pointer stays the same for all the frames; only its content changes
+                    data[d].assign (hg->num(), 0.0f);
+                    hgv->setScalarData (&data[d]);
+                    hgv->finalize();
+                    models.push_back (v->addVisualModel (hgv));
+                }
+                current_run = job.run;
+            }
+
+            {
+                morph::HdfData h5 (job.h5file, morph::FileAccess::ReadOnly);
+                h5.read_error_action = morph::ReadErrorAction::Exception;
+                for (std::size_t d = 0; d < o.datasets.size(); ++d) {
+                    h5.read_contained_vals (o.datasets[d].c_str(), data[d]);
+                    if (data[d].size() != hg->num()) {
+                        throw std::runtime_error (o.datasets[d] + " does not have one value per hex");
+                    }
+                }
+            }
+            for (auto m : models) {
+                if (!o.fixed_range) { m->clearAutoscaleColour(); }
+                m->reinit();
+            }
+
+            v->render();
+            ctx.resolve();
+            v->saveImage (job.pngfile);
+            ctx.bind();
+        } catch (const std::exception& e) {
+            std::cerr << job.h5file << ": " << e.what() << std::endl;
+            ++failures;
+            // Rebuild the scene for the next frame
+            current_run = o.logdirs.size();
+        }
+    }
+    return failures;
+}
+
+int main (int argc, char** argv)
+{
+    options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string a (argv[i]);
+        auto need = [&](int n) {
+            if (i + n >= argc) {
+                std::cerr << a << " needs " << n << " argument" << (n > 1 ? "s" : "") << std::endl;
+                std::exit (1);
+            }
+        };
+        if (a == "-d") { need (1); o.datasets.push_back (argv[++i]); }
+        else if (a == "-o") { need (1); o.outdir = argv[++i]; }
+        else if (a == "-j") { need (1); o.jobs = std::max (1, std::atoi (argv[++i])); }
+        else if (a == "-s") { need (2); o.width = std::atoi (argv[++i]); o.height = std::atoi (argv[++i]); }
+        else if (a == "-r") {
+            need (2);
+            o.fixed_range = true;
+            o.range_min = std::atof (argv[++i]);
+            o.range_max = std::atof (argv[++i]);
+        }
+        else if (a == "-z") { need (1); o.zscale = std::atof (argv[++i]); }
+        else if (a == "-p") { need (1); o.prefix = argv[++i]; }
+        else if (a == "-m") { need (1); o.samples = std::max (0, std::atoi (argv[++i])); }
+        else if (!a.empty() && a[0] == '-') {
+            std::cerr << "Unknown option " << a << std::endl;
+            return 1;
+        }
+        else { o.logdirs.push_back (a); }
+    }
+    if (o.logdirs.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-d /dataset]... [-o outdir] [-j jobs] [-s width height]"
+                  << " [-r min max] [-z zscale] [-p prefix] [-m samples] logdir [logdir...]\n";
+        return 1;
+    }
+    if (o.datasets.empty()) { o.datasets.push_back ("/A"); }
+    if (o.width <= 0 || o.height <= 0) {
+        std::cerr << "Bad image size\n";
+        return 1;
+    }
+    if (!o.outdir.empty()) { morph::Tools::createDirIf (o.outdir); }
+
+    std::vector<frame_job> frames = find_frames (o);
+    if (frames.empty()) {
+        std::cerr << "No " << o.prefix << "*.h5 frames found\n";
+        return 1;
+    }
+    const unsigned int n_workers = std::min (o.jobs, static_cast<unsigned int>(frames.size()));
+    std::cout << "Rendering " << frames.size() << " frames from " << o.logdirs.size() << " run"
+              << (o.logdirs.size() > 1 ? "s" : "") << " with " << n_workers << " worker"
+              << (n_workers > 1 ? "s" : "") << std::endl;
+
+    if (n_workers == 1) { return render_frames (o, frames, 0, 1) > 0 ? 1 : 0; }
+
+    // The workers are processes, so that each has its own GL context, fonts and resources. Each
+    // already has a core to itself, so ask Mesa's llvmpipe not to start its own threads too.
+    setenv ("LP_NUM_THREADS", "1", 0);
+    std::vector<pid_t> pids;
+    for (unsigned int w = 0; w < n_workers; ++w) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "fork failed\n";
+            break;
+        }
+        if (pid == 0) {
+            int failures = 1;
+            try {
+                failures = render_frames (o, frames, w, n_workers);
+            } catch (const std::exception& e) {
+                std::cerr << "Worker " << w << ": " << e.what() << std::endl;
+            }
+            _exit (failures > 0 ? 1 : 0);
+        }
+        pids.push_back (pid);
+    }
+    int rtn = pids.size() == n_workers ? 0 : 1;
+    for (auto pid : pids) {
+        int status = 0;
+        waitpid (pid, &status, 0);
+        if (!WIFEXITED (status) || WEXITSTATUS (status) != 0) { rtn = 1; }
+    }
+    return rtn;
+}
@@ -7,6 +7,8 @@
 #include <vector>
 #include <array>
 #include <sstream>
+#include <string>
+#include <stdexcept>
 #include <morph/RD_Base.h>
 #include <morph/HdfData.h>
 
@@ -45,6 +47,12 @@ public:
     alignas(Flt) Flt D_A = 0.1;
     alignas(Flt) Flt D_B = 0.1;
 
+    /*!
+     * Working space for the laplacians in derivative(), which is called several times
+     * per step
+     */
+    std::vector<Flt> lap;
+
     /*!
      * Simple constructor; no arguments. Simply call RD_Base constructor.
      */
@@ -67,6 +75,10 @@ public:
         // a member of this class (via its parent, RD_Base)
         this->resize_vector_variable (this->A);
         this->resize_vector_variable (this->B);
+        this->resize_vector_variable (this->lap);
+        // A and B are the state of the model, to be saved in checkpoints
+        this->register_checkpoint ("/A", this->A);
+        this->register_checkpoint ("/B", this->B);
     }
 
     /*!
@@ -130,11 +142,62 @@ public:
         }
     }
 
+    /*!
+     * The reaction terms of A and B (y[0] and y[1]), for step_imex
+     */
+    void reaction (const std::vector<std::vector<Flt>>& y, std::vector<std::vector<Flt>>& R)
+    {
+#pragma omp parallel for
+        for (unsigned int h=0; h<this->nhex; ++h) {
+            const Flt a2b = this->k3 * y[0][h] * y[0][h] * y[1][h];
+            R[0][h] = this->k1 - (this->k2 * y[0][h]) + a2b;
+            R[1][h] = this->k4 - a2b;
+        }
+    }
+
+    /*!
+     * The time derivatives of A and B (y[0] and y[1]), for step_adaptive
+     */
+    void derivative (const std::vector<std::vector<Flt>>& y, std::vector<std::vector<Flt>>& dydt)
+    {
+        this->reaction (y, dydt);
+        this->compute_laplace (y[0], this->lap);
+#pragma omp parallel for
+        for (unsigned int h=0; h<this->nhex; ++h) { dydt[0][h] += this->D_A * this->lap[h]; }
+        this->compute_laplace (y[1], this->lap);
+#pragma omp parallel for
+        for (unsigned int h=0; h<this->nhex; ++h) { dydt[1][h] += this->D_B * this->lap[h]; }
+    }
+
+    /*!
+     * The time stepping method. "rk4" is 4th order Runge-Kutta with a fixed dt; "rk45"
+     * chooses dt at each step to keep the error within the tolerances (see
+     * RD_Base::step_adaptive); "imex" treats diffusion implicitly, so that much larger
+     * steps are stable (see RD_Base::step_imex).
+     */
+    std::string integrator = "rk4";
+
     /*!
      * Simulate one timestep of the model
      */
     void step()
     {
+        if (this->integrator == "rk45") {
+            this->stepCount++;
+            this->step_adaptive ({ &this->A, &this->B },
+                                 [this](const std::vector<std::vector<Flt>>& y, std::vector<std::vector<Flt>>& dydt)
+                                 { this->derivative (y, dydt); });
+            return;
+        } else if (this->integrator == "imex") {
+            this->stepCount++;
+            this->step_imex ({ &this->A, &this->B }, { this->D_A, this->D_B },
+                             [this](const std::vector<std::vector<Flt>>& y, std::vector<std::vector<Flt>>& R)
+                             { this->reaction (y, R); });
+            return;
+        } else if (this->integrator != "rk4") {
+            throw std::runtime_error ("RD_Schnakenberg: Unknown integrator '" + this->integrator + "'");
+        }
+
         this->stepCount++;
 
         // 1. 4th order Runge-Kutta computation for A
@@ -0,0 +1,297 @@
+/*!
+ * A morphologica example; an ensemble of 2D Schnakenberg Reaction Diffusion systems that
+ * share one HexGrid, for parameter sweeps. Each member has its own parameters. The members
+ * are computed together, with the ensemble as the innermost dimension of the variables (see
+ * RD_Base::ensemble_size). Members that converge (or blow up) are dropped from the ensemble,
+ * so that the remaining members run faster.
+ */
+
+#include <vector>
+#include <array>
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <morph/RD_Base.h>
+#include <morph/HdfData.h>
+
+template <class Flt>
+class RD_SchnakenbergEnsemble : public morph::RD_Base<Flt>
+{
+public:
+    //! Reactants A and B, for all of the live members; ensemble variables
+    std::vector<Flt> A;
+    std::vector<Flt> B;
+
+    /*
+     * Schnakenberg parameters, one per live member
+     * F = k1 - k2 A + k3 A^2 B
+     * G = k4        - k3 A^2 B
+     */
+    std::vector<Flt> k1;
+    std::vector<Flt> k2;
+    std::vector<Flt> k3;
+    std::vector<Flt> k4;
+
+    //! The diffusion parameters, one per live member
+    std::vector<Flt> D_A;
+    std::vector<Flt> D_B;
+
+    /*!
+     * Early termination. Every check_every steps, the largest rate of change of A over all
+     * the hexes is found for each member. A member whose rate is below converge_rate (or is
+     * not finite) is finished and is dropped from the ensemble. Set check_every to 0 to run
+     * all the members for every step.
+     */
+    unsigned int check_every = 1000;
+    Flt converge_rate = Flt{1e-4};
+
+    //! The original (sweep) index of each live member
+    std::vector<unsigned int> member_id;
+
+    //! The results for each original member, filled when it finishes (or by finish_all())
+    std::vector<std::vector<Flt>> A_final;
+    std::vector<std::vector<Flt>> B_final;
+    //! The step on which each original member finished. 0 if it has not finished.
+    std::vector<unsigned int> finished_at;
+    //! True for the members that finished by blowing up, rather than by converging
+    std::vector<bool> diverged;
+
+    RD_SchnakenbergEnsemble() : morph::RD_Base<Flt>() {}
+    ~RD_SchnakenbergEnsemble() {}
+
+    /*!
+     * Perform memory allocations, vector resizes and so on. Set ensemble_size first. The
+     * per-member parameters are set to the single-model defaults; change them after
+     * allocate() and before init().
+     */
+    void allocate()
+    {
+        morph::RD_Base<Flt>::allocate();
+        this->resize_ensemble_variable (this->A);
+        this->resize_ensemble_variable (this->B);
+        for (auto p : { &this->k1, &this->k2, &this->k3, &this->k4 }) { p->assign (this->ensemble_size, Flt{1}); }
+        this->D_A.assign (this->ensemble_size, Flt{0.1});
+        this->D_B.assign (this->ensemble_size, Flt{0.1});
+
+        this->member_id.resize (this->ensemble_size);
+        for (unsigned int m = 0; m < this->ensemble_size; ++m) { this->member_id[m] = m; }
+        this->A_final.assign (this->ensemble_size, std::vector<Flt>());
+        this->B_final.assign (this->ensemble_size, std::vector<Flt>());
+        this->finished_at.assign (this->ensemble_size, 0);
+        this->diverged.assign (this->ensemble_size, false);
+
+        this->resize_scratch();
+    }
+
+    //! Initialise A and B with noise
+    void init()
+    {
+        this->noiseify_ensemble_variable (this->A, 0.5, 1);
+        this->noiseify_ensemble_variable (this->B, 0.6, 1);
+        this->A_check = this->A;
+    }
+
+    //! The number of members that are still running
+    unsigned int live() const { return this->ensemble_size; }
+
+    /*!
+     * Save A and B for each original member (or the current state, for a member that is
+     * still running) to dat_NNNNN.h5, as /A_m and /B_m
+     */
+    void save()
+    {
+        std::stringstream fname;
+        fname << this->logpath << "/dat_";
+        fname.width(5);
+        fname.fill('0');
+        fname << this->stepCount << ".h5";
+        morph::HdfData data(fname.str());
+        std::vector<Flt> v;
+        for (unsigned int m = 0; m < this->ensemble_size; ++m) {
+            std::string id = std::to_string (this->member_id[m]);
+            this->get_ensemble_member (this->A, m, v);
+            data.add_contained_vals (("/A_" + id).c_str(), v);
+            this->get_ensemble_member (this->B, m, v);
+            data.add_contained_vals (("/B_" + id).c_str(), v);
+        }
+        for (unsigned int i = 0; i < this->finished_at.size(); ++i) {
+            if (this->finished_at[i] == 0) { continue; }
+            std::string id = std::to_string (i);
+            data.add_contained_vals (("/A_" + id).c_str(), this->A_final[i]);
+            data.add_contained_vals (("/B_" + id).c_str(), this->B_final[i]);
+        }
+    }
+
+    /*!
+     * Schnakenberg computation for reagent A at Hex h, for all the members. A_ is the
+     * ensemble variable at the current Runge-Kutta test point and lapA its laplacian at h.
+     */
+    void compute_dAdt (unsigned int h, const Flt* A_, const Flt* lapA, Flt* dAdt) const
+    {
+        const unsigned int E = this->ensemble_size;
+        const unsigned int o = h * E;
+#pragma omp simd
+        for (unsigned int m = 0; m < E; ++m) {
+            dAdt[m] = this->k1[m] - (this->k2[m] * A_[o+m])
+            + (this->k3[m] * A_[o+m] * A_[o+m] * this->B[o+m]) + this->D_A[m] * lapA[m];
+        }
+    }
+
+    //! Schnakenberg computation for reagent B at Hex h, for all the members
+    void compute_dBdt (unsigned int h, const Flt* B_, const Flt* lapB, Flt* dBdt) const
+    {
+        const unsigned int E = this->ensemble_size;
+        const unsigned int o = h * E;
+#pragma omp simd
+        for (unsigned int m = 0; m < E; ++m) {
+            dBdt[m] = this->k4[m] - (this->k3[m] * this->A[o+m] * this->A[o+m] * B_[o+m]) + this->D_B[m] * lapB[m];
+        }
+    }
+
+    /*!
+     * Simulate one timestep of all the live members. This is the same 4th order
+     * Runge-Kutta scheme as RD_Schnakenberg::step (A is stepped, then B), so each member
+     * follows the trajectory that it would have followed on its own.
+     */
+    void step()
+    {
+        if (this->ensemble_size == 0) { return; }
+        this->stepCount++;
+        this->rk4 (this->A, [this](unsigned int h, const Flt* X, const Flt* lap, Flt* dXdt) { this->compute_dAdt (h, X, lap, dXdt); });
+        this->rk4 (this->B, [this](unsigned int h, const Flt* X, const Flt* lap, Flt* dXdt) { this->compute_dBdt (h, X, lap, dXdt); });
+        if (this->check_every > 0 && this->stepCount % this->check_every == 0) { this->check_members(); }
+    }
+
+    //! Finish the members that are still running, recording their results as they are now
+    void finish_all()
+    {
+        if (this->ensemble_size == 0) { return; }
+        for (unsigned int m = 0; m < this->ensemble_size; ++m) { this->record (m, false); }
+        this->drop_members (std::vector<unsigned int>());
+    }
+
+private:
+    /*!
+     * Scratch space for the Runge-Kutta stages: two test points (each stage reads one and
+     * writes the other) and the weighted sum of the stages' increments
+     */
+    std::array<std::vector<Flt>, 2> Xtst;
+    std::vector<Flt> Ksum;
+    //! A at the last check for convergence
+    std::vector<Flt> A_check;
+
+    void resize_scratch()
+    {
+        for (auto p : { &this->Xtst[0], &this->Xtst[1], &this->Ksum }) { this->resize_ensemble_variable (*p); }
+    }
+
+    /*!
+     * Runge-Kutta step of the variable X. Each stage is a single pass over the grid which
+     * computes the laplacian and the reaction terms at a hex (for all the members), then
+     * the stage's increment and the next test point. The ensemble's variables are too
+     * large to stay in cache from one pass to the next, so this is much faster than
+     * computing the laplacian, the derivative and the increments in separate passes.
+     */
+    template <typename F>
+    void rk4 (std::vector<Flt>& X, F compute_dXdt)
+    {
+        const unsigned int E = this->ensemble_size;
+        // The step to each stage's test point, and the weight of each stage in the sum
+        constexpr Flt tstfac[3] = { Flt{0.5}, Flt{0.5}, Flt{1} };
+        constexpr Flt weight[3] = { Flt{1}, Flt{2}, Flt{2} };
+
+        const Flt* Xin = X.data();
+        for (unsigned int s = 0; s < 4; ++s) {
+            Flt* Xout = this->Xtst[s % 2].data();
+#pragma omp parallel
+            {
+                std::vector<Flt> lap (E);
+                std::vector<Flt> dXdt (E);
+#pragma omp for
+                for (unsigned int h=0; h<this->nhex; ++h) {
+                    this->compute_laplace_ensemble (Xin, h, lap.data());
+                    compute_dXdt (h, Xin, lap.data(), dXdt.data());
+                    const unsigned int o = h * E;
+                    Flt* x = X.data() + o;
+                    Flt* ks = this->Ksum.data() + o;
+                    Flt* xo = Xout + o;
+                    if (s == 0) {
+#pragma omp simd
+                        for (unsigned int m = 0; m < E; ++m) {
+                            Flt K = dXdt[m] * this->dt;
+                            ks[m] = K;
+                            xo[m] = x[m] + K * tstfac[0];
+                        }
+                    } else if (s < 3) {
+#pragma omp simd
+                        for (unsigned int m = 0; m < E; ++m) {
+                            Flt K = dXdt[m] * this->dt;
+                            ks[m] += weight[s] * K;
+                            xo[m] = x[m] + K * tstfac[s];
+                        }
+                    } else {
+                        // The last stage reads X only at h, so X can be updated in place
+#pragma omp simd
+                        for (unsigned int m = 0; m < E; ++m) {
+                            x[m] += (ks[m] + dXdt[m] * this->dt) / Flt{6};
+                        }
+                    }
+                }
+            }
+            Xin = Xout;
+        }
+    }
+
+    //! Copy member m's state into the results for its original index
+    void record (unsigned int m, bool blew_up)
+    {
+        const unsigned int id = this->member_id[m];
+        this->get_ensemble_member (this->A, m, this->A_final[id]);
+        this->get_ensemble_member (this->B, m, this->B_final[id]);
+        this->finished_at[id] = this->stepCount;
+        this->diverged[id] = blew_up;
+    }
+
+    //! Find the members that have converged or blown up, record them and drop them
+    void check_members()
+    {
+        const unsigned int E = this->ensemble_size;
+        std::vector<Flt> maxrate (E, Flt{0});
+        for (unsigned int h = 0; h < this->nhex; ++h) {
+            const unsigned int o = h * E;
+            for (unsigned int m = 0; m < E; ++m) {
+                Flt r = std::abs (this->A[o+m] - this->A_check[o+m]);
+                // Written so that a NaN is carried into maxrate
+                maxrate[m] = (r <= maxrate[m]) ? maxrate[m] : r;
+            }
+        }
+        const Flt interval = this->dt * this->check_every;
+        std::vector<unsigned int> keep;
+        for (unsigned int m = 0; m < E; ++m) {
+            Flt rate = maxrate[m] / interval;
+            if (!std::isfinite (rate)) {
+                this->record (m, true);
+            } else if (rate < this->converge_rate) {
+                this->record (m, false);
+            } else {
+                keep.push_back (m);
+            }
+        }
+
+        if (keep.size() < E) { this->drop_members (keep); }
+        this->A_check = this->A;
+    }
+
+    //! Drop all the members that are not in keep
+    void drop_members (const std::vector<unsigned int>& keep)
+    {
+        for (auto p : { &this->A, &this->B, &this->A_check, &this->k1, &this->k2, &this->k3, &this->k4, &this->D_A, &this->D_B }) {
+            this->compact_ensemble_variable (*p, keep);
+        }
+        std::vector<unsigned int> live_ids;
+        for (auto m : keep) { live_ids.push_back (this->member_id[m]); }
+        this->member_id.swap (live_ids);
+        this->ensemble_size = keep.size();
+        this->resize_scratch();
+    }
+}; // RD_SchnakenbergEnsemble
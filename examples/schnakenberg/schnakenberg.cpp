@@ -94,7 +94,9 @@ using std::chrono::steady_clock;
  * main(): Run a simulation, using parameters obtained from a JSON file.
  *
  * The path to this JSON file is the only argument required for the program. An
- * example JSON file is provided with this example (see schnak.json).
+ * example JSON file is provided with this example (see schnak.json). Parameters in the
+ * JSON may be overridden with further arguments of the form -co:name=value, which may
+ * follow an optional log path as the second argument.
  */
 int main (int argc, char **argv)
 {
@@ -112,6 +114,9 @@ int main (int argc, char **argv)
         cerr << "Error setting up JSON config: " << conf.emsg << endl;
         return 1;
     }
+    // Apply any command line overrides of the parameters (-co:name=value), as used by
+    // morph::Sweep (see examples/sweep.cpp)
+    conf.process_args (argc, argv);
 
     /*
      * Get simulation-wide parameters from JSON
@@ -143,7 +148,7 @@ int main (int argc, char **argv)
         }
         logpath = logbase + justfile;
     }
-    if (argc == 3) {
+    if (argc >= 3 && string(argv[2]).find ("-co:") != 0) {
         string argpath(argv[2]);
         cerr << "Overriding the config-given logpath " << logpath << " with " << argpath << endl;
         logpath = argpath;
@@ -231,6 +236,11 @@ int main (int argc, char **argv)
     RD.D_A = conf.getDouble ("D_A", 0.1);
     RD.D_B = conf.getDouble ("D_B", 0.1);
 
+    // The time stepping method: rk4, rk45 (adaptive dt, starting at dt) or imex
+    RD.integrator = conf.getString ("integrator", "rk4");
+    RD.abs_tol = conf.getDouble ("abs_tol", 1e-6);
+    RD.rel_tol = conf.getDouble ("rel_tol", 1e-4);
+
     // Now parameters are set, call init(), which in this example simply initializes A
     // and B with noise.
     RD.init();
@@ -263,6 +273,15 @@ int main (int argc, char **argv)
     // ready), positions can be saved to an HDF5 file:
     RD.savePositions();
 
+    // Checkpoint the model every checkpointevery steps (never, if 0). With "restart" set to
+    // true, continue from the last checkpoint in logpath, if there is one.
+    const unsigned int checkpointevery = conf.getUInt ("checkpointevery", 0UL);
+    const string checkpointpath = logpath + "/checkpoint.ckp";
+    if (conf.getBool ("restart", false) && Tools::fileExists (checkpointpath)) {
+        RD.restore_checkpoint (checkpointpath);
+        cout << "Restarting from step " << RD.stepCount << endl;
+    }
+
 #ifdef COMPILE_PLOTTING
     // Before starting the simulation, create the HexGridVisuals.
 
@@ -346,12 +365,28 @@ int main (int argc, char **argv)
         if ((RD.stepCount % logevery) == 0) {
             RD.save();
         }
+        if (checkpointevery > 0 && (RD.stepCount % checkpointevery) == 0) {
+            RD.checkpoint (checkpointpath);
+        }
 
         if (RD.stepCount > steps) {
             finished = true;
         }
     }
 
+    // Let the last checkpoint finish writing
+    RD.checkpoint_wait();
+
+    if (RD.integrator != "rk4") {
+        cout << "Simulated time " << RD.sim_time << " in " << RD.stats.accepted << " steps ("
+             << RD.stats.rejected << " rejected); dt from " << RD.stats.dt_min << " to " << RD.stats.dt_max << endl;
+        if (RD.stats.cg_solves > 0) {
+            cout << "Conjugate gradient solves: " << RD.stats.cg_solves << ", mean iterations "
+                 << static_cast<double>(RD.stats.cg_iterations) / RD.stats.cg_solves
+                 << ", max iterations " << RD.stats.cg_iterations_max << endl;
+        }
+    }
+
     // Before saving the json, we'll place any additional useful info
     // in there, such as the FLT. If float_width is 4, then
     // results were computed with single precision, if 8, then double
@@ -367,6 +402,8 @@ int main (int argc, char **argv)
     conf.set ("k3", RD.k3);
     conf.set ("k4", RD.k4);
     conf.set ("dt", RD.get_dt());
+    conf.set ("integrator", RD.integrator);
+    if (RD.integrator != "rk4") { conf.set ("sim_time", RD.sim_time); }
     // Store the binary name and command argument into root, too.
     if (argc > 0) { conf.set("argv0", argv[0]); }
     if (argc > 1) { conf.set("argv1", argv[1]); }
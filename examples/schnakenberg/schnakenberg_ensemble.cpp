@@ -0,0 +1,163 @@
+/*
+ * A morphologica example: A parameter sweep of the Schnakenberg RD system, run as one
+ * ensemble on a single HexGrid (see rd_schnakenberg_ensemble.h). k4 is swept across the
+ * members of the ensemble; the other parameters come from the JSON file as for the
+ * schnakenberg example.
+ *
+ * To compare the throughput of the ensemble with that of separate runs, the first n_separate
+ * members are also run on their own with RD_Schnakenberg, and the time per member per step
+ * for each is reported.
+ *
+ * Usage: schnakenberg_ensemble /path/to/params.json
+ */
+
+#ifndef FLT
+# error "Please define FLT when compiling (hint: See CMakeLists.txt)"
+#endif
+
+#include "rd_schnakenberg.h"
+#include "rd_schnakenberg_ensemble.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <morph/tools.h>
+#include <morph/Config.h>
+#include <morph/HdfData.h>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+// Apply the config's grid settings to either model
+template <typename M>
+void setup_grid (M& RD, const morph::Config& conf)
+{
+    RD.svgpath = conf.getString ("svgpath", "");
+    RD.ellipse_a = conf.getDouble ("ellipse_a", 0.8);
+    RD.ellipse_b = conf.getDouble ("ellipse_b", 0.6);
+    RD.hextohex_d = conf.getFloat ("hextohex_d", 0.01f);
+    RD.hexspan = conf.getFloat ("hexspan", 4.0f);
+    RD.boundaryFalloffDist = conf.getFloat ("boundaryFalloffDist", 0.01f);
+}
+
+int main (int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " /path/to/params.json" << std::endl;
+        return 1;
+    }
+    morph::Config conf(argv[1]);
+    if (!conf.ready) {
+        std::cerr << "Error setting up JSON config: " << conf.emsg << std::endl;
+        return 1;
+    }
+
+    const unsigned int steps = conf.getUInt ("steps", 1000UL);
+    const unsigned int n_members = std::max (1U, conf.getUInt ("ensemble_size", 64UL));
+    const unsigned int n_separate = std::min (n_members, conf.getUInt ("n_separate", 4UL));
+    const FLT dt = static_cast<FLT>(conf.getDouble ("dt", 0.00001));
+    const FLT k4_min = static_cast<FLT>(conf.getDouble ("k4_min", 1.0));
+    const FLT k4_max = static_cast<FLT>(conf.getDouble ("k4_max", 2.0));
+    const std::string logpath = conf.getString ("logpath", "logs/schnakenberg_ensemble");
+    auto k4_of = [&](unsigned int m) {
+        return n_members > 1 ? k4_min + (k4_max - k4_min) * m / (n_members - 1) : k4_min;
+    };
+
+    // The ensemble
+    auto t0 = steady_clock::now();
+    RD_SchnakenbergEnsemble<FLT> RD;
+    setup_grid (RD, conf);
+    RD.ensemble_size = n_members;
+    RD.allocate();
+    RD.set_dt (dt);
+    RD.check_every = conf.getUInt ("check_every", 1000UL);
+    RD.converge_rate = static_cast<FLT>(conf.getDouble ("converge_rate", 1e-4));
+    for (unsigned int m = 0; m < n_members; ++m) {
+        RD.k1[m] = conf.getDouble ("k1", 1);
+        RD.k2[m] = conf.getDouble ("k2", 1);
+        RD.k3[m] = conf.getDouble ("k3", 1);
+        RD.k4[m] = k4_of (m);
+        RD.D_A[m] = conf.getDouble ("D_A", 0.1);
+        RD.D_B[m] = conf.getDouble ("D_B", 0.1);
+    }
+    RD.init();
+    auto t1 = steady_clock::now();
+    // Count the member-steps actually computed, as members may finish early
+    unsigned long long member_steps = 0;
+    while (RD.stepCount < steps && RD.live() > 0) {
+        member_steps += RD.live();
+        RD.step();
+    }
+    auto t2 = steady_clock::now();
+    RD.finish_all();
+    const double ens_setup = duration<double>(t1 - t0).count();
+    const double ens_run = duration<double>(t2 - t1).count();
+
+    std::cout << "Ensemble of " << n_members << " on " << RD.nhex << " hexes: setup "
+              << ens_setup << " s, " << member_steps << " member-steps in " << ens_run << " s ("
+              << 1e9 * ens_run / member_steps << " ns per member-step, "
+              << 1e9 * ens_run / (member_steps * RD.nhex) << " ns per member-step-hex)\n";
+    unsigned int n_early = 0;
+    for (unsigned int m = 0; m < n_members; ++m) {
+        if (RD.finished_at[m] < steps) {
+            ++n_early;
+            std::cout << "  member " << m << " (k4 = " << k4_of (m) << ") "
+                      << (RD.diverged[m] ? "blew up" : "converged") << " at step " << RD.finished_at[m] << "\n";
+        }
+    }
+    std::cout << n_early << " of " << n_members << " members finished early\n";
+
+    // Separate runs of the first n_separate members, one after another, as separate
+    // processes would run them.
+    double sep_setup = 0.0;
+    double sep_run = 0.0;
+    unsigned long long sep_steps = 0;
+    for (unsigned int m = 0; m < n_separate; ++m) {
+        auto s0 = steady_clock::now();
+        RD_Schnakenberg<FLT> RD1;
+        setup_grid (RD1, conf);
+        RD1.allocate();
+        RD1.set_dt (dt);
+        RD1.k1 = conf.getDouble ("k1", 1);
+        RD1.k2 = conf.getDouble ("k2", 1);
+        RD1.k3 = conf.getDouble ("k3", 1);
+        RD1.k4 = k4_of (m);
+        RD1.D_A = conf.getDouble ("D_A", 0.1);
+        RD1.D_B = conf.getDouble ("D_B", 0.1);
+        RD1.init();
+        auto s1 = steady_clock::now();
+        // Run for as many steps as the member ran in the ensemble
+        while (RD1.stepCount < RD.finished_at[m]) { RD1.step(); }
+        auto s2 = steady_clock::now();
+        sep_setup += duration<double>(s1 - s0).count();
+        sep_run += duration<double>(s2 - s1).count();
+        sep_steps += RD1.stepCount;
+    }
+    if (sep_steps > 0) {
+        const double ens_ns = 1e9 * ens_run / member_steps;
+        const double sep_ns = 1e9 * sep_run / sep_steps;
+        std::cout << n_separate << " separate runs: setup " << sep_setup / n_separate << " s each, "
+                  << sep_ns << " ns per member-step\n";
+        std::cout << "The ensemble is " << sep_ns / ens_ns << " times faster per member-step\n";
+    }
+
+    // Save the final state of every member, with its parameters
+    morph::Tools::createDirIf (logpath);
+    RD.logpath = logpath;
+    RD.savePositions();
+    morph::HdfData data (logpath + "/ensemble.h5");
+    std::vector<FLT> k4s;
+    for (unsigned int m = 0; m < n_members; ++m) {
+        const std::string id = std::to_string (m);
+        data.add_contained_vals (("/A_" + id).c_str(), RD.A_final[m]);
+        data.add_contained_vals (("/B_" + id).c_str(), RD.B_final[m]);
+        k4s.push_back (k4_of (m));
+    }
+    data.add_contained_vals ("/k4", k4s);
+    data.add_contained_vals ("/finished_at", RD.finished_at);
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Run a parameter sweep of a simulation program, described by a JSON file, with
+ * morph::Sweep. The runs execute concurrently, each pinned to its own cores, and a manifest
+ * of the runs is written to the sweep's output directory.
+ *
+ * Settings in the sweep file can be overridden on the command line. For example, to run the
+ * Schnakenberg sweep with two cores for each run, from the build directory:
+ *
+ *   ./examples/sweep ../examples/schnakenberg/schnakenberg_sweep.json -co:threads_per_run=2
+ *
+ * Usage: sweep /path/to/sweep.json [-co:setting=value ...]
+ */
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <morph/Config.h>
+#include <morph/Sweep.h>
+
+int main (int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " /path/to/sweep.json [-co:setting=value ...]" << std::endl;
+        return 1;
+    }
+    morph::Config conf (argv[1]);
+    if (!conf.ready) {
+        std::cerr << "Error reading the sweep file " << argv[1] << std::endl;
+        return 1;
+    }
+    conf.process_args (argc, argv);
+
+    try {
+        morph::Sweep sweep (conf);
+        std::cout << "Sweep of " << sweep.runs.size() << " runs of " << sweep.program
+                  << ", " << sweep.threads_per_run << " core(s) each\n";
+        // Report each run as it finishes. Set "echo" to true in the sweep file to see
+        // the output of the runs, too.
+        sweep.on_finished = [](const morph::SweepRun& r) {
+            std::cout << "Run " << r.index << ": " << r.status << " after " << r.attempts << " attempt(s), "
+                      << r.attempt_seconds.back() << " s. Results in " << r.result_path << std::endl;
+        };
+        const unsigned int n_failed = sweep.run();
+        std::cout << n_failed << " of " << sweep.runs.size() << " runs failed. See "
+                  << sweep.manifest << std::endl;
+        return n_failed > 0 ? 2 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
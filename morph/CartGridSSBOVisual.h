@@ -0,0 +1,309 @@
+/*!
+ * \file
+ *
+ * A visual model of scalar data over a CartGrid where the data are not on the CPU at all, but
+ * in a GPU buffer, such as a Shader Storage Buffer Object that a compute shader writes.
+ *
+ * The buffer is bound directly as the vertex attribute of the model's vertices (one vertex for
+ * each CartGrid element, triangulated as in CartGridVisual's Triangles mode), and the data are
+ * converted to colours (and, optionally, to z positions) in the vertex shader, with the colour
+ * map sampled from a lookup texture. The vertex positions and indices are uploaded once; after
+ * that, drawing a new frame of a compute shader's results costs no CPU work and no copies.
+ *
+ *   morph::CartGrid cg (0.01f, 0.01f, 1.0f, 1.0f);
+ *   cg.setBoundaryOnOuterEdge();
+ *   auto gv = std::make_unique<morph::CartGridSSBOVisual<morph::gl::version_4_5>>(&cg, offset);
+ *   v.bindmodel (gv);
+ *   gv->setBuffer (my_ssbo_name); // Element i of the buffer is element i of cg
+ *   gv->colourScale.compute_autoscale (0.0f, 1.0f);
+ *   gv->finalize();
+ *   v.addVisualModel (gv);
+ *
+ * The buffer must hold at least cg.num() floats (after the offset) and the commands that
+ * write it must be followed by glMemoryBarrier (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT) (which
+ * compute_shaderprog::dispatch does). As the data are never seen on the CPU, colourScale and
+ * zScale cannot autoscale. Set them (or call their compute_autoscale() with the range found by
+ * morph::gl::reduce::minmax()) before rendering. Linear and logarithmic scales are supported.
+ * Colour maps that take a single datum are supported; RainbowZeroBlack and RainbowZeroWhite
+ * render as Rainbow.
+ */
+
+#pragma once
+
+#ifndef USE_GLEW
+#ifdef __OSX__
+# include <OpenGL/gl3.h>
+#else
+# include <GL3/gl3.h>
+#endif
+#endif
+#include <morph/VisualDataModel.h>
+#include <morph/ColourMap.h>
+#include <morph/CartGrid.h>
+#include <morph/Scale.h>
+#include <morph/vec.h>
+#include <morph/gl/version.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/uniforms.h>
+#include <morph/gl/util.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace morph {
+
+    //! Visualize the scalar data in a GPU buffer over a CartGrid. See the file comment.
+    template <int glver = morph::gl::version_4_1>
+    class CartGridSSBOVisual : public VisualDataModel<float, glver>
+    {
+    public:
+        CartGridSSBOVisual (const CartGrid* _cg, const vec<float> _offset)
+        {
+            this->mv_offset = _offset;
+            this->viewmatrix.translate (this->mv_offset);
+            // Flat, with data in [0, 1] spanning the colour map, unless the client says otherwise
+            this->zScale.setParams (0.0f, 0.0f);
+            this->colourScale.setParams (1.0f, 0.0f);
+            this->cg = _cg;
+            // This model never uploads colours, so the layout must keep attributes separate
+            this->layout = VisualModel<glver>::vertex_layout::separate;
+        }
+
+        ~CartGridSSBOVisual()
+        {
+            if (this->lut_texture) { glDeleteTextures (1, &this->lut_texture); }
+            if (this->prog) { glDeleteProgram (this->prog); }
+        }
+
+        /*!
+         * Show the data in the buffer named buffer_name. Element i of the CartGrid is shown
+         * with the float at index offset + i of the buffer. The buffer is not owned by this
+         * model. Changing the buffer does not need reinit().
+         */
+        void setBuffer (const GLuint buffer_name, const std::size_t offset = 0)
+        {
+            this->buffer = buffer_name;
+            this->buffer_offset = offset;
+        }
+
+        //! The number of entries in the colour map lookup texture
+        unsigned int lut_size = 256;
+
+        //! Make the vertices at the centre of each CartGrid element, and the triangles
+        //! between them. Only the positions are uploaded; colours and normals come from the
+        //! shaders.
+        void initializeVertices()
+        {
+            this->idx = 0;
+            const unsigned int nrect = this->cg->num();
+            this->vertexPositions.reserve (3 * nrect);
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                this->vertex_push (this->cg->d_x[ri], this->cg->d_y[ri], 0.0f, this->vertexPositions);
+            }
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                if (this->cg->d_nne[ri] != -1 && this->cg->d_ne[ri] != -1) {
+                    this->indices.insert (this->indices.end(), { ri, GLuint(this->cg->d_nne[ri]), GLuint(this->cg->d_ne[ri]) });
+                }
+                if (this->cg->d_nw[ri] != -1 && this->cg->d_nsw[ri] != -1) {
+                    this->indices.insert (this->indices.end(), { ri, GLuint(this->cg->d_nw[ri]), GLuint(this->cg->d_nsw[ri]) });
+                }
+            }
+            this->idx += nrect;
+        }
+
+        //! Render with this model's own shader program, taking the data from the buffer
+        void render()
+        {
+            if (this->hide == true) { return; }
+            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            if (this->prog == 0) { this->init_program(); }
+            this->update_lut();
+
+            if (!this->indices.empty() && this->buffer != 0) {
+                glUseProgram (this->prog);
+                glBindVertexArray (this->vao);
+
+                // The data attribute comes straight from the buffer. This is set on every
+                // render, as the buffer may have changed, and as the base class's buffer
+                // set up (after a reinit) points the attribute at its (empty) colour buffer.
+                glBindBuffer (GL_ARRAY_BUFFER, this->buffer);
+                glVertexAttribPointer (visgl::colLoc, 1, GL_FLOAT, GL_FALSE, 0,
+                                       reinterpret_cast<void*>(this->buffer_offset * sizeof(float)));
+                glEnableVertexAttribArray (visgl::colLoc);
+                glDisableVertexAttribArray (visgl::normLoc);
+                glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+                this->ssbo_uniforms.use (this->prog);
+                auto& u = this->ssbo_uniforms;
+                if (u[u_alpha] != -1) { glUniform1f (u[u_alpha], this->alpha); }
+                if (u[u_v_matrix] != -1) { glUniformMatrix4fv (u[u_v_matrix], 1, GL_FALSE, this->scenematrix.mat.data()); }
+                if (u[u_m_matrix] != -1) {
+                    glUniformMatrix4fv (u[u_m_matrix], 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+                }
+                std::array<float, 2> cs = scale_params (this->colourScale, "colourScale");
+                std::array<float, 2> zs = scale_params (this->zScale, "zScale");
+                if (u[u_cscale] != -1) { glUniform2f (u[u_cscale], cs[0], cs[1]); }
+                if (u[u_zscale] != -1) { glUniform2f (u[u_zscale], zs[0], zs[1]); }
+                if (u[u_scale_log] != -1) {
+                    glUniform2i (u[u_scale_log], this->colourScale.getType() == ScaleFn::Logarithmic ? 1 : 0,
+                                 this->zScale.getType() == ScaleFn::Logarithmic ? 1 : 0);
+                }
+                if (u[u_cmap_lut] != -1) { glUniform1i (u[u_cmap_lut], 0); }
+                glActiveTexture (GL_TEXTURE0);
+                glBindTexture (GL_TEXTURE_2D, this->lut_texture);
+
+                glDrawElements (GL_TRIANGLES, this->indices.size(), this->index_type, 0);
+
+                glBindVertexArray (0);
+                glBindTexture (GL_TEXTURE_2D, 0);
+                // Leave the Visual's program in use for the models that follow
+                if (this->get_gprog) { glUseProgram (this->get_gprog (this->parentVis)); }
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+
+            this->render_texts();
+        }
+
+    protected:
+        //! The CartGrid to visualize
+        const CartGrid* cg;
+
+        //! The name of the buffer holding the data, and the index of the first datum
+        GLuint buffer = 0;
+        std::size_t buffer_offset = 0;
+
+        //! This model's shader program
+        GLuint prog = 0;
+        //! The colour map lookup texture, and the colour map it was made from
+        GLuint lut_texture = 0;
+        ColourMapType lut_type = ColourMapType::Fixed;
+        std::array<float, 3> lut_hsv = { -1.0f, -1.0f, -1.0f };
+        unsigned int lut_built_size = 0;
+
+        enum ssbo_uniform_idx { u_alpha, u_v_matrix, u_m_matrix, u_cscale, u_zscale, u_scale_log, u_cmap_lut };
+        morph::gl::uniform_locations<7> ssbo_uniforms = std::array<const char*, 7>{
+            "alpha", "v_matrix", "m_matrix", "cscale", "zscale", "scale_log", "cmap_lut"
+        };
+
+        //! The linear parameters (m, c) of scale s, which must have been set
+        static std::array<float, 2> scale_params (Scale<float, float>& s, const char* which)
+        {
+            if (!s.ready()) {
+                throw std::runtime_error (std::string("CartGridSSBOVisual: ") + which
+                                          + " can't autoscale data on the GPU; set its params or call compute_autoscale()");
+            }
+            return { s.getParams (0), s.getParams (1) };
+        }
+
+        //! The vertex shader. The data arrive in the colour attribute location.
+        static constexpr const char* vtx_shader = "uniform mat4 m_matrix;\n"
+        "uniform mat4 v_matrix;\n"
+        "uniform float alpha;\n"
+        "uniform sampler2D cmap_lut;\n"
+        "uniform vec2 cscale;\n"  // m, c of the colour scale's linear transform
+        "uniform vec2 zscale;\n"  // m, c of the z scale's
+        "uniform ivec2 scale_log;\n" // Take the log of the datum first (colour, z)?
+        "layout(std140) uniform morph_frame\n"
+        "{\n"
+        "    highp mat4 p_matrix;\n"
+        "    highp vec3 light_colour;\n"
+        "    highp float ambient_intensity;\n"
+        "    highp vec3 diffuse_position;\n"
+        "    highp float diffuse_intensity;\n"
+        "};\n"
+        "layout(location = 0) in vec4 position;\n"
+        "layout(location = 2) in float datum;\n"
+        "out VERTEX\n"
+        "{\n"
+        "    vec4 color;\n"
+        "    vec3 fragpos;\n"
+        "} vertex;\n"
+        "void main()\n"
+        "{\n"
+        "    float dc = scale_log.x != 0 ? log (datum) : datum;\n"
+        "    float dz = scale_log.y != 0 ? log (datum) : datum;\n"
+        "    float t = clamp (cscale.x * dc + cscale.y, 0.0, 1.0);\n"
+        "    float n = float(textureSize (cmap_lut, 0).x);\n"
+        "    vec3 c = texture (cmap_lut, vec2((t * (n - 1.0) + 0.5) / n, 0.5)).rgb;\n"
+        "    vec4 p = vec4(position.xy, position.z + zscale.x * dz + zscale.y, 1.0);\n"
+        "    gl_Position = (p_matrix * v_matrix * m_matrix * p);\n"
+        "    vertex.color = vec4(c, alpha);\n"
+        "    vertex.fragpos = vec3(m_matrix * p);\n"
+        "}\n";
+
+        //! The fragment shader lights each triangle with its own normal, found from the
+        //! derivatives of the fragment position, as there are no vertex normals
+        static constexpr const char* frag_shader = "in VERTEX\n"
+        "{\n"
+        "    vec4 color;\n"
+        "    vec3 fragpos;\n"
+        "} vertex;\n"
+        "layout(std140) uniform morph_frame\n"
+        "{\n"
+        "    highp mat4 p_matrix;\n"
+        "    highp vec3 light_colour;\n"
+        "    highp float ambient_intensity;\n"
+        "    highp vec3 diffuse_position;\n"
+        "    highp float diffuse_intensity;\n"
+        "};\n"
+        "out vec4 finalcolor;\n"
+        "void main()\n"
+        "{\n"
+        "    vec3 norm = normalize (cross (dFdx (vertex.fragpos), dFdy (vertex.fragpos)));\n"
+        "    vec3 light_dirn = normalize (diffuse_position - vertex.fragpos);\n"
+        "    float effective_diffuse = abs (dot (norm, light_dirn));\n"
+        "    vec3 diffuse = diffuse_intensity * effective_diffuse * light_colour;\n"
+        "    vec3 ambient = ambient_intensity * light_colour;\n"
+        "    finalcolor = vec4((ambient + diffuse) * vertex.color.rgb, vertex.color.a);\n"
+        "}\n";
+
+        //! Compile and link the shaders and bind the program's morph_frame block
+        void init_program()
+        {
+            std::string vtx = std::string (morph::gl::version::shaderpreamble (glver)) + vtx_shader;
+            std::string frag = std::string (morph::gl::version::shaderpreamble (glver)) + frag_shader;
+            std::vector<morph::gl::ShaderInfo> shaders = {
+                {GL_VERTEX_SHADER, "", vtx.c_str(), 0 },
+                {GL_FRAGMENT_SHADER, "", frag.c_str(), 0 }
+            };
+            this->prog = morph::gl::LoadShaders (shaders);
+            if (this->prog == 0) { throw std::runtime_error ("CartGridSSBOVisual: failed to build the shader program"); }
+            morph::gl::bind_frame_block (this->prog);
+        }
+
+        //! (Re)make the colour map lookup texture if the colour map has changed
+        void update_lut()
+        {
+            if (this->lut_texture != 0 && this->lut_type == this->cm.getType()
+                && this->lut_hsv == this->cm.getHSV() && this->lut_built_size == this->lut_size) { return; }
+
+            std::vector<std::uint8_t> rgba (4 * this->lut_size, 255);
+            for (unsigned int i = 0; i < this->lut_size; ++i) {
+                float t = this->lut_size > 1 ? static_cast<float>(i) / static_cast<float>(this->lut_size - 1) : 0.0f;
+                std::array<float, 3> c = this->cm.convert (t);
+                for (unsigned int j = 0; j < 3; ++j) {
+                    rgba[4 * i + j] = static_cast<std::uint8_t>(std::round (std::clamp (c[j], 0.0f, 1.0f) * 255.0f));
+                }
+            }
+            if (this->lut_texture == 0) { glGenTextures (1, &this->lut_texture); }
+            glBindTexture (GL_TEXTURE_2D, this->lut_texture);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, this->lut_size, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+            glBindTexture (GL_TEXTURE_2D, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+
+            this->lut_type = this->cm.getType();
+            this->lut_hsv = this->cm.getHSV();
+            this->lut_built_size = this->lut_size;
+        }
+    };
+
+} // namespace morph
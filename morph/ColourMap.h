@@ -900,6 +900,9 @@ namespace morph {
         //! Get the hue, in its most saturated form
         std::array<float, 3> getHueRGB() const { return ColourMap::hsv2rgb (this->hue, 1.0f, 1.0f); }
 
+        //! Get the hue, saturation and value that parameterise the map (as set by setHSV)
+        std::array<float, 3> getHSV() const { return { this->hue, this->sat, this->val }; }
+
         void setHueRotation (const T rotation_rads)
         {
             if (this->type != ColourMapType::HSV) {
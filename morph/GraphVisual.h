@@ -438,7 +438,7 @@ namespace morph {
             ds.markerstyle = morph::markerstyle::bar;
             // How to choose? User sets afterwards?
             ds.showlines = true;
-            ds.markersize = (this->width - this->width*2*this->dataaxisdist) * (h.binwidth / h.range);
+            ds.markersize = (this->width - this->width*2*this->dataaxisdist) * (h.binwidth / (h.binedges.back() - h.binedges.front()));
             ds.linewidth = ds.markersize/10.0;
 
             unsigned int data_index = this->graphDataCoords.size();
@@ -452,6 +452,22 @@ namespace morph {
             this->setdata (h.bins, h.proportions, ds);
         }
 
+        /*!
+         * Redraw the dataset at data_idx (which was set with setdata (histo)) from the
+         * histogram h, which may have had more data added to it since. The axes are not
+         * rescaled, so for a live histogram, either give it a fixed range or set the
+         * abscissa range manually.
+         */
+        void update (const morph::histo<Flt>& h, const unsigned int data_idx)
+        {
+            if (data_idx < this->datastyles.size()) {
+                this->datastyles[data_idx].markersize = (this->width - this->width*2*this->dataaxisdist)
+                * (h.binwidth / (h.binedges.back() - h.binedges.front()));
+                this->datastyles[data_idx].linewidth = this->datastyles[data_idx].markersize/10.0;
+            }
+            this->update (h.bins, h.proportions, data_idx);
+        }
+
         //! Set graph from histogram with pre-configured datasetstyle
         void setdata (const morph::histo<Flt>& h, const DatasetStyle& ds)
         {
@@ -17,6 +17,7 @@
 #include <morph/vec.h>
 #include <morph/vvec.h>
 #include <morph/GridFeatures.h>
+#include <morph/GridFilter.h>
 
 namespace morph {
 
@@ -491,6 +492,22 @@ namespace morph {
             return ordinates;
         }
 
+        /*!
+         * Convolve data (defined on this grid) with the kernel kerneldata (defined on
+         * kernelgrid), writing into result. kernelgrid may be a Grid or a Gridct and must
+         * have the same dx as this grid. The kernel element at coordinate (0,0) is the centre
+         * of the kernel. As for CartGrid::convolve, kerneldata is not flipped, so this is
+         * strictly a correlation. Offset elements beyond the edge of the grid wrap according
+         * to the grid's wrap setting, or contribute nothing. Separable kernels are detected
+         * and applied as two 1D passes. See morph/GridFilter.h.
+         */
+        template <typename T, typename KG>
+        void convolve (const KG& kernelgrid, const morph::vvec<T>& kerneldata,
+                       const morph::vvec<T>& data, morph::vvec<T>& result) const
+        {
+            morph::GridFilter<T>::convolve (*this, kernelgrid, kerneldata, data, result);
+        }
+
         //! Return the row for the index
         I row (const I index) const {
             if (this->rowmaj == true) {
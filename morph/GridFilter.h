@@ -0,0 +1,275 @@
+/*!
+ * \file
+ *
+ * A 2D convolution (strictly, correlation) engine for data laid out on the rectangular grids
+ * morph::Grid and morph::Gridct. This is the code behind Grid::convolve() and
+ * Gridct::convolve().
+ *
+ * The kernel is given on its own (small) grid, just as for CartGrid::convolve. Each kernel
+ * element contributes kerneldata[k] * data[at the element offset by the kernel element's
+ * location] to each element of the result. Where the offset element lies outside the grid,
+ * it either wraps around (if the grid wraps in that direction) or contributes nothing.
+ *
+ * Internally, the kernel is turned into a dense array of memory offsets: 'inner' offsets
+ * along the contiguous axis of the data (x for row-major grids, y for column-major ones)
+ * and 'outer' offsets across it. If that array is rank one (as are Gaussians, boxes and
+ * the derivative-of-Gaussian kernels) it is applied as two 1D passes, costing kw + kh
+ * rather than kw * kh operations per element. All passes work along contiguous memory,
+ * in blocks that fit in cache, and are parallelised over lines with OpenMP.
+ */
+
+#pragma once
+
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <morph/GridFeatures.h>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace morph {
+
+    template <typename T>
+    struct GridFilter
+    {
+        //! The number of elements along a line that are processed together in the inner
+        //! loops. A block of output plus the kernel's span of input stays in L1/L2 cache.
+        static constexpr int block = 1024;
+
+        /*!
+         * Correlate data on grid with the kernel kerneldata on kernelgrid, writing into
+         * result. G and KG may be any of the morph::Grid or morph::Gridct types. The kernel
+         * grid must have the same element spacing as grid. Its element at coordinate (0,0)
+         * is the centre of the kernel, so that a 5x5 kernel grid is typically made with an
+         * offset of -2 dx.
+         *
+         * If allow_separable is false, the kernel is always applied as a full 2D kernel
+         * (the result of the separated version differs by rounding only).
+         */
+        template <typename G, typename KG>
+        static void convolve (const G& grid, const KG& kernelgrid, const morph::vvec<T>& kerneldata,
+                              const morph::vvec<T>& data, morph::vvec<T>& result, const bool allow_separable = true)
+        {
+            const std::size_t n = static_cast<std::size_t>(grid.n);
+            if (data.size() != n) { throw std::runtime_error ("GridFilter::convolve: The data vector is not the same size as the Grid."); }
+            if (result.size() != n) { throw std::runtime_error ("GridFilter::convolve: The result vector is not the same size as the Grid."); }
+            if (kerneldata.size() != static_cast<std::size_t>(kernelgrid.n)) {
+                throw std::runtime_error ("GridFilter::convolve: The kernel data is not the same size as the kernel grid.");
+            }
+            if (&data == &result) { throw std::runtime_error ("GridFilter::convolve: Pass in separate memory for the result."); }
+
+            const auto gdx = grid.get_dx();
+            const auto kdx = kernelgrid.get_dx();
+            for (unsigned int j = 0; j < 2U; ++j) {
+                if (std::abs (kdx[j] - gdx[j]) > std::abs (gdx[j]) * 1e-4) {
+                    throw std::runtime_error ("GridFilter::convolve: The kernel grid must have the same dx as the Grid.");
+                }
+            }
+            if (n == 0U) { return; }
+
+            // Memory layout of the data: n_outer lines of n_inner elements
+            const GridOrder order = grid.get_order();
+            const bool colmaj = order == GridOrder::bottomleft_to_topright_colmaj
+                                || order == GridOrder::topleft_to_bottomright_colmaj;
+            const bool y_down = order == GridOrder::topleft_to_bottomright
+                                || order == GridOrder::topleft_to_bottomright_colmaj;
+            const int n_inner = static_cast<int>(colmaj ? grid.get_h() : grid.get_w());
+            const int n_outer = static_cast<int>(colmaj ? grid.get_w() : grid.get_h());
+            const GridDomainWrap wrap = grid.get_wrap();
+            const bool wrap_x = wrap == GridDomainWrap::Horizontal || wrap == GridDomainWrap::Both;
+            const bool wrap_y = wrap == GridDomainWrap::Vertical || wrap == GridDomainWrap::Both;
+            const bool wrap_inner = colmaj ? wrap_y : wrap_x;
+            const bool wrap_outer = colmaj ? wrap_x : wrap_y;
+
+            // Kernel element offsets, in memory terms
+            const std::size_t nk = kerneldata.size();
+            std::vector<int> ki (nk, 0);
+            std::vector<int> ko (nk, 0);
+            for (std::size_t k = 0; k < nk; ++k) {
+                const auto c = kernelgrid[static_cast<decltype(kernelgrid.n)>(k)];
+                const int sx = static_cast<int>(std::lround (c[0] / gdx[0]));
+                const int sy = static_cast<int>(std::lround (c[1] / gdx[1])) * (y_down ? -1 : 1);
+                ki[k] = colmaj ? sy : sx;
+                ko[k] = colmaj ? sx : sy;
+            }
+            if (nk == 0U) { result.zero(); return; }
+            const int ki_min = *std::min_element (ki.begin(), ki.end());
+            const int ko_min = *std::min_element (ko.begin(), ko.end());
+            const int kw = *std::max_element (ki.begin(), ki.end()) - ki_min + 1;
+            const int kh = *std::max_element (ko.begin(), ko.end()) - ko_min + 1;
+
+            // The dense kernel; kh lines of kw. Element [0][0] is at offset (ki_min, ko_min).
+            std::vector<T> K (static_cast<std::size_t>(kw) * kh, T{0});
+            for (std::size_t k = 0; k < nk; ++k) {
+                K[static_cast<std::size_t>(ko[k] - ko_min) * kw + (ki[k] - ki_min)] += kerneldata[k];
+            }
+
+            std::vector<T> k_inner;
+            std::vector<T> k_outer;
+            if (allow_separable && kw > 1 && kh > 1 && GridFilter<T>::separate (K, kw, kh, k_inner, k_outer)) {
+                GridFilter<T>::separable (data.data(), result.data(), n_inner, n_outer, wrap_inner, wrap_outer,
+                                          k_inner.data(), kw, -ki_min, k_outer.data(), kh, -ko_min);
+            } else {
+                GridFilter<T>::full (data.data(), result.data(), n_inner, n_outer, wrap_inner, wrap_outer,
+                                     K.data(), kw, kh, -ki_min, -ko_min);
+            }
+        }
+
+        /*!
+         * If the kw by kh kernel K is (to within rounding) the outer product of a column
+         * k_outer and a row k_inner, then find these and return true.
+         */
+        static bool separate (const std::vector<T>& K, const int kw, const int kh,
+                              std::vector<T>& k_inner, std::vector<T>& k_outer)
+        {
+            // Pivot on the largest element
+            std::size_t p = 0U;
+            T kmax = T{0};
+            for (std::size_t i = 0; i < K.size(); ++i) {
+                if (std::abs (K[i]) > kmax) { kmax = std::abs (K[i]); p = i; }
+            }
+            if (kmax == T{0}) { return false; }
+            const int pi = static_cast<int>(p % kw);
+            const int po = static_cast<int>(p / kw);
+
+            k_inner.resize (kw);
+            k_outer.resize (kh);
+            for (int i = 0; i < kw; ++i) { k_inner[i] = K[static_cast<std::size_t>(po) * kw + i] / K[p]; }
+            for (int o = 0; o < kh; ++o) { k_outer[o] = K[static_cast<std::size_t>(o) * kw + pi]; }
+
+            const T tol = T{64} * std::numeric_limits<T>::epsilon() * kmax;
+            for (int o = 0; o < kh; ++o) {
+                for (int i = 0; i < kw; ++i) {
+                    if (std::abs (K[static_cast<std::size_t>(o) * kw + i] - k_outer[o] * k_inner[i]) > tol) { return false; }
+                }
+            }
+            return true;
+        }
+
+        /*!
+         * Apply the separable kernel (the outer product of k_outer and k_inner) to src (n_outer
+         * lines of n_inner elements) writing into dst. kc_inner and kc_outer are the indices
+         * of the kernels' centre elements.
+         */
+        static void separable (const T* src, T* dst, const int n_inner, const int n_outer,
+                               const bool wrap_inner, const bool wrap_outer,
+                               const T* k_inner, const int kw, const int kc_inner,
+                               const T* k_outer, const int kh, const int kc_outer)
+        {
+            // Pass 1, along the lines
+            std::vector<T> tmp (static_cast<std::size_t>(n_inner) * n_outer, T{0});
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int o = 0; o < n_outer; ++o) {
+                const std::size_t off = static_cast<std::size_t>(o) * n_inner;
+                GridFilter<T>::correlate_line (src + off, tmp.data() + off, n_inner, k_inner, kw, kc_inner, wrap_inner);
+            }
+            // Pass 2, across the lines. Each output line is a weighted sum of kh input lines;
+            // this is done in column blocks so that the kh input blocks stay in cache.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int o = 0; o < n_outer; ++o) {
+                T* out = dst + static_cast<std::size_t>(o) * n_inner;
+                std::fill (out, out + n_inner, T{0});
+                for (int c0 = 0; c0 < n_inner; c0 += block) {
+                    const int c1 = std::min (c0 + block, n_inner);
+                    for (int j = 0; j < kh; ++j) {
+                        int so = o + j - kc_outer;
+                        if (!GridFilter<T>::line_in_range (so, n_outer, wrap_outer)) { continue; }
+                        const T kv = k_outer[j];
+                        const T* in = tmp.data() + static_cast<std::size_t>(so) * n_inner;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                        for (int c = c0; c < c1; ++c) { out[c] += kv * in[c]; }
+                    }
+                }
+            }
+        }
+
+        /*!
+         * Apply the full kw by kh kernel K to src, writing into dst. Each output line is the
+         * sum of the 1D correlations of kh input lines with the matching line of the kernel.
+         */
+        static void full (const T* src, T* dst, const int n_inner, const int n_outer,
+                          const bool wrap_inner, const bool wrap_outer,
+                          const T* K, const int kw, const int kh, const int kc_inner, const int kc_outer)
+        {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int o = 0; o < n_outer; ++o) {
+                T* out = dst + static_cast<std::size_t>(o) * n_inner;
+                std::fill (out, out + n_inner, T{0});
+                for (int j = 0; j < kh; ++j) {
+                    int so = o + j - kc_outer;
+                    if (!GridFilter<T>::line_in_range (so, n_outer, wrap_outer)) { continue; }
+                    const T* krow = K + static_cast<std::size_t>(j) * kw;
+                    bool allzero = true;
+                    for (int i = 0; i < kw && allzero; ++i) { allzero = krow[i] == T{0}; }
+                    if (allzero) { continue; }
+                    GridFilter<T>::correlate_line (src + static_cast<std::size_t>(so) * n_inner, out,
+                                                   n_inner, krow, kw, kc_inner, wrap_inner);
+                }
+            }
+        }
+
+        /*!
+         * Accumulate the 1D correlation of the n elements of src with the kernel k (of width
+         * kw, centred on element kc) into dst: dst[i] += sum_j k[j] * src[i + j - kc]. Out of
+         * range elements of src wrap around if wrap is true, or are zero otherwise.
+         */
+        static void correlate_line (const T* src, T* dst, const int n, const T* k, const int kw,
+                                    const int kc, const bool wrap)
+        {
+            // The interior, [lo, hi), is where every tap lands inside src
+            const int lo = std::min (std::max (kc, 0), n);
+            const int hi = std::max (lo, n - std::max (kw - 1 - kc, 0));
+
+            auto edge = [src, dst, n, k, kw, kc, wrap](const int i) {
+                T sum = T{0};
+                for (int j = 0; j < kw; ++j) {
+                    int si = i + j - kc;
+                    if (si < 0 || si >= n) {
+                        if (!wrap) { continue; }
+                        si = ((si % n) + n) % n;
+                    }
+                    sum += k[j] * src[si];
+                }
+                dst[i] += sum;
+            };
+            for (int i = 0; i < lo; ++i) { edge (i); }
+            for (int i = hi; i < n; ++i) { edge (i); }
+
+            // Blocked, with the kernel taps in the outer loop so that the inner loop is a
+            // contiguous, vectorisable multiply-add
+            for (int b0 = lo; b0 < hi; b0 += block) {
+                const int b1 = std::min (b0 + block, hi);
+                for (int j = 0; j < kw; ++j) {
+                    const T kv = k[j];
+                    if (kv == T{0}) { continue; }
+                    const T* s = src + (j - kc);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                    for (int i = b0; i < b1; ++i) { dst[i] += kv * s[i]; }
+                }
+            }
+        }
+
+        //! Bring line index so into [0, n) by wrapping, if allowed. Return false if it is
+        //! out of range and cannot wrap.
+        static bool line_in_range (int& so, const int n, const bool wrap)
+        {
+            if (so >= 0 && so < n) { return true; }
+            if (!wrap) { return false; }
+            so = ((so % n) + n) % n;
+            return true;
+        }
+    };
+
+} // namespace morph
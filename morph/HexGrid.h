@@ -26,6 +26,8 @@
 
 #include <set>
 #include <list>
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <array>
 #include <stdexcept>
@@ -36,6 +38,23 @@
 #include <vector>
 #include <stdexcept>
 #include <limits>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <fstream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#ifdef __WIN__
+# include <direct.h>
+# include <process.h>
+#else
+# include <unistd.h>
+# include <sys/stat.h>
+#endif
 
 namespace morph {
 
@@ -432,6 +451,234 @@ namespace morph {
         }
 #endif // HEXGRID_COMPILE_LOAD_AND_SAVE
 
+        /*!
+         * Save the domain of this HexGrid (its parameters and the d_ vectors) into a compact
+         * binary file at @path. Unlike save(), this needs no HDF5 and writes nothing per Hex;
+         * loadCompact() rebuilds the Hexes from the d_ vectors. The numbers are written in the
+         * byte order of this machine. The file is written under a temporary name and then
+         * renamed, so a reader never sees a partly written file.
+         */
+        void saveCompact (const std::string& path) const
+        {
+            const std::uint32_t n = static_cast<std::uint32_t>(this->d_x.size());
+            compact_header hdr;
+            hdr.n = n;
+            hdr.d = this->d;
+            hdr.v = this->v;
+            hdr.x_span = this->x_span;
+            hdr.z = this->z;
+            hdr.boundaryCentroid[0] = this->boundaryCentroid[0];
+            hdr.boundaryCentroid[1] = this->boundaryCentroid[1];
+            hdr.originalBoundaryCentroid[0] = this->originalBoundaryCentroid[0];
+            hdr.originalBoundaryCentroid[1] = this->originalBoundaryCentroid[1];
+            hdr.d_rowlen = this->d_rowlen;
+            hdr.d_numrows = this->d_numrows;
+            hdr.d_size = this->d_size;
+            hdr.d_growthbuffer_horz = this->d_growthbuffer_horz;
+            hdr.d_growthbuffer_vert = this->d_growthbuffer_vert;
+
+#ifdef __WIN__
+            const std::string tmppath = path + ".tmp" + std::to_string (_getpid());
+#else
+            const std::string tmppath = path + ".tmp" + std::to_string (::getpid());
+#endif
+            {
+                std::ofstream f (tmppath, std::ios::binary | std::ios::trunc);
+                if (!f.is_open()) { throw std::runtime_error ("HexGrid::saveCompact: Failed to open " + tmppath); }
+                f.write (reinterpret_cast<const char*>(&hdr), sizeof (hdr));
+                auto write_vec = [&f, n](const auto& vec) {
+                    if (vec.size() != n) { throw std::runtime_error ("HexGrid::saveCompact: The d_ vectors differ in size"); }
+                    f.write (reinterpret_cast<const char*>(vec.data()), n * sizeof (vec[0]));
+                };
+                write_vec (this->d_x);
+                write_vec (this->d_y);
+                write_vec (this->d_distToBoundary);
+                write_vec (this->d_ri);
+                write_vec (this->d_gi);
+                write_vec (this->d_bi);
+                write_vec (this->d_ne);
+                write_vec (this->d_nne);
+                write_vec (this->d_nnw);
+                write_vec (this->d_nw);
+                write_vec (this->d_nsw);
+                write_vec (this->d_nse);
+                write_vec (this->d_flags);
+                if (!f.good()) {
+                    std::remove (tmppath.c_str());
+                    throw std::runtime_error ("HexGrid::saveCompact: Failed to write " + tmppath);
+                }
+            }
+            if (std::rename (tmppath.c_str(), path.c_str()) != 0) {
+                std::remove (tmppath.c_str());
+                throw std::runtime_error ("HexGrid::saveCompact: Failed to rename " + tmppath + " to " + path);
+            }
+        }
+
+        /*!
+         * Populate this HexGrid from a file written by saveCompact(). The d_ vectors are read
+         * straight out of the file, then the list of Hexes and their neighbour relations are
+         * rebuilt from the d_ vectors.
+         */
+        void loadCompact (const std::string& path)
+        {
+            std::ifstream f (path, std::ios::binary | std::ios::ate);
+            if (!f.is_open()) { throw std::runtime_error ("HexGrid::loadCompact: Failed to open " + path); }
+            const std::size_t fsize = static_cast<std::size_t>(f.tellg());
+            f.seekg (0);
+            compact_header hdr;
+            if (fsize < sizeof (hdr) || !f.read (reinterpret_cast<char*>(&hdr), sizeof (hdr))) {
+                throw std::runtime_error ("HexGrid::loadCompact: " + path + " is too short");
+            }
+            const compact_header expected;
+            if (std::memcmp (hdr.magic, expected.magic, sizeof (hdr.magic)) != 0
+                || hdr.version != expected.version || hdr.byte_order != expected.byte_order) {
+                throw std::runtime_error ("HexGrid::loadCompact: " + path + " is not a compact HexGrid file"
+                                          " of this version and byte order");
+            }
+            const std::size_t n = hdr.n;
+            if (fsize != sizeof (hdr) + n * compact_bytes_per_hex) {
+                throw std::runtime_error ("HexGrid::loadCompact: " + path + " has the wrong size");
+            }
+
+            this->d = hdr.d;
+            this->v = hdr.v;
+            this->x_span = hdr.x_span;
+            this->z = hdr.z;
+            this->boundaryCentroid = { hdr.boundaryCentroid[0], hdr.boundaryCentroid[1] };
+            this->originalBoundaryCentroid = { hdr.originalBoundaryCentroid[0], hdr.originalBoundaryCentroid[1] };
+            this->d_rowlen = hdr.d_rowlen;
+            this->d_numrows = hdr.d_numrows;
+            this->d_size = hdr.d_size;
+            this->d_growthbuffer_horz = hdr.d_growthbuffer_horz;
+            this->d_growthbuffer_vert = hdr.d_growthbuffer_vert;
+
+            auto read_vec = [&f, &path, n](auto& vec) {
+                using T = typename std::remove_reference_t<decltype(vec)>::value_type;
+                vec.resize (n);
+                if (!f.read (reinterpret_cast<char*>(vec.data()), n * sizeof (T))) {
+                    throw std::runtime_error ("HexGrid::loadCompact: Failed to read " + path);
+                }
+            };
+            read_vec (this->d_x);
+            read_vec (this->d_y);
+            read_vec (this->d_distToBoundary);
+            read_vec (this->d_ri);
+            read_vec (this->d_gi);
+            read_vec (this->d_bi);
+            read_vec (this->d_ne);
+            read_vec (this->d_nne);
+            read_vec (this->d_nnw);
+            read_vec (this->d_nw);
+            read_vec (this->d_nsw);
+            read_vec (this->d_nse);
+            read_vec (this->d_flags);
+
+            // hexenFromDomain follows the neighbour indices, so they must be in range
+            const int ni = static_cast<int>(n);
+            for (const std::vector<int>* nb : { &this->d_ne, &this->d_nne, &this->d_nnw,
+                                                &this->d_nw, &this->d_nsw, &this->d_nse }) {
+                for (int i : *nb) {
+                    if (i < -1 || i >= ni) {
+                        throw std::runtime_error ("HexGrid::loadCompact: " + path + " has an out of range neighbour index");
+                    }
+                }
+            }
+
+            this->hexenFromDomain();
+        }
+
+        /*!
+         * Initialise the grid as init (d_, x_span_, z) followed by setBoundary (p, loffset)
+         * would, but keep the result in a cache of compact grid files (see saveCompact), keyed
+         * on d_, x_span_, loffset and the points of the boundary. When the same grid is asked
+         * for again, in this process or any other, it is loaded from the cache rather than
+         * rebuilt. Either way, the HexGrid (and, with loffset, the offset boundary points)
+         * end up the same. z, which is not part of the key, keeps its value.
+         *
+         * The cache is in @cachedir, or, if that is empty, in $MORPH_HEXGRID_CACHE,
+         * $XDG_CACHE_HOME/morphologica/hexgrid or ~/.cache/morphologica/hexgrid, in that
+         * order of preference. A cache that can't be written is not an error; the grid is
+         * just not cached.
+         *
+         * \return true if the grid was loaded from the cache
+         */
+        bool initCached (float d_, float x_span_, const BezCurvePath<float>& p, bool loffset = true,
+                         const std::string& cachedir = "")
+        {
+            this->boundary = p;
+            if (this->boundary.isNull()) {
+                throw std::runtime_error ("HexGrid::initCached: The boundary path is null");
+            }
+            this->boundary.computePoints (d_/2.0f, true);
+            std::vector<morph::BezCoord<float>> bpoints = this->boundary.getPoints();
+            return this->initCached (d_, x_span_, bpoints, loffset, cachedir);
+        }
+
+        //! initCached for a boundary given as a vector of points
+        bool initCached (float d_, float x_span_, std::vector<BezCoord<float>>& bpoints, bool loffset = true,
+                         const std::string& cachedir = "")
+        {
+            std::string dir = cachedir.empty() ? HexGrid::defaultCacheDir() : cachedir;
+            std::string path = "";
+            if (!dir.empty()) {
+                // FNV-1a hash of the format version and everything that determines the grid
+                std::uint64_t hash = 0xcbf29ce484222325ULL;
+                auto hash_bytes = [&hash](const void* data, std::size_t len) {
+                    const unsigned char* b = static_cast<const unsigned char*>(data);
+                    for (std::size_t i = 0; i < len; ++i) { hash = (hash ^ b[i]) * 0x100000001b3ULL; }
+                };
+                const std::uint32_t version = compact_header().version;
+                const std::uint32_t offs = loffset ? 1 : 0;
+                const std::uint64_t np = bpoints.size();
+                hash_bytes (&version, sizeof (version));
+                hash_bytes (&d_, sizeof (d_));
+                hash_bytes (&x_span_, sizeof (x_span_));
+                hash_bytes (&offs, sizeof (offs));
+                hash_bytes (&np, sizeof (np));
+                for (const auto& bp : bpoints) {
+                    const float xy[2] = { bp.x(), bp.y() };
+                    hash_bytes (xy, sizeof (xy));
+                }
+                std::stringstream ss;
+                ss << dir << "/hexgrid_" << std::hex << std::setw (16) << std::setfill ('0') << hash << ".bin";
+                path = ss.str();
+
+                if (std::ifstream (path).good()) {
+                    const float z_ = this->z;
+                    try {
+                        this->loadCompact (path);
+                        this->z = z_;
+                        // Centre bpoints on (0,0), as setBoundary (bpoints, true) would have
+                        if (loffset) {
+                            const morph::vec<float, 2> c = morph::BezCurvePath<float>::getCentroid (bpoints);
+                            for (auto& bp : bpoints) { bp.subtract (c); }
+                        }
+                        return true;
+                    } catch (const std::exception& e) {
+                        // Fall through and rebuild (and re-cache) the grid
+                        this->z = z_;
+                        DBG ("Rebuilding grid: " << e.what());
+                    }
+                }
+            }
+
+            this->hexen.clear();
+            this->vhexen.clear();
+            this->bhexen.clear();
+            this->init (d_, x_span_, this->z);
+            this->setBoundary (bpoints, loffset);
+
+            if (!path.empty() && HexGrid::makeDirs (dir)) {
+                try {
+                    this->saveCompact (path);
+                } catch (const std::exception&) {
+                    // Not cached, but the grid is fine
+                }
+            }
+            return false;
+        }
+
+
         /*!
          * Default constructor
          */
@@ -470,6 +717,236 @@ namespace morph {
             this->init();
         }
 
+        /*!
+         * Build the grid directly from the boundary \a bpoints, with a hex to hex distance of
+         * @a d_. This gives the same domain as constructing a hexagonal grid large enough to
+         * contain the boundary and then calling setBoundary (bpoints, loffset), but it never
+         * creates the hexes that lie outside the boundary. For very large domains it is much
+         * faster.
+         *
+         * The boundary hexes are those nearest to each point in \a bpoints; the hexes inside
+         * are found, a row of hexes at a time, from the crossings of the row with the boundary
+         * polygon. Any hex inside which lacks one of its six neighbours is also marked as a
+         * boundary hex, so that the boundary always encloses the domain.
+         *
+         * The hexes are ordered in rows, bottom row first, from left to right within a row.
+         */
+        void initFromBoundary (float d_, std::vector<BezCoord<float>>& bpoints, bool loffset = true)
+        {
+            this->d = d_;
+            this->v = this->d * morph::mathconst<float>::root_3_over_2;
+            if (bpoints.size() < 3) {
+                throw std::runtime_error ("HexGrid::initFromBoundary: A boundary needs at least 3 points");
+            }
+
+            this->boundaryCentroid = morph::BezCurvePath<float>::getCentroid (bpoints);
+            if (loffset) {
+                for (auto& bp : bpoints) { bp.subtract (this->boundaryCentroid); }
+                this->originalBoundaryCentroid = this->boundaryCentroid;
+                this->boundaryCentroid = {0.0f, 0.0f};
+            }
+
+            this->hexen.clear();
+            this->vhexen.clear();
+            this->bhexen.clear();
+            this->d_clear();
+            this->gridReduced = true;
+
+            // The boundary hexes, as {ri, gi}, and the extent of the boundary
+            const int n_bp = static_cast<int>(bpoints.size());
+            std::vector<morph::vec<int, 2>> bhex (n_bp);
+#pragma omp parallel for
+            for (int i = 0; i < n_bp; ++i) {
+                bhex[i] = this->nearestHexPosition (bpoints[i].x(), bpoints[i].y());
+            }
+            float xmin = bpoints[0].x();
+            float xmax = xmin;
+            float ymin = bpoints[0].y();
+            float ymax = ymin;
+            int gmin = bhex[0][1];
+            int gmax = gmin;
+            for (int i = 0; i < n_bp; ++i) {
+                xmin = std::min (xmin, bpoints[i].x());
+                xmax = std::max (xmax, bpoints[i].x());
+                ymin = std::min (ymin, bpoints[i].y());
+                ymax = std::max (ymax, bpoints[i].y());
+                gmin = std::min (gmin, bhex[i][1]);
+                gmax = std::max (gmax, bhex[i][1]);
+            }
+            gmin = std::min (gmin, static_cast<int>(std::floor (ymin / this->v)));
+            gmax = std::max (gmax, static_cast<int>(std::ceil (ymax / this->v)));
+            this->x_span = xmax - xmin;
+            const int n_rows = gmax - gmin + 1;
+
+            // Sort the boundary hexes and the crossings of the boundary polygon into rows
+            std::vector<std::vector<int>> row_bnd (n_rows);
+            std::vector<std::vector<float>> row_cross (n_rows);
+            for (int i = 0; i < n_bp; ++i) {
+                row_bnd[bhex[i][1] - gmin].push_back (bhex[i][0]);
+
+                const BezCoord<float>& p0 = bpoints[i];
+                const BezCoord<float>& p1 = bpoints[(i + 1) % n_bp];
+                int g0 = static_cast<int>(std::floor (std::min (p0.y(), p1.y()) / this->v));
+                int g1 = static_cast<int>(std::ceil (std::max (p0.y(), p1.y()) / this->v));
+                for (int g = std::max (g0, gmin); g <= std::min (g1, gmax); ++g) {
+                    float yg = this->v * g;
+                    if ((p0.y() > yg) != (p1.y() > yg)) {
+                        float xc = p0.x() + (yg - p0.y()) * (p1.x() - p0.x()) / (p1.y() - p0.y());
+                        row_cross[g - gmin].push_back (xc);
+                    }
+                }
+            }
+
+            // Each row of the domain is the union of its boundary hexes and the hexes whose
+            // centres lie between pairs of crossings
+            std::vector<std::vector<int>> row_ri (n_rows);
+#pragma omp parallel for schedule(dynamic)
+            for (int row = 0; row < n_rows; ++row) {
+                const int g = row + gmin;
+                std::vector<int>& bnd = row_bnd[row];
+                std::sort (bnd.begin(), bnd.end());
+                bnd.erase (std::unique (bnd.begin(), bnd.end()), bnd.end());
+
+                std::vector<float>& cross = row_cross[row];
+                std::sort (cross.begin(), cross.end());
+                std::vector<int> inside;
+                for (std::size_t c = 0; c + 1 < cross.size(); c += 2) {
+                    int r0 = static_cast<int>(std::floor (cross[c] / this->d - g / 2.0f));
+                    int r1 = static_cast<int>(std::ceil (cross[c+1] / this->d - g / 2.0f));
+                    for (int r = r0; r <= r1; ++r) {
+                        float x = this->d * r + (this->d / 2.0f) * g;
+                        if (x > cross[c] && x < cross[c+1]) { inside.push_back (r); }
+                    }
+                }
+                std::vector<int>& ri = row_ri[row];
+                ri.reserve (bnd.size() + inside.size());
+                std::set_union (bnd.begin(), bnd.end(), inside.begin(), inside.end(), std::back_inserter (ri));
+            }
+
+            // Offsets of the start of each row into the domain
+            std::vector<unsigned int> row_start (n_rows + 1, 0);
+            for (int row = 0; row < n_rows; ++row) { row_start[row+1] = row_start[row] + row_ri[row].size(); }
+            const int n_hex = static_cast<int>(row_start[n_rows]);
+            if (n_hex == 0) { throw std::runtime_error ("HexGrid::initFromBoundary: The boundary contains no hexes"); }
+
+            // The list of Hexes has to be built in one thread
+            std::vector<std::list<morph::Hex>::iterator> hv (n_hex);
+            for (int row = 0; row < n_rows; ++row) {
+                unsigned int vi = row_start[row];
+                for (int r : row_ri[row]) {
+                    hv[vi] = this->hexen.emplace (this->hexen.end(), vi, this->d, r, row + gmin);
+                    ++vi;
+                }
+            }
+
+            // The index of the hex at (r, g), or -1 if it is not in the domain
+            auto index_of = [&row_ri, &row_start, gmin, n_rows](int r, int g)
+            {
+                int row = g - gmin;
+                if (row < 0 || row >= n_rows) { return -1; }
+                const std::vector<int>& ri = row_ri[row];
+                auto it = std::lower_bound (ri.begin(), ri.end(), r);
+                if (it == ri.end() || *it != r) { return -1; }
+                return static_cast<int>(row_start[row] + (it - ri.begin()));
+            };
+
+            // Connect the neighbours, set the flags and fill the d_ vectors
+            this->vhexen.resize (n_hex);
+            this->d_x.resize (n_hex);
+            this->d_y.resize (n_hex);
+            this->d_ri.resize (n_hex);
+            this->d_gi.resize (n_hex);
+            this->d_bi.resize (n_hex);
+            this->d_flags.resize (n_hex);
+            this->d_distToBoundary.resize (n_hex);
+            this->d_ne.resize (n_hex);
+            this->d_nne.resize (n_hex);
+            this->d_nnw.resize (n_hex);
+            this->d_nw.resize (n_hex);
+            this->d_nsw.resize (n_hex);
+            this->d_nse.resize (n_hex);
+#pragma omp parallel for schedule(dynamic, 1024)
+            for (int i = 0; i < n_hex; ++i) {
+                morph::Hex& h = *hv[i];
+                const int r = h.ri;
+                const int g = h.gi;
+                this->d_ne[i] = index_of (r+1, g);
+                this->d_nne[i] = index_of (r, g+1);
+                this->d_nnw[i] = index_of (r-1, g+1);
+                this->d_nw[i] = index_of (r-1, g);
+                this->d_nsw[i] = index_of (r, g-1);
+                this->d_nse[i] = index_of (r+1, g-1);
+                if (this->d_ne[i] >= 0) { h.set_ne (hv[this->d_ne[i]]); }
+                if (this->d_nne[i] >= 0) { h.set_nne (hv[this->d_nne[i]]); }
+                if (this->d_nnw[i] >= 0) { h.set_nnw (hv[this->d_nnw[i]]); }
+                if (this->d_nw[i] >= 0) { h.set_nw (hv[this->d_nw[i]]); }
+                if (this->d_nsw[i] >= 0) { h.set_nsw (hv[this->d_nsw[i]]); }
+                if (this->d_nse[i] >= 0) { h.set_nse (hv[this->d_nse[i]]); }
+
+                const std::vector<int>& bnd = row_bnd[g - gmin];
+                if (std::binary_search (bnd.begin(), bnd.end(), r) || !h.testFlags (HEX_HAS_NEIGHB_ALL)) {
+                    h.setFlag (HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY);
+                } else {
+                    h.setFlag (HEX_INSIDE_BOUNDARY);
+                }
+
+                h.di = i;
+                this->vhexen[i] = &h;
+                this->d_x[i] = h.x;
+                this->d_y[i] = h.y;
+                this->d_ri[i] = h.ri;
+                this->d_gi[i] = h.gi;
+                this->d_bi[i] = h.bi;
+                this->d_flags[i] = h.getFlags();
+                this->d_distToBoundary[i] = h.distToBoundary;
+            }
+
+            // Populate bhexen. The first hex, in the bottom row, is always a boundary hex.
+            std::set<unsigned int> seen;
+            std::list<morph::Hex>::const_iterator bhi = this->hexen.begin();
+            if (this->boundaryContiguous (bhi, bhi, seen) == false) {
+                throw std::runtime_error ("HexGrid::initFromBoundary: The boundary is not a contiguous sequence of hexes.");
+            }
+        }
+
+        /*!
+         * Build the grid directly from the boundary \a p, with a hex to hex distance of @a d_.
+         * The equivalent of constructing a hexagonal grid and then calling setBoundary (p,
+         * loffset), without building the hexes outside the boundary.
+         */
+        void initFromBoundary (float d_, const BezCurvePath<float>& p, bool loffset = true)
+        {
+            this->d = d_;
+            this->boundary = p;
+            if (this->boundary.isNull()) {
+                throw std::runtime_error ("HexGrid::initFromBoundary: The boundary path is null");
+            }
+            this->boundary.computePoints (this->d/2.0f, true);
+            std::vector<morph::BezCoord<float>> bpoints = this->boundary.getPoints();
+            this->initFromBoundary (d_, bpoints, loffset);
+        }
+
+        /*!
+         * Build an elliptical grid directly, the equivalent of setEllipticalBoundary on a
+         * large enough hexagonal grid, with a hex to hex distance of @a d_.
+         */
+        void initEllipticalBoundary (float d_, const float a, const float b,
+                                     const morph::vec<float, 2> c = {0.0f, 0.0f}, bool offset = true)
+        {
+            this->d = d_;
+            std::vector<morph::BezCoord<float>> bpoints = this->ellipseCompute (a, b, c);
+            this->initFromBoundary (d_, bpoints, offset);
+        }
+
+        /*!
+         * Build a circular grid of radius @a a directly, with a hex to hex distance of @a d_.
+         */
+        void initCircularBoundary (float d_, const float a,
+                                   const morph::vec<float, 2> c = {0.0f, 0.0f}, bool offset = true)
+        {
+            this->initEllipticalBoundary (d_, a, a, c, offset);
+        }
+
         /*!
          * Compute the centroid of the passed in list of Hexes.
          */
@@ -509,11 +986,14 @@ namespace morph {
         // If possible, get the hex at the given rgb position
         std::list<Hex>::iterator findHexAt (const morph::vec<int, 3>& rgbpos)
         {
-            std::list<morph::Hex>::iterator hi = this->hexen.begin(); // First hex in hexen is always 0,0,0
+            std::list<morph::Hex>::iterator hi = this->hexen.begin();
+            if (hi == this->hexen.end()) { return hi; }
+            // Walk from the first hex, which is 0,0,0 unless the grid was built by initFromBoundary
+            const morph::vec<int, 3> start = { hi->ri, hi->gi, hi->bi };
 
             // +ri is East
-            int inc = rgbpos[0] > 0 ? 1 : -1;
-            for (int ri = 0; ri != rgbpos[0] && hi != this->hexen.end(); ri+=inc) {
+            int inc = rgbpos[0] > start[0] ? 1 : -1;
+            for (int ri = start[0]; ri != rgbpos[0] && hi != this->hexen.end(); ri+=inc) {
                 if (inc > 0) {
                     hi = hi->has_ne() ? hi->ne : this->hexen.end();
                 } else {
@@ -522,8 +1002,8 @@ namespace morph {
             }
 
             // gi is NorthEast
-            inc = rgbpos[1] > 0 ? 1 : -1;
-            for (int ri = 0; ri != rgbpos[1] && hi != this->hexen.end(); ri+=inc) {
+            inc = rgbpos[1] > start[1] ? 1 : -1;
+            for (int ri = start[1]; ri != rgbpos[1] && hi != this->hexen.end(); ri+=inc) {
                 if (inc > 0) {
                     hi = hi->has_nne() ? hi->nne : this->hexen.end();
                 } else {
@@ -532,8 +1012,8 @@ namespace morph {
             }
 
             // bi is NorthWest
-            inc = rgbpos[2] > 0 ? 1 : -1;
-            for (int ri = 0; ri != rgbpos[2] && hi != this->hexen.end(); ri+=inc) {
+            inc = rgbpos[2] > start[2] ? 1 : -1;
+            for (int ri = start[2]; ri != rgbpos[2] && hi != this->hexen.end(); ri+=inc) {
                 if (inc > 0) {
                     hi = hi->has_nnw() ? hi->nnw : this->hexen.end();
                 } else {
@@ -541,6 +1021,16 @@ namespace morph {
                 }
             }
 
+            // The walk can leave a non-convex domain (or, from a first hex on the boundary, a
+            // convex one), so if it failed, search. Compare positions with bi reduced to 0.
+            if (hi == this->hexen.end()) {
+                const int r0 = rgbpos[0] - rgbpos[2];
+                const int g0 = rgbpos[1] + rgbpos[2];
+                for (hi = this->hexen.begin(); hi != this->hexen.end(); ++hi) {
+                    if (hi->ri - hi->bi == r0 && hi->gi + hi->bi == g0) { break; }
+                }
+            }
+
             return hi;
         }
 
@@ -1054,6 +1544,11 @@ namespace morph {
          */
         float getv() const { return this->v; }
 
+        /*!
+         * Getter for z, the z coordinate of this hex grid layer.
+         */
+        float getz() const { return this->z; }
+
         /*!
          * Get the shortest distance from the centre to the perimeter. This is the
          * "short radius".
@@ -1124,33 +1619,48 @@ namespace morph {
 
         /*!
          * Run through all the hexes and compute the distance to the nearest boundary
-         * hex.
+         * hex. The boundary hex centres are first gathered into two compact arrays so that
+         * the inner loop streams through 8 bytes per boundary hex, rather than through
+         * every Hex in the list. If the d_ vectors are populated, d_distToBoundary is
+         * updated too.
          */
         void computeDistanceToBoundary()
         {
-            std::list<morph::Hex>::iterator h = this->hexen.begin();
-            while (h != this->hexen.end()) {
+            std::vector<float> bx;
+            std::vector<float> by;
+            std::vector<morph::Hex*> hp;
+            hp.reserve (this->hexen.size());
+            for (morph::Hex& h : this->hexen) {
+                if (h.testFlags(HEX_IS_BOUNDARY) == true) {
+                    bx.push_back (h.x);
+                    by.push_back (h.y);
+                }
+                hp.push_back (&h);
+            }
+            const int nh = static_cast<int>(hp.size());
+            const std::size_t nb = bx.size();
+#pragma omp parallel for schedule(dynamic, 256)
+            for (int i = 0; i < nh; ++i) {
+                morph::Hex* h = hp[i];
                 if (h->testFlags(HEX_IS_BOUNDARY) == true) {
                     h->distToBoundary = 0.0f;
+                } else if (h->testFlags(HEX_INSIDE_BOUNDARY) == false) {
+                    // Set to a dummy, negative value
+                    h->distToBoundary = -100.0;
                 } else {
-                    if (h->testFlags(HEX_INSIDE_BOUNDARY) == false) {
-                        // Set to a dummy, negative value
-                        h->distToBoundary = -100.0;
-                    } else {
-                        // Not a boundary hex, but inside boundary
-                        std::list<morph::Hex>::iterator bh = this->hexen.begin();
-                        while (bh != this->hexen.end()) {
-                            if (bh->testFlags(HEX_IS_BOUNDARY) == true) {
-                                float delta = h->distanceFrom (*bh);
-                                if (delta < h->distToBoundary || h->distToBoundary < 0.0f) {
-                                    h->distToBoundary = delta;
-                                }
-                            }
-                            ++bh;
-                        }
+                    // Not a boundary hex, but inside boundary
+                    float dtb = h->distToBoundary;
+                    for (std::size_t j = 0; j < nb; ++j) {
+                        float dx = bx[j] - h->x;
+                        float dy = by[j] - h->y;
+                        float delta = std::sqrt (dx*dx + dy*dy);
+                        if (delta < dtb || dtb < 0.0f) { dtb = delta; }
                     }
+                    h->distToBoundary = dtb;
                 }
-                ++h;
+            }
+            if (this->d_distToBoundary.size() == this->hexen.size()) {
+                for (const morph::Hex& h : this->hexen) { this->d_distToBoundary[h.di] = h.distToBoundary; }
             }
         }
 
@@ -3214,6 +3724,132 @@ namespace morph {
             return h;
         }
 
+        //! The header of a file written by saveCompact()
+        struct compact_header
+        {
+            char magic[8] = { 'M', 'O', 'R', 'P', 'H', 'H', 'E', 'X' };
+            std::uint32_t version = 1;
+            //! Reads 0x01020304 on a machine with the byte order of the one that wrote the file
+            std::uint32_t byte_order = 0x01020304;
+            std::uint32_t n = 0;
+            float d = 1.0f;
+            float v = 1.0f;
+            float x_span = 1.0f;
+            float z = 0.0f;
+            float boundaryCentroid[2] = { 0.0f, 0.0f };
+            float originalBoundaryCentroid[2] = { 0.0f, 0.0f };
+            std::uint32_t d_rowlen = 0;
+            std::uint32_t d_numrows = 0;
+            std::uint32_t d_size = 0;
+            std::uint32_t d_growthbuffer_horz = 0;
+            std::uint32_t d_growthbuffer_vert = 0;
+        };
+        //! 3 float, 9 int and 1 unsigned int d_ vectors
+        static constexpr std::size_t compact_bytes_per_hex = 3 * sizeof (float) + 9 * sizeof (int) + sizeof (unsigned int);
+
+        /*!
+         * Rebuild hexen (and vhexen and bhexen) from the d_ vectors, as after loading them
+         * with loadCompact().
+         */
+        void hexenFromDomain()
+        {
+            this->hexen.clear();
+            this->vhexen.clear();
+            this->bhexen.clear();
+            const int n = static_cast<int>(this->d_x.size());
+            std::vector<std::list<morph::Hex>::iterator> hv (n);
+            for (int i = 0; i < n; ++i) {
+                hv[i] = this->hexen.emplace (this->hexen.end(), i, this->d, this->d_ri[i], this->d_gi[i]);
+                if (this->d_bi[i] != 0) {
+                    hv[i]->bi = this->d_bi[i];
+                    hv[i]->computeLocation();
+                }
+            }
+            this->vhexen.resize (n);
+#pragma omp parallel for schedule(dynamic, 1024)
+            for (int i = 0; i < n; ++i) {
+                morph::Hex& h = *hv[i];
+                h.di = i;
+                h.distToBoundary = this->d_distToBoundary[i];
+                // The neighbour flags are set along with the neighbour iterators
+                h.setFlags (this->d_flags[i] & ~HEX_HAS_NEIGHB_ALL);
+                if (this->d_ne[i] >= 0) { h.set_ne (hv[this->d_ne[i]]); }
+                if (this->d_nne[i] >= 0) { h.set_nne (hv[this->d_nne[i]]); }
+                if (this->d_nnw[i] >= 0) { h.set_nnw (hv[this->d_nnw[i]]); }
+                if (this->d_nw[i] >= 0) { h.set_nw (hv[this->d_nw[i]]); }
+                if (this->d_nsw[i] >= 0) { h.set_nsw (hv[this->d_nsw[i]]); }
+                if (this->d_nse[i] >= 0) { h.set_nse (hv[this->d_nse[i]]); }
+                this->vhexen[i] = &h;
+            }
+            this->gridReduced = true;
+
+            // Populate bhexen, starting from the first boundary hex
+            std::list<morph::Hex>::const_iterator bhi = this->hexen.begin();
+            while (bhi != this->hexen.end() && !bhi->testFlags (HEX_IS_BOUNDARY)) { ++bhi; }
+            if (bhi != this->hexen.end()) {
+                std::set<unsigned int> seen;
+                this->boundaryContiguous (bhi, bhi, seen);
+            }
+        }
+
+        //! The directory for initCached() to use when it is not given one
+        static std::string defaultCacheDir()
+        {
+            const char* e = std::getenv ("MORPH_HEXGRID_CACHE");
+            if (e != nullptr && e[0] != '\0') { return std::string (e); }
+            e = std::getenv ("XDG_CACHE_HOME");
+            if (e != nullptr && e[0] != '\0') { return std::string (e) + "/morphologica/hexgrid"; }
+#ifdef __WIN__
+            e = std::getenv ("LOCALAPPDATA");
+            if (e != nullptr && e[0] != '\0') { return std::string (e) + "/morphologica/hexgrid"; }
+#else
+            e = std::getenv ("HOME");
+            if (e != nullptr && e[0] != '\0') { return std::string (e) + "/.cache/morphologica/hexgrid"; }
+#endif
+            return "";
+        }
+
+        //! Create the directory @dir and any of its parents that don't exist. Return true on success.
+        static bool makeDirs (const std::string& dir)
+        {
+            for (std::size_t pos = 1; pos <= dir.size(); ++pos) {
+                if (pos == dir.size() || dir[pos] == '/' || dir[pos] == '\\') {
+                    std::string sub = dir.substr (0, pos);
+                    // Another process may make the same directory at the same time, so EEXIST is fine
+#ifdef __WIN__
+                    if (_mkdir (sub.c_str()) != 0 && errno != EEXIST) { return false; }
+#else
+                    if (::mkdir (sub.c_str(), 0755) != 0 && errno != EEXIST) { return false; }
+#endif
+                }
+            }
+            return true;
+        }
+
+        /*!
+         * The {ri, gi} position of the hex (with bi = 0) whose centre is nearest to the point
+         * (x, y), found by rounding in cube coordinates.
+         */
+        morph::vec<int, 2> nearestHexPosition (const float x, const float y) const
+        {
+            const float gf = y / this->v;
+            const float rf = x / this->d - gf / 2.0f;
+            const float bf = -rf - gf;
+            float r = std::round (rf);
+            float g = std::round (gf);
+            const float b = std::round (bf);
+            const float dr = std::abs (r - rf);
+            const float dg = std::abs (g - gf);
+            const float db = std::abs (b - bf);
+            // Rounding all three may not give r + g + b = 0; recompute the furthest from its fraction
+            if (dr > dg && dr > db) {
+                r = -g - b;
+            } else if (dg > db) {
+                g = -r - b;
+            }
+            return { static_cast<int>(r), static_cast<int>(g) };
+        }
+
         /*!
          * Determine whether the boundary is contiguous. Whilst doing so, populate a
          * list<Hex> containing just the boundary Hexes.
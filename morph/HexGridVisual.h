@@ -124,15 +124,21 @@ namespace morph {
             this->set_datasize();
             if (this->datasize == 0) { return; }
 
+            // Pre-size the vertex and index vectors from the number of hexes
+            std::size_t nhex = this->hg->num();
             switch (this->hexVisMode) {
             case HexVisMode::Triangles:
             {
+                this->reserve_vertices (nhex, 6U * nhex);
                 this->initializeVerticesTris();
                 break;
             }
             case HexVisMode::HexInterp:
             default:
             {
+                // 7 vertices and 18 indices per hex, for the hexes and for the zero grid
+                std::size_t nlayers = (this->showhexes ? 1U : 0U) + (this->zerogrid ? 1U : 0U);
+                this->reserve_vertices (7U * nhex * nlayers, 18U * nhex * nlayers);
                 this->initializeVerticesHexesInterpolated();
                 break;
             }
@@ -258,7 +264,7 @@ namespace morph {
                 // Use a single colour for each hex, even though hex z positions are
                 // interpolated. Do the _colour_ scaling:
                 std::array<float, 3> clr = this->setColour (hi);
-                if (this->showboundary && (this->hg->vhexen[hi])->boundaryHex() == true) {
+                if (this->showboundary && (this->hg->d_flags[hi] & HEX_IS_BOUNDARY)) {
                     this->markHex (hi);
                 }
                 if (this->showcentre && this->hg->d_x[hi] == 0.0f && this->hg->d_y[hi] == 0.0f) {
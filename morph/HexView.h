@@ -0,0 +1,208 @@
+/*!
+ * \file
+ *
+ * A lightweight view of one hex in a HexGrid, read from the HexGrid's d_ vectors.
+ *
+ * A morph::Hex holds everything about a hex in one ~100 byte object: indices, Cartesian and
+ * polar coordinates, lattice indices, flags and six std::list iterators to its neighbours. An
+ * algorithm that only needs flags, neighbours or coordinates still pulls the whole Hex (and its
+ * list node) through the cache. The HexGrid's d_ vectors hold the 'hot' data (x, y, ri, gi, bi,
+ * flags, neighbour indices and distance to boundary) as structure-of-arrays. HexView gives
+ * those the familiar Hex accessors (onBoundary(), has_ne(), ne(), x_y(), get_vertex_coord()
+ * and so on). The 'cold', derived values, r and phi, are computed when asked for.
+ *
+ * The Hex record itself is unchanged and HexGrid still allocates hexen and vhexen alongside the
+ * d_ vectors, so HexView saves no memory. It makes sweeps over the grid touch less of it.
+ *
+ * A HexView is valid while its HexGrid's d_ vectors are unchanged. It indexes the d_ vectors,
+ * so vi == di, which is the case whenever HexGrid::populate_d_vectors() has been run on a grid
+ * whose vector indices are in order (as they are after HexGrid::setBoundary()).
+ *
+ * \date 2026
+ */
+#pragma once
+
+#include <morph/Hex.h>
+#include <morph/HexGrid.h>
+#include <morph/vec.h>
+#include <morph/mathconst.h>
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cmath>
+
+namespace morph {
+
+    class HexView
+    {
+    public:
+        HexView (const HexGrid* _hg, unsigned int _vi) : hg(_hg), vi(_vi) {}
+
+        //! The HexGrid this view looks into
+        const HexGrid* hg = nullptr;
+        //! The index of the hex in the d_ vectors (and in data vectors arranged like them)
+        unsigned int vi = 0;
+        //! The d_ vector index, which for a HexView is the same as vi
+        unsigned int di() const { return this->vi; }
+
+        /*
+         * Hot data, read straight from the d_ vectors
+         */
+        float x() const { return this->hg->d_x[this->vi]; }
+        float y() const { return this->hg->d_y[this->vi]; }
+        morph::vec<float, 2> x_y() const { return morph::vec<float, 2>({ this->x(), this->y() }); }
+        std::array<float, 3> position() const { return { this->x(), this->y(), this->hg->getz() }; }
+        int ri() const { return this->hg->d_ri[this->vi]; }
+        int gi() const { return this->hg->d_gi[this->vi]; }
+        int bi() const { return this->hg->d_bi[this->vi]; }
+        float distToBoundary() const { return this->hg->d_distToBoundary[this->vi]; }
+        unsigned int getFlags() const { return this->hg->d_flags[this->vi]; }
+
+        /*
+         * Cold data, computed on demand
+         */
+        //! Polar coordinate radius of the centre of the hex
+        float r() const { return std::sqrt (this->x() * this->x() + this->y() * this->y()); }
+        //! Polar coordinate angle
+        float phi() const { return std::atan2 (this->y(), this->x()); }
+        //! The centre-to-centre distance between hexes
+        float d() const { return this->hg->getd(); }
+
+        //! Distance from the centre of this hex to a Cartesian point
+        template <typename LFlt>
+        float distanceFrom (const morph::vec<LFlt, 2> cartesianPoint) const
+        {
+            float dx = cartesianPoint[0] - this->x();
+            float dy = cartesianPoint[1] - this->y();
+            return std::sqrt (dx*dx + dy*dy);
+        }
+        //! Distance from another hex to this one
+        float distanceFrom (const HexView& other) const
+        {
+            float dx = other.x() - this->x();
+            float dy = other.y() - this->y();
+            return std::sqrt (dx*dx + dy*dy);
+        }
+
+        //! The Cartesian coordinate of vertex ni (HEX_VERTEX_POS_NE, etc). As Hex::get_vertex_coord.
+        morph::vec<float, 2> get_vertex_coord (unsigned short ni) const
+        {
+            // Computed as in Hex, so that the coordinates are identical
+            const float sr = this->d() / 2;
+            const float lr = this->d() * morph::mathconst<float>::one_over_root_3;
+            const float vtone = this->d() * morph::mathconst<float>::one_over_2_root_3;
+            switch (ni) {
+            case HEX_VERTEX_POS_NE: { return { this->x() + sr, this->y() + vtone }; }
+            case HEX_VERTEX_POS_N:  { return { this->x(), this->y() + lr }; }
+            case HEX_VERTEX_POS_NW: { return { this->x() - sr, this->y() + vtone }; }
+            case HEX_VERTEX_POS_SW: { return { this->x() - sr, this->y() - vtone }; }
+            case HEX_VERTEX_POS_S:  { return { this->x(), this->y() - lr }; }
+            case HEX_VERTEX_POS_SE: { return { this->x() + sr, this->y() - vtone }; }
+            default: { return { -1.0f, -1.0f }; }
+            }
+        }
+
+        //! Output a string containing just "RG(ri, gi)"
+        std::string outputRG() const
+        {
+            std::string s("RG(");
+            s += std::to_string(this->ri()).substr(0,4) + ",";
+            s += std::to_string(this->gi()).substr(0,4) + ")";
+            return s;
+        }
+
+        /*
+         * Flags, as in Hex
+         */
+        bool testFlags (unsigned int flgs) const { return (this->getFlags() & flgs) == flgs; }
+        bool boundaryHex() const { return (this->getFlags() & HEX_IS_BOUNDARY) ? true : false; }
+        bool insideBoundary() const { return (this->getFlags() & HEX_INSIDE_BOUNDARY) ? true : false; }
+        bool insideDomain() const { return (this->getFlags() & HEX_INSIDE_DOMAIN) ? true : false; }
+        //! True if the hex is missing at least one neighbour
+        bool onBoundary() const { return (this->getFlags() & HEX_HAS_NEIGHB_ALL) != HEX_HAS_NEIGHB_ALL; }
+
+        /*
+         * Neighbours
+         */
+        bool has_ne() const { return this->hg->d_ne[this->vi] != -1; }
+        bool has_nne() const { return this->hg->d_nne[this->vi] != -1; }
+        bool has_nnw() const { return this->hg->d_nnw[this->vi] != -1; }
+        bool has_nw() const { return this->hg->d_nw[this->vi] != -1; }
+        bool has_nsw() const { return this->hg->d_nsw[this->vi] != -1; }
+        bool has_nse() const { return this->hg->d_nse[this->vi] != -1; }
+
+        //! Views of the neighbours. Only valid if the corresponding has_ne() etc is true.
+        HexView ne() const { return HexView (this->hg, this->hg->d_ne[this->vi]); }
+        HexView nne() const { return HexView (this->hg, this->hg->d_nne[this->vi]); }
+        HexView nnw() const { return HexView (this->hg, this->hg->d_nnw[this->vi]); }
+        HexView nw() const { return HexView (this->hg, this->hg->d_nw[this->vi]); }
+        HexView nsw() const { return HexView (this->hg, this->hg->d_nsw[this->vi]); }
+        HexView nse() const { return HexView (this->hg, this->hg->d_nse[this->vi]); }
+
+        //! The d_ index of neighbour ni (HEX_NEIGHBOUR_POS_E, etc) or -1 if there is no such neighbour
+        int neighbour_index (unsigned short ni) const
+        {
+            switch (ni) {
+            case HEX_NEIGHBOUR_POS_E:  { return this->hg->d_ne[this->vi]; }
+            case HEX_NEIGHBOUR_POS_NE: { return this->hg->d_nne[this->vi]; }
+            case HEX_NEIGHBOUR_POS_NW: { return this->hg->d_nnw[this->vi]; }
+            case HEX_NEIGHBOUR_POS_W:  { return this->hg->d_nw[this->vi]; }
+            case HEX_NEIGHBOUR_POS_SW: { return this->hg->d_nsw[this->vi]; }
+            case HEX_NEIGHBOUR_POS_SE: { return this->hg->d_nse[this->vi]; }
+            default: { return -1; }
+            }
+        }
+        bool has_neighbour (unsigned short ni) const { return this->neighbour_index (ni) != -1; }
+        HexView get_neighbour (unsigned short ni) const { return HexView (this->hg, this->neighbour_index (ni)); }
+
+        //! Equal if the views are of the same hex in the same grid
+        bool operator== (const HexView& rhs) const { return this->hg == rhs.hg && this->vi == rhs.vi; }
+        bool operator!= (const HexView& rhs) const { return !(*this == rhs); }
+
+        /*!
+         * Memory footprint per hex. A Hex in HexGrid::hexen costs sizeof(Hex) plus the two
+         * pointers of its std::list node plus its pointer in HexGrid::vhexen. The d_ vectors cost
+         * the sum of one element of each. A HexGrid holds both, so it costs the sum,
+         * resident_bytes_per_hex. HexView only reads the d_ vectors; it neither adds to nor
+         * takes away from this. What it changes is how much of it a sweep over the grid touches.
+         */
+        static constexpr std::size_t hex_bytes_per_hex = sizeof(Hex) + 2 * sizeof(void*) + sizeof(Hex*);
+        static constexpr std::size_t hot_bytes_per_hex = 2 * sizeof(float)      // d_x, d_y
+                                                       + 3 * sizeof(int)        // d_ri, d_gi, d_bi
+                                                       + 6 * sizeof(int)        // d_ne ... d_nse
+                                                       + sizeof(unsigned int)   // d_flags
+                                                       + sizeof(float);         // d_distToBoundary
+        static constexpr std::size_t resident_bytes_per_hex = hex_bytes_per_hex + hot_bytes_per_hex;
+    };
+
+    /*!
+     * A range of HexViews over all the hexes in a HexGrid's d_ vectors, so that code which once
+     * iterated over HexGrid::hexen can write
+     *
+     * \code
+     * for (morph::HexView h : morph::hexviews (hg)) { if (h.onBoundary()) { ... } }
+     * \endcode
+     */
+    struct hexviews
+    {
+        struct iterator
+        {
+            const HexGrid* hg;
+            unsigned int vi;
+            HexView operator*() const { return HexView (this->hg, this->vi); }
+            iterator& operator++() { ++this->vi; return *this; }
+            bool operator!= (const iterator& rhs) const { return this->vi != rhs.vi; }
+            bool operator== (const iterator& rhs) const { return this->vi == rhs.vi; }
+        };
+
+        hexviews (const HexGrid* _hg) : hg(_hg) {}
+        hexviews (const HexGrid& _hg) : hg(&_hg) {}
+
+        iterator begin() const { return iterator{ this->hg, 0u }; }
+        iterator end() const { return iterator{ this->hg, static_cast<unsigned int>(this->hg->d_x.size()) }; }
+        std::size_t size() const { return this->hg->d_x.size(); }
+
+        const HexGrid* hg;
+    };
+
+} // namespace morph
@@ -0,0 +1,259 @@
+/*
+ * A driver for advancing several independent Nelder-Mead simplexes (see NM_Simplex.h) in
+ * lock-step. This is useful for multi-start optimization (many simplexes seeded from different
+ * places on the same objective) and for solving many small, independent problems at once.
+ *
+ * Each 'round', the driver moves every unfinished simplex forward until it needs one or more
+ * objective function values, and collects all of the points that need to be evaluated into a
+ * single batch. Client code computes the values for the whole batch (in parallel, if it wishes)
+ * and then hands them back. As with NM_Simplex, the computation of the objective function is left
+ * to the client code. Usage is like this:
+ *
+ *   morph::NM_Simplex_batch<float> batch;
+ *   batch.add (simplex_a);
+ *   batch.add (simplex_b);
+ *   while (batch.prepare() > 0) {
+ *       // Compute batch.values[i] from batch.points[i] for all i. batch.point_owner[i] says which
+ *       // simplex point i belongs to, should that matter to your objective.
+ *       batch.apply();
+ *   }
+ *
+ * or, more simply, with batch.run (objective) or batch.run_batch (vectorised_objective).
+ *
+ * Because each simplex sees exactly the same sequence of values that it would see if it were
+ * driven on its own, the result for each simplex is identical to a serial run.
+ */
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <morph/NM_Simplex.h>
+#include <morph/vvec.h>
+
+namespace morph {
+
+    template <typename T>
+    class NM_Simplex_batch
+    {
+    public:
+        //! The independent simplexes which are advanced together.
+        std::vector<morph::NM_Simplex<T>> simplexes;
+
+        //! The points for which the client code must compute the objective function this round.
+        morph::vvec<morph::vvec<T>> points;
+
+        //! Client code writes the objective function value for points[i] into values[i].
+        morph::vvec<T> values;
+
+        //! For each entry in points, the index into simplexes of the simplex that it belongs to.
+        morph::vvec<unsigned int> point_owner;
+
+        //! How many rounds (calls to prepare() that produced points) have been made?
+        unsigned long long int rounds = 0;
+
+    private:
+        //! For each simplex, the index of its first point in this->points (or
+        //! std::numeric_limits<unsigned int>::max() if it has no points this round).
+        std::vector<unsigned int> point_start;
+
+        //! Set true by prepare() and false by apply().
+        bool awaiting_values = false;
+
+    public:
+        //! Add a simplex to the batch. It should be in state NeedToComputeThenOrder (i.e. it
+        //! should have been constructed with its initial vertices) and have its parameters
+        //! (termination_threshold, too_many_operations, downhill, etc) already set.
+        void add (const morph::NM_Simplex<T>& s)
+        {
+            if (this->awaiting_values) {
+                throw std::runtime_error ("NM_Simplex_batch::add: Can't add a simplex between prepare() and apply()");
+            }
+            this->simplexes.push_back (s);
+        }
+
+        //! Are all of the simplexes in the ReadyToStop state?
+        bool finished() const
+        {
+            for (auto& s : this->simplexes) {
+                if (s.state != NM_Simplex_State::ReadyToStop) { return false; }
+            }
+            return true;
+        }
+
+        /*!
+         * Advance every simplex until it either needs objective function values or is ready to
+         * stop, then gather all of the points that need evaluating into this->points. Resizes
+         * this->values to match. Returns the number of points to evaluate; if this is 0, all the
+         * simplexes have finished.
+         */
+        std::size_t prepare()
+        {
+            this->points.clear();
+            this->point_owner.clear();
+            this->point_start.assign (this->simplexes.size(), std::numeric_limits<unsigned int>::max());
+
+            for (unsigned int si = 0; si < this->simplexes.size(); ++si) {
+                morph::NM_Simplex<T>& s = this->simplexes[si];
+                while (s.state == NM_Simplex_State::NeedToOrder) { s.order(); }
+
+                switch (s.state) {
+                case NM_Simplex_State::NeedToComputeThenOrder:
+                {
+                    this->point_start[si] = this->points.size();
+                    for (unsigned int i = 0; i <= s.n; ++i) {
+                        this->points.push_back (s.vertices[i]);
+                        this->point_owner.push_back (si);
+                    }
+                    break;
+                }
+                case NM_Simplex_State::NeedToComputeReflection:
+                {
+                    this->point_start[si] = this->points.size();
+                    this->points.push_back (s.xr);
+                    this->point_owner.push_back (si);
+                    break;
+                }
+                case NM_Simplex_State::NeedToComputeExpansion:
+                {
+                    this->point_start[si] = this->points.size();
+                    this->points.push_back (s.xe);
+                    this->point_owner.push_back (si);
+                    break;
+                }
+                case NM_Simplex_State::NeedToComputeContraction:
+                {
+                    this->point_start[si] = this->points.size();
+                    this->points.push_back (s.xc);
+                    this->point_owner.push_back (si);
+                    break;
+                }
+                case NM_Simplex_State::Unknown:
+                {
+                    throw std::runtime_error ("NM_Simplex_batch::prepare: A simplex is in the Unknown state (was it initialised with vertices?)");
+                }
+                default:
+                {
+                    // ReadyToStop. Nothing to do for this simplex.
+                    break;
+                }
+                }
+            }
+
+            this->values.resize (this->points.size(), T{0});
+            this->awaiting_values = !this->points.empty();
+            if (this->awaiting_values) { this->rounds++; }
+            return this->points.size();
+        }
+
+        //! Pass the objective function values in this->values back to their simplexes.
+        void apply()
+        {
+            if (!this->awaiting_values) {
+                throw std::runtime_error ("NM_Simplex_batch::apply: Call prepare() first");
+            }
+            if (this->values.size() != this->points.size()) {
+                throw std::runtime_error ("NM_Simplex_batch::apply: values and points differ in size");
+            }
+
+            for (unsigned int si = 0; si < this->simplexes.size(); ++si) {
+                unsigned int p = this->point_start[si];
+                if (p == std::numeric_limits<unsigned int>::max()) { continue; }
+                morph::NM_Simplex<T>& s = this->simplexes[si];
+
+                switch (s.state) {
+                case NM_Simplex_State::NeedToComputeThenOrder:
+                {
+                    for (unsigned int i = 0; i <= s.n; ++i) { s.values[i] = this->values[p + i]; }
+                    s.order();
+                    break;
+                }
+                case NM_Simplex_State::NeedToComputeReflection:
+                {
+                    s.apply_reflection (this->values[p]);
+                    break;
+                }
+                case NM_Simplex_State::NeedToComputeExpansion:
+                {
+                    s.apply_expansion (this->values[p]);
+                    break;
+                }
+                case NM_Simplex_State::NeedToComputeContraction:
+                {
+                    s.apply_contraction (this->values[p]);
+                    break;
+                }
+                default:
+                {
+                    break;
+                }
+                }
+            }
+            this->awaiting_values = false;
+        }
+
+        /*!
+         * Run all the simplexes to completion with a scalar objective function, which must have
+         * a signature equivalent to T objective (const morph::vvec<T>& x). Each round's batch of
+         * points is evaluated in parallel (with OpenMP, if it's available), so objective must be
+         * safe to call concurrently.
+         */
+        template <typename F>
+        void run (F objective)
+        {
+            while (this->prepare() > 0) {
+                const int np = static_cast<int>(this->points.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+                for (int i = 0; i < np; ++i) {
+                    this->values[i] = objective (this->points[i]);
+                }
+                this->apply();
+            }
+        }
+
+        /*!
+         * Run all the simplexes to completion with a vectorised objective function. This has a
+         * signature equivalent to:
+         *
+         *   void objective_batch (const morph::vvec<morph::vvec<T>>& points, morph::vvec<T>& values)
+         *
+         * and should write the objective for every points[i] into values[i]. This is the hook to
+         * use if your objective is cheap enough that it is better computed in a single tight loop
+         * (or if you want to farm out the evaluation to your own thread pool or GPU).
+         */
+        template <typename F>
+        void run_batch (F objective_batch)
+        {
+            while (this->prepare() > 0) {
+                objective_batch (this->points, this->values);
+                this->apply();
+            }
+        }
+
+        //! Return the index of the simplex whose best vertex is the best of all the simplexes.
+        //! Each simplex's own downhill setting is respected; this assumes they all match.
+        unsigned int best_simplex()
+        {
+            if (this->simplexes.empty()) {
+                throw std::runtime_error ("NM_Simplex_batch::best_simplex: No simplexes");
+            }
+            unsigned int best = 0;
+            for (unsigned int si = 1; si < this->simplexes.size(); ++si) {
+                T v = this->simplexes[si].best_value();
+                T bv = this->simplexes[best].best_value();
+                if ((this->simplexes[si].downhill && v < bv) || (!this->simplexes[si].downhill && v > bv)) {
+                    best = si;
+                }
+            }
+            return best;
+        }
+
+        //! The location of the best vertex of all the simplexes
+        morph::vvec<T> best_vertex() { return this->simplexes[this->best_simplex()].best_vertex(); }
+        //! The value of the best vertex of all the simplexes
+        T best_value() { return this->simplexes[this->best_simplex()].best_value(); }
+    };
+
+} // namespace morph
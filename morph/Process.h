@@ -20,6 +20,7 @@
 #include <iostream>
 extern "C" {
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -87,6 +88,7 @@ namespace morph {
             pauseBeforeStart(0),
             error (PROCESSNOERROR),
             pid(0),
+            exitStatus(0),
             signalledStart(false)
         {
             // Set up the polling structs
@@ -191,6 +193,7 @@ namespace morph {
             this->signalledStart = false;
             this->pauseBeforeStart = 0;
             this->error = PROCESSNOERROR;
+            this->exitStatus = 0;
             this->progName = "unknown";
             this->environment.clear();
             // Ensure all file descriptors are closed.
@@ -314,6 +317,12 @@ namespace morph {
                 close (this->childErrToParent[PROCESS_WRITING_END]);
                 this->childErrToParent[PROCESS_WRITING_END] = 0;
 
+                // Don't let the parent's ends of the pipes leak into any other processes
+                // that are started while this one runs
+                fcntl (this->parentToChild[PROCESS_WRITING_END], F_SETFD, FD_CLOEXEC);
+                fcntl (this->childToParent[PROCESS_READING_END], F_SETFD, FD_CLOEXEC);
+                fcntl (this->childErrToParent[PROCESS_READING_END], F_SETFD, FD_CLOEXEC);
+
                 // Write to this->parentToChild[PROCESS_WRITING_END] to write to stdin of the child
                 // Read from this->childToParent[PROCESS_READING_END] to read from stdout of child
                 // Read from this->childErrToParent[PROCESS_READING_END] to read from stderr of child
@@ -411,7 +420,7 @@ namespace morph {
             int theError;
             if (this->signalledStart == true) {
                 int rtn = 0;
-                if ((rtn = waitpid (this->pid, nullptr, WNOHANG)) == this->pid) {
+                if ((rtn = waitpid (this->pid, &this->exitStatus, WNOHANG)) == this->pid) {
                     if (this->callbacks != nullptr) {
                         this->callbacks->processFinishedSignal (this->progName);
                     }
@@ -433,6 +442,11 @@ namespace morph {
         // Accessors
         pid_t getPid() const { return this->pid; }
         int getError() const { return this->error; }
+        /*!
+         * The status of the finished process, as set by waitpid. Interpret it with the
+         * WIFEXITED, WEXITSTATUS, WIFSIGNALED and WTERMSIG macros.
+         */
+        int getExitStatus() const { return this->exitStatus; }
         void setError (const int e) { this->error = e; }
 
         //! Setter for the callbacks.
@@ -451,8 +465,10 @@ namespace morph {
 
             p.fd = this->childToParent[PROCESS_READING_END];
             p.events = POLLIN | POLLPRI;
-            // We know we have at least one character to read, so seed revents
-            p.revents = POLLIN;
+            // Poll before the first read, so that this never blocks, even if the process
+            // has finished (or left a child holding the pipe open) with nothing to read.
+            p.revents = 0;
+            poll (&p, 1, 0);
             while (p.revents & POLLIN || p.revents & POLLPRI) {
                 // This read of 1 byte should never block
                 if ((bytes = read (this->childToParent[PROCESS_READING_END], &c, 1)) == 1) {
@@ -474,8 +490,9 @@ namespace morph {
 
             p.fd = this->childErrToParent[PROCESS_READING_END];
             p.events = POLLIN | POLLPRI;
-            // We know we have at least one character to read, so seed revents
-            p.revents = POLLIN;
+            // Poll before the first read, so that this never blocks
+            p.revents = 0;
+            poll (&p, 1, 0);
             while (p.revents & POLLIN || p.revents & POLLPRI) {
                 // This read of 1 byte should never block because a poll() call tells us there is data
                 if ((bytes = read (this->childErrToParent[PROCESS_READING_END], &c, 1)) == 1) {
@@ -537,6 +554,9 @@ namespace morph {
         //! Process ID of the program
         pid_t pid;
 
+        //! The status of the program when it finished, from waitpid()
+        int exitStatus;
+
         /*!
          * Set to true if the fact that the program has been started has been signalled
          * using the callback callbacks->startedSignal
@@ -87,6 +87,10 @@ namespace morph {
             this->colourScale.do_autoscale = true;
             this->colourScale.transform ((*this->scalarData), dcopy);
 
+            // 4 vertices and 6 indices per quad (and the same again for any back quads)
+            std::size_t nfaces = this->computeBackQuads == true ? 2U : 1U;
+            this->reserve_vertices (4U * nquads * nfaces, 6U * nquads * nfaces);
+
             morph::vec<float> v0, v1, v2, v3;
             for (unsigned int qi = 0; qi < nquads; ++qi) {
 
@@ -8,7 +8,10 @@
 
 #include <morph/mathconst.h>
 #include <morph/vec.h>
+#include <morph/simd_transform.h>
 #include <limits>
+#include <vector>
+#include <cstddef>
 #include <cmath>
 #include <array>
 #include <iostream>
@@ -316,11 +319,11 @@ namespace morph {
 
             mat[4] = Flt{2}*x*y - Flt{2}*w*z;
             mat[5] = w*w - x*x + y*y - z*z;
-            mat[6] = Flt{2}*y*z - Flt{2}*w*x;
+            mat[6] = Flt{2}*y*z + Flt{2}*w*x;
             mat[7] = Flt{0};
 
             mat[8] = Flt{2}*x*z + Flt{2}*w*y;
-            mat[9] = Flt{2}*y*z + Flt{2}*w*x;
+            mat[9] = Flt{2}*y*z - Flt{2}*w*x;
             mat[10] = w*w - x*x - y*y + z*z;
             mat[11] = Flt{0};
 
@@ -348,11 +351,11 @@ namespace morph {
 
             mat[4] = Flt{2}*x*y - Flt{2}*w*z;
             mat[5] = 1.0 - Flt{2}*x*x - Flt{2}*z*z;
-            mat[6] = Flt{2}*y*z - Flt{2}*w*x;
+            mat[6] = Flt{2}*y*z + Flt{2}*w*x;
             mat[7] = Flt{0};
 
             mat[8] = Flt{2}*x*z + Flt{2}*w*y;
-            mat[9] = Flt{2}*y*z + Flt{2}*w*x;
+            mat[9] = Flt{2}*y*z - Flt{2}*w*x;
             mat[10] = Flt{1} - Flt{2}*x*x - Flt{2}*y*y;
             mat[11] = Flt{0};
 
@@ -362,6 +365,45 @@ namespace morph {
             mat[15] = Flt{1};
         }
 
+        //! Rotate the vector v by this Quaternion: returns q v q* (which is q v q^-1 for a unit q)
+        vec<Flt, 3> operator* (const vec<Flt, 3>& v) const
+        {
+            std::array<Flt, 16> m = this->rotationMatrix();
+            vec<Flt, 3> r;
+            simd_transform::points3 (m.data(), &v, &r, 1);
+            return r;
+        }
+
+        /*!
+         * Rotate n points by this Quaternion: out[i] = q in[i] q*. The rotation matrix is
+         * computed once and applied with the SIMD kernels in morph/simd_transform.h, in parallel
+         * for large n. out may be the same array as in.
+         */
+        void rotate_points (const vec<Flt, 3>* in, vec<Flt, 3>* out, const std::size_t n) const
+        {
+            const std::array<Flt, 16> rm = this->rotationMatrix();
+            const Flt* m = rm.data();
+            simd_transform::blocked (n, [m, in, out](std::size_t i0, std::size_t k) { simd_transform::points3 (m, in + i0, out + i0, k); });
+        }
+
+        //! Rotate points held as separate x, y and z arrays
+        void rotate_points (const Flt* xi, const Flt* yi, const Flt* zi,
+                            Flt* xo, Flt* yo, Flt* zo, const std::size_t n) const
+        {
+            const std::array<Flt, 16> rm = this->rotationMatrix();
+            const Flt* m = rm.data();
+            simd_transform::blocked (n, [=](std::size_t i0, std::size_t k) {
+                simd_transform::points_soa (m, xi + i0, yi + i0, zi + i0, xo + i0, yo + i0, zo + i0, k);
+            });
+        }
+
+        //! Rotate the points in pts in place
+        template <typename Al>
+        void rotate_points (std::vector<vec<Flt, 3>, Al>& pts) const
+        {
+            this->rotate_points (pts.data(), pts.data(), pts.size());
+        }
+
         //! Overload the stream output operator
         friend std::ostream& operator<< <Flt> (std::ostream& os, const Quaternion<Flt>& q);
     };
@@ -11,6 +11,20 @@
 #include <array>
 #include <iomanip>
 #include <cmath>
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <map>
+#include <functional>
+#include <thread>
+#include <exception>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
 #include <hdf5.h>
 #include <morph/MorphDbg.h>
 
@@ -178,6 +192,66 @@ namespace morph {
         float ellipse_a = 1.0f;
         float ellipse_b = 1.0f;
 
+        /*!
+         * The number of members in the ensemble. In ensemble mode, ensemble_size copies
+         * of the model (usually with different parameters) run together on the one
+         * HexGrid. An 'ensemble variable' holds nhex * ensemble_size values with the
+         * member innermost, so that the value for member m at hex hi is at index
+         * hi * ensemble_size + m. A pass over the grid then reads each neighbour index
+         * once for all of the members, and the inner loop over the members vectorises.
+         */
+        unsigned int ensemble_size = 1;
+
+        /*!
+         * Settings for the adaptive and IMEX integrators, step_adaptive() and step_imex().
+         *
+         * step_adaptive keeps the error estimate of each step below abs_tol + rel_tol * |y|
+         * (as a root mean square over all of the variables and hexes). If dt_limit is
+         * greater than 0, it will not make dt larger than dt_limit.
+         */
+        Flt abs_tol = Flt{1e-6};
+        Flt rel_tol = Flt{1e-4};
+        Flt dt_limit = Flt{0};
+
+        /*!
+         * step_imex solves for the diffusion term with a preconditioned conjugate gradient
+         * method, stopping when the residual falls to cg_tol times the norm of the right
+         * hand side, or after cg_maxiter iterations.
+         */
+        Flt cg_tol = Flt{1e-6};
+        unsigned int cg_maxiter = 1000;
+
+        /*!
+         * Statistics from step_adaptive and step_imex
+         */
+        struct integrator_stats
+        {
+            //! Steps accepted and steps rejected (step_imex never rejects a step)
+            unsigned long long accepted = 0;
+            unsigned long long rejected = 0;
+            //! The number of calls to the model's derivative (or reaction) function
+            unsigned long long rhs_evals = 0;
+            //! The smallest, largest and latest accepted step
+            Flt dt_min = std::numeric_limits<Flt>::max();
+            Flt dt_max = Flt{0};
+            Flt dt_last = Flt{0};
+            //! The number of conjugate gradient solves, and their iterations in total
+            unsigned long long cg_solves = 0;
+            unsigned long long cg_iterations = 0;
+            //! The most iterations taken by one solve
+            unsigned int cg_iterations_max = 0;
+            //! The number of solves that stopped at cg_maxiter without reaching cg_tol
+            unsigned long long cg_failures = 0;
+            //! The relative residual at the end of the latest solve
+            Flt cg_residual = Flt{0};
+
+            void reset() { *this = integrator_stats(); }
+        };
+        integrator_stats stats;
+
+        //! The time simulated by step_adaptive and step_imex
+        Flt sim_time = Flt{0};
+
         /*!
          * Simple constructor; no arguments.
          */
@@ -189,7 +263,12 @@ namespace morph {
         /*!
          * Destructor required to free up HexGrid memory
          */
-        ~RD_Base() { delete (this->hg); }
+        ~RD_Base()
+        {
+            // Let an asynchronous checkpoint finish. Any error from it is lost.
+            if (this->checkpoint_thread.joinable()) { this->checkpoint_thread.join(); }
+            delete (this->hg);
+        }
 
         /*!
          * Utility functions to resize/zero vector-vectors that hold N
@@ -262,6 +341,56 @@ namespace morph {
         void resize_vector_variable (std::vector<Flt>& v) { v.resize (this->nhex, Flt{0}); }
         void zero_vector_variable (std::vector<Flt>& v) { v.assign (this->nhex, Flt{0}); }
 
+        /*!
+         * Resize/zero an ensemble variable that'll be nhex * ensemble_size elements long
+         */
+        void resize_ensemble_variable (std::vector<Flt>& v) { v.resize (this->nhex * this->ensemble_size, Flt{0}); }
+        void zero_ensemble_variable (std::vector<Flt>& v) { v.assign (this->nhex * this->ensemble_size, Flt{0}); }
+
+        /*!
+         * Copy ensemble member m of the ensemble variable ev out to the vector variable v
+         * (for saving or plotting, say) or in from v.
+         */
+        void get_ensemble_member (const std::vector<Flt>& ev, unsigned int m, std::vector<Flt>& v)
+        {
+            const unsigned int E = this->ensemble_size;
+            v.resize (this->nhex);
+            for (unsigned int hi = 0; hi < this->nhex; ++hi) { v[hi] = ev[hi * E + m]; }
+        }
+        void set_ensemble_member (std::vector<Flt>& ev, unsigned int m, const std::vector<Flt>& v)
+        {
+            const unsigned int E = this->ensemble_size;
+            for (unsigned int hi = 0; hi < this->nhex; ++hi) { ev[hi * E + m] = v[hi]; }
+        }
+
+        /*!
+         * Remove members from the ensemble variable (or per-member parameter) ev, keeping
+         * only the members listed in keep (which must be in ascending order). Used to drop members that have
+         * finished (converged, or blown up), so that no more work is done on them. ev may
+         * have nhex * ensemble_size elements or just ensemble_size (for a per-member
+         * parameter). Call this for every ensemble variable and parameter, and only then
+         * set ensemble_size to keep.size().
+         */
+        void compact_ensemble_variable (std::vector<Flt>& ev, const std::vector<unsigned int>& keep)
+        {
+            const unsigned int E = this->ensemble_size;
+            const unsigned int Enew = keep.size();
+            if (E == 0 || ev.size() % E != 0) {
+                throw std::runtime_error ("RD_Base::compact_ensemble_variable: ev is not an ensemble variable");
+            }
+            for (unsigned int k = 0; k < Enew; ++k) {
+                if (keep[k] >= E || (k > 0 && keep[k] <= keep[k-1])) {
+                    throw std::runtime_error ("RD_Base::compact_ensemble_variable: keep must list members in ascending order");
+                }
+            }
+            const std::size_t n = ev.size() / E;
+            // Working upwards in place is safe, as each destination is at or below its source
+            for (std::size_t i = 0; i < n; ++i) {
+                for (unsigned int k = 0; k < Enew; ++k) { ev[i * Enew + k] = ev[i * E + keep[k]]; }
+            }
+            ev.resize (n * Enew);
+        }
+
         /*!
          * Resize/zero a parameter that'll be N elements long
          */
@@ -352,13 +481,14 @@ namespace morph {
          */
         void noiseify_vector_variable (std::vector<Flt>& v, Flt offset, Flt gain)
         {
-            morph::RandUniform<Flt> rng;
-            for (auto h : this->hg->hexen) {
+            morph::RandUniform<Flt, morph::xoshiro256pp> rng;
+            rng.fill (v.data(), this->hg->num());
+            for (const auto& h : this->hg->hexen) {
                 // boundarySigmoid. Jumps sharply (100, larger is
                 // sharper) over length scale 0.05 to 1. So if
                 // distance from boundary > 0.05, noise has normal
                 // value. Close to boundary, noise is less.
-                v[h.vi] = rng.get() * gain + offset;
+                v[h.vi] = v[h.vi] * gain + offset;
                 if (h.distToBoundary > -0.5) { // It's possible that distToBoundary is set to -1.0
                     Flt bSig = Flt{1} / ( Flt{1} + std::exp (-Flt{100}*(h.distToBoundary-this->boundaryFalloffDist)) );
                     v[h.vi] = v[h.vi] * bSig;
@@ -366,23 +496,43 @@ namespace morph {
             }
         }
 
+        /*!
+         * noiseify_vector_variable for an ensemble variable. Every member gets its own
+         * noise, with the same roll-off at the boundary.
+         */
+        void noiseify_ensemble_variable (std::vector<Flt>& ev, Flt offset, Flt gain)
+        {
+            const unsigned int E = this->ensemble_size;
+            morph::RandUniform<Flt, morph::xoshiro256pp> rng;
+            rng.fill (ev.data(), this->hg->num() * E);
+            for (const auto& h : this->hg->hexen) {
+                Flt bSig = Flt{1};
+                if (h.distToBoundary > -0.5) {
+                    bSig = Flt{1} / ( Flt{1} + std::exp (-Flt{100}*(h.distToBoundary-this->boundaryFalloffDist)) );
+                }
+                Flt* e = ev.data() + h.vi * E;
+                for (unsigned int m = 0; m < E; ++m) { e[m] = (e[m] * gain + offset) * bSig; }
+            }
+        }
+
         /*!
          * Perform memory allocations, vector resizes and so on.
          */
         virtual void allocate()
         {
-            // Create a HexGrid. 3 is the 'x span' which determines how
-            // many hexes are initially created. 0 is the z co-ordinate for the HexGrid.
-            this->hg = new HexGrid (this->hextohex_d, this->hexspan, 0);
-            DBG ("Initial hexagonal HexGrid has " << this->hg->num() << " hexes");
-
             // Either set a boundary using the svgpath, or set it as an ellipse
             if (this->svgpath != "") {
                 // Read the curves which make a boundary
                 this->r.init (this->svgpath);
-                // Set the boundary in the HexGrid
-                this->hg->setBoundary (this->r.getCorticalPath());
+                // Create the HexGrid with this boundary, or load it from the grid cache if
+                // it has been made before. hexspan is the 'x span' which determines how many
+                // hexes are initially created.
+                this->hg = new HexGrid();
+                this->hg->initCached (this->hextohex_d, this->hexspan, this->r.getCorticalPath());
             } else {
+                // Create a HexGrid. 0 is the z co-ordinate for the HexGrid.
+                this->hg = new HexGrid (this->hextohex_d, this->hexspan, 0);
+                DBG ("Initial hexagonal HexGrid has " << this->hg->num() << " hexes");
                 this->hg->setEllipticalBoundary (this->ellipse_a, this->ellipse_b);
             }
             // Compute the distances from the boundary
@@ -455,7 +605,9 @@ namespace morph {
         virtual void save() {}
 
         /*!
-         * Save position information
+         * Save position information, and the HexGrid itself (in the compact file hexgrid.bin,
+         * from which the HexGrid can be re-loaded to plot the saved data frames; see
+         * HexGrid::saveCompact and examples/hdf_render.cpp)
          */
         void savePositions()
         {
@@ -464,6 +616,7 @@ namespace morph {
             HdfData data(fname.str());
             data.add_val ("/area", this->hg->num() * this->hg->getHexArea());
             this->saveHexPositions (data);
+            this->hg->saveCompact (this->logpath + "/hexgrid.bin");
         }
 
         /*!
@@ -684,6 +837,668 @@ namespace morph {
             }
         }
 
+        /*!
+         * Compute the laplacian of the ensemble variable F, with the result placed in
+         * lapF. Each member's result is the same as compute_laplace would give for that
+         * member alone.
+         */
+        void compute_laplace_ensemble (const std::vector<Flt>& F, std::vector<Flt>& lapF)
+        {
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi=0; hi<this->nhex; ++hi) {
+                this->compute_laplace_ensemble (F.data(), hi, lapF.data() + hi * this->ensemble_size);
+            }
+        }
+
+        /*!
+         * Compute the laplacian of the ensemble variable F at Hex hi, for all of the
+         * members, with the result placed in lap[0] to lap[ensemble_size-1]. For models
+         * that combine the laplacian with their reaction terms in a single pass over the
+         * grid, so that the laplacian is never stored.
+         */
+        void compute_laplace_ensemble (const Flt* F, const unsigned int hi, Flt* lap) const
+        {
+            const unsigned int E = this->ensemble_size;
+            const Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+            // Missing neighbours are ghosts with the same value as Hex hi
+            auto row = [F, hi, E](int nb) { return F + (nb == -1 ? hi : static_cast<unsigned int>(nb)) * E; };
+            const Flt* f = F + hi * E;
+            const Flt* f_ne = row (NE(hi));
+            const Flt* f_nne = row (NNE(hi));
+            const Flt* f_nnw = row (NNW(hi));
+            const Flt* f_nw = row (NW(hi));
+            const Flt* f_nsw = row (NSW(hi));
+            const Flt* f_nse = row (NSE(hi));
+#pragma omp simd
+            for (unsigned int m = 0; m < E; ++m) {
+                lap[m] = norm * (Flt{-6} * f[m] + f_ne[m] + f_nne[m] + f_nnw[m] + f_nw[m] + f_nsw[m] + f_nse[m]);
+            }
+        }
+
+        /*!
+         * Adaptive time stepping with the Dormand-Prince 5(4) embedded Runge-Kutta method.
+         *
+         * Advance the variables y (pointers to each of the model's vector variables) by one
+         * step, trying a step of dt first. rhs (y, dydt) computes the time derivative of
+         * every variable (reaction and diffusion) and writes it into dydt; it is given the
+         * variables in the same order as y. If the error estimate for the step is too large
+         * (see abs_tol and rel_tol), the step is retried with a smaller dt. After the step,
+         * dt is set for the next one, so that the model takes steps as large as the
+         * tolerances allow. Returns the length of the step taken.
+         *
+         * The last stage of an accepted step is the derivative at the new y, which is the
+         * first stage of the next step ("first same as last"), so a step costs six calls
+         * to rhs, not seven. If the variables are changed between steps, this is detected
+         * and rhs is called again. If the derivative itself changes (a parameter of the
+         * model is changed, say), call adaptive_restart() before the next step.
+         */
+        template <typename F>
+        Flt step_adaptive (const std::vector<std::vector<Flt>*>& y, F rhs)
+        {
+            // The Dormand-Prince tableau. a[s] gives stage s's test point; the last row
+            // is also the 5th order solution. e is the difference between the 5th and the
+            // embedded 4th order solutions.
+            static constexpr double a[7][6] = {
+                { 0, 0, 0, 0, 0, 0 },
+                { 1.0/5.0, 0, 0, 0, 0, 0 },
+                { 3.0/40.0, 9.0/40.0, 0, 0, 0, 0 },
+                { 44.0/45.0, -56.0/15.0, 32.0/9.0, 0, 0, 0 },
+                { 19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0, 0, 0 },
+                { 9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0, 0 },
+                { 35.0/384.0, 0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0 }
+            };
+            static constexpr double e[7] = {
+                71.0/57600.0, 0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0
+            };
+
+            const unsigned int nv = y.size();
+
+            // rk_ys holds the y accepted in the previous step and rk_k[0] the derivative
+            // there, unless the variables have been changed since
+            bool fsal = this->rk_fsal && this->rk_ys.size() == nv && this->rk_k.size() == 7;
+            for (unsigned int v = 0; fsal && v < nv; ++v) { fsal = (*y[v] == this->rk_ys[v]); }
+
+            this->rk_y0.resize (nv);
+            this->rk_ys.resize (nv);
+            this->rk_k.resize (7);
+            if (fsal) {
+                this->rk_y0.swap (this->rk_ys);
+            } else {
+                for (auto& k : this->rk_k) { this->resize_vector_vector (k, nv); }
+                for (unsigned int v = 0; v < nv; ++v) { this->rk_y0[v] = *y[v]; }
+                rhs (this->rk_y0, this->rk_k[0]);
+                ++this->stats.rhs_evals;
+            }
+            for (unsigned int v = 0; v < nv; ++v) { this->rk_ys[v].resize (this->nhex); }
+
+            while (true) {
+                const Flt h = this->dt;
+                for (unsigned int s = 1; s < 7; ++s) {
+                    for (unsigned int v = 0; v < nv; ++v) {
+#pragma omp parallel for
+                        for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+                            Flt sum = Flt{0};
+                            for (unsigned int j = 0; j < s; ++j) { sum += static_cast<Flt>(a[s][j]) * this->rk_k[j][v][hi]; }
+                            this->rk_ys[v][hi] = this->rk_y0[v][hi] + h * sum;
+                        }
+                    }
+                    rhs (this->rk_ys, this->rk_k[s]);
+                    ++this->stats.rhs_evals;
+                }
+
+                // The root mean square of the error estimate, scaled by the tolerances
+                double errsum = 0.0;
+                for (unsigned int v = 0; v < nv; ++v) {
+#pragma omp parallel for reduction(+:errsum)
+                    for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+                        Flt err = Flt{0};
+                        for (unsigned int j = 0; j < 7; ++j) { err += static_cast<Flt>(e[j]) * this->rk_k[j][v][hi]; }
+                        const Flt sc = this->abs_tol + this->rel_tol * std::max (std::abs (this->rk_y0[v][hi]),
+                                                                                 std::abs (this->rk_ys[v][hi]));
+                        const double r = h * err / sc;
+                        errsum += r * r;
+                    }
+                }
+                const double errnorm = std::sqrt (errsum / (static_cast<double>(nv) * this->nhex));
+
+                // Choose the next step size, with a safety factor and limits on how fast it changes
+                double fac = errnorm > 0.0 ? 0.9 * std::pow (errnorm, -0.2) : 5.0;
+                if (!std::isfinite (errnorm)) { fac = 0.2; }
+                fac = std::min (5.0, std::max (0.2, fac));
+                Flt h_next = static_cast<Flt>(h * fac);
+                if (this->dt_limit > Flt{0}) { h_next = std::min (h_next, this->dt_limit); }
+
+                if (errnorm <= 1.0) {
+                    // Keep the accepted y in rk_ys, and its derivative, the last stage, as
+                    // the first stage of the next step
+                    for (unsigned int v = 0; v < nv; ++v) { *y[v] = this->rk_ys[v]; }
+                    this->rk_k[0].swap (this->rk_k[6]);
+                    this->rk_fsal = true;
+                    this->sim_time += h;
+                    ++this->stats.accepted;
+                    this->stats.dt_min = std::min (this->stats.dt_min, h);
+                    this->stats.dt_max = std::max (this->stats.dt_max, h);
+                    this->stats.dt_last = h;
+                    // Don't grow straight after a rejection
+                    this->set_dt (this->rk_rejected ? std::min (h, h_next) : h_next);
+                    this->rk_rejected = false;
+                    return h;
+                }
+                ++this->stats.rejected;
+                this->rk_rejected = true;
+                if (!(h_next > std::numeric_limits<Flt>::min())) {
+                    throw std::runtime_error ("RD_Base::step_adaptive: step size underflow");
+                }
+                this->set_dt (h_next);
+            }
+        }
+
+        /*!
+         * Implicit-explicit (IMEX) time stepping, for models whose diffusion terms limit
+         * the explicit step size (which falls with the square of the hex to hex distance).
+         *
+         * The model is dy/dt = D del^2 y + R(y), for each variable y, with diffusion
+         * constant D. The diffusion term is treated implicitly, with the Crank-Nicolson
+         * method, so that it does not limit the step size. The reaction terms are treated
+         * explicitly with second order Adams-Bashforth (Euler on the first step). Each step
+         * requires one sparse linear solve per variable, with the hex grid laplacian,
+         * which is done by the conjugate gradient method with a diagonal preconditioner.
+         *
+         * y holds pointers to the model's vector variables and D their diffusion constants.
+         * reaction (y, R) computes just the reaction terms of every variable, writing them
+         * into R. The step is dt, which can be changed between steps. Call imex_restart()
+         * after changing the variables outside step_imex, so that the Adams-Bashforth step
+         * doesn't use a reaction term from before the change.
+         */
+        template <typename F>
+        void step_imex (const std::vector<std::vector<Flt>*>& y, const std::vector<Flt>& D, F reaction)
+        {
+            const unsigned int nv = y.size();
+            if (nv == 0) { return; }
+            if (D.size() != nv) {
+                throw std::runtime_error ("RD_Base::step_imex: Need one diffusion constant per variable");
+            }
+            if (this->imex_R.size() != nv || this->imex_R[0].size() != this->nhex) {
+                this->resize_vector_vector (this->imex_R, nv);
+            }
+            // imex_Rprev is the reaction term from the last step (which may have come from a checkpoint)
+            if (this->imex_Rprev.size() != nv || this->imex_Rprev[0].size() != this->nhex) {
+                this->resize_vector_vector (this->imex_Rprev, nv);
+                this->imex_restart();
+            }
+            this->rk_y0.resize (nv);
+            for (unsigned int v = 0; v < nv; ++v) { this->rk_y0[v] = *y[v]; }
+            reaction (this->rk_y0, this->imex_R);
+            ++this->stats.rhs_evals;
+
+            // Variable step Adams-Bashforth weights
+            const Flt h = this->dt;
+            const Flt w = this->imex_dt_prev > Flt{0} ? h / this->imex_dt_prev : Flt{0};
+            const Flt wn = Flt{1} + w / Flt{2};
+            const Flt wp = -w / Flt{2};
+
+            this->resize_vector_variable (this->cg_b);
+            for (unsigned int v = 0; v < nv; ++v) {
+                std::vector<Flt>& u = *y[v];
+                const Flt c = h * D[v] / Flt{2};
+                // The right hand side; (1 + c L) u + h R*
+                this->compute_laplace (u, this->cg_b);
+#pragma omp parallel for
+                for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+                    this->cg_b[hi] = u[hi] + c * this->cg_b[hi]
+                    + h * (wn * this->imex_R[v][hi] + wp * this->imex_Rprev[v][hi]);
+                }
+                if (c == Flt{0}) {
+                    u.swap (this->cg_b);
+                } else {
+                    // Solve (1 - c L) u = b, starting from the current u
+                    this->solve_implicit_diffusion (c, this->cg_b, u);
+                }
+            }
+
+            this->imex_R.swap (this->imex_Rprev);
+            this->imex_dt_prev = h;
+            this->sim_time += h;
+            ++this->stats.accepted;
+            this->stats.dt_min = std::min (this->stats.dt_min, h);
+            this->stats.dt_max = std::max (this->stats.dt_max, h);
+            this->stats.dt_last = h;
+        }
+
+        //! Make the next step_adaptive evaluate the derivative at its start, rather than
+        //! reuse the last stage of the previous step
+        void adaptive_restart() { this->rk_fsal = false; }
+
+        //! Make the next step_imex start again with an Euler step for the reaction terms
+        void imex_restart()
+        {
+            this->imex_dt_prev = Flt{0};
+            this->zero_vector_vector (this->imex_Rprev, this->imex_Rprev.size());
+        }
+
+        /*!
+         * Solve (1 - c L) x = b for x, where L is the laplacian of compute_laplace (with its
+         * ghost neighbours at the boundary) and c > 0, by the conjugate gradient method
+         * with a diagonal (Jacobi) preconditioner. (1 - c L) is symmetric and positive
+         * definite. x should hold an initial guess. The iterations are counted in stats.
+         */
+        void solve_implicit_diffusion (const Flt c, const std::vector<Flt>& b, std::vector<Flt>& x)
+        {
+            const unsigned int n = this->nhex;
+            const Flt norm = Flt{2} / (Flt{3} * this->d * this->d);
+            for (auto p : { &this->cg_r, &this->cg_z, &this->cg_p, &this->cg_Ap, &this->cg_diag }) { this->resize_vector_variable (*p); }
+
+            // The preconditioner is the inverse of the diagonal of (1 - c L). Only the real
+            // neighbours of a hex contribute to the diagonal of L; a ghost cancels itself.
+#pragma omp parallel for
+            for (unsigned int hi = 0; hi < n; ++hi) {
+                const int nn = HAS_NE(hi) + HAS_NNE(hi) + HAS_NNW(hi) + HAS_NW(hi) + HAS_NSW(hi) + HAS_NSE(hi);
+                this->cg_diag[hi] = Flt{1} / (Flt{1} + c * norm * nn);
+            }
+
+            // r = b - A x, z = M^-1 r, p = z
+            this->compute_laplace (x, this->cg_Ap);
+            double rz = 0.0;
+            double rr = 0.0;
+            double bb = 0.0;
+#pragma omp parallel for reduction(+:rz,rr,bb)
+            for (unsigned int hi = 0; hi < n; ++hi) {
+                this->cg_r[hi] = b[hi] - (x[hi] - c * this->cg_Ap[hi]);
+                this->cg_z[hi] = this->cg_diag[hi] * this->cg_r[hi];
+                this->cg_p[hi] = this->cg_z[hi];
+                rz += static_cast<double>(this->cg_r[hi]) * this->cg_z[hi];
+                rr += static_cast<double>(this->cg_r[hi]) * this->cg_r[hi];
+                bb += static_cast<double>(b[hi]) * b[hi];
+            }
+            const double target = static_cast<double>(this->cg_tol) * this->cg_tol * (bb > 0.0 ? bb : 1.0);
+
+            unsigned int it = 0;
+            while (rr > target && it < this->cg_maxiter) {
+                this->compute_laplace (this->cg_p, this->cg_Ap);
+                double pAp = 0.0;
+#pragma omp parallel for reduction(+:pAp)
+                for (unsigned int hi = 0; hi < n; ++hi) {
+                    this->cg_Ap[hi] = this->cg_p[hi] - c * this->cg_Ap[hi];
+                    pAp += static_cast<double>(this->cg_p[hi]) * this->cg_Ap[hi];
+                }
+                const Flt alpha = static_cast<Flt>(rz / pAp);
+                double rz_new = 0.0;
+                rr = 0.0;
+#pragma omp parallel for reduction(+:rz_new,rr)
+                for (unsigned int hi = 0; hi < n; ++hi) {
+                    x[hi] += alpha * this->cg_p[hi];
+                    this->cg_r[hi] -= alpha * this->cg_Ap[hi];
+                    this->cg_z[hi] = this->cg_diag[hi] * this->cg_r[hi];
+                    rz_new += static_cast<double>(this->cg_r[hi]) * this->cg_z[hi];
+                    rr += static_cast<double>(this->cg_r[hi]) * this->cg_r[hi];
+                }
+                const Flt beta = static_cast<Flt>(rz_new / rz);
+                rz = rz_new;
+#pragma omp parallel for
+                for (unsigned int hi = 0; hi < n; ++hi) {
+                    this->cg_p[hi] = this->cg_z[hi] + beta * this->cg_p[hi];
+                }
+                ++it;
+            }
+
+            ++this->stats.cg_solves;
+            this->stats.cg_iterations += it;
+            this->stats.cg_iterations_max = std::max (this->stats.cg_iterations_max, it);
+            this->stats.cg_residual = static_cast<Flt>(std::sqrt (rr / (bb > 0.0 ? bb : 1.0)));
+            if (rr > target) { ++this->stats.cg_failures; }
+        }
+
+        /*!
+         * Checkpoint and restart.
+         *
+         * A model registers the arrays and objects that make up its state (in allocate(),
+         * say) with register_checkpoint(). checkpoint() then copies all of them, along with
+         * RD_Base's own state (stepCount, dt, sim_time, ensemble_size and the integrators'
+         * history), into one buffer, and writes that to a single file in a background
+         * thread. There are two buffers, so the solver only pauses for the copy, unless the
+         * previous checkpoint is still being written. restore_checkpoint() reads the file
+         * back into the registered state, after which the model continues exactly (bit for
+         * bit) as it would have done from the checkpoint.
+         *
+         * Register a vector of trivially copyable values (Flt, int, ...). On restore, the
+         * vector is resized to match the file.
+         */
+        template <typename T>
+        void register_checkpoint (const std::string& name, std::vector<T>& v)
+        {
+            static_assert (std::is_trivially_copyable<T>::value, "register_checkpoint: T must be trivially copyable");
+            this->add_checkpoint_entry (
+                name,
+                [&v](std::vector<char>& buf) {
+                    const char* p = reinterpret_cast<const char*>(v.data());
+                    buf.insert (buf.end(), p, p + v.size() * sizeof (T));
+                },
+                [&v, name](const char* p, std::size_t n) {
+                    if (n % sizeof (T) != 0) {
+                        throw std::runtime_error ("RD_Base::restore_checkpoint: " + name + " has the wrong size");
+                    }
+                    v.resize (n / sizeof (T));
+                    if (n > 0) { std::memcpy (v.data(), p, n); }
+                });
+        }
+
+        //! Register a vector of vectors (of possibly different lengths) for checkpointing
+        template <typename T>
+        void register_checkpoint (const std::string& name, std::vector<std::vector<T>>& vv)
+        {
+            static_assert (std::is_trivially_copyable<T>::value, "register_checkpoint: T must be trivially copyable");
+            this->add_checkpoint_entry (
+                name,
+                [&vv](std::vector<char>& buf) {
+                    auto put = [&buf](const void* p, std::size_t n) {
+                        buf.insert (buf.end(), static_cast<const char*>(p), static_cast<const char*>(p) + n);
+                    };
+                    const std::uint64_t rows = vv.size();
+                    put (&rows, sizeof (rows));
+                    for (const auto& v : vv) {
+                        const std::uint64_t len = v.size();
+                        put (&len, sizeof (len));
+                        put (v.data(), len * sizeof (T));
+                    }
+                },
+                [&vv, name](const char* p, std::size_t n) {
+                    const char* end = p + n;
+                    auto get = [&p, end, &name](void* dst, std::size_t bytes) {
+                        if (static_cast<std::size_t>(end - p) < bytes) {
+                            throw std::runtime_error ("RD_Base::restore_checkpoint: " + name + " is truncated");
+                        }
+                        if (bytes > 0) { std::memcpy (dst, p, bytes); }
+                        p += bytes;
+                    };
+                    std::uint64_t rows = 0;
+                    get (&rows, sizeof (rows));
+                    if (rows > n) { throw std::runtime_error ("RD_Base::restore_checkpoint: " + name + " is corrupt"); }
+                    vv.resize (rows);
+                    for (auto& v : vv) {
+                        std::uint64_t len = 0;
+                        get (&len, sizeof (len));
+                        if (len > n / sizeof (T)) { throw std::runtime_error ("RD_Base::restore_checkpoint: " + name + " is corrupt"); }
+                        v.resize (len);
+                        get (v.data(), len * sizeof (T));
+                    }
+                });
+        }
+
+        //! Register a single trivially copyable object (a parameter, a counter or a struct)
+        template <typename T>
+        void register_checkpoint (const std::string& name, T& obj)
+        {
+            static_assert (std::is_trivially_copyable<T>::value,
+                           "register_checkpoint: T must be trivially copyable; see register_checkpoint_text");
+            this->add_checkpoint_entry (
+                name,
+                [&obj](std::vector<char>& buf) {
+                    const char* p = reinterpret_cast<const char*>(&obj);
+                    buf.insert (buf.end(), p, p + sizeof (T));
+                },
+                [&obj, name](const char* p, std::size_t n) {
+                    if (n != sizeof (T)) {
+                        throw std::runtime_error ("RD_Base::restore_checkpoint: " + name + " has the wrong size");
+                    }
+                    std::memcpy (static_cast<void*>(&obj), p, n);
+                });
+        }
+
+        /*!
+         * Register an object that can be written with operator<< and read back with
+         * operator>>. Use this for random number generators: the std:: engines and
+         * distributions, and morph::RandUniform, RandNormal and so on, all write their full
+         * state this way.
+         */
+        template <typename T>
+        void register_checkpoint_text (const std::string& name, T& obj)
+        {
+            this->add_checkpoint_entry (
+                name,
+                [&obj](std::vector<char>& buf) {
+                    std::ostringstream os;
+                    os << obj;
+                    const std::string st = os.str();
+                    buf.insert (buf.end(), st.begin(), st.end());
+                },
+                [&obj, name](const char* p, std::size_t n) {
+                    std::istringstream is (std::string (p, n));
+                    is >> obj;
+                    if (is.fail()) { throw std::runtime_error ("RD_Base::restore_checkpoint: Failed to read " + name); }
+                });
+        }
+
+        //! Forget all registered checkpoint state
+        void clear_checkpoint_registry() { this->checkpoint_entries.clear(); }
+
+        //! If false, checkpoint() writes the file before returning
+        bool checkpoint_async = true;
+
+        /*!
+         * Write a checkpoint to path (see register_checkpoint). The file is written to a
+         * temporary name and then renamed, so a crash while writing never leaves a partial
+         * checkpoint at path. Any error from writing the previous checkpoint is thrown here
+         * (or from checkpoint_wait).
+         */
+        void checkpoint (const std::string& path)
+        {
+            // Fill the buffer that is not being written out by the previous checkpoint
+            std::vector<char>& buf = this->checkpoint_buf[this->checkpoint_next];
+            buf.clear();
+            checkpoint_header hdr;
+            hdr.flt_size = sizeof (Flt);
+            hdr.nhex = this->nhex;
+            const char* hp = reinterpret_cast<const char*>(&hdr);
+            buf.insert (buf.end(), hp, hp + sizeof (hdr));
+            std::uint32_t n_entries = 0;
+            auto write_entries = [&buf, &n_entries](const std::vector<checkpoint_entry>& entries) {
+                for (const auto& e : entries) {
+                    const std::uint32_t namelen = e.name.size();
+                    const char* np = reinterpret_cast<const char*>(&namelen);
+                    buf.insert (buf.end(), np, np + sizeof (namelen));
+                    buf.insert (buf.end(), e.name.begin(), e.name.end());
+                    // The length of the data goes before it, once it is known
+                    const std::size_t lenpos = buf.size();
+                    buf.resize (buf.size() + sizeof (std::uint64_t));
+                    e.save (buf);
+                    const std::uint64_t len = buf.size() - lenpos - sizeof (std::uint64_t);
+                    std::memcpy (buf.data() + lenpos, &len, sizeof (len));
+                    ++n_entries;
+                }
+            };
+            write_entries (this->base_checkpoint_entries());
+            write_entries (this->checkpoint_entries);
+            hdr.n_entries = n_entries;
+            hdr.bytes = buf.size();
+            std::memcpy (buf.data(), &hdr, sizeof (hdr));
+
+            // Wait for the previous checkpoint, then write this one
+            this->checkpoint_wait();
+            this->checkpoint_next ^= 1;
+            if (this->checkpoint_async) {
+                this->checkpoint_thread = std::thread ([this, &buf, path]() {
+                    try {
+                        RD_Base<Flt>::write_checkpoint_file (path, buf);
+                    } catch (...) {
+                        this->checkpoint_error = std::current_exception();
+                    }
+                });
+            } else {
+                RD_Base<Flt>::write_checkpoint_file (path, buf);
+            }
+        }
+
+        //! Wait until the last checkpoint has been written. Throws if writing it failed.
+        void checkpoint_wait()
+        {
+            if (this->checkpoint_thread.joinable()) { this->checkpoint_thread.join(); }
+            if (this->checkpoint_error) {
+                std::exception_ptr e = this->checkpoint_error;
+                this->checkpoint_error = nullptr;
+                std::rethrow_exception (e);
+            }
+        }
+
+        /*!
+         * Restore the state written by checkpoint() to path. The model must have been
+         * allocated, on the same HexGrid, and must have registered the same state. Throws
+         * if the file does not match the model.
+         */
+        void restore_checkpoint (const std::string& path)
+        {
+            this->checkpoint_wait();
+            std::ifstream f (path, std::ios::binary | std::ios::ate);
+            if (!f.is_open()) { throw std::runtime_error ("RD_Base::restore_checkpoint: Failed to open " + path); }
+            std::vector<char> buf (static_cast<std::size_t>(f.tellg()));
+            f.seekg (0);
+            f.read (buf.data(), buf.size());
+            if (!f.good()) { throw std::runtime_error ("RD_Base::restore_checkpoint: Failed to read " + path); }
+
+            checkpoint_header hdr;
+            const checkpoint_header expected;
+            if (buf.size() < sizeof (hdr)) { throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " is too short"); }
+            std::memcpy (&hdr, buf.data(), sizeof (hdr));
+            if (std::memcmp (hdr.magic, expected.magic, sizeof (hdr.magic)) != 0 || hdr.version != expected.version) {
+                throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " is not a checkpoint file");
+            }
+            if (hdr.byte_order != expected.byte_order || hdr.flt_size != sizeof (Flt)) {
+                throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " was written with a different byte order or Flt");
+            }
+            if (hdr.bytes != buf.size()) { throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " is truncated"); }
+            if (hdr.nhex != this->nhex) {
+                throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " is for a HexGrid of "
+                                          + std::to_string (hdr.nhex) + " hexes, not " + std::to_string (this->nhex));
+            }
+
+            // Index the entries
+            std::map<std::string, std::pair<const char*, std::size_t>> index;
+            std::size_t pos = sizeof (hdr);
+            auto need = [&buf, &pos, &path](std::size_t n) {
+                if (buf.size() - pos < n) { throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " is corrupt"); }
+            };
+            for (std::uint32_t i = 0; i < hdr.n_entries; ++i) {
+                std::uint32_t namelen = 0;
+                need (sizeof (namelen));
+                std::memcpy (&namelen, buf.data() + pos, sizeof (namelen));
+                pos += sizeof (namelen);
+                need (namelen);
+                std::string name (buf.data() + pos, namelen);
+                pos += namelen;
+                std::uint64_t len = 0;
+                need (sizeof (len));
+                std::memcpy (&len, buf.data() + pos, sizeof (len));
+                pos += sizeof (len);
+                need (len);
+                index[name] = { buf.data() + pos, len };
+                pos += len;
+            }
+
+            // Check that everything is there before changing anything
+            std::vector<checkpoint_entry> base = this->base_checkpoint_entries();
+            for (const auto* entries : { &base, &this->checkpoint_entries }) {
+                for (const auto& e : *entries) {
+                    if (index.count (e.name) == 0) {
+                        throw std::runtime_error ("RD_Base::restore_checkpoint: " + path + " has no " + e.name);
+                    }
+                }
+            }
+            for (const auto* entries : { &base, &this->checkpoint_entries }) {
+                for (const auto& e : *entries) {
+                    const auto& [p, n] = index[e.name];
+                    e.load (p, n);
+                }
+            }
+            // Recompute the members that depend on dt
+            this->set_dt (this->dt);
+        }
+
+    private:
+        //! Working space for step_adaptive
+        std::vector<std::vector<Flt>> rk_y0;
+        std::vector<std::vector<Flt>> rk_ys;
+        std::vector<std::vector<std::vector<Flt>>> rk_k;
+        bool rk_rejected = false;
+        //! True if rk_ys and rk_k[0] hold the y accepted by the last step and its derivative
+        bool rk_fsal = false;
+        //! Working space for step_imex and solve_implicit_diffusion
+        std::vector<std::vector<Flt>> imex_R;
+        std::vector<std::vector<Flt>> imex_Rprev;
+        Flt imex_dt_prev = Flt{0};
+        std::vector<Flt> cg_b, cg_r, cg_z, cg_p, cg_Ap, cg_diag;
+
+        //! Working space and registry for checkpoint()
+        struct checkpoint_entry
+        {
+            std::string name;
+            //! Append the state to a buffer
+            std::function<void(std::vector<char>&)> save;
+            //! Restore the state from n bytes at p
+            std::function<void(const char*, std::size_t)> load;
+        };
+        std::vector<checkpoint_entry> checkpoint_entries;
+        std::array<std::vector<char>, 2> checkpoint_buf;
+        unsigned int checkpoint_next = 0;
+        std::thread checkpoint_thread;
+        std::exception_ptr checkpoint_error = nullptr;
+
+        struct checkpoint_header
+        {
+            char magic[8] = { 'M', 'O', 'R', 'P', 'H', 'C', 'K', 'P' };
+            std::uint32_t version = 1;
+            //! Reads 0x01020304 on a machine with the byte order of the one that wrote the file
+            std::uint32_t byte_order = 0x01020304;
+            std::uint32_t flt_size = 0;
+            std::uint32_t nhex = 0;
+            std::uint32_t n_entries = 0;
+            std::uint32_t reserved = 0;
+            //! The size of the whole file
+            std::uint64_t bytes = 0;
+        };
+
+        void add_checkpoint_entry (const std::string& name,
+                                   std::function<void(std::vector<char>&)> save,
+                                   std::function<void(const char*, std::size_t)> load)
+        {
+            for (const auto& e : this->checkpoint_entries) {
+                if (e.name == name) { throw std::runtime_error ("RD_Base::register_checkpoint: " + name + " is already registered"); }
+            }
+            this->checkpoint_entries.push_back ({ name, save, load });
+        }
+
+        //! RD_Base's own state, which is always checkpointed
+        std::vector<checkpoint_entry> base_checkpoint_entries()
+        {
+            std::vector<checkpoint_entry> saved;
+            saved.swap (this->checkpoint_entries);
+            this->register_checkpoint ("/rd_base/stepCount", this->stepCount);
+            this->register_checkpoint ("/rd_base/dt", this->dt);
+            this->register_checkpoint ("/rd_base/sim_time", this->sim_time);
+            this->register_checkpoint ("/rd_base/ensemble_size", this->ensemble_size);
+            this->register_checkpoint ("/rd_base/stats", this->stats);
+            this->register_checkpoint ("/rd_base/rk_rejected", this->rk_rejected);
+            this->register_checkpoint ("/rd_base/imex_dt_prev", this->imex_dt_prev);
+            this->register_checkpoint ("/rd_base/imex_Rprev", this->imex_Rprev);
+            saved.swap (this->checkpoint_entries);
+            return saved;
+        }
+
+        static void write_checkpoint_file (const std::string& path, const std::vector<char>& buf)
+        {
+            const std::string tmppath = path + ".tmp" + std::to_string (::getpid());
+            {
+                std::ofstream f (tmppath, std::ios::binary | std::ios::trunc);
+                if (!f.is_open()) { throw std::runtime_error ("RD_Base::checkpoint: Failed to open " + tmppath); }
+                f.write (buf.data(), buf.size());
+                if (!f.good()) {
+                    std::remove (tmppath.c_str());
+                    throw std::runtime_error ("RD_Base::checkpoint: Failed to write " + tmppath);
+                }
+            }
+            if (std::rename (tmppath.c_str(), path.c_str()) != 0) {
+                std::remove (tmppath.c_str());
+                throw std::runtime_error ("RD_Base::checkpoint: Failed to rename " + tmppath + " to " + path);
+            }
+        }
     }; // RD_Base
 
 } // namespace morph
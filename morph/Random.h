@@ -6,8 +6,13 @@
 #include <type_traits>
 #include <string>
 #include <ostream>
+#include <istream>
 #include <array>
 #include <cuchar>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
 
 /*!
  * \file Random.h
@@ -52,10 +57,20 @@
  * double sample2 = randDouble.get();
  * \endcode
  *
- * A final note: There are some faster RNG algorithms on the
- * block. Xoroshiro/Xoshiro/Xorshift and SplitMix64. These don't appear to be in the c++
- * standard as yet, but they're short and could probably be implemented easily here,
- * another day.
+ * Two faster engines that are not (yet) in the C++ standard are implemented here and may be
+ * used as E: morph::xoshiro256pp (xoshiro256++, seeded with SplitMix64) and morph::philox4x32
+ * (the counter based Philox4x32-10). Each has a 'stream' constructor argument which gives
+ * independent sequences from one seed, for use in separate threads.
+ *
+ * To fill a lot of memory with random numbers, use the fill() methods, which are much faster
+ * than calling get() in a loop. RandUniform<float/double>::fill() converts the engine's bits
+ * straight into numbers; RandNormal::fill() and RandLogNormal::fill() use the Ziggurat
+ * method. Note that fill() gives different sequences from get() with the same seed.
+ *
+ * For reproducible parallel noise, morph::parallel_uniform_fill() and
+ * morph::parallel_normal_fill() fill an array in blocks, on all threads, each block from its
+ * own Philox substream. The result depends only on the seed and stream arguments, not on the
+ * number of threads.
  */
 
 namespace morph {
@@ -65,6 +80,404 @@ namespace morph {
     // de-duplicated. max(), min() and get() methods all need the dist member
     // attribute, so each one has to be written out in each wrapper class. So it goes.
 
+    /*!
+     * The xoshiro256++ engine of Blackman and Vigna (https://prng.di.unimi.it/). Fast, with
+     * a period of 2^256 - 1 and 64 bit output. Meets the requirements of
+     * UniformRandomBitGenerator, so may be used as E in RandUniform and friends.
+     */
+    class xoshiro256pp
+    {
+    public:
+        using result_type = std::uint64_t;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        xoshiro256pp() { this->seed (0); }
+        //! Seed the state from \a _seed using SplitMix64
+        xoshiro256pp (const std::uint64_t _seed) { this->seed (_seed); }
+        //! Seed from \a _seed and jump ahead by \a stream times 2^128 steps, giving one of
+        //! 2^128 non-overlapping streams.
+        xoshiro256pp (const std::uint64_t _seed, const std::uint64_t stream)
+        {
+            this->seed (_seed);
+            for (std::uint64_t i = 0; i < stream; ++i) { this->jump(); }
+        }
+        //! Set the state directly. It must not be all zero.
+        xoshiro256pp (const std::array<std::uint64_t, 4>& state) : s(state) {}
+
+        void seed (const std::uint64_t _seed)
+        {
+            std::uint64_t x = _seed;
+            for (auto& si : this->s) {
+                // SplitMix64
+                std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                si = z ^ (z >> 31);
+            }
+        }
+
+        result_type operator()()
+        {
+            const std::uint64_t result = rotl (this->s[0] + this->s[3], 23) + this->s[0];
+            const std::uint64_t t = this->s[1] << 17;
+            this->s[2] ^= this->s[0];
+            this->s[3] ^= this->s[1];
+            this->s[1] ^= this->s[2];
+            this->s[0] ^= this->s[3];
+            this->s[2] ^= t;
+            this->s[3] = rotl (this->s[3], 45);
+            return result;
+        }
+
+        void discard (unsigned long long z) { for (; z > 0; --z) { (*this)(); } }
+
+        //! Jump ahead by 2^128 steps
+        void jump()
+        {
+            static constexpr std::uint64_t j[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                                    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+            this->jump_by (j);
+        }
+        //! Jump ahead by 2^192 steps
+        void long_jump()
+        {
+            static constexpr std::uint64_t j[4] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                                    0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+            this->jump_by (j);
+        }
+
+        bool operator== (const xoshiro256pp& rhs) const { return this->s == rhs.s; }
+        bool operator!= (const xoshiro256pp& rhs) const { return this->s != rhs.s; }
+
+        //! Write the state as text, as the standard engines do
+        friend std::ostream& operator<< (std::ostream& os, const xoshiro256pp& e)
+        {
+            return os << e.s[0] << ' ' << e.s[1] << ' ' << e.s[2] << ' ' << e.s[3];
+        }
+        //! Read a state written by operator<<
+        friend std::istream& operator>> (std::istream& is, xoshiro256pp& e)
+        {
+            return is >> e.s[0] >> e.s[1] >> e.s[2] >> e.s[3];
+        }
+
+    private:
+        static constexpr std::uint64_t rotl (const std::uint64_t x, const int k) { return (x << k) | (x >> (64 - k)); }
+
+        void jump_by (const std::uint64_t (&j)[4])
+        {
+            std::array<std::uint64_t, 4> t = { 0, 0, 0, 0 };
+            for (int i = 0; i < 4; ++i) {
+                for (int b = 0; b < 64; ++b) {
+                    if (j[i] & (std::uint64_t{1} << b)) {
+                        for (int k = 0; k < 4; ++k) { t[k] ^= this->s[k]; }
+                    }
+                    (*this)();
+                }
+            }
+            this->s = t;
+        }
+
+        std::array<std::uint64_t, 4> s;
+    };
+
+    /*!
+     * The Philox4x32-10 counter based engine of Salmon et al. (Parallel random numbers: as
+     * easy as 1, 2, 3; SC11). Each output is a function of the key (the seed) and a 128 bit
+     * counter, so any position in the sequence can be reached in constant time (see
+     * discard()). The upper 64 bits of the counter hold a stream number, giving 2^64
+     * independent streams for each seed. 32 bit output. Meets the requirements of
+     * UniformRandomBitGenerator.
+     */
+    class philox4x32
+    {
+    public:
+        using result_type = std::uint32_t;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        philox4x32() { this->seed (0); }
+        philox4x32 (const std::uint64_t _seed, const std::uint64_t stream = 0) { this->seed (_seed, stream); }
+
+        void seed (const std::uint64_t _seed, const std::uint64_t stream = 0)
+        {
+            this->key = { static_cast<std::uint32_t>(_seed), static_cast<std::uint32_t>(_seed >> 32) };
+            this->ctr = { 0, 0, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32) };
+            this->idx = 4;
+        }
+
+        result_type operator()()
+        {
+            if (this->idx == 4) {
+                this->out = philox4x32::block (this->ctr, this->key);
+                // Increment the 64 bit position part of the counter
+                if (++this->ctr[0] == 0) { ++this->ctr[1]; }
+                this->idx = 0;
+            }
+            return this->out[this->idx++];
+        }
+
+        //! Skip \a z outputs in constant time
+        void discard (unsigned long long z)
+        {
+            // The position of the next output
+            std::uint64_t pos = this->position() + z;
+            std::uint64_t blk = pos / 4;
+            this->ctr[0] = static_cast<std::uint32_t>(blk);
+            this->ctr[1] = static_cast<std::uint32_t>(blk >> 32);
+            this->idx = 4;
+            // Generate the block and step into it
+            for (std::uint64_t i = 0; i < pos % 4; ++i) { (*this)(); }
+        }
+
+        //! The number of outputs generated since seeding
+        std::uint64_t position() const
+        {
+            std::uint64_t blk = (static_cast<std::uint64_t>(this->ctr[1]) << 32) | this->ctr[0];
+            // When idx < 4, ctr has already been incremented past the current block
+            return this->idx == 4 ? blk * 4 : (blk - 1) * 4 + this->idx;
+        }
+
+        //! The Philox4x32 bijection with 10 rounds: encrypt counter \a c with key \a k
+        static std::array<std::uint32_t, 4> block (std::array<std::uint32_t, 4> c, std::array<std::uint32_t, 2> k)
+        {
+            for (int r = 0; r < 10; ++r) {
+                const std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53U) * c[0];
+                const std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57U) * c[2];
+                c = { static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<std::uint32_t>(p1),
+                      static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<std::uint32_t>(p0) };
+                k[0] += 0x9E3779B9U;
+                k[1] += 0xBB67AE85U;
+            }
+            return c;
+        }
+
+        bool operator== (const philox4x32& rhs) const
+        {
+            return this->key == rhs.key && this->position() == rhs.position()
+            && this->ctr[2] == rhs.ctr[2] && this->ctr[3] == rhs.ctr[3];
+        }
+        bool operator!= (const philox4x32& rhs) const { return !(*this == rhs); }
+
+        //! Write the state as text, as the standard engines do
+        friend std::ostream& operator<< (std::ostream& os, const philox4x32& e)
+        {
+            os << e.key[0] << ' ' << e.key[1];
+            for (auto c : e.ctr) { os << ' ' << c; }
+            for (auto o : e.out) { os << ' ' << o; }
+            return os << ' ' << e.idx;
+        }
+        //! Read a state written by operator<<
+        friend std::istream& operator>> (std::istream& is, philox4x32& e)
+        {
+            is >> e.key[0] >> e.key[1];
+            for (auto& c : e.ctr) { is >> c; }
+            for (auto& o : e.out) { is >> o; }
+            return is >> e.idx;
+        }
+
+    private:
+        std::array<std::uint32_t, 2> key;
+        std::array<std::uint32_t, 4> ctr;
+        std::array<std::uint32_t, 4> out = { 0, 0, 0, 0 };
+        unsigned int idx = 4;
+    };
+
+    /*!
+     * Helpers for the fill() methods: turning engine output into uniform numbers in
+     * [0,1) and into normal numbers.
+     */
+    namespace rand_fill {
+
+        //! 32 random bits from engine e
+        template <typename E>
+        std::uint32_t bits32 (E& e)
+        {
+            constexpr auto range = E::max() - E::min();
+            if constexpr (range == std::numeric_limits<std::uint64_t>::max()) {
+                return static_cast<std::uint32_t>((e() - E::min()) >> 32);
+            } else if constexpr (range >= std::numeric_limits<std::uint32_t>::max()) {
+                return static_cast<std::uint32_t>(e() - E::min());
+            } else {
+                return static_cast<std::uint32_t>(std::generate_canonical<double, 32> (e) * 4294967296.0);
+            }
+        }
+
+        //! 64 random bits from engine e
+        template <typename E>
+        std::uint64_t bits64 (E& e)
+        {
+            constexpr auto range = E::max() - E::min();
+            if constexpr (range == std::numeric_limits<std::uint64_t>::max()) {
+                return static_cast<std::uint64_t>(e() - E::min());
+            } else {
+                std::uint64_t hi = bits32 (e);
+                return (hi << 32) | bits32 (e);
+            }
+        }
+
+        //! A uniform number in [0,1) from engine e, using as many bits as T has mantissa
+        template <typename T, typename E>
+        T unit (E& e)
+        {
+            static_assert (std::is_floating_point<T>::value, "rand_fill::unit is for floating point T");
+            if constexpr (std::numeric_limits<T>::digits <= 24) {
+                return static_cast<T>(bits32 (e) >> 8) * T{5.9604644775390625e-08}; // 2^-24
+            } else {
+                return static_cast<T>(bits64 (e) >> 11) * T{1.1102230246251565404236316680908203125e-16}; // 2^-53
+            }
+        }
+
+        //! Fill data[0..n) with uniform numbers in [a,b) from engine e
+        template <typename T, typename E>
+        void uniform (E& e, T* data, const std::size_t n, const T a, const T b)
+        {
+            const T w = b - a;
+            for (std::size_t i = 0; i < n; ++i) { data[i] = a + w * unit<T> (e); }
+        }
+
+        /*!
+         * The tables for the 256 layer Ziggurat method of Marsaglia and Tsang (The Ziggurat
+         * method for generating random variables, J. Stat. Softw. 5, 2000). x[i] is the
+         * right hand edge of layer i and f[i] = exp(-x[i]^2/2).
+         */
+        struct ziggurat_tables
+        {
+            static constexpr double r = 3.6541528853610088; // x[1], the start of the tail
+            static constexpr double v = 0.00492867323399;   // The area of each layer
+            double x[257];
+            double f[257];
+            ziggurat_tables()
+            {
+                this->f[1] = std::exp (-0.5 * r * r);
+                // Layer 0 is the base strip plus the tail, given the same area as the others
+                this->x[0] = v / this->f[1];
+                this->x[1] = r;
+                for (int i = 1; i < 255; ++i) {
+                    this->x[i+1] = std::sqrt (-2.0 * std::log (v / this->x[i] + this->f[i]));
+                    this->f[i+1] = std::exp (-0.5 * this->x[i+1] * this->x[i+1]);
+                }
+                this->x[256] = 0.0;
+                this->f[256] = 1.0;
+                this->f[0] = 0.0; // not used
+            }
+            static const ziggurat_tables& get() { static const ziggurat_tables t; return t; }
+        };
+
+        /*!
+         * A normal number (mean 0, sd 1) from engine e by the Ziggurat method. Each try takes
+         * 64 bits: 8 choose the layer, 1 the sign and 53 the position in the layer. About 99%
+         * of numbers need just one try and no transcendental functions.
+         */
+        template <typename E>
+        double ziggurat (E& e, const ziggurat_tables& zt)
+        {
+            // Set the sign bit of x from bit 8 of u without a branch; the sign is unpredictable.
+            auto with_sign = [](const double x, const std::uint64_t u) {
+                std::uint64_t xb = 0;
+                std::memcpy (&xb, &x, sizeof (double));
+                xb ^= (u & 0x100) << 55;
+                double r = 0.0;
+                std::memcpy (&r, &xb, sizeof (double));
+                return r;
+            };
+            for (;;) {
+                const std::uint64_t u = bits64 (e);
+                const unsigned int i = u & 0xff;
+                const double x = static_cast<double>(u >> 11) * 1.1102230246251565404236316680908203125e-16 * zt.x[i];
+                // Inside the rectangle that fits under the curve (the common case)
+                if (x < zt.x[i+1]) { return with_sign (x, u); }
+                if (i == 0) {
+                    // The tail beyond r (Marsaglia 1964)
+                    double a = 0.0;
+                    double b = 0.0;
+                    do {
+                        a = -std::log (1.0 - unit<double> (e)) / ziggurat_tables::r;
+                        b = -std::log (1.0 - unit<double> (e));
+                    } while (b + b < a * a);
+                    return with_sign (ziggurat_tables::r + a, u);
+                }
+                // In the wedge between the rectangle and the curve
+                const double y = zt.f[i] + unit<double> (e) * (zt.f[i+1] - zt.f[i]);
+                if (y < std::exp (-0.5 * x * x)) { return with_sign (x, u); }
+            }
+        }
+
+        //! Fill data[0..n) with normally distributed numbers (mean \a mean, standard
+        //! deviation \a sigma) from engine e, by the Ziggurat method.
+        template <typename T, typename E>
+        void normal (E& e, T* data, const std::size_t n, const T mean, const T sigma)
+        {
+            const ziggurat_tables& zt = ziggurat_tables::get();
+            for (std::size_t i = 0; i < n; ++i) { data[i] = mean + sigma * static_cast<T>(ziggurat (e, zt)); }
+        }
+
+        //! The number of elements in each block of the parallel fills
+        static constexpr std::size_t parallel_block = 4096;
+
+    } // namespace rand_fill
+
+    /*!
+     * Fill data[0..n) with uniform random numbers in [a,b), using all the threads. Block b of
+     * rand_fill::parallel_block elements is drawn from a Philox4x32 engine with key \a seed
+     * and stream \a stream, starting at the position reserved for block b. So the result
+     * depends only on seed and stream, not on the number of threads. Use a different stream
+     * (the time step, say) for each fill of a simulation.
+     */
+    template <typename T>
+    void parallel_uniform_fill (T* data, const std::size_t n, const std::uint64_t seed,
+                                const std::uint64_t stream = 0, const T a = T{0}, const T b = T{1})
+    {
+        const std::int64_t n_blocks = static_cast<std::int64_t>((n + rand_fill::parallel_block - 1) / rand_fill::parallel_block);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (std::int64_t bi = 0; bi < n_blocks; ++bi) {
+            const std::size_t i0 = static_cast<std::size_t>(bi) * rand_fill::parallel_block;
+            philox4x32 e (seed, stream);
+            // Each block starts 2^32 outputs on from the last, far more than it will use
+            e.discard (static_cast<std::uint64_t>(bi) << 32);
+            rand_fill::uniform (e, data + i0, std::min (rand_fill::parallel_block, n - i0), a, b);
+        }
+    }
+
+    //! parallel_uniform_fill for a std::vector (or a morph::vvec)
+    template <typename T>
+    void parallel_uniform_fill (std::vector<T>& v, const std::uint64_t seed,
+                                const std::uint64_t stream = 0, const T a = T{0}, const T b = T{1})
+    {
+        parallel_uniform_fill (v.data(), v.size(), seed, stream, a, b);
+    }
+
+    /*!
+     * Fill data[0..n) with normally distributed random numbers, using all the threads. The
+     * result depends only on seed and stream, as for parallel_uniform_fill.
+     */
+    template <typename T>
+    void parallel_normal_fill (T* data, const std::size_t n, const std::uint64_t seed,
+                               const std::uint64_t stream = 0, const T mean = T{0}, const T sigma = T{1})
+    {
+        const std::int64_t n_blocks = static_cast<std::int64_t>((n + rand_fill::parallel_block - 1) / rand_fill::parallel_block);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (std::int64_t bi = 0; bi < n_blocks; ++bi) {
+            const std::size_t i0 = static_cast<std::size_t>(bi) * rand_fill::parallel_block;
+            philox4x32 e (seed, stream);
+            // Each block starts 2^32 outputs on from the last, far more than it will use
+            e.discard (static_cast<std::uint64_t>(bi) << 32);
+            rand_fill::normal (e, data + i0, std::min (rand_fill::parallel_block, n - i0), mean, sigma);
+        }
+    }
+
+    //! parallel_normal_fill for a std::vector (or a morph::vvec)
+    template <typename T>
+    void parallel_normal_fill (std::vector<T>& v, const std::uint64_t seed,
+                               const std::uint64_t stream = 0, const T mean = T{0}, const T sigma = T{1})
+    {
+        parallel_normal_fill (v.data(), v.size(), seed, stream, mean, sigma);
+    }
+
     /*!
      * RandUniform to be specialised depending on whether T is integral or not
      *
@@ -150,6 +563,11 @@ namespace morph {
         {
             for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
         }
+        //! Fill data[0..n) with random numbers. Much faster than calling get() n times, as the
+        //! engine's bits are converted directly, but gives a different sequence.
+        void fill (T* data, std::size_t n) { rand_fill::uniform (this->generator, data, n, this->dist.a(), this->dist.b()); }
+        //! Fill the vector v with random numbers
+        void fill (std::vector<T>& v) { this->fill (v.data(), v.size()); }
         T min() { return this->dist.min(); }
         T max() { return this->dist.max(); }
         //! Change the max/min of the distribution to be in range [a,b)
@@ -158,6 +576,10 @@ namespace morph {
             typename std::uniform_real_distribution<T>::param_type prms (a, b);
             this->dist.param (prms);
         }
+        //! Write the state of the engine and the distribution as text, so that the sequence
+        //! can be continued later (after a restart from a checkpoint, say) with operator>>
+        friend std::ostream& operator<< (std::ostream& os, const RandUniform& r) { return os << r.generator << ' ' << r.dist; }
+        friend std::istream& operator>> (std::istream& is, RandUniform& r) { return is >> r.generator >> r.dist; }
     };
 
     //! Integer specialization: Generate uniform random numbers in a integer format
@@ -233,6 +655,10 @@ namespace morph {
         {
             for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
         }
+        //! Fill data[0..n) with random numbers
+        void fill (T* data, std::size_t n) { for (std::size_t i = 0; i < n; ++i) { data[i] = this->dist (this->generator); } }
+        //! Fill the vector v with random numbers
+        void fill (std::vector<T>& v) { this->fill (v.data(), v.size()); }
         //! min wrapper
         T min() { return this->dist.min(); }
         //! max wrapper
@@ -243,6 +669,9 @@ namespace morph {
             typename std::uniform_int_distribution<T>::param_type prms (a, b);
             this->dist.param (prms);
         }
+        //! Write/read the engine and distribution state (as for floating point RandUniform)
+        friend std::ostream& operator<< (std::ostream& os, const RandUniform& r) { return os << r.generator << ' ' << r.dist; }
+        friend std::istream& operator>> (std::istream& is, RandUniform& r) { return is >> r.generator >> r.dist; }
     };
 
     /*!
@@ -320,8 +749,16 @@ namespace morph {
         {
             for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
         }
+        //! Fill data[0..n) with random numbers, using the Ziggurat method. Much faster than
+        //! calling get() n times, but gives a different sequence.
+        void fill (T* data, std::size_t n) { rand_fill::normal (this->generator, data, n, this->dist.mean(), this->dist.stddev()); }
+        //! Fill the vector v with random numbers
+        void fill (std::vector<T>& v) { this->fill (v.data(), v.size()); }
         T min() { return this->dist.min(); }
         T max() { return this->dist.max(); }
+        //! Write/read the engine and distribution state (see RandUniform)
+        friend std::ostream& operator<< (std::ostream& os, const RandNormal& r) { return os << r.generator << ' ' << r.dist; }
+        friend std::istream& operator>> (std::istream& is, RandNormal& r) { return is >> r.generator >> r.dist; }
     };
 
     /*!
@@ -402,8 +839,20 @@ namespace morph {
         {
             for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
         }
+        //! Fill data[0..n) with random numbers, exponentiating normal numbers from the Ziggurat
+        //! method. Faster than calling get() n times, but gives a different sequence.
+        void fill (T* data, std::size_t n)
+        {
+            rand_fill::normal (this->generator, data, n, this->dist.m(), this->dist.s());
+            for (std::size_t i = 0; i < n; ++i) { data[i] = std::exp (data[i]); }
+        }
+        //! Fill the vector v with random numbers
+        void fill (std::vector<T>& v) { this->fill (v.data(), v.size()); }
         T min() { return this->dist.min(); }
         T max() { return this->dist.max(); }
+        //! Write/read the engine and distribution state (see RandUniform)
+        friend std::ostream& operator<< (std::ostream& os, const RandLogNormal& r) { return os << r.generator << ' ' << r.dist; }
+        friend std::istream& operator>> (std::istream& is, RandLogNormal& r) { return is >> r.generator >> r.dist; }
     };
 
     /*!
@@ -483,10 +932,17 @@ namespace morph {
         {
             for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
         }
+        //! Fill data[0..n) with random numbers
+        void fill (T* data, std::size_t n) { for (std::size_t i = 0; i < n; ++i) { data[i] = this->dist (this->generator); } }
+        //! Fill the vector v with random numbers
+        void fill (std::vector<T>& v) { this->fill (v.data(), v.size()); }
         //! min wrapper
         T min() { return this->dist.min(); }
         //! max wrapper
         T max() { return this->dist.max(); }
+        //! Write/read the engine and distribution state (see RandUniform)
+        friend std::ostream& operator<< (std::ostream& os, const RandPoisson& r) { return os << r.generator << ' ' << r.dist; }
+        friend std::istream& operator>> (std::istream& is, RandPoisson& r) { return is >> r.generator >> r.dist; }
     };
 
     //! Enumerated class defining groups of characters, such as AlphaNumericUpperCase,
@@ -3,6 +3,10 @@
  *
  * A class for reading SVG files containing paths defining the outline of a neocortex.
  *
+ * The file is scanned in a single pass by morph::xml_sax (no document tree is built) and the
+ * path data of each <path> are parsed in parallel, so that large atlases with thousands of
+ * paths load quickly.
+ *
  * \author: Seb James
  * \date: July 2018
  */
@@ -10,16 +14,22 @@
 
 #include <morph/MorphDbg.h>
 #include <string>
+#include <string_view>
 #include <list>
 #include <vector>
+#include <array>
 #include <map>
-#ifdef __WIN__
-# include <rapidxml-1.13/rapidxml.hpp>
-#else
-# include <morph/rapidxml.hpp>
-#endif
+#include <utility>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <charconv>
+#include <system_error>
+#include <cctype>
+#include <cstdlib>
+#include <morph/xml_sax.h>
 #include <morph/BezCurvePath.h>
-#include <morph/AllocAndRead.h>
 #include <morph/tools.h>
 
 namespace morph
@@ -39,17 +49,15 @@ namespace morph
         ReadCurves() {}
 
         /*!
-         * Construct using the SVG file at svgpath. The text of the file is read into memory and the
-         * XML root node is found (an <svg> element). All initialisation is done; not need to call
-         * init(const string& svgpath)
+         * Construct using the SVG file at svgpath. The text of the file is read into memory and
+         * scanned for the curves within its <svg> root element. All initialisation is done; not
+         * need to call init(const string& svgpath)
          */
         ReadCurves (const std::string& svgpath)
         {
             // Read (without parsing) the svg file text into memory:
-            this->modeldata.read (svgpath);
-            // Parse the XML and find the root node:
-            this->init();
-            // Read the curves:
+            this->readText (svgpath);
+            // Scan the XML and read the curves:
             this->read();
             if (this->gotCortex == false) {
                 std::cerr << "WARNING: No object in SVG with id \"cortex\". Cortical boundary will be null.\n";
@@ -58,15 +66,14 @@ namespace morph
 
         /*!
          * Initialise using the SVG file at svgpath. The text of the file is read into memory and
-         * the XML root node is found (an <svg> element). If you constructed with a const string&
-         * svgpath, then you don't need to call this init function.
+         * scanned for the curves within its <svg> root element. If you constructed with a const
+         * string& svgpath, then you don't need to call this init function.
          */
         void init (const std::string& svgpath)
         {
             // Read (without parsing) the svg file text into memory:
-            this->modeldata.read (svgpath);
-            // Parse the XML and find the root node:
-            this->init();
+            this->readText (svgpath);
+            // Scan the XML and read the curves:
             this->read();
             if (this->gotCortex == false) {
                 std::cerr << "WARNING: No object in SVG with id \"cortex\". Cortical boundary will be null.\n";
@@ -132,504 +139,162 @@ namespace morph
          */
         std::map<std::string, morph::vec<float, 2>> circles;
 
-    private:
-
-        /*!
-         * Some initialisation - parse the doc and find the root node.
-         */
-        void init()
-        {
-            if (!this->root_node) {
-                // we are choosing to parse the XML declaration parse_no_data_nodes
-                // prevents RapidXML from using the somewhat surprising behaviour of
-                // having both values and data nodes, and having data nodes take
-                // precedence over values when printing >>> note that this will skip
-                // parsing of CDATA nodes <<<
-                this->doc.parse<rapidxml::parse_declaration_node|rapidxml::parse_no_data_nodes>(this->modeldata.data());
-
-                // Get the root node.
-                this->root_node = this->doc.first_node ("svg");
-                if (!this->root_node) {
-                    std::stringstream ee;
-                    ee << "No root node 'svg'!";
-                    throw std::runtime_error (ee.str());
-                }
-            }
-        }
-
-        /*!
-         * Do the work of reading the file and populating corticalPath, enclosedRegions and
-         * lineToMillimetres.
-         */
-        void read()
-        {
-            // Search each layer - these are called <g> elements in the SVG.
-            for (rapidxml::xml_node<>* g_node = this->root_node->first_node("g");
-                 g_node;
-                 g_node = g_node->next_sibling("g")) {
-                this->readG (g_node);
-            }
-
-            // Search un-enclosed paths, as well as those enclosed in <g> elements
-            for (rapidxml::xml_node<>* path_node = this->root_node->first_node("path");
-                 path_node;
-                 path_node = path_node->next_sibling("path")) {
-                // Un-enclosed paths will need to use their id attribute
-                std::string p_id(""); // unenclosed path id
-                rapidxml::xml_attribute<>* path_id_attr;
-                if ((path_id_attr = path_node->first_attribute ("id"))) {
-                    p_id = path_id_attr->value();
-                    this->readPath (path_node, p_id);
-                } // else failed to get p_id
-            }
-
-            // Search circles, and make up a table of all the circles along with their IDs
-            for (rapidxml::xml_node<>* circ_node = this->root_node->first_node("circle");
-                 circ_node;
-                 circ_node = circ_node->next_sibling("circle")) {
-                this->readCircle (circ_node);
-            }
-
-            // Now the file is read, set the scaling:
-            this->setScale();
-        }
-
-        /*!
-         * Read a <g> element; its id attribute and its enclosed <path> or <line> element.
-         */
-        void readG (rapidxml::xml_node<>* g_node)
-        {
-            // Within each <g>: Read the id attribute, then search out <path>
-            // elements and read those.
-            std::string g_id("");
-            rapidxml::xml_attribute<>* id_attr;
-            if ((id_attr = g_node->first_attribute ("id"))) {
-                g_id = id_attr->value();
-            } // else failed to get g_id
-
-            // Recursively search down any number of levels until a <path>
-            // node is found. Read it, then continue searching.
-            rapidxml::xml_node<>* path_node = g_node;
-            do {
-                path_node = this->findNodeRecursive (path_node, "path");
-
-                if (path_node != nullptr) {
-                    // See if path has an id that isn't the generic "path0000"
-                    // format. If so, use this to override the id from the <g>
-                    // element
-                    std::string p_id("");
-                    rapidxml::xml_attribute<>* path_id_attr;
-                    // Check path id attribute...
-                    if ((path_id_attr = path_node->first_attribute ("id"))) {
-                        p_id = path_id_attr->value();
-                    } // else failed to get p_id
-                    if (!p_id.empty()) {
-                        if (!(p_id.find("path") == 0)) {
-                            // p_id doesn't start with "path", so write it into g_id
-                            g_id = p_id;
-                        }
-                    }
-                    this->readPath (path_node, g_id);
-
-                    path_node = path_node->next_sibling();
-
-                    if (path_node != nullptr) {
-                        // Check path_node, itself before passing to findNodeRecursive...
-                        if ((path_id_attr = path_node->first_attribute ("id"))) {
-                            p_id = path_id_attr->value();
-                        } // else failed to get p_id
-                        if (!p_id.empty()) {
-                            if (!(p_id.find("path") == 0)) {
-                                // p_id doesn't start with "path", so write it into g_id
-                                g_id = p_id;
-                            }
-                        }
-                        this->readPath (path_node, g_id);
-                    }
-                }
-
-            } while (path_node != nullptr);
-
-            // Search for a line element
-            rapidxml::xml_node<>* line_node = this->findNodeRecursive (g_node, "line");
-            if (line_node != nullptr) {
-                if (this->foundLine == true) {
-                    std::cerr << "WARNING: Found a second <line> element in this SVG, was only expecting one (as a single scale bar)\n";
-                }
-                this->readLine (line_node, g_id);
-                this->foundLine = true;
-            }
-        }
-
         /*!
-         * Read a circle element and store it in circles.
-         */
-        void readCircle (rapidxml::xml_node<>* circ_node)
-        {
-            // Within each <circle>: Read the id attribute
-            std::string circ_id("");
-            rapidxml::xml_attribute<>* _attr;
-            if ((_attr = circ_node->first_attribute ("id"))) {
-                circ_id = _attr->value();
-                bool gotx = false;
-                bool goty = false;
-                float cx = 0.0;
-                float cy = 0.0;
-                // Now, get the x and y attributes of the circle, cx and cy
-                if ((_attr = circ_node->first_attribute ("cx"))) {
-                    gotx = true;
-                    cx = std::atof (_attr->value());
-                }
-                if ((_attr = circ_node->first_attribute ("cy"))) {
-                    goty = true;
-                    cy = std::atof (_attr->value());
-                }
-                if (gotx && goty) {
-                    this->circles[circ_id] = morph::vec<float,2>({cx, cy});
-                }
-
-            } // else failed to get circ_id
-        }
-
-        /*!
-         * Recursively search in \a a_node until a node with the tag name \a tagname is
-         * found. Return it.
-         */
-        rapidxml::xml_node<>* findNodeRecursive (rapidxml::xml_node<>* a_node,
-                                                 const std::string& tagname) const
-        {
-            for (rapidxml::xml_node<>* path_node = a_node->first_node();
-                 path_node;
-                 path_node = path_node->next_sibling()) {
-
-                if (strncmp (path_node->name(), tagname.c_str(), tagname.size()) == 0) {
-                    return path_node;
-                }
-
-                rapidxml::xml_node<>* rtn_node = findNodeRecursive (path_node, tagname);
-                if (rtn_node != nullptr && strncmp (rtn_node->name(), tagname.c_str(), tagname.size()) == 0) {
-                    return rtn_node;
-                }
-            }
-
-            return nullptr;
-        }
-
-        /*!
-         * Read a <path> element. A path will contain a series of commands in a d attribute. These
-         * commands can be interpreted as a series of Bezier curves, and the Beziers can be expanded
-         * out into BezCoords. I should save the Bezier curves in this class object, and generate
-         * the coordinates when the client code requests it, possibly providing scaling information
-         * at that time.
-         *
-         * layerName contains the name of the layer in which the path was found.
-         */
-        void readPath (rapidxml::xml_node<>* path_node, const std::string& layerName)
-        {
-            std::string d("");
-            rapidxml::xml_attribute<>* d_attr;
-            if ((d_attr = path_node->first_attribute ("d"))) {
-                d = d_attr->value();
-            } // else failed to get d
-
-            if (d.empty()) {
-                throw std::runtime_error ("Found a <path> element without a d attribute");
-            }
-
-            DBG ("Path commands for layer " << layerName << ": " << d);
-
-            morph::BezCurvePath<float> curves = this->parseD (d);
-            curves.name = layerName;
-            if (layerName == "cortex") {
-                this->gotCortex = true;
-                this->corticalPath = curves;
-            } else if (layerName.find ("mm") != std::string::npos) {
-                this->linePath = curves;
-                this->setupScaling (layerName);
-            } else {
-                this->enclosedRegions.push_back (curves);
-            }
-        }
-
-        /*!
-         * If g_id contains the string "mm", then treat it as a scale bar. If it contains "cortex",
-         * then treat it as the special outer/main boundary
-         */
-        void setupScaling (const std::string& g_id)
-        {
-            if (g_id.find("mm") != std::string::npos) {
-                // Parse lines. Note that Inkscape will save a line as a path with
-                // implicit lineto in the form of a path with 2 pairs of
-                // coordinates in a move command. Adobe Illustrator uses a <line>
-                // element.
-
-                // Extract the length of the line in mm from the layer name
-                // _x33_mm means .33 mm
-                std::string mm(g_id);
-                morph::Tools::searchReplace ("x", ".", mm);
-                morph::Tools::searchReplace ("_", "", mm);
-                morph::Tools::searchReplace ("m", "", mm);
-                float mmf = std::atof (mm.c_str());
-                // dl is the length of the scale bar line
-                float dl = 0.0f;
-                dl = this->linePath.getEndToEnd();
-                // Having found the length of the line from the <line> or
-                // <path>, compute lineToMillimetres
-                this->lineToMillimetres[0] = 1;
-                this->lineToMillimetres[1] = dl > 0.0f ? mmf/dl : 1.0f;
-            }
-        }
-
-        /*!
-         * Split up a string of SVG command numbers. These are delimited either by a comma, a space
-         * or by a minus sign. Interpret them as floats and return in a vector.
-         *
-         * This version also sets this->lastCmd where appropriate, and ensures that numParams are
-         * extracted from s. When s contains a longer than numParams list of numbers, endOfCmd is
-         * set to point to the end of the commands read into the return value.
-         */
-        std::vector<float> splitSvgCmdString (const std::string& s, char cmd,
-                                              unsigned int numParams,
-                                              std::string::size_type& endOfCmd)
-        {
-            std::vector<float> numbers;
-            unsigned int numnum = 0; // number of numbers stored in numbers
-            float n = 0.0f;
-
-            std::string::size_type p0 = 0;
-            std::string::size_type p1 = s.find_first_of ("-, ", p0);
-            while (p1 != std::string::npos && numnum < numParams) {
-
-                if (p1 != p0) {
-                    std::stringstream ss;
-                    ss << s.substr(p0, p1-p0);
-                    std::string ccs = ss.str();
-                    if (morph::Tools::containsOnlyWhitespace (ccs)) {
-                        // Do nothing
-                    } else {
-                        ss >> n;
-                        numbers.push_back (n);
-                        ++numnum;
-                    }
-                }
-
-                if (s[p1] == ',') {
-                    p0 = p1+1;
-                } else if (s[p1] == ' ') {
-                    p0 = p1+1;
-                } else if (s[p1] == '-') {
-                    if (false == (p1>0 && s[p1-1] == 'e')) {
-                        p0 = p1; // Not +1 so that we include the - in the next one
-                    } else {
-                        // This '-' character followed an exponent 'e' character, so it does not denote a
-                        // delimiter between values in the string s. So pop off the incomplete number
-                        // string which will just have been pushed back, decrement numnum and carry on.
-                        numbers.pop_back();
-                        --numnum;
-                    }
-                }
-
-                if (numnum < numParams) {
-                    p1 = s.find_first_of ("-, ", p1+1);
-                }
-            }
-
-            if (p1 == std::string::npos) {
-                // No minus signs. Attempt to convert s into a single float and return
-                std::stringstream ss;
-                ss << s.substr (p0, p1-p0);
-                if (!ss.str().empty()) {
-                    ss >> n;
-                    numbers.push_back (n);
-                    ++numnum;
-                }
-            }
-
-            if (numnum > numParams) {
-                throw std::runtime_error ("splitSvgCmdString: unexpected number of params in command.");
-            }
-
-            endOfCmd = p1;
-
-            if (endOfCmd == std::string::npos) {
-                this->lastCmd = '\0';
-            } else {
-                this->lastCmd = cmd;
-            }
-
-            return numbers;
-        }
-
-        /*!
-         * This parses the d attribute string in an SVG path. I'm assuming this will always be a
-         * list of Bezier Curves.
+         * Parse the d attribute of an SVG <path>. I'm assuming this will always be a list of
+         * Bezier curves and straight lines (the M, L, H, V, C, S and Z commands, each absolute or
+         * relative). A command may be followed by several sets of parameters; "c" followed by 12
+         * numbers is two cubic curves. Numbers may be separated by whitespace, by commas or by the
+         * sign of the next number, and are read with std::from_chars straight out of d, so that
+         * nothing is allocated other than the curves themselves.
          *
          * NB: The SVG is encoded in a left-hand coordinate system, with x positive right and y
          * positive down. This parsing does not change that coordinate system, and so the BezCoords
          * in the path may need to have their y coordinates reversed.
          */
-        morph::BezCurvePath<float> parseD (const std::string& d)
+        static morph::BezCurvePath<float> parseD (std::string_view d)
         {
             morph::BezCurvePath<float> curves;
 
-            // As we parse through the path, we have to keep track of the
-            // current coordinate position, as curves are specified from the
-            // position at the end of the previous curve.
+            // As we parse through the path, we have to keep track of the current coordinate
+            // position, as curves are specified from the position at the end of the previous curve.
             morph::vec<float, 2> currentCoordinate = {0.0f, 0.0f};
 
-            // The first coordinate of the path. Can be required with a Z
-            // command.
+            // The first coordinate of the path. Can be required with a Z command.
             morph::vec<float, 2> firstCoordinate = {0.0f, 0.0f};
 
-            // The last Bezier control points, c2, especially may be required
-            // in a shortcut Bezier command (s or S), hence declaring these
-            // outside the scope of the while loop.
-            morph::vec<float, 2> c1; // Control point 1
-            morph::vec<float, 2> c2; // Control point 2
-            morph::vec<float, 2> f;  // Final point of curve
-
-            // A list of SVG command characters
-            const char* svgCmds = "mMcCsSqQtTzZlLhHvV";
-
-            // Text parsing time!
-            std::string::size_type p0 = 0;
-            std::string::size_type p1 = d.find_first_of (svgCmds, p0);
-            std::string::size_type p2 = 0;
-            std::string::size_type p3 = std::string::npos;
-            this->lastCmd = '\0';
-            char cmd = '\0';
-            while (p1 != std::string::npos) {
-
-                // if lastCmd == '\0' switch on d, else switch on lastCmd.
-                if (lastCmd == '\0') {
-                    cmd = d[p1];
-                } else {
-                    cmd = this->lastCmd;
+            // The last Bezier control points, c2, especially may be required in a shortcut Bezier
+            // command (s or S), hence declaring these outside the scope of the while loop.
+            morph::vec<float, 2> c1 = {0.0f, 0.0f}; // Control point 1
+            morph::vec<float, 2> c2 = {0.0f, 0.0f}; // Control point 2
+            morph::vec<float, 2> f = {0.0f, 0.0f};  // Final point of curve
+            // True if the previous curve was a cubic, in which case c2 is reflected by S
+            bool lastWasCubic = false;
+
+            // The parameters of one command
+            std::array<float, 6> v = {};
+
+            const std::size_t n = d.size();
+            std::size_t i = 0;
+
+            // Skip whitespace and commas. Return true if a number follows.
+            auto number_next = [&d, &i, n]()
+            {
+                while (i < n && (d[i] == ' ' || d[i] == ',' || d[i] == '\n' || d[i] == '\t' || d[i] == '\r')) { ++i; }
+                return i < n && (d[i] == '-' || d[i] == '+' || d[i] == '.' || (d[i] >= '0' && d[i] <= '9'));
+            };
+
+            // Read the next k parameters of command cmd into v. Returns false if there are none.
+            auto read_params = [&d, &i, n, &v, &number_next](unsigned int k, char cmd)
+            {
+                if (!number_next()) { return false; }
+                for (unsigned int j = 0; j < k; ++j) {
+                    if (j > 0 && !number_next()) {
+                        std::stringstream ee;
+                        ee << "Unexpected size of SVG path " << static_cast<char>(std::toupper (cmd)) << " command (expected ";
+                        if (k == 2) { ee << "pairs of numbers)"; } else { ee << k << " numbers, got " << j << ")"; }
+                        throw std::runtime_error (ee.str());
+                    }
+                    if (d[i] == '+') { ++i; } // from_chars doesn't accept a leading '+'
+                    auto [ptr, ec] = std::from_chars (d.data() + i, d.data() + n, v[j]);
+                    if (ec != std::errc()) {
+                        std::stringstream ee;
+                        ee << "Failed to read a number from SVG path data at character " << i;
+                        throw std::runtime_error (ee.str());
+                    }
+                    i = static_cast<std::size_t>(ptr - d.data());
                 }
+                return true;
+            };
+
+            // Anything before the first command is ignored
+            const std::string_view svgCmds = "mMcCsSqQtTzZlLhHvVaA";
+            i = d.find_first_of (svgCmds);
+            if (i == std::string_view::npos) { return curves; }
+
+            while (i < n) {
 
-                p3 = std::string::npos;
+                const char cmd = d[i++];
 
                 switch (cmd) { // switch on the command character
 
-                case 'L': // lineto command, absolution coordinates
+                case 'L': // lineto command, absolute coordinates
                 case 'l': // lineto command, deltas
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string lCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::Tools::containsOnlyWhitespace (lCmd)) {
-                        p3 = lCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (lCmd, cmd, 10000, p3);
-                        if (v.size()%2 != 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path L command (expected pairs of numbers)");
-                        }
-                        for (unsigned int i = 0; i<v.size(); i+=2) {
-                            if (cmd == 'l') { // delta coordinates
-                                f = { currentCoordinate[0] + v[i], currentCoordinate[1] + v[i+1] };
-                            } else {
-                                f = { v[i], v[i+1] };
-                            }
-                            morph::BezCurve<float> c(currentCoordinate, f);
-                            curves.addCurve (c);
-                            currentCoordinate = f;
+                    while (read_params (2, cmd)) {
+                        if (cmd == 'l') { // delta coordinates
+                            f = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
+                        } else {
+                            f = { v[0], v[1] };
                         }
+                        morph::BezCurve<float> c(currentCoordinate, f);
+                        curves.addCurve (c);
+                        currentCoordinate = f;
+                        lastWasCubic = false;
                     }
                     break;
                 }
 
-                case 'H': // horizontal lineto command, absolution coordinates
+                case 'H': // horizontal lineto command, absolute coordinates
                 case 'h': // horizontal lineto command, deltas
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string lCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::Tools::containsOnlyWhitespace (lCmd)) {
-                        p3 = lCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (lCmd, cmd, 10000, p3);
-                        if (v.size() == 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path H command (expected at least one number)");
-                        }
-                        for (unsigned int i = 0; i<v.size(); ++i) {
-                            if (cmd == 'h') { // delta coordinates
-                                f = { currentCoordinate[0] + v[i], currentCoordinate[1] };
-                            } else {
-                                f = { v[i], currentCoordinate[1] };
-                            }
-                            morph::BezCurve<float> c(currentCoordinate, f);
-                            curves.addCurve (c);
-                            currentCoordinate = f;
+                    while (read_params (1, cmd)) {
+                        if (cmd == 'h') { // delta coordinates
+                            f = { currentCoordinate[0] + v[0], currentCoordinate[1] };
+                        } else {
+                            f = { v[0], currentCoordinate[1] };
                         }
+                        morph::BezCurve<float> c(currentCoordinate, f);
+                        curves.addCurve (c);
+                        currentCoordinate = f;
+                        lastWasCubic = false;
                     }
                     break;
                 }
 
-                case 'V': // vertical lineto command, absolution coordinates
+                case 'V': // vertical lineto command, absolute coordinates
                 case 'v': // vertical lineto command, deltas
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string lCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::Tools::containsOnlyWhitespace (lCmd)) {
-                        p3 = lCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (lCmd, cmd, 10000, p3);
-                        if (v.size() == 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path V command (expected at least one number)");
-                        }
-                        for (unsigned int i = 0; i<v.size(); ++i) {
-                            if (cmd == 'v') { // delta coordinates
-                                if (v[i] != 0.0f) {
-                                    f = { currentCoordinate[0], currentCoordinate[1] + v[i] };
-                                    morph::BezCurve<float> c(currentCoordinate, f);
-                                    curves.addCurve (c);
-                                    currentCoordinate = f;
-                                }
-                            } else {
-                                f = { currentCoordinate[0], v[i] };
+                    while (read_params (1, cmd)) {
+                        if (cmd == 'v') { // delta coordinates
+                            if (v[0] != 0.0f) {
+                                f = { currentCoordinate[0], currentCoordinate[1] + v[0] };
                                 morph::BezCurve<float> c(currentCoordinate, f);
                                 curves.addCurve (c);
                                 currentCoordinate = f;
                             }
+                        } else {
+                            f = { currentCoordinate[0], v[0] };
+                            morph::BezCurve<float> c(currentCoordinate, f);
+                            curves.addCurve (c);
+                            currentCoordinate = f;
                         }
+                        lastWasCubic = false;
                     }
                     break;
                 }
 
-                case 'M': // move command, absolution coordinates
+                case 'M': // move command, absolute coordinates
                 case 'm': // move command, deltas
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string mCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::Tools::containsOnlyWhitespace (mCmd)) {
-                        p3 = mCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (mCmd, cmd, 10000, p3);
-                        if (v.size()%2 != 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path M command (expected pairs of numbers)");
-                        }
-
+                    // The first pair is the move; any further pairs are implicit linetos
+                    bool first = true;
+                    while (read_params (2, cmd)) {
                         if (cmd == 'm') { // delta coordinates
-                            currentCoordinate = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
+                            f = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
                         } else {
-                            currentCoordinate = { v[0], v[1] };
+                            f = { v[0], v[1] };
                         }
-                        firstCoordinate = currentCoordinate;
-                        curves.initialCoordinate = currentCoordinate;
-
-                        if (v.size() == 2) {
-                            // Just 2 coords means it's a move command; nothing further to do
+                        if (first) {
+                            currentCoordinate = f;
+                            firstCoordinate = currentCoordinate;
+                            curves.initialCoordinate = currentCoordinate;
+                            first = false;
                         } else {
-                            // pairs of commands implies linetos.
-                            for (unsigned int i = 2; i<v.size(); i+=2) {
-                                if (cmd == 'm') { // delta coordinates
-                                    f = { currentCoordinate[0] + v[i], currentCoordinate[1] + v[i+1] };
-                                } else {
-                                    f = { v[i], v[i+1] };
-                                }
-                                morph::BezCurve<float> c(currentCoordinate, f);
-                                curves.addCurve (c);
-                                currentCoordinate = f;
-                            }
+                            morph::BezCurve<float> c(currentCoordinate, f);
+                            curves.addCurve (c);
+                            currentCoordinate = f;
                         }
+                        lastWasCubic = false;
                     }
                     break;
                 }
@@ -637,29 +302,20 @@ namespace morph
                 case 'C': // cubic Bezier curve, abs positions
                 case 'c': // cubic Bezier curve, deltas
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string cCmd = d.substr (p1+1, p2-p1-1); // cCmd may be either a single command (6 params) or a great long line.
-                    if (morph::Tools::containsOnlyWhitespace (cCmd)) {
-                        p3 = cCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (cCmd, cmd, 6, p3);
-                        if (v.size() != 6) {
-                            std::stringstream ee;
-                            ee << "Unexpected size of SVG path C command (expected 6 numbers, got " << v.size() << ")";
-                            throw std::runtime_error (ee.str());
-                        }
+                    while (read_params (6, cmd)) {
                         if (cmd == 'c') { // delta coordinates
                             c1 = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
                             c2 = { currentCoordinate[0] + v[2], currentCoordinate[1] + v[3] };
                             f = { currentCoordinate[0] + v[4], currentCoordinate[1] + v[5] };
                         } else { // 'C', so absolute coordinates were given
-                            c1 = { v[0],v[1] };
-                            c2 = { v[2],v[3] };
-                            f = { v[4],v[5] };
+                            c1 = { v[0], v[1] };
+                            c2 = { v[2], v[3] };
+                            f = { v[4], v[5] };
                         }
                         morph::BezCurve<float> c(currentCoordinate, f, c1, c2);
                         curves.addCurve (c);
                         currentCoordinate = f;
+                        lastWasCubic = true;
                     }
                     break;
                 }
@@ -667,21 +323,13 @@ namespace morph
                 case 'S': // shortcut cubic Bezier, absolute coordinates
                 case 's': // shortcut cubic Bezier, deltas
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string sCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::Tools::containsOnlyWhitespace (sCmd)) {
-                        p3 = sCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (sCmd, cmd, 4, p3);
-                        if (v.size() != 4) {
-                            throw std::runtime_error ("Unexpected size of SVG path S command (expected 4 numbers)");
-                        }
-                        // c2 and currentCoordinate are stored locally in abs. coordinates:
-                        c1 = (currentCoordinate * 2) - c2;
-                        if (d[p1] == 's') { // delta coordinates
-                            // Deltas are determined from the currentCoordinate
+                    while (read_params (4, cmd)) {
+                        // c1 is the reflection of the previous curve's c2 about the current
+                        // coordinate, or the current coordinate if the previous curve wasn't a cubic.
+                        c1 = lastWasCubic ? (currentCoordinate * 2) - c2 : currentCoordinate;
+                        if (cmd == 's') { // delta coordinates
                             c2 = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
-                            f =  { currentCoordinate[0] + v[2], currentCoordinate[1]  + v[3] };
+                            f =  { currentCoordinate[0] + v[2], currentCoordinate[1] + v[3] };
                         } else { // 'S', so absolute coordinates were given
                             c2 = { v[0], v[1] };
                             f =  { v[2], v[3] };
@@ -689,6 +337,7 @@ namespace morph
                         morph::BezCurve<float> c(currentCoordinate, f, c1, c2);
                         curves.addCurve (c);
                         currentCoordinate = f;
+                        lastWasCubic = true;
                     }
                     break;
                 }
@@ -705,6 +354,12 @@ namespace morph
                     throw std::runtime_error ("Shortcut quadratic Bezier is unimplemented");
                     break;
                 }
+                case 'A':
+                case 'a': // Elliptical arc
+                {
+                    throw std::runtime_error ("Elliptical arc is unimplemented");
+                    break;
+                }
                 case 'Z':
                 case 'z': // straight line from current position to first point of path.
                 {
@@ -713,75 +368,329 @@ namespace morph
                         curves.addCurve (c);
                         currentCoordinate = firstCoordinate;
                     }
+                    lastWasCubic = false;
+                    // Z takes no parameters; ignore any numbers that follow it
+                    while (read_params (1, cmd)) {}
                     break;
                 }
 
-                default:
+                case ' ':
+                case ',':
+                case '\n':
+                case '\t':
+                case '\r':
                     break;
-                }
 
-                if (p3 == std::string::npos) {
-                    p0 = p1+1;
-                    p1 = d.find_first_of (svgCmds, p0);
-                } else {
-                    p1 = p1+1+p3;
-                    if (p1+1 == p2) {
-                        // It's a new command!
-                        this->lastCmd = '\0';
-                    }
+                default:
+                {
+                    std::stringstream ee;
+                    ee << "Unexpected character '" << cmd << "' in SVG path data at character " << (i - 1);
+                    throw std::runtime_error (ee.str());
+                }
                 }
             }
 
             return curves;
         }
 
+    private:
+
         /*!
-         * Read a <line> element. Read x1,y1,x2,y2 attributes from which line length can be
-         * determined and lineToMillimetres populated.
+         * A <path> or a scale bar <line> found while scanning the SVG. The path data are parsed
+         * after the scan, in parallel.
          */
-        void readLine (rapidxml::xml_node<>* line_node, const std::string& layerName)
+        struct svg_item
         {
-            std::string x1("");
-            rapidxml::xml_attribute<>* x1_attr;
-            if ((x1_attr = line_node->first_attribute ("x1"))) {
-                x1 = x1_attr->value();
-            } // else failed to get x1
-            if (x1.empty()) {
-                throw std::runtime_error ("Found a <line> element without a x1 attribute");
+            //! True for a <line>, false for a <path>
+            bool is_line = false;
+            //! The name of the layer to which the item belongs (see readPath)
+            std::string layerName;
+            //! The path data, viewing svgtext
+            std::string_view d;
+            //! The path data with entity references replaced, if there were any in d
+            std::string d_unescaped;
+            //! True if the <path> had a d attribute
+            bool got_d = false;
+            //! The x1, y1, x2 and y2 attributes of a <line>
+            std::array<std::string, 4> xy;
+        };
+
+        //! Read the text of the file at svgpath into svgtext
+        void readText (const std::string& svgpath)
+        {
+            std::ifstream f (svgpath, std::ios::in | std::ios::binary);
+            if (!f.is_open()) {
+                std::stringstream ee;
+                ee << "ReadCurves: Failed to open file " << svgpath << " for reading";
+                throw std::runtime_error (ee.str());
             }
-            std::string x2("");
-            rapidxml::xml_attribute<>* x2_attr;
-            if ((x2_attr = line_node->first_attribute ("x2"))) {
-                x2 = x2_attr->value();
-            } // else failed to get x2
-            if (x2.empty()) {
-                throw std::runtime_error ("Found a <line> element without a x2 attribute");
+            f.seekg (0, std::ios::end);
+            this->svgtext.resize (static_cast<std::size_t>(f.tellg()));
+            f.seekg (0);
+            f.read (this->svgtext.data(), static_cast<std::streamsize>(this->svgtext.size()));
+        }
+
+        /*!
+         * Do the work of reading the file and populating corticalPath, enclosedRegions and
+         * lineToMillimetres.
+         *
+         * The SVG text is scanned once with morph::xml_sax, without building a document tree. The
+         * scan collects the <path> and <line> elements of interest (as views into svgtext), then
+         * the path data are parsed in parallel and the results filed, in document order, under
+         * their layer names.
+         *
+         * Within the <svg> root these are read:
+         *
+         * Each <g> layer. Its id is the layer name. The first <path> in the layer is read, along
+         * with its next sibling and the first path in that sibling, and so on. A path id that
+         * doesn't start with "path" replaces the layer name. The first <line> in the layer is
+         * read as the scale bar.
+         *
+         * Each un-enclosed <path> that has an id attribute, which is its layer name. These are
+         * filed after all the <g> layers.
+         *
+         * Each un-enclosed <circle>, into circles.
+         */
+        void read()
+        {
+            std::vector<svg_item> g_items;   // From the <g> layers, in order
+            std::vector<svg_item> top_items; // Un-enclosed paths
+            std::vector<std::pair<std::string, morph::vec<float, 2>>> circs;
+
+            // Scan state. svg_open is true while inside the <svg> root element.
+            bool seen_svg = false;
+            bool svg_open = false;
+            // Inside a top level <g>: its (possibly overridden) id and the first <line> in it
+            bool g_open = false;
+            std::string g_id("");
+            bool g_has_line = false;
+            svg_item g_line;
+            g_line.is_line = true;
+            // Which paths in the <g> are read: search for a path below scope_depth, expect the
+            // sibling of the path at sib_depth, or done.
+            enum class g_search { path, sibling, done };
+            g_search mode = g_search::done;
+            unsigned int scope_depth = 0;
+            unsigned int sib_depth = 0;
+
+            auto make_path = [](const xml_sax::element& e, const std::string& layer)
+            {
+                svg_item it;
+                it.layerName = layer;
+                const xml_sax::attribute* d_attr = e.find ("d");
+                if (d_attr != nullptr && !d_attr->value.empty()) {
+                    it.got_d = true;
+                    it.d = d_attr->value;
+                    if (it.d.find ('&') != std::string_view::npos) { it.d_unescaped = xml_sax::unescape (it.d); }
+                }
+                return it;
+            };
+
+            auto g_path = [&](const xml_sax::element& e)
+            {
+                // See if path has an id that isn't the generic "path0000" format. If so, use this
+                // to override the id from the <g> element
+                const xml_sax::attribute* id_attr = e.find ("id");
+                if (id_attr != nullptr && !id_attr->value.empty() && id_attr->value.rfind ("path", 0) != 0) {
+                    g_id = xml_sax::to_string (id_attr->value);
+                }
+                g_items.push_back (make_path (e, g_id));
+            };
+
+            auto on_start = [&](const xml_sax::element& e)
+            {
+                if (e.depth == 0) {
+                    // The root node. If there's more than one <svg>, read the first.
+                    if (!seen_svg && e.name == "svg") { seen_svg = true; svg_open = true; }
+                    return;
+                }
+                if (!svg_open) { return; }
+
+                if (e.depth == 1) {
+                    if (e.name == "g") {
+                        g_open = true;
+                        g_id = xml_sax::to_string (e.value ("id"));
+                        g_has_line = false;
+                        mode = g_search::path;
+                        scope_depth = 1;
+                    } else if (e.name == "path") {
+                        // Un-enclosed paths will need to use their id attribute
+                        const xml_sax::attribute* id_attr = e.find ("id");
+                        if (id_attr != nullptr) { top_items.push_back (make_path (e, xml_sax::to_string (id_attr->value))); }
+                    } else if (e.name == "circle") {
+                        // The ID of the circle is the key, the location of its centre gives the coordinate
+                        const xml_sax::attribute* id_attr = e.find ("id");
+                        const xml_sax::attribute* cx_attr = e.find ("cx");
+                        const xml_sax::attribute* cy_attr = e.find ("cy");
+                        if (id_attr != nullptr && cx_attr != nullptr && cy_attr != nullptr) {
+                            float cx = std::atof (xml_sax::to_string (cx_attr->value).c_str());
+                            float cy = std::atof (xml_sax::to_string (cy_attr->value).c_str());
+                            circs.emplace_back (xml_sax::to_string (id_attr->value), morph::vec<float, 2>({cx, cy}));
+                        }
+                    }
+                    return;
+                }
+                if (!g_open) { return; }
+
+                // Within a <g> layer
+                if (e.name == "line" && !g_has_line) {
+                    g_has_line = true;
+                    const char* xynames[4] = { "x1", "y1", "x2", "y2" };
+                    for (unsigned int j = 0; j < 4; ++j) { g_line.xy[j] = xml_sax::to_string (e.value (xynames[j])); }
+                }
+                if (mode == g_search::path && e.name == "path") {
+                    g_path (e);
+                    mode = g_search::sibling;
+                    sib_depth = e.depth;
+                } else if (mode == g_search::sibling && e.depth == sib_depth) {
+                    g_path (e);
+                    mode = g_search::path;
+                    scope_depth = e.depth;
+                }
+            };
+
+            auto on_end = [&](std::string_view, unsigned int depth)
+            {
+                if (!svg_open) { return; }
+                if (depth == 0) { svg_open = false; return; }
+                if (!g_open) { return; }
+                if (depth == 1) {
+                    // The layer's scale bar is named after the layer
+                    if (g_has_line) {
+                        g_line.layerName = g_id;
+                        g_items.push_back (g_line);
+                    }
+                    g_open = false;
+                } else if ((mode == g_search::sibling && depth + 1 == sib_depth)
+                           || (mode == g_search::path && depth == scope_depth)) {
+                    mode = g_search::done;
+                }
+            };
+
+            xml_sax::scan (this->svgtext, on_start, on_end);
+            if (!seen_svg) {
+                std::stringstream ee;
+                ee << "No root node 'svg'!";
+                throw std::runtime_error (ee.str());
             }
-            std::string y1("");
-            rapidxml::xml_attribute<>* y1_attr;
-            if ((y1_attr = line_node->first_attribute ("y1"))) {
-                y1 = y1_attr->value();
-            } // else failed to get y1
-            if (y1.empty()) {
-                throw std::runtime_error ("Found a <line> element without a y1 attribute");
+
+            // The layers' items come before the un-enclosed paths
+            std::vector<svg_item>& items = g_items;
+            items.insert (items.end(), std::make_move_iterator (top_items.begin()), std::make_move_iterator (top_items.end()));
+
+            // Parse the path data, which are independent of one another, in parallel
+            std::vector<morph::BezCurvePath<float>> paths (items.size());
+            std::vector<std::string> errors (items.size());
+            const long long nitems = static_cast<long long>(items.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for (long long ii = 0; ii < nitems; ++ii) {
+                const svg_item& it = items[ii];
+                if (it.is_line) { continue; }
+                if (!it.got_d) {
+                    errors[ii] = "Found a <path> element without a d attribute";
+                    continue;
+                }
+                try {
+                    paths[ii] = ReadCurves::parseD (it.d_unescaped.empty() ? it.d : std::string_view (it.d_unescaped));
+                } catch (const std::exception& e) {
+                    errors[ii] = e.what();
+                }
             }
-            std::string y2("");
-            rapidxml::xml_attribute<>* y2_attr;
-            if ((y2_attr = line_node->first_attribute ("y2"))) {
-                y2 = y2_attr->value();
-            } // else failed to get y2
-            if (y2.empty()) {
-                throw std::runtime_error ("Found a <line> element without a y2 attribute");
+
+            // File the results in document order
+            for (std::size_t ii = 0; ii < items.size(); ++ii) {
+                if (!errors[ii].empty()) { throw std::runtime_error (errors[ii]); }
+                if (items[ii].is_line) {
+                    if (this->foundLine == true) {
+                        std::cerr << "WARNING: Found a second <line> element in this SVG, was only expecting one (as a single scale bar)\n";
+                    }
+                    this->readLine (items[ii].xy, items[ii].layerName);
+                    this->foundLine = true;
+                } else {
+                    DBG ("Path commands for layer " << items[ii].layerName << ": " << items[ii].d);
+                    paths[ii].name = items[ii].layerName;
+                    this->readPath (std::move (paths[ii]));
+                }
+            }
+
+            for (auto& c : circs) { this->circles[c.first] = c.second; }
+
+            // Now the file is read, set the scaling:
+            this->setScale();
+        }
+
+        /*!
+         * File a parsed <path>. The path's name is the name of the layer in which it was found.
+         * The "cortex" layer is the cortical path; a layer whose name contains "mm" is a scale bar;
+         * any other is an enclosed region.
+         */
+        void readPath (morph::BezCurvePath<float>&& curves)
+        {
+            if (curves.name == "cortex") {
+                this->gotCortex = true;
+                this->corticalPath = std::move (curves);
+            } else if (curves.name.find ("mm") != std::string::npos) {
+                this->linePath = std::move (curves);
+                this->setupScaling (this->linePath.name);
+            } else {
+                this->enclosedRegions.push_back (std::move (curves));
+            }
+        }
+
+        /*!
+         * If g_id contains the string "mm", then treat it as a scale bar. If it contains "cortex",
+         * then treat it as the special outer/main boundary
+         */
+        void setupScaling (const std::string& g_id)
+        {
+            if (g_id.find("mm") != std::string::npos) {
+                // Parse lines. Note that Inkscape will save a line as a path with
+                // implicit lineto in the form of a path with 2 pairs of
+                // coordinates in a move command. Adobe Illustrator uses a <line>
+                // element.
+
+                // Extract the length of the line in mm from the layer name
+                // _x33_mm means .33 mm
+                std::string mm(g_id);
+                morph::Tools::searchReplace ("x", ".", mm);
+                morph::Tools::searchReplace ("_", "", mm);
+                morph::Tools::searchReplace ("m", "", mm);
+                float mmf = std::atof (mm.c_str());
+                // dl is the length of the scale bar line
+                float dl = 0.0f;
+                dl = this->linePath.getEndToEnd();
+                // Having found the length of the line from the <line> or
+                // <path>, compute lineToMillimetres
+                this->lineToMillimetres[0] = 1;
+                this->lineToMillimetres[1] = dl > 0.0f ? mmf/dl : 1.0f;
+            }
+        }
+
+        /*!
+         * Read a <line> element, given its x1, y1, x2 and y2 attributes, from which line length
+         * can be determined and lineToMillimetres populated.
+         */
+        void readLine (const std::array<std::string, 4>& xy, const std::string& layerName)
+        {
+            const char* xynames[4] = { "x1", "y1", "x2", "y2" };
+            for (unsigned int j = 0; j < 4; ++j) {
+                if (xy[j].empty()) {
+                    std::stringstream ee;
+                    ee << "Found a <line> element without a " << xynames[j] << " attribute";
+                    throw std::runtime_error (ee.str());
+                }
             }
 
             // Now do something with x1,y1,x2,y2: Create a BezCurve object then add this
             // to this->linePath
             morph::vec<float, 2> p1;
-            p1[0] = static_cast<float>(std::atof (x1.c_str()));
-            p1[1] = static_cast<float>(std::atof (y1.c_str()));
+            p1[0] = static_cast<float>(std::atof (xy[0].c_str()));
+            p1[1] = static_cast<float>(std::atof (xy[1].c_str()));
             morph::vec<float, 2> p2;
-            p2[0] = static_cast<float>(std::atof (x2.c_str()));
-            p2[1] = static_cast<float>(std::atof (y2.c_str()));
+            p2[0] = static_cast<float>(std::atof (xy[2].c_str()));
+            p2[1] = static_cast<float>(std::atof (xy[3].c_str()));
             morph::BezCurve<float> linecurve (p1, p2);
             this->linePath.reset();
             this->linePath.initialCoordinate = p1;
@@ -843,25 +752,9 @@ namespace morph
         bool foundLine = false;
 
         /*!
-         * An object into which to read the xml text prior to parsing.
-         */
-        morph::AllocAndRead modeldata;
-
-        /*!
-         * Main xml_document object.
-         */
-        rapidxml::xml_document<> doc;
-
-        /*!
-         * the root node pointer.
-         */
-        rapidxml::xml_node<>* root_node = static_cast<rapidxml::xml_node<>*>(0);
-
-        /*!
-         * Records the last command. Used when a string of identical commands needs to be parsed by
-         * parseD.
+         * The text of the SVG file. The path data are parsed straight from here.
          */
-        char lastCmd = '\0';
+        std::string svgtext;
     };
 
 } // namespace morph
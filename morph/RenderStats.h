@@ -0,0 +1,371 @@
+/*!
+ * \file
+ *
+ * Render loop instrumentation for morph::Visual. A RenderStats object keeps a ring buffer of
+ * the most recent frames. For each frame it records the CPU time spent in render(), the
+ * GPU time (from GL_TIME_ELAPSED queries, where the GL version supports them) and the
+ * vertex and draw call counts for each model, along with the CPU time spent rebuilding
+ * (initializeVertices) and uploading (reinit_buffers) models since the previous frame.
+ *
+ * Percentiles of any of these can be queried from code and the whole buffer can be exported
+ * as JSON or in the Chrome trace event format (load it in chrome://tracing or Perfetto).
+ *
+ * This class makes no GL calls. Visual drives it; see Visual::render_stats.
+ */
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <vector>
+#include <map>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace morph {
+
+    //! The timings and counts for one model in one frame. Times are in microseconds.
+    struct model_timing
+    {
+        std::string name;
+        //! When this model's render() started, relative to the start of the frame
+        double render_start_us = 0.0;
+        //! CPU time in render()
+        double render_cpu_us = 0.0;
+        //! GPU time for the model's draw calls. Negative if not (or not yet) known.
+        double render_gpu_us = -1.0;
+        //! CPU time rebuilding the model (initializeVertices) since the last frame
+        double reinit_us = 0.0;
+        //! CPU time uploading the model's vertex data to the GPU since the last frame
+        double upload_us = 0.0;
+        std::size_t vertices = 0U;
+        std::size_t indices = 0U;
+        std::size_t draw_calls = 0U;
+    };
+
+    //! The statistics for one frame. Times are in microseconds.
+    struct frame_stats
+    {
+        unsigned long long int frame = 0U;
+        //! When the frame started, relative to the creation of the RenderStats object
+        double start_us = 0.0;
+        //! CPU time for the whole of Visual::render()
+        double cpu_us = 0.0;
+        //! The sum of the models' GPU times. Negative if none are known.
+        double gpu_us = -1.0;
+        std::size_t vertices = 0U;
+        std::size_t draw_calls = 0U;
+        std::vector<model_timing> models;
+    };
+
+    //! The quantities that RenderStats::percentile() can report
+    enum class render_metric
+    {
+        cpu,      // frame: Visual::render() time. model: time in the model's render()
+        gpu,      // frame: sum of models' GPU times. model: GPU time of the model's draw calls
+        reinit,   // time in initializeVertices
+        upload,   // time in reinit_buffers
+        vertices,
+        draw_calls
+    };
+
+    class RenderStats
+    {
+        using sc = std::chrono::steady_clock;
+
+    public:
+        RenderStats (const std::size_t _capacity = 256U) { this->set_capacity (_capacity); }
+
+        //! Set true to record statistics. Visual checks this flag on each frame.
+        bool enabled = false;
+
+        //! Change the number of frames kept. This clears the buffer.
+        void set_capacity (const std::size_t _capacity)
+        {
+            if (_capacity == 0U) { throw std::runtime_error ("RenderStats: capacity must be at least 1"); }
+            this->capacity = _capacity;
+            this->clear();
+        }
+
+        //! Forget all recorded frames
+        void clear()
+        {
+            this->frames.assign (this->capacity, frame_stats{});
+            this->head = 0U;
+            this->count = 0U;
+            this->current = frame_stats{};
+            this->current.frame = this->next_frame;
+            this->current_keys.clear();
+        }
+
+        //! The number of frames in the buffer
+        std::size_t size() const { return this->count; }
+
+        //! Frame i in the buffer, with 0 the oldest
+        const frame_stats& operator[] (const std::size_t i) const
+        {
+            if (i >= this->count) { throw std::runtime_error ("RenderStats: frame index out of range"); }
+            return this->frames[(this->head + this->capacity - this->count + i) % this->capacity];
+        }
+
+        //! The most recently completed frame
+        const frame_stats& latest() const { return (*this)[this->count - 1U]; }
+
+        //! Called by Visual at the start of render()
+        void begin_frame()
+        {
+            this->frame_t0 = sc::now();
+            this->current.start_us = this->us_since (this->t0, this->frame_t0);
+        }
+
+        //! Called by Visual at the end of render(). Stores the current frame in the buffer.
+        void end_frame()
+        {
+            this->current.cpu_us = this->us_since (this->frame_t0, sc::now());
+            for (const auto& m : this->current.models) {
+                this->current.vertices += m.vertices;
+                this->current.draw_calls += m.draw_calls;
+            }
+            this->frames[this->head] = std::move (this->current);
+            this->head = (this->head + 1U) % this->capacity;
+            this->count = std::min (this->count + 1U, this->capacity);
+
+            this->current = frame_stats{};
+            this->current.frame = ++this->next_frame;
+            this->current_keys.clear();
+        }
+
+        //! The number that the frame in progress will have
+        unsigned long long int frame_number() const { return this->current.frame; }
+
+        /*!
+         * Return the index, in the current frame's models, of the model identified by key
+         * (usually its address), adding it if necessary. If name is empty, a previously
+         * given name, or a generated one, is used.
+         */
+        std::size_t model (const void* key, const std::string& name = "")
+        {
+            for (std::size_t i = 0; i < this->current_keys.size(); ++i) {
+                if (this->current_keys[i] == key) {
+                    if (!name.empty()) { this->current.models[i].name = this->label (key, name); }
+                    return i;
+                }
+            }
+            this->current_keys.push_back (key);
+            this->current.models.emplace_back();
+            this->current.models.back().name = this->label (key, name);
+            return this->current.models.size() - 1U;
+        }
+
+        //! Record the render of model mi in the current frame
+        void record_render (const std::size_t mi, const sc::time_point start, const sc::time_point end,
+                            const std::size_t vertices, const std::size_t indices, const std::size_t draw_calls)
+        {
+            model_timing& m = this->current.models[mi];
+            m.render_start_us = this->us_since (this->frame_t0, start);
+            m.render_cpu_us += this->us_since (start, end);
+            m.vertices = vertices;
+            m.indices = indices;
+            m.draw_calls = draw_calls;
+        }
+
+        //! Record the time a model spent in initializeVertices and in reinit_buffers
+        void record_reinit (const void* key, const std::string& name, const double reinit_us, const double upload_us)
+        {
+            model_timing& m = this->current.models[this->model (key, name)];
+            m.reinit_us += reinit_us;
+            m.upload_us += upload_us;
+        }
+
+        //! Set the GPU time for model mi of the given frame. GPU timer results arrive a few
+        //! frames late, by which time the frame may have left the buffer.
+        void set_gpu_time (const unsigned long long int frame, const std::size_t mi, const double gpu_us)
+        {
+            frame_stats* f = nullptr;
+            if (frame == this->current.frame) {
+                f = &this->current;
+            } else {
+                for (std::size_t i = 0; i < this->count; ++i) {
+                    frame_stats& fi = this->frames[(this->head + this->capacity - 1U - i) % this->capacity];
+                    if (fi.frame == frame) { f = &fi; break; }
+                    if (fi.frame < frame) { break; }
+                }
+            }
+            if (f == nullptr || mi >= f->models.size()) { return; }
+            f->models[mi].render_gpu_us = gpu_us;
+            f->gpu_us = (f->gpu_us < 0.0 ? 0.0 : f->gpu_us) + gpu_us;
+        }
+
+        /*!
+         * The pc'th percentile (pc in [0,100]) of metric m over the frames in the buffer. If
+         * model is given, the metric is for that model alone. Frames for which the metric is
+         * not known (GPU times, which may be unavailable) are skipped. Returns NaN if there
+         * is nothing to report.
+         */
+        double percentile (const double pc, const render_metric m = render_metric::cpu, const std::string& model = "") const
+        {
+            std::vector<double> v;
+            v.reserve (this->count);
+            for (std::size_t i = 0; i < this->count; ++i) {
+                const frame_stats& f = (*this)[i];
+                if (model.empty()) {
+                    double x = RenderStats::frame_value (f, m);
+                    if (x >= 0.0) { v.push_back (x); }
+                } else {
+                    for (const auto& mt : f.models) {
+                        if (mt.name != model) { continue; }
+                        double x = RenderStats::model_value (mt, m);
+                        if (x >= 0.0) { v.push_back (x); }
+                    }
+                }
+            }
+            if (v.empty()) { return std::numeric_limits<double>::quiet_NaN(); }
+            // Nearest rank
+            double rank = std::ceil (std::clamp (pc, 0.0, 100.0) / 100.0 * static_cast<double>(v.size()));
+            std::size_t k = rank < 1.0 ? 0U : static_cast<std::size_t>(rank) - 1U;
+            std::nth_element (v.begin(), v.begin() + k, v.end());
+            return v[k];
+        }
+
+        //! The frames in the buffer, with a summary, as JSON
+        nlohmann::json to_json() const
+        {
+            nlohmann::json j;
+            nlohmann::json& jframes = j["frames"];
+            jframes = nlohmann::json::array();
+            for (std::size_t i = 0; i < this->count; ++i) {
+                const frame_stats& f = (*this)[i];
+                nlohmann::json jf = { {"frame", f.frame}, {"start_us", f.start_us}, {"cpu_us", f.cpu_us},
+                                      {"gpu_us", f.gpu_us}, {"vertices", f.vertices}, {"draw_calls", f.draw_calls} };
+                jf["models"] = nlohmann::json::array();
+                for (const auto& m : f.models) {
+                    jf["models"].push_back ({ {"name", m.name}, {"render_start_us", m.render_start_us},
+                                              {"render_cpu_us", m.render_cpu_us}, {"render_gpu_us", m.render_gpu_us},
+                                              {"reinit_us", m.reinit_us}, {"upload_us", m.upload_us},
+                                              {"vertices", m.vertices}, {"indices", m.indices},
+                                              {"draw_calls", m.draw_calls} });
+                }
+                jframes.push_back (jf);
+            }
+            auto nan_to_null = [](double x) { return std::isnan (x) ? nlohmann::json() : nlohmann::json (x); };
+            j["summary"] = { {"frames", this->count},
+                             {"cpu_us_p50", nan_to_null (this->percentile (50.0, render_metric::cpu))},
+                             {"cpu_us_p99", nan_to_null (this->percentile (99.0, render_metric::cpu))},
+                             {"gpu_us_p50", nan_to_null (this->percentile (50.0, render_metric::gpu))},
+                             {"gpu_us_p99", nan_to_null (this->percentile (99.0, render_metric::gpu))} };
+            return j;
+        }
+
+        /*!
+         * The frames in the buffer in Chrome's trace event format. CPU work is on thread 0:
+         * one event per frame, with the models' render, reinit and upload times inside it.
+         * GPU times are on thread 1. As elapsed time queries give durations but not start
+         * times, each frame's GPU events are laid end to end from the start of the frame.
+         */
+        nlohmann::json to_chrome_trace() const
+        {
+            nlohmann::json events = nlohmann::json::array();
+            auto event = [&events](const std::string& name, const std::string& cat, double ts, double dur, int tid) {
+                events.push_back ({ {"name", name}, {"cat", cat}, {"ph", "X"}, {"ts", ts}, {"dur", dur},
+                                    {"pid", 0}, {"tid", tid} });
+            };
+            for (std::size_t i = 0; i < this->count; ++i) {
+                const frame_stats& f = (*this)[i];
+                event ("frame " + std::to_string (f.frame), "frame", f.start_us, f.cpu_us, 0);
+                double gpu_ts = f.start_us;
+                for (const auto& m : f.models) {
+                    // reinit and upload happened between frames; show them just before this one
+                    if (m.reinit_us > 0.0 || m.upload_us > 0.0) {
+                        double ts = f.start_us - m.reinit_us - m.upload_us;
+                        event (m.name + " reinit", "reinit", ts, m.reinit_us, 0);
+                        event (m.name + " upload", "upload", ts + m.reinit_us, m.upload_us, 0);
+                    }
+                    if (m.render_cpu_us > 0.0) {
+                        event (m.name, "render", f.start_us + m.render_start_us, m.render_cpu_us, 0);
+                    }
+                    if (m.render_gpu_us >= 0.0) {
+                        event (m.name, "gpu", gpu_ts, m.render_gpu_us, 1);
+                        gpu_ts += m.render_gpu_us;
+                    }
+                }
+            }
+            return nlohmann::json { {"traceEvents", events}, {"displayTimeUnit", "ms"} };
+        }
+
+        //! Write to_json() to the file at path
+        void save_json (const std::string& path) const { RenderStats::save (path, this->to_json()); }
+
+        //! Write to_chrome_trace() to the file at path
+        void save_chrome_trace (const std::string& path) const { RenderStats::save (path, this->to_chrome_trace()); }
+
+    private:
+        std::size_t capacity = 0U;
+        //! The ring buffer of completed frames. The next is written at head.
+        std::vector<frame_stats> frames;
+        std::size_t head = 0U;
+        std::size_t count = 0U;
+        //! The frame in progress (and reinits since the last frame)
+        frame_stats current;
+        std::vector<const void*> current_keys;
+        unsigned long long int next_frame = 0U;
+        //! Names for the models
+        std::map<const void*, std::string> labels;
+        sc::time_point t0 = sc::now();
+        sc::time_point frame_t0 = sc::now();
+
+        static double us_since (const sc::time_point a, const sc::time_point b)
+        {
+            return std::chrono::duration<double, std::micro>(b - a).count();
+        }
+
+        const std::string& label (const void* key, const std::string& name)
+        {
+            auto li = this->labels.find (key);
+            if (li == this->labels.end()) {
+                std::string l = name.empty() ? "model " + std::to_string (this->labels.size()) : name;
+                li = this->labels.emplace (key, l).first;
+            } else if (!name.empty()) {
+                li->second = name;
+            }
+            return li->second;
+        }
+
+        static double frame_value (const frame_stats& f, const render_metric m)
+        {
+            double x = 0.0;
+            switch (m) {
+            case render_metric::cpu: return f.cpu_us;
+            case render_metric::gpu: return f.gpu_us;
+            case render_metric::vertices: return static_cast<double>(f.vertices);
+            case render_metric::draw_calls: return static_cast<double>(f.draw_calls);
+            case render_metric::reinit: for (const auto& mt : f.models) { x += mt.reinit_us; } return x;
+            case render_metric::upload: for (const auto& mt : f.models) { x += mt.upload_us; } return x;
+            default: return -1.0;
+            }
+        }
+
+        static double model_value (const model_timing& mt, const render_metric m)
+        {
+            switch (m) {
+            case render_metric::cpu: return mt.render_cpu_us;
+            case render_metric::gpu: return mt.render_gpu_us;
+            case render_metric::reinit: return mt.reinit_us;
+            case render_metric::upload: return mt.upload_us;
+            case render_metric::vertices: return static_cast<double>(mt.vertices);
+            case render_metric::draw_calls: return static_cast<double>(mt.draw_calls);
+            default: return -1.0;
+            }
+        }
+
+        static void save (const std::string& path, const nlohmann::json& j)
+        {
+            std::ofstream f (path);
+            if (!f.is_open()) { throw std::runtime_error ("RenderStats: Failed to open " + path + " for writing"); }
+            f << j.dump (1);
+        }
+    };
+
+} // namespace morph
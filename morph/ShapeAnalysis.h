@@ -14,6 +14,7 @@
 #include <stdexcept>
 #include <morph/Hex.h>
 #include <morph/HexGrid.h>
+#include <morph/HexView.h>
 #include <morph/DirichDom.h>
 #include <morph/DirichVtx.h>
 #include <morph/MorphDbg.h>
@@ -37,9 +38,22 @@ namespace morph {
     {
     public:
 
+        /*!
+         * The contour and region finders read flags and neighbours from hg's d_ vectors through
+         * HexViews, rather than copying each Hex out of hg->hexen. If hg's d_ vectors have not
+         * been populated (a HexGrid with no boundary), this calls hg->populate_d_vectors(),
+         * which changes hg.
+         */
+        static void require_d_vectors (HexGrid* hg)
+        {
+            if (hg->d_x.size() != hg->num()) { hg->populate_d_vectors(); }
+        }
+
         /*!
          * Obtain the contours (as a vector of list<Hex>) in the scalar fields f, where threshold is
          * crossed.
+         *
+         * Populates hg's d_ vectors, if they are empty (see require_d_vectors).
          */
         static std::vector<std::list<Hex> > get_contours (HexGrid* hg,
                                                           std::vector<std::vector<Flt> >& f,
@@ -57,7 +71,12 @@ namespace morph {
 
             Flt maxf = -1e7;
             Flt minf = +1e7;
-            for (auto h : hg->hexen) {
+            require_d_vectors (hg);
+            // The Hexes, in the order of the d_ vectors, to copy into the contours
+            std::vector<const Hex*> dhexen;
+            dhexen.reserve (nhex);
+            for (const Hex& h : hg->hexen) { dhexen.push_back (&h); }
+            for (HexView h : hexviews (hg)) {
                 if (h.onBoundary() == false) {
                     for (unsigned int i = 0; i<N; ++i) {
                         if (f[i][h.vi] > maxf) { maxf = f[i][h.vi]; }
@@ -82,21 +101,21 @@ namespace morph {
 
             // Collate
             for (unsigned int i = 0; i<N; ++i) {
-                for (auto h : hg->hexen) {
+                for (HexView h : hexviews (hg)) {
                     if (h.onBoundary() == false) {
                         if (norm_f[i][h.vi] >= threshold) {
-                            if ( (h.has_ne() && norm_f[i][h.ne->vi] < threshold)
-                                 || (h.has_nne() && norm_f[i][h.nne->vi] < threshold)
-                                 || (h.has_nnw() && norm_f[i][h.nnw->vi] < threshold)
-                                 || (h.has_nw() && norm_f[i][h.nw->vi] < threshold)
-                                 || (h.has_nsw() && norm_f[i][h.nsw->vi] < threshold)
-                                 || (h.has_nse() && norm_f[i][h.nse->vi] < threshold) ) {
-                                rtn[i].push_back (h);
+                            if ( (h.has_ne() && norm_f[i][h.ne().vi] < threshold)
+                                 || (h.has_nne() && norm_f[i][h.nne().vi] < threshold)
+                                 || (h.has_nnw() && norm_f[i][h.nnw().vi] < threshold)
+                                 || (h.has_nw() && norm_f[i][h.nw().vi] < threshold)
+                                 || (h.has_nsw() && norm_f[i][h.nsw().vi] < threshold)
+                                 || (h.has_nse() && norm_f[i][h.nse().vi] < threshold) ) {
+                                rtn[i].push_back (*dhexen[h.vi]);
                             }
                         }
                     } else { // h.onBoundary() is true
                         if (norm_f[i][h.vi] >= threshold) {
-                            rtn[i].push_back (h);
+                            rtn[i].push_back (*dhexen[h.vi]);
                         }
                     }
                 }
@@ -108,6 +127,8 @@ namespace morph {
         /*!
          * Like get_contours, but returns a full hexgrid's worth of Flts instead of
          * lists of Hexes.
+         *
+         * Populates hg's d_ vectors, if they are empty (see require_d_vectors).
          */
         static std::vector<Flt> get_contour_map (HexGrid* hg,
                                                  std::vector<std::vector<Flt> >& f,
@@ -120,7 +141,8 @@ namespace morph {
 
             Flt maxf = -1e7;
             Flt minf = +1e7;
-            for (auto h : hg->hexen) {
+            require_d_vectors (hg);
+            for (HexView h : hexviews (hg)) {
                 if (h.onBoundary() == false) {
                     for (unsigned int i = 0; i<N; ++i) {
                         if (f[i][h.vi] > maxf) { maxf = f[i][h.vi]; }
@@ -145,15 +167,15 @@ namespace morph {
 
             // Collate
             for (unsigned int i = 0; i<N; ++i) {
-                for (auto h : hg->hexen) {
+                for (HexView h : hexviews (hg)) {
                     if (h.onBoundary() == false) {
                         if (norm_f[i][h.vi] >= threshold) {
-                            if ( (h.has_ne() && norm_f[i][h.ne->vi] < threshold)
-                                 || (h.has_nne() && norm_f[i][h.nne->vi] < threshold)
-                                 || (h.has_nnw() && norm_f[i][h.nnw->vi] < threshold)
-                                 || (h.has_nw() && norm_f[i][h.nw->vi] < threshold)
-                                 || (h.has_nsw() && norm_f[i][h.nsw->vi] < threshold)
-                                 || (h.has_nse() && norm_f[i][h.nse->vi] < threshold) ) {
+                            if ( (h.has_ne() && norm_f[i][h.ne().vi] < threshold)
+                                 || (h.has_nne() && norm_f[i][h.nne().vi] < threshold)
+                                 || (h.has_nnw() && norm_f[i][h.nnw().vi] < threshold)
+                                 || (h.has_nw() && norm_f[i][h.nw().vi] < threshold)
+                                 || (h.has_nsw() && norm_f[i][h.nsw().vi] < threshold)
+                                 || (h.has_nse() && norm_f[i][h.nse().vi] < threshold) ) {
                                 rtn[h.vi] = (Flt)i/(Flt)N;
                             }
                         }
@@ -170,18 +192,20 @@ namespace morph {
 
         //! Like get_contour_map, but no pre-normalizing and sets contours to the flag value
         //! (used by SPW in SOM model analysis steps)
+        //! Populates hg's d_ vectors, if they are empty (see require_d_vectors).
         static std::vector<Flt> get_contour_map_flag_nonorm (HexGrid* hg,std::vector<Flt> & f, Flt threshold, Flt flagVal) {
             unsigned int nhex = hg->num();
             std::vector<Flt> rtn (nhex, 0.0);
-            for (auto h : hg->hexen) {
+            require_d_vectors (hg);
+            for (HexView h : hexviews (hg)) {
                 if (h.onBoundary() == false) {
                     if (f[h.vi] >= threshold) {
-                        if ((h.has_ne() && f[h.ne->vi] < threshold)
-                            || (h.has_nne() && f[h.nne->vi] < threshold)
-                            || (h.has_nnw() && f[h.nnw->vi] < threshold)
-                            || (h.has_nw() && f[h.nw->vi] < threshold)
-                            || (h.has_nsw() && f[h.nsw->vi] < threshold)
-                            || (h.has_nse() && f[h.nse->vi] < threshold) ) {
+                        if ((h.has_ne() && f[h.ne().vi] < threshold)
+                            || (h.has_nne() && f[h.nne().vi] < threshold)
+                            || (h.has_nnw() && f[h.nnw().vi] < threshold)
+                            || (h.has_nw() && f[h.nw().vi] < threshold)
+                            || (h.has_nsw() && f[h.nsw().vi] < threshold)
+                            || (h.has_nse() && f[h.nse().vi] < threshold) ) {
                             rtn[h.vi] = flagVal;
                         }
                     }
@@ -193,6 +217,7 @@ namespace morph {
         //! Like get_contour_map, but for N vector<Flt>s in @f, return N+1 positive values in the
         //! return vector. Good for plotting contours with ColourMapType::RainbowZeroBlack or
         //! ColourMapType::RainbowZeroWhite
+        //! Populates hg's d_ vectors, if they are empty (see require_d_vectors).
         static std::vector<Flt> get_contour_map_nozero (HexGrid* hg,
                                                         std::vector<std::vector<Flt> >& f,
                                                         Flt threshold) {
@@ -204,7 +229,8 @@ namespace morph {
 
             Flt maxf = -1e7;
             Flt minf = +1e7;
-            for (auto h : hg->hexen) {
+            require_d_vectors (hg);
+            for (HexView h : hexviews (hg)) {
                 if (h.onBoundary() == false) {
                     for (unsigned int i = 0; i<N; ++i) {
                         if (f[i][h.vi] > maxf) { maxf = f[i][h.vi]; }
@@ -229,15 +255,15 @@ namespace morph {
 
             // Collate
             for (unsigned int i = 0; i<N; ++i) {
-                for (auto h : hg->hexen) {
+                for (HexView h : hexviews (hg)) {
                     if (h.onBoundary() == false) {
                         if (norm_f[i][h.vi] >= threshold) {
-                            if ( (h.has_ne() && norm_f[i][h.ne->vi] < threshold)
-                                 || (h.has_nne() && norm_f[i][h.nne->vi] < threshold)
-                                 || (h.has_nnw() && norm_f[i][h.nnw->vi] < threshold)
-                                 || (h.has_nw() && norm_f[i][h.nw->vi] < threshold)
-                                 || (h.has_nsw() && norm_f[i][h.nsw->vi] < threshold)
-                                 || (h.has_nse() && norm_f[i][h.nse->vi] < threshold) ) {
+                            if ( (h.has_ne() && norm_f[i][h.ne().vi] < threshold)
+                                 || (h.has_nne() && norm_f[i][h.nne().vi] < threshold)
+                                 || (h.has_nnw() && norm_f[i][h.nnw().vi] < threshold)
+                                 || (h.has_nw() && norm_f[i][h.nw().vi] < threshold)
+                                 || (h.has_nsw() && norm_f[i][h.nsw().vi] < threshold)
+                                 || (h.has_nse() && norm_f[i][h.nse().vi] < threshold) ) {
                                 rtn[h.vi] = (Flt)(i+1)/(Flt)(N+1); // only this line...
                             }
                         }
@@ -256,6 +282,8 @@ namespace morph {
          * Take a set of variables, @f, for the given HexGrid @hg. Return a vector of Flts (again,
          * based on the HexGrid @hg) which marks each hex with the outer index of the @f which has
          * highest value in that hex, scaled and converted to a float.
+         *
+         * Populates hg's d_ vectors, if they are empty (see require_d_vectors).
          */
         static std::vector<Flt>
         dirichlet_regions (HexGrid* hg, std::vector<std::vector<Flt> >& f) {
@@ -265,7 +293,8 @@ namespace morph {
             std::vector<Flt> rtn (f[0].size(), 0.0);
 
             // Mark regions first.
-            for (auto h : hg->hexen) {
+            require_d_vectors (hg);
+            for (HexView h : hexviews (hg)) {
 
                 Flt maxf = -1e7;
                 for (unsigned int i = 0; i<N; ++i) {
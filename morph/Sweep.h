@@ -0,0 +1,656 @@
+/*!
+ * \file Sweep.h
+ *
+ * \brief Run a parameter sweep of a simulation program as concurrent child processes
+ *
+ * A Sweep expands a design (a grid of parameter values, or random samples) into a list of
+ * runs. Each run is the simulation program, launched with morph::Config overrides
+ * (-co:name=value, see Config::process_args) for its parameters and for the path to which it
+ * should write its results. The runs are executed as morph::Process children, several at a
+ * time, each on its own set of cores. Their stdout and stderr are streamed into log files
+ * (and optionally to a callback) by way of ProcessCallbacks, failed runs are retried and a
+ * JSON manifest records what was run, where, for how long and with what outcome.
+ *
+ * A sweep is described by a JSON file such as:
+ *
+ * {
+ *     "program" : "build/examples/schnakenberg/schnakenberg_noplot",
+ *     "args" : [ "examples/schnakenberg/schnakenberg.json" ],
+ *     "design" : "grid",
+ *     "parameters" : {
+ *         "k4" : [ 1.5, 1.7, 1.9 ],
+ *         "D_B" : { "min" : 10, "max" : 40, "num" : 4, "log" : true }
+ *     },
+ *     "fixed" : { "steps" : 20000 },
+ *     "outdir" : "logs/sweep",
+ *     "threads_per_run" : 1,
+ *     "retries" : 1
+ * }
+ *
+ * See the member attributes of Sweep for all the settings. The settings (but not the
+ * parameters) can themselves be overridden on the command line of the program that runs
+ * the Sweep with -co:name=value, by passing a Config on which process_args has been called.
+ *
+ * This class is for Unix-like systems only, as it uses morph::Process. Pinning runs to cores
+ * is supported on Linux.
+ *
+ * For an example of its use, see examples/sweep.cpp
+ */
+#pragma once
+
+#include <morph/Config.h>
+#include <morph/Process.h>
+#include <morph/Random.h>
+#include <morph/tools.h>
+#include <nlohmann/json.hpp>
+#include <map>
+#include <list>
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+extern "C" {
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+# include <sched.h>
+#endif
+}
+
+namespace morph {
+
+    //! One run of a Sweep and, once it has been run, its outcome
+    struct SweepRun
+    {
+        //! The run's index in the sweep
+        unsigned int index = 0;
+        //! The values of the swept parameters for this run, as passed to the program
+        std::map<std::string, std::string> overrides;
+        //! The directory for this run's results (and its output logs)
+        std::string result_path = "";
+        //! Files holding the stdout and stderr of the run
+        std::string stdout_path = "";
+        std::string stderr_path = "";
+        //! "pending", "running", "ok", "failed" or "timeout"
+        std::string status = "pending";
+        //! The exit code of the last attempt, or minus the number of the signal that ended it
+        int exit_code = 0;
+        //! How many times the run was started
+        unsigned int attempts = 0;
+        //! The wall time of each attempt, in seconds
+        std::vector<double> attempt_seconds;
+        //! When the last attempt started and ended, in seconds since the sweep started
+        double start_time = 0.0;
+        double end_time = 0.0;
+        //! The cores on which the last attempt ran (empty if it was not pinned)
+        std::vector<int> cores;
+    };
+
+    //! A child process of a Sweep, with the files that its output goes to
+    struct SweepChild
+    {
+        unsigned int run = 0;
+        unsigned int slot = 0;
+        Process proc;
+        std::ofstream out;
+        std::ofstream err;
+        std::chrono::steady_clock::time_point t0;
+        //! Called with each chunk of output text and true if the text came from stderr
+        std::function<void(const std::string&, bool)> on_output;
+
+        //! Read whatever the child has written to stdout (or stderr) and pass it on
+        void read (bool from_stderr)
+        {
+            std::string text = from_stderr ? this->proc.readAllStandardError() : this->proc.readAllStandardOutput();
+            if (text.empty()) { return; }
+            std::ofstream& f = from_stderr ? this->err : this->out;
+            f << text << std::flush;
+            if (this->on_output) { this->on_output (text, from_stderr); }
+        }
+    };
+
+    //! Callbacks class extends ProcessCallbacks to stream a SweepChild's output
+    class SweepProcessCallbacks : public ProcessCallbacks
+    {
+    public:
+        SweepProcessCallbacks (SweepChild* c) { this->child = c; }
+        void readyReadStandardOutputSignal() { this->child->read (false); }
+        void readyReadStandardErrorSignal() { this->child->read (true); }
+    private:
+        SweepChild* child;
+    };
+
+    /*!
+     * A concurrent parameter sweep runner. Construct with the sweep's JSON file (or a Config
+     * holding it), which expands the design into runs, then call run().
+     */
+    class Sweep
+    {
+    public:
+        //! Construct from the path to a JSON sweep file
+        Sweep (const std::string& sweepfile)
+        {
+            morph::Config conf (sweepfile);
+            if (!conf.ready) {
+                throw std::runtime_error ("Sweep: Failed to read the sweep file '" + sweepfile + "'");
+            }
+            this->init (conf);
+        }
+
+        //! Construct from a Config, whose config_overrides apply to the sweep's settings
+        Sweep (const morph::Config& conf) { this->init (conf); }
+
+        //! The simulation program (a path; the PATH is not searched)
+        std::string program = "";
+        //! Arguments to the program, which come before the config overrides
+        std::vector<std::string> args;
+        //! "grid" (every combination of the parameters' values) or "random"
+        std::string design = "grid";
+        //! For the random design, the number of runs and the seed (0 for a random seed)
+        unsigned int samples = 0;
+        unsigned int seed = 0;
+        //! Overrides which are passed to every run
+        std::map<std::string, std::string> fixed;
+        //! The directory under which each run gets its own result directory, run_NNNN
+        std::string outdir = "sweep";
+        //! The config parameter through which a run is told its result directory
+        std::string result_key = "logpath";
+        //! The manifest file. If empty, it is outdir/manifest.json
+        std::string manifest = "";
+        /*!
+         * Cores per run. Unless max_concurrent is set, the number of runs that execute at
+         * once is the number of cores that are available to this process, divided by
+         * threads_per_run.
+         */
+        unsigned int threads_per_run = 1;
+        //! If non-zero, the number of runs that execute at once (which may oversubscribe the cores)
+        unsigned int max_concurrent = 0;
+        //! If true, pin each run to its own threads_per_run cores (Linux only)
+        bool pin = true;
+        //! If true, set OMP_NUM_THREADS to threads_per_run in the environment of each run
+        bool set_omp_threads = true;
+        //! The number of times to re-run a run that fails (or times out)
+        unsigned int retries = 0;
+        //! If non-zero, a run is stopped and counts as failed after this many seconds
+        double timeout = 0.0;
+        //! If true, copy the output of the runs to stdout and stderr, prefixed with the run
+        bool echo = false;
+        //! How often to poll the running children, in microseconds
+        unsigned int poll_interval = 2000;
+
+        //! All the runs in the sweep
+        std::vector<SweepRun> runs;
+
+        //! Called with a run, a chunk of its output and true if the output came from stderr
+        std::function<void(const SweepRun&, const std::string&, bool)> on_output;
+        //! Called when a run has finished (successfully or not) for the last time
+        std::function<void(const SweepRun&)> on_finished;
+
+        /*!
+         * Run the sweep; every run that has not yet finished successfully. Returns the
+         * number of runs that failed. Throws if the program can't be run at all.
+         */
+        unsigned int run()
+        {
+            if (this->program.empty()) { throw std::runtime_error ("Sweep: No program to run"); }
+            if (access (this->program.c_str(), X_OK) != 0) {
+                throw std::runtime_error ("Sweep: The program '" + this->program + "' is not executable");
+            }
+            morph::Tools::createDirIf (this->outdir);
+            if (this->manifest.empty()) { this->manifest = this->outdir + "/manifest.json"; }
+
+            this->setup_slots();
+            this->sweep_t0 = std::chrono::steady_clock::now();
+
+            std::deque<unsigned int> pending;
+            for (auto& r : this->runs) {
+                if (r.status != "ok") {
+                    r.status = "pending";
+                    r.attempts = 0;
+                    r.attempt_seconds.clear();
+                    pending.push_back (r.index);
+                }
+            }
+
+            // One child (and its callbacks) per slot. A slot with no child is free.
+            std::vector<std::unique_ptr<SweepChild>> children (this->slot_cores.size());
+            std::vector<std::unique_ptr<SweepProcessCallbacks>> callbacks (this->slot_cores.size());
+            unsigned int n_running = 0;
+
+            while (!pending.empty() || n_running > 0) {
+                // Fill the free slots
+                for (unsigned int s = 0; s < children.size() && !pending.empty(); ++s) {
+                    if (children[s]) { continue; }
+                    unsigned int ri = pending.front();
+                    pending.pop_front();
+                    children[s] = std::make_unique<SweepChild>();
+                    callbacks[s] = std::make_unique<SweepProcessCallbacks> (children[s].get());
+                    if (this->launch (ri, s, *children[s], *callbacks[s])) {
+                        ++n_running;
+                    } else {
+                        this->finish (*children[s], -1, "failed", pending);
+                        children[s].reset();
+                        callbacks[s].reset();
+                    }
+                }
+
+                usleep (this->poll_interval);
+
+                // Stream output and look for finished (or overdue) children
+                for (unsigned int s = 0; s < children.size(); ++s) {
+                    if (!children[s]) { continue; }
+                    SweepChild& c = *children[s];
+                    c.proc.probeProcess();
+                    if (c.proc.running() && c.proc.getError() == PROCESSNOERROR) {
+                        if (this->timeout > 0.0 && this->seconds_since (c.t0) > this->timeout) {
+                            const int code = this->stop (c.proc.getPid());
+                            c.read (false);
+                            c.read (true);
+                            this->finish (c, code, "timeout", pending);
+                        } else {
+                            continue;
+                        }
+                    } else {
+                        // Collect any output written just before the child exited
+                        c.read (false);
+                        c.read (true);
+                        if (c.proc.getError() != PROCESSNOERROR) {
+                            if (c.proc.running()) { this->stop (c.proc.getPid()); }
+                            this->finish (c, -1, "failed", pending);
+                        } else {
+                            const int code = exit_code (c.proc.getExitStatus());
+                            this->finish (c, code, code == 0 ? "ok" : "failed", pending);
+                        }
+                    }
+                    children[s].reset();
+                    callbacks[s].reset();
+                    --n_running;
+                }
+            }
+
+            this->write_manifest();
+            unsigned int n_failed = 0;
+            for (auto& r : this->runs) { n_failed += (r.status == "ok") ? 0 : 1; }
+            return n_failed;
+        }
+
+        //! Write the manifest of the sweep, replacing any earlier manifest atomically
+        void write_manifest() const
+        {
+            nlohmann::json m;
+            m["program"] = this->program;
+            m["args"] = this->args;
+            m["design"] = this->design;
+            m["fixed"] = this->fixed;
+            m["outdir"] = this->outdir;
+            m["threads_per_run"] = this->threads_per_run;
+            m["slots"] = this->slot_cores.size();
+            m["pinned"] = this->pinned;
+            m["retries"] = this->retries;
+            m["elapsed"] = this->seconds_since (this->sweep_t0);
+            unsigned int n_ok = 0;
+            nlohmann::json rs = nlohmann::json::array();
+            for (const auto& r : this->runs) {
+                nlohmann::json j;
+                j["index"] = r.index;
+                j["parameters"] = r.overrides;
+                j["result_path"] = r.result_path;
+                j["stdout"] = r.stdout_path;
+                j["stderr"] = r.stderr_path;
+                j["status"] = r.status;
+                j["exit_code"] = r.exit_code;
+                j["attempts"] = r.attempts;
+                j["attempt_seconds"] = r.attempt_seconds;
+                j["start"] = r.start_time;
+                j["end"] = r.end_time;
+                j["cores"] = r.cores;
+                rs.push_back (j);
+                n_ok += (r.status == "ok") ? 1 : 0;
+            }
+            m["n_runs"] = this->runs.size();
+            m["n_ok"] = n_ok;
+            m["runs"] = rs;
+
+            const std::string tmp = this->manifest + ".tmp";
+            std::ofstream f (tmp, std::ios::out | std::ios::trunc);
+            if (!f.is_open()) { throw std::runtime_error ("Sweep: Failed to open '" + tmp + "' for writing"); }
+            f << std::setw(4) << m << std::endl;
+            f.close();
+            if (std::rename (tmp.c_str(), this->manifest.c_str()) != 0) {
+                throw std::runtime_error ("Sweep: Failed to write the manifest '" + this->manifest + "'");
+            }
+        }
+
+        //! The cores available to this process
+        static std::vector<int> available_cores()
+        {
+            std::vector<int> cores;
+#ifdef __linux__
+            cpu_set_t mask;
+            CPU_ZERO (&mask);
+            if (sched_getaffinity (0, sizeof (mask), &mask) == 0) {
+                for (int c = 0; c < CPU_SETSIZE; ++c) {
+                    if (CPU_ISSET (c, &mask)) { cores.push_back (c); }
+                }
+            }
+#endif
+            if (cores.empty()) {
+                const unsigned int n = std::max (1U, std::thread::hardware_concurrency());
+                for (unsigned int c = 0; c < n; ++c) { cores.push_back (static_cast<int>(c)); }
+            }
+            return cores;
+        }
+
+        //! Convert a JSON value to the text of a config override
+        static std::string override_text (const nlohmann::json& v)
+        {
+            return v.is_string() ? v.get<std::string>() : v.dump();
+        }
+
+    private:
+        //! The cores of each slot. There are as many slots as runs that execute at once.
+        std::vector<std::vector<int>> slot_cores;
+        //! True if the runs are pinned to the cores of their slots
+        bool pinned = false;
+        std::chrono::steady_clock::time_point sweep_t0 = std::chrono::steady_clock::now();
+
+        double seconds_since (std::chrono::steady_clock::time_point t) const
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+        }
+
+        //! Read the settings and the design from conf and expand the design into runs
+        void init (const morph::Config& conf)
+        {
+            this->program = conf.getString ("program", "");
+            for (const auto& a : conf.getArray ("args")) { this->args.push_back (override_text (a)); }
+            this->design = conf.getString ("design", "grid");
+            this->samples = conf.getUInt ("samples", 0);
+            this->seed = conf.getUInt ("seed", 0);
+            const nlohmann::json fixed_params = conf.get ("fixed");
+            for (const auto& f : fixed_params.items()) { this->fixed[f.key()] = override_text (f.value()); }
+            this->outdir = conf.getString ("outdir", "sweep");
+            this->result_key = conf.getString ("result_key", "logpath");
+            this->manifest = conf.getString ("manifest", "");
+            this->threads_per_run = std::max (1U, conf.getUInt ("threads_per_run", 1));
+            this->max_concurrent = conf.getUInt ("max_concurrent", 0);
+            this->pin = conf.getBool ("pin", true);
+            this->set_omp_threads = conf.getBool ("set_omp_threads", true);
+            this->retries = conf.getUInt ("retries", 0);
+            this->timeout = conf.getDouble ("timeout", 0.0);
+            this->echo = conf.getBool ("echo", false);
+
+            nlohmann::json params = conf.get ("parameters");
+            if (!params.is_object() || params.empty()) {
+                throw std::runtime_error ("Sweep: The sweep file has no \"parameters\" object");
+            }
+            if (this->design == "grid") {
+                this->expand_grid (params);
+            } else if (this->design == "random") {
+                this->expand_random (params);
+            } else {
+                throw std::runtime_error ("Sweep: Unknown design '" + this->design + "' (use grid or random)");
+            }
+
+            // The runs' result directories, with the index zero-padded to sort in order
+            const int width = std::max (4, static_cast<int>(std::to_string (this->runs.size()).size()));
+            for (auto& r : this->runs) {
+                std::stringstream ss;
+                ss << this->outdir << "/run_" << std::setw(width) << std::setfill('0') << r.index;
+                r.result_path = ss.str();
+                r.stdout_path = r.result_path + "/stdout.log";
+                r.stderr_path = r.result_path + "/stderr.log";
+            }
+        }
+
+        /*!
+         * The values of a grid parameter: either an array of values, or an object giving
+         * "min", "max" and "num", which are spaced linearly (or logarithmically if "log" is
+         * true).
+         */
+        static std::vector<std::string> grid_values (const std::string& name, const nlohmann::json& p)
+        {
+            std::vector<std::string> vals;
+            if (p.is_array()) {
+                for (const auto& v : p) { vals.push_back (override_text (v)); }
+            } else if (p.is_object() && p.contains ("min") && p.contains ("max") && p.contains ("num")) {
+                const double lo = p["min"].get<double>();
+                const double hi = p["max"].get<double>();
+                const unsigned int num = p["num"].get<unsigned int>();
+                const bool logspace = p.contains ("log") && p["log"].get<bool>();
+                if (logspace && (lo <= 0.0 || hi <= 0.0)) {
+                    throw std::runtime_error ("Sweep: Parameter '" + name + "' is log spaced but its range is not positive");
+                }
+                for (unsigned int i = 0; i < num; ++i) {
+                    const double f = num > 1 ? static_cast<double>(i) / (num - 1) : 0.0;
+                    const double v = logspace ? lo * std::pow (hi / lo, f) : lo + f * (hi - lo);
+                    vals.push_back (override_text (nlohmann::json (v)));
+                }
+            } else {
+                throw std::runtime_error ("Sweep: Parameter '" + name + "' needs an array of values or min, max and num");
+            }
+            if (vals.empty()) { throw std::runtime_error ("Sweep: Parameter '" + name + "' has no values"); }
+            return vals;
+        }
+
+        /*!
+         * Every combination of the parameters' values. The parameters are taken in the
+         * (alphabetical) order of their names, and the last varies fastest.
+         */
+        void expand_grid (const nlohmann::json& params)
+        {
+            std::vector<std::string> names;
+            std::vector<std::vector<std::string>> values;
+            unsigned long long n = 1;
+            for (const auto& p : params.items()) {
+                names.push_back (p.key());
+                values.push_back (grid_values (p.key(), p.value()));
+                n *= values.back().size();
+            }
+            std::vector<std::size_t> idx (names.size(), 0);
+            for (unsigned long long i = 0; i < n; ++i) {
+                SweepRun r;
+                r.index = static_cast<unsigned int>(i);
+                for (std::size_t k = 0; k < names.size(); ++k) { r.overrides[names[k]] = values[k][idx[k]]; }
+                this->runs.push_back (r);
+                // Increment the multi-index, last parameter fastest
+                for (std::size_t k = names.size(); k-- > 0;) {
+                    if (++idx[k] < values[k].size()) { break; }
+                    idx[k] = 0;
+                }
+            }
+        }
+
+        /*!
+         * samples runs, with each parameter drawn independently. A parameter is either an
+         * array of values (one of which is chosen, uniformly) or an object giving "min" and
+         * "max", between which it is drawn uniformly (or log-uniformly if "log" is true).
+         */
+        void expand_random (const nlohmann::json& params)
+        {
+            if (this->samples == 0) { throw std::runtime_error ("Sweep: A random design needs \"samples\""); }
+            morph::RandUniform<double> rng (0.0, 1.0, this->seed != 0 ? this->seed : std::random_device{}());
+            for (unsigned int i = 0; i < this->samples; ++i) {
+                SweepRun r;
+                r.index = i;
+                for (const auto& p : params.items()) {
+                    const nlohmann::json& pv = p.value();
+                    const double u = rng.get();
+                    if (pv.is_array() && !pv.empty()) {
+                        const std::size_t k = std::min (pv.size() - 1, static_cast<std::size_t>(u * pv.size()));
+                        r.overrides[p.key()] = override_text (pv[k]);
+                    } else if (pv.is_object() && pv.contains ("min") && pv.contains ("max")) {
+                        const double lo = pv["min"].get<double>();
+                        const double hi = pv["max"].get<double>();
+                        const bool logspace = pv.contains ("log") && pv["log"].get<bool>();
+                        if (logspace && (lo <= 0.0 || hi <= 0.0)) {
+                            throw std::runtime_error ("Sweep: Parameter '" + p.key() + "' is log spaced but its range is not positive");
+                        }
+                        const double v = logspace ? lo * std::pow (hi / lo, u) : lo + u * (hi - lo);
+                        r.overrides[p.key()] = override_text (nlohmann::json (v));
+                    } else {
+                        throw std::runtime_error ("Sweep: Parameter '" + p.key() + "' needs an array of values or min and max");
+                    }
+                }
+                this->runs.push_back (r);
+            }
+        }
+
+        //! Share the available cores out between the slots
+        void setup_slots()
+        {
+            const std::vector<int> cores = available_cores();
+            const unsigned int tpr = std::max (1U, this->threads_per_run);
+            unsigned int nslots = std::max (1U, static_cast<unsigned int>(cores.size()) / tpr);
+            if (this->max_concurrent > 0) { nslots = this->max_concurrent; }
+            // When there are more slots than fit on the cores, slots share cores
+            this->slot_cores.assign (nslots, std::vector<int>());
+            for (unsigned int s = 0; s < nslots; ++s) {
+                for (unsigned int k = 0; k < tpr; ++k) { this->slot_cores[s].push_back (cores[(s * tpr + k) % cores.size()]); }
+            }
+#ifdef __linux__
+            this->pinned = this->pin;
+#else
+            this->pinned = false;
+#endif
+        }
+
+        /*!
+         * Start run ri in slot s. The child inherits the affinity and the environment of the
+         * thread that forks it, so these are set for the duration of the fork.
+         */
+        bool launch (unsigned int ri, unsigned int s, SweepChild& c, SweepProcessCallbacks& cb)
+        {
+            SweepRun& r = this->runs[ri];
+            c.run = ri;
+            c.slot = s;
+            morph::Tools::createDirIf (r.result_path);
+            const std::ios::openmode mode = std::ios::out | (r.attempts > 0 ? std::ios::app : std::ios::trunc);
+            c.out.open (r.stdout_path, mode);
+            c.err.open (r.stderr_path, mode);
+            if (r.attempts > 0) {
+                c.out << "--- attempt " << (r.attempts + 1) << " ---\n";
+                c.err << "--- attempt " << (r.attempts + 1) << " ---\n";
+            }
+            c.on_output = [this, ri](const std::string& text, bool from_stderr) { this->output (ri, text, from_stderr); };
+
+            std::list<std::string> argl = { this->program };
+            for (const auto& a : this->args) { argl.push_back (a); }
+            for (const auto& o : this->fixed) { argl.push_back ("-co:" + o.first + "=" + o.second); }
+            for (const auto& o : r.overrides) { argl.push_back ("-co:" + o.first + "=" + o.second); }
+            argl.push_back ("-co:" + this->result_key + "=" + r.result_path);
+
+            // The environment and affinity for the child
+            const char* omp_prev = std::getenv ("OMP_NUM_THREADS");
+            const std::string omp_saved = omp_prev != nullptr ? omp_prev : "";
+            if (this->set_omp_threads) { setenv ("OMP_NUM_THREADS", std::to_string (this->threads_per_run).c_str(), 1); }
+            r.cores.clear();
+#ifdef __linux__
+            cpu_set_t saved_mask;
+            const bool have_mask = this->pinned && sched_getaffinity (0, sizeof (saved_mask), &saved_mask) == 0;
+            if (have_mask) {
+                cpu_set_t mask;
+                CPU_ZERO (&mask);
+                for (int core : this->slot_cores[s]) { CPU_SET (core, &mask); }
+                if (sched_setaffinity (0, sizeof (mask), &mask) == 0) { r.cores = this->slot_cores[s]; }
+            }
+#endif
+            c.proc.setCallbacks (&cb);
+            r.status = "running";
+            r.attempts++;
+            r.start_time = this->seconds_since (this->sweep_t0);
+            c.t0 = std::chrono::steady_clock::now();
+            const int started = c.proc.start (this->program, argl);
+#ifdef __linux__
+            if (have_mask) { sched_setaffinity (0, sizeof (saved_mask), &saved_mask); }
+#endif
+            if (this->set_omp_threads) {
+                if (omp_prev != nullptr) { setenv ("OMP_NUM_THREADS", omp_saved.c_str(), 1); } else { unsetenv ("OMP_NUM_THREADS"); }
+            }
+            if (started != PROCESS_MAIN_APP) {
+                c.err << "Sweep: Failed to start the process (error " << c.proc.getError() << ")\n";
+                return false;
+            }
+            return true;
+        }
+
+        //! Record the outcome of a child's attempt at its run, and queue the run for a retry if it failed
+        void finish (SweepChild& c, int exit_code, const std::string& status, std::deque<unsigned int>& pending)
+        {
+            SweepRun& r = this->runs[c.run];
+            r.exit_code = exit_code;
+            r.end_time = this->seconds_since (this->sweep_t0);
+            r.attempt_seconds.push_back (this->seconds_since (c.t0));
+            if (status != "ok" && r.attempts <= this->retries) {
+                r.status = "pending";
+                pending.push_back (c.run);
+                if (this->echo) {
+                    std::cerr << "[run " << r.index << "] " << status << " (exit code " << exit_code << "), retrying\n";
+                }
+                return;
+            }
+            r.status = status;
+            c.out.close();
+            c.err.close();
+            if (this->echo) {
+                std::cout << "[run " << r.index << "] " << status << " after " << r.attempt_seconds.back() << " s\n";
+            }
+            if (this->on_finished) { this->on_finished (r); }
+            this->write_manifest();
+        }
+
+        //! Pass output from run ri on to on_output and, if echo is set, to stdout/stderr
+        void output (unsigned int ri, const std::string& text, bool from_stderr)
+        {
+            const SweepRun& r = this->runs[ri];
+            if (this->on_output) { this->on_output (r, text, from_stderr); }
+            if (this->echo) {
+                std::ostream& os = from_stderr ? std::cerr : std::cout;
+                std::stringstream ss (text);
+                std::string line;
+                while (std::getline (ss, line)) { os << "[run " << r.index << "] " << line << "\n"; }
+                os << std::flush;
+            }
+        }
+
+        //! The exit code of a process with status st from waitpid, or minus the signal that ended it
+        static int exit_code (int st)
+        {
+            return WIFEXITED(st) ? WEXITSTATUS(st) : (WIFSIGNALED(st) ? -WTERMSIG(st) : -1);
+        }
+
+        /*!
+         * Stop a child: ask it to terminate and, if it does not within a second, kill it.
+         * Returns its exit code.
+         */
+        static int stop (pid_t pid)
+        {
+            if (pid <= 0) { return -1; }
+            int st = 0;
+            kill (pid, SIGTERM);
+            for (int i = 0; i < 100; ++i) {
+                if (waitpid (pid, &st, WNOHANG) == pid) { return exit_code (st); }
+                usleep (10000);
+            }
+            kill (pid, SIGKILL);
+            waitpid (pid, &st, 0);
+            return exit_code (st);
+        }
+    };
+
+} // namespace morph
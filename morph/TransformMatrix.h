@@ -10,8 +10,11 @@
 
 #include <morph/Quaternion.h>
 #include <morph/vec.h>
+#include <morph/simd_transform.h>
 #include <cmath>
 #include <array>
+#include <vector>
+#include <cstddef>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -576,236 +579,20 @@ namespace morph {
         //! Right-multiply this->mat with m2.
         void operator*= (const std::array<Flt, 16>& m2)
         {
-            std::array<Flt, 16> result;
-            // Top row
-            result[0] = this->mat[0] * m2[0]
-                + this->mat[4] * m2[1]
-                + this->mat[8] * m2[2]
-                + this->mat[12] * m2[3];
-            result[4] = this->mat[0] * m2[4]
-                + this->mat[4] * m2[5]
-                + this->mat[8] * m2[6]
-                + this->mat[12] * m2[7];
-            result[8] = this->mat[0] * m2[8]
-                + this->mat[4] * m2[9]
-                + this->mat[8] * m2[10]
-                + this->mat[12] * m2[11];
-            result[12] = this->mat[0] * m2[12]
-                + this->mat[4] * m2[13]
-                + this->mat[8] * m2[14]
-                + this->mat[12] * m2[15];
-
-            // Second row
-            result[1] = this->mat[1] * m2[0]
-                + this->mat[5] * m2[1]
-                + this->mat[9] * m2[2]
-                + this->mat[13] * m2[3];
-            result[5] = this->mat[1] * m2[4]
-                + this->mat[5] * m2[5]
-                + this->mat[9] * m2[6]
-                + this->mat[13] * m2[7];
-            result[9] = this->mat[1] * m2[8]
-                + this->mat[5] * m2[9]
-                + this->mat[9] * m2[10]
-                + this->mat[13] * m2[11];
-            result[13] = this->mat[1] * m2[12]
-                + this->mat[5] * m2[13]
-                + this->mat[9] * m2[14]
-                + this->mat[13] * m2[15];
-
-            // Third row
-            result[2] = this->mat[2] * m2[0]
-                + this->mat[6] * m2[1]
-                + this->mat[10] * m2[2]
-                + this->mat[14] * m2[3];
-            result[6] = this->mat[2] * m2[4]
-                + this->mat[6] * m2[5]
-                + this->mat[10] * m2[6]
-                + this->mat[14] * m2[7];
-            result[10] = this->mat[2] * m2[8]
-                + this->mat[6] * m2[9]
-                + this->mat[10] * m2[10]
-                + this->mat[14] * m2[11];
-            result[14] = this->mat[2] * m2[12]
-                + this->mat[6] * m2[13]
-                + this->mat[10] * m2[14]
-                + this->mat[14] * m2[15];
-
-            // Bottom row
-            result[3] = this->mat[3] * m2[0]
-                + this->mat[7] * m2[1]
-                + this->mat[11] * m2[2]
-                + this->mat[15] * m2[3];
-            result[7] = this->mat[3] * m2[4]
-                + this->mat[7] * m2[5]
-                + this->mat[11] * m2[6]
-                + this->mat[15] * m2[7];
-            result[11] = this->mat[3] * m2[8]
-                + this->mat[7] * m2[9]
-                + this->mat[11] * m2[10]
-                + this->mat[15] * m2[11];
-            result[15] = this->mat[3] * m2[12]
-                + this->mat[7] * m2[13]
-                + this->mat[11] * m2[14]
-                + this->mat[15] * m2[15];
-
-            this->mat.swap (result);
+            simd_transform::mat4_mul (this->mat.data(), m2.data(), this->mat.data());
         }
 
         //! Right-multiply this->mat with m2.mat.
         void operator*= (const TransformMatrix<Flt>& m2)
         {
-            std::array<Flt, 16> result;
-            // Top row
-            result[0] = this->mat[0] * m2.mat[0]
-                + this->mat[4] * m2.mat[1]
-                + this->mat[8] * m2.mat[2]
-                + this->mat[12] * m2.mat[3];
-            result[4] = this->mat[0] * m2.mat[4]
-                + this->mat[4] * m2.mat[5]
-                + this->mat[8] * m2.mat[6]
-                + this->mat[12] * m2.mat[7];
-            result[8] = this->mat[0] * m2.mat[8]
-                + this->mat[4] * m2.mat[9]
-                + this->mat[8] * m2.mat[10]
-                + this->mat[12] * m2.mat[11];
-            result[12] = this->mat[0] * m2.mat[12]
-                + this->mat[4] * m2.mat[13]
-                + this->mat[8] * m2.mat[14]
-                + this->mat[12] * m2.mat[15];
-
-            // Second row
-            result[1] = this->mat[1] * m2.mat[0]
-                + this->mat[5] * m2.mat[1]
-                + this->mat[9] * m2.mat[2]
-                + this->mat[13] * m2.mat[3];
-            result[5] = this->mat[1] * m2.mat[4]
-                + this->mat[5] * m2.mat[5]
-                + this->mat[9] * m2.mat[6]
-                + this->mat[13] * m2.mat[7];
-            result[9] = this->mat[1] * m2.mat[8]
-                + this->mat[5] * m2.mat[9]
-                + this->mat[9] * m2.mat[10]
-                + this->mat[13] * m2.mat[11];
-            result[13] = this->mat[1] * m2.mat[12]
-                + this->mat[5] * m2.mat[13]
-                + this->mat[9] * m2.mat[14]
-                + this->mat[13] * m2.mat[15];
-
-            // Third row
-            result[2] = this->mat[2] * m2.mat[0]
-                + this->mat[6] * m2.mat[1]
-                + this->mat[10] * m2.mat[2]
-                + this->mat[14] * m2.mat[3];
-            result[6] = this->mat[2] * m2.mat[4]
-                + this->mat[6] * m2.mat[5]
-                + this->mat[10] * m2.mat[6]
-                + this->mat[14] * m2.mat[7];
-            result[10] = this->mat[2] * m2.mat[8]
-                + this->mat[6] * m2.mat[9]
-                + this->mat[10] * m2.mat[10]
-                + this->mat[14] * m2.mat[11];
-            result[14] = this->mat[2] * m2.mat[12]
-                + this->mat[6] * m2.mat[13]
-                + this->mat[10] * m2.mat[14]
-                + this->mat[14] * m2.mat[15];
-
-            // Bottom row
-            result[3] = this->mat[3] * m2.mat[0]
-                + this->mat[7] * m2.mat[1]
-                + this->mat[11] * m2.mat[2]
-                + this->mat[15] * m2.mat[3];
-            result[7] = this->mat[3] * m2.mat[4]
-                + this->mat[7] * m2.mat[5]
-                + this->mat[11] * m2.mat[6]
-                + this->mat[15] * m2.mat[7];
-            result[11] = this->mat[3] * m2.mat[8]
-                + this->mat[7] * m2.mat[9]
-                + this->mat[11] * m2.mat[10]
-                + this->mat[15] * m2.mat[11];
-            result[15] = this->mat[3] * m2.mat[12]
-                + this->mat[7] * m2.mat[13]
-                + this->mat[11] * m2.mat[14]
-                + this->mat[15] * m2.mat[15];
-
-            this->mat.swap (result);
+            simd_transform::mat4_mul (this->mat.data(), m2.mat.data(), this->mat.data());
         }
 
+        //! Right multiply this->mat with m2.
         TransformMatrix<Flt> operator* (const std::array<Flt, 16>& m2) const
         {
             TransformMatrix<Flt> result;
-            // Top row
-            result.mat[0] = this->mat[0] * m2[0]
-                + this->mat[4] * m2[1]
-                + this->mat[8] * m2[2]
-                + this->mat[12] * m2[3];
-            result.mat[4] = this->mat[0] * m2[4]
-                + this->mat[4] * m2[5]
-                + this->mat[8] * m2[6]
-                + this->mat[12] * m2[7];
-            result.mat[8] = this->mat[0] * m2[8]
-                + this->mat[4] * m2[9]
-                + this->mat[8] * m2[10]
-                + this->mat[12] * m2[11];
-            result.mat[12] = this->mat[0] * m2[12]
-                + this->mat[4] * m2[13]
-                + this->mat[8] * m2[14]
-                + this->mat[12] * m2[15];
-
-            // Second row
-            result.mat[1] = this->mat[1] * m2[0]
-                + this->mat[5] * m2[1]
-                + this->mat[9] * m2[2]
-                + this->mat[13] * m2[3];
-            result.mat[5] = this->mat[1] * m2[4]
-                + this->mat[5] * m2[5]
-                + this->mat[9] * m2[6]
-                + this->mat[13] * m2[7];
-            result.mat[9] = this->mat[1] * m2[8]
-                + this->mat[5] * m2[9]
-                + this->mat[9] * m2[10]
-                + this->mat[13] * m2[11];
-            result.mat[13] = this->mat[1] * m2[12]
-                + this->mat[5] * m2[13]
-                + this->mat[9] * m2[14]
-                + this->mat[13] * m2[15];
-
-            // Third row
-            result.mat[2] = this->mat[2] * m2[0]
-                + this->mat[6] * m2[1]
-                + this->mat[10] * m2[2]
-                + this->mat[14] * m2[3];
-            result.mat[6] = this->mat[2] * m2[4]
-                + this->mat[6] * m2[5]
-                + this->mat[10] * m2[6]
-                + this->mat[14] * m2[7];
-            result.mat[10] = this->mat[2] * m2[8]
-                + this->mat[6] * m2[9]
-                + this->mat[10] * m2[10]
-                + this->mat[14] * m2[11];
-            result.mat[14] = this->mat[2] * m2[12]
-                + this->mat[6] * m2[13]
-                + this->mat[10] * m2[14]
-                + this->mat[14] * m2[15];
-
-            // Bottom row
-            result.mat[3] = this->mat[3] * m2[0]
-                + this->mat[7] * m2[1]
-                + this->mat[11] * m2[2]
-                + this->mat[15] * m2[3];
-            result.mat[7] = this->mat[3] * m2[4]
-                + this->mat[7] * m2[5]
-                + this->mat[11] * m2[6]
-                + this->mat[15] * m2[7];
-            result.mat[11] = this->mat[3] * m2[8]
-                + this->mat[7] * m2[9]
-                + this->mat[11] * m2[10]
-                + this->mat[15] * m2[11];
-            result.mat[15] = this->mat[3] * m2[12]
-                + this->mat[7] * m2[13]
-                + this->mat[11] * m2[14]
-                + this->mat[15] * m2[15];
-
+            simd_transform::mat4_mul (this->mat.data(), m2.data(), result.mat.data());
             return result;
         }
 
@@ -813,78 +600,7 @@ namespace morph {
         TransformMatrix<Flt> operator* (const TransformMatrix<Flt>& m2) const
         {
             TransformMatrix<Flt> result;
-            // Top row
-            result.mat[0] = this->mat[0] * m2.mat[0]
-                + this->mat[4] * m2.mat[1]
-                + this->mat[8] * m2.mat[2]
-                + this->mat[12] * m2.mat[3];
-            result.mat[4] = this->mat[0] * m2.mat[4]
-                + this->mat[4] * m2.mat[5]
-                + this->mat[8] * m2.mat[6]
-                + this->mat[12] * m2.mat[7];
-            result.mat[8] = this->mat[0] * m2.mat[8]
-                + this->mat[4] * m2.mat[9]
-                + this->mat[8] * m2.mat[10]
-                + this->mat[12] * m2.mat[11];
-            result.mat[12] = this->mat[0] * m2.mat[12]
-                + this->mat[4] * m2.mat[13]
-                + this->mat[8] * m2.mat[14]
-                + this->mat[12] * m2.mat[15];
-
-            // Second row
-            result.mat[1] = this->mat[1] * m2.mat[0]
-                + this->mat[5] * m2.mat[1]
-                + this->mat[9] * m2.mat[2]
-                + this->mat[13] * m2.mat[3];
-            result.mat[5] = this->mat[1] * m2.mat[4]
-                + this->mat[5] * m2.mat[5]
-                + this->mat[9] * m2.mat[6]
-                + this->mat[13] * m2.mat[7];
-            result.mat[9] = this->mat[1] * m2.mat[8]
-                + this->mat[5] * m2.mat[9]
-                + this->mat[9] * m2.mat[10]
-                + this->mat[13] * m2.mat[11];
-            result.mat[13] = this->mat[1] * m2.mat[12]
-                + this->mat[5] * m2.mat[13]
-                + this->mat[9] * m2.mat[14]
-                + this->mat[13] * m2.mat[15];
-
-            // Third row
-            result.mat[2] = this->mat[2] * m2.mat[0]
-                + this->mat[6] * m2.mat[1]
-                + this->mat[10] * m2.mat[2]
-                + this->mat[14] * m2.mat[3];
-            result.mat[6] = this->mat[2] * m2.mat[4]
-                + this->mat[6] * m2.mat[5]
-                + this->mat[10] * m2.mat[6]
-                + this->mat[14] * m2.mat[7];
-            result.mat[10] = this->mat[2] * m2.mat[8]
-                + this->mat[6] * m2.mat[9]
-                + this->mat[10] * m2.mat[10]
-                + this->mat[14] * m2.mat[11];
-            result.mat[14] = this->mat[2] * m2.mat[12]
-                + this->mat[6] * m2.mat[13]
-                + this->mat[10] * m2.mat[14]
-                + this->mat[14] * m2.mat[15];
-
-            // Bottom row
-            result.mat[3] = this->mat[3] * m2.mat[0]
-                + this->mat[7] * m2.mat[1]
-                + this->mat[11] * m2.mat[2]
-                + this->mat[15] * m2.mat[3];
-            result.mat[7] = this->mat[3] * m2.mat[4]
-                + this->mat[7] * m2.mat[5]
-                + this->mat[11] * m2.mat[6]
-                + this->mat[15] * m2.mat[7];
-            result.mat[11] = this->mat[3] * m2.mat[8]
-                + this->mat[7] * m2.mat[9]
-                + this->mat[11] * m2.mat[10]
-                + this->mat[15] * m2.mat[11];
-            result.mat[15] = this->mat[3] * m2.mat[12]
-                + this->mat[7] * m2.mat[13]
-                + this->mat[11] * m2.mat[14]
-                + this->mat[15] * m2.mat[15];
-
+            simd_transform::mat4_mul (this->mat.data(), m2.mat.data(), result.mat.data());
             return result;
         }
 
@@ -957,6 +673,58 @@ namespace morph {
             return v;
         }
 
+        /*!
+         * Batch transforms. These apply the matrix to n points at once using the kernels in
+         * morph/simd_transform.h (SSE/AVX for float), keeping the matrix in registers for the
+         * whole loop, and share large point clouds between OpenMP threads. Use them in place of
+         * operator* in a loop over a point cloud. out may be the same array as in, except in the
+         * vec<Flt, 3> to vec<Flt, 4> overload.
+         */
+        //! out[i] = (mat * (in[i], 1)).xyz. The bottom row of mat is not used.
+        void transform_points (const vec<Flt, 3>* in, vec<Flt, 3>* out, const std::size_t n) const
+        {
+            const Flt* m = this->mat.data();
+            simd_transform::blocked (n, [m, in, out](std::size_t i0, std::size_t k) { simd_transform::points3 (m, in + i0, out + i0, k); });
+        }
+
+        //! out[i] = mat * (in[i], 1), which is the same as out[i] = *this * in[i]
+        void transform_points (const vec<Flt, 3>* in, vec<Flt, 4>* out, const std::size_t n) const
+        {
+            const Flt* m = this->mat.data();
+            simd_transform::blocked (n, [m, in, out](std::size_t i0, std::size_t k) { simd_transform::points3to4 (m, in + i0, out + i0, k); });
+        }
+
+        //! out[i] = mat * in[i]
+        void transform_points (const vec<Flt, 4>* in, vec<Flt, 4>* out, const std::size_t n) const
+        {
+            const Flt* m = this->mat.data();
+            simd_transform::blocked (n, [m, in, out](std::size_t i0, std::size_t k) { simd_transform::points4 (m, in + i0, out + i0, k); });
+        }
+
+        //! As transform_points (vec<Flt, 3>*, vec<Flt, 3>*, n) for points held as separate x, y and z arrays
+        void transform_points (const Flt* xi, const Flt* yi, const Flt* zi,
+                               Flt* xo, Flt* yo, Flt* zo, const std::size_t n) const
+        {
+            const Flt* m = this->mat.data();
+            simd_transform::blocked (n, [=](std::size_t i0, std::size_t k) {
+                simd_transform::points_soa (m, xi + i0, yi + i0, zi + i0, xo + i0, yo + i0, zo + i0, k);
+            });
+        }
+
+        //! Transform the points in pts in place
+        template <typename Al>
+        void transform_points (std::vector<vec<Flt, 3>, Al>& pts) const
+        {
+            this->transform_points (pts.data(), pts.data(), pts.size());
+        }
+
+        //! Transform the homogeneous points in pts in place
+        template <typename Al>
+        void transform_points (std::vector<vec<Flt, 4>, Al>& pts) const
+        {
+            this->transform_points (pts.data(), pts.data(), pts.size());
+        }
+
         //! *= operator for a scalar value.
         template <typename T=Flt>
         void operator*= (const T& f)
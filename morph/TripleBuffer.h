@@ -0,0 +1,100 @@
+/*!
+ * \file
+ *
+ * A lock-free triple buffer for handing the latest state of a simulation from the thread
+ * that computes it to a thread that displays it (or saves it, or analyses it).
+ *
+ * There is one writer and one reader. The writer fills the back slot and publishes it; the
+ * reader fetches the most recently published slot. Neither ever waits for the other. If
+ * the writer publishes twice before the reader fetches, the earlier frame is dropped (and
+ * counted), never queued, so a slow reader does not hold up the writer.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace morph {
+
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer() {}
+
+        //! Initialise all three slots with init. For containers, this sizes the slots up front
+        //! so that publishing a container of the same size does not allocate.
+        TripleBuffer (const T& init)
+        {
+            for (auto& s : this->slots) { s = init; }
+        }
+
+        // Writer side. Call these from one thread only.
+
+        //! The slot that the writer fills before calling publish()
+        T& back() { return this->slots[this->back_idx]; }
+
+        //! Make the back slot the latest frame and take a new back slot
+        void publish()
+        {
+            unsigned int prev = this->middle.exchange (this->back_idx | fresh, std::memory_order_acq_rel);
+            if (prev & fresh) { this->n_dropped.fetch_add (1, std::memory_order_relaxed); }
+            this->back_idx = prev & index_mask;
+            this->n_published.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        //! Copy value into the back slot and publish it
+        void publish (const T& value)
+        {
+            this->back() = value;
+            this->publish();
+        }
+
+        // Reader side. Call these from one (other) thread only.
+
+        /*!
+         * If a frame has been published since the last fetch, make it the front slot and
+         * return true. Otherwise return false and leave the front slot as it was. The front
+         * slot, and any pointer to it, remains valid and unchanged until the next call to
+         * fetch().
+         */
+        bool fetch()
+        {
+            if (!(this->middle.load (std::memory_order_relaxed) & fresh)) { return false; }
+            // Only the reader clears the fresh bit, so the exchange returns a fresh frame
+            unsigned int prev = this->middle.exchange (this->front_idx, std::memory_order_acq_rel);
+            this->front_idx = prev & index_mask;
+            return true;
+        }
+
+        //! The frame that the reader last fetched
+        const T& front() const { return this->slots[this->front_idx]; }
+        T& front() { return this->slots[this->front_idx]; }
+
+        //! True if there is a frame waiting to be fetched
+        bool has_new() const { return (this->middle.load (std::memory_order_relaxed) & fresh) != 0U; }
+
+        //! The number of frames published
+        std::uint64_t published() const { return this->n_published.load (std::memory_order_relaxed); }
+        //! The number of published frames that were overwritten before they could be fetched
+        std::uint64_t dropped() const { return this->n_dropped.load (std::memory_order_relaxed); }
+
+    private:
+        static constexpr unsigned int index_mask = 0x3;
+        static constexpr unsigned int fresh = 0x4;
+
+        std::array<T, 3> slots;
+        //! The index of the middle slot, which is exchanged with the back and front slots, and
+        //! the fresh bit, set when the middle slot holds a frame that the reader has not seen.
+        std::atomic<unsigned int> middle{1};
+        //! Owned by the writer
+        unsigned int back_idx = 0;
+        //! Owned by the reader
+        unsigned int front_idx = 2;
+
+        std::atomic<std::uint64_t> n_published{0};
+        std::atomic<std::uint64_t> n_dropped{0};
+    };
+
+} // namespace morph
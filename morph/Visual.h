@@ -46,6 +46,7 @@
 #include <morph/VisualTextModel.h> // includes VisualResources.h
 #include <morph/VisualCommon.h>
 #include <morph/gl/shaders.h> // for ShaderInfo/LoadShaders
+#include <morph/gl/uniforms.h>
 #include <morph/keys.h>
 
 #include <morph/VisualResources.h>
@@ -56,6 +57,7 @@
 #include <morph/vec.h>
 #include <morph/ColourMap.h>
 #include <morph/tools.h>
+#include <morph/RenderStats.h>
 
 #include <string>
 #include <array>
@@ -63,6 +65,8 @@
 #include <memory>
 #include <functional>
 #include <chrono>
+#include <deque>
+#include <type_traits>
 #include <cuchar>
 
 #include <morph/VisualDefaultShaders.h>
@@ -158,6 +162,11 @@ namespace morph {
         //! Deconstructor destroys GLFW/Qt window and deregisters access to VisualResources
         virtual ~Visual()
         {
+            this->delete_gpu_timers();
+            if (this->frame_ubo != 0) {
+                glDeleteBuffers (1, &this->frame_ubo);
+                this->frame_ubo = 0;
+            }
 #ifndef OWNED_MODE
             glfwDestroyWindow (this->window);
 #endif
@@ -252,6 +261,7 @@ namespace morph {
             model->get_shaderprogs = &morph::Visual<glver>::get_shaderprogs;
             model->get_gprog = &morph::Visual<glver>::get_gprog;
             model->get_tprog = &morph::Visual<glver>::get_tprog;
+            model->render_stats = &this->render_stats;
         }
 
         /*!
@@ -348,6 +358,28 @@ namespace morph {
             }
         }
 
+        /*!
+         * Render on this thread, at up to about 1/frame_interval frames per second, until
+         * the window is closed (readyToFinish) or keep_running() returns false. Before
+         * each frame, update() is called to pick up the latest data published by the
+         * simulation (see morph::TripleBuffer and VisualDataModel::updateFrom).
+         *
+         * Call this from the thread that created the Visual (GLFW requires that events are
+         * processed on the main thread) and run the simulation in another std::thread. The
+         * simulation only ever publishes snapshots, so it never waits for a frame to be
+         * rendered, and a frame that is published while another is being rendered replaces
+         * any frame still waiting.
+         */
+        template <typename U, typename K>
+        void render_loop (U update, K keep_running, const double frame_interval = 0.01667)
+        {
+            while (this->readyToFinish == false && keep_running()) {
+                update();
+                this->render();
+                glfwWaitEventsTimeout (frame_interval);
+            }
+        }
+
         //! Wrapper around the glfw polling function
         void poll() { glfwPollEvents(); }
         //! A wait-for-events with a timeout wrapper
@@ -376,6 +408,8 @@ namespace morph {
 #ifdef PROFILE_RENDER
             sc::time_point renderstart = sc::now();
 #endif
+            const bool profiling = this->render_stats.enabled;
+            if (profiling) { this->render_stats.begin_frame(); }
 
 #ifndef OWNED_MODE
             this->setContext();
@@ -412,41 +446,13 @@ namespace morph {
             // Set the background colour:
             glClearBufferfv (GL_COLOR, 0, bgcolour.data());
 
-            // Lighting shader variables
-            //
-            // Ambient light colour
-            GLint loc_lightcol = glGetUniformLocation (this->shaders.gprog, static_cast<const GLchar*>("light_colour"));
-            if (loc_lightcol != -1) {
-                glUniform3fv (loc_lightcol, 1, this->light_colour.data());
-            }
-            // Ambient light intensity
-            GLint loc_ai = glGetUniformLocation (this->shaders.gprog, static_cast<const GLchar*>("ambient_intensity"));
-            if (loc_ai != -1) {
-                glUniform1f (loc_ai, this->ambient_intensity);
-            }
-            // Diffuse light position
-            GLint loc_dp = glGetUniformLocation (this->shaders.gprog, static_cast<const GLchar*>("diffuse_position"));
-            if (loc_dp != -1) {
-                glUniform3fv (loc_dp, 1, this->diffuse_position.data());
-            }
-            // Diffuse light intensity
-            GLint loc_di = glGetUniformLocation (this->shaders.gprog, static_cast<const GLchar*>("diffuse_intensity"));
-            if (loc_di != -1) {
-                glUniform1f (loc_di, this->diffuse_intensity);
-            }
-
-            // Switch to text shader program and set the projection matrix
-            glUseProgram (this->shaders.tprog);
-            GLint loc_p = glGetUniformLocation (this->shaders.tprog, static_cast<const GLchar*>("p_matrix"));
-            if (loc_p != -1) { glUniformMatrix4fv (loc_p, 1, GL_FALSE, this->projection.mat.data()); }
+            // The projection and the lighting shader variables are the same for every model,
+            // so set them once for the frame
+            this->set_frame_uniforms();
 
             // Switch back to the regular shader prog and render the VisualModels.
             glUseProgram (this->shaders.gprog);
 
-            // Set the projection matrix just once
-            loc_p = glGetUniformLocation (this->shaders.gprog, static_cast<const GLchar*>("p_matrix"));
-            if (loc_p != -1) { glUniformMatrix4fv (loc_p, 1, GL_FALSE, this->projection.mat.data()); }
-
             if (this->showCoordArrows == true) {
                 // Ensure coordarrows centre sphere will be visible on BG:
                 this->coordArrows->setColourForBackground (this->bgcolour);
@@ -456,7 +462,7 @@ namespace morph {
                 } else {
                     this->positionCoordArrows();
                 }
-                this->coordArrows->render();
+                this->render_model (this->coordArrows.get(), profiling, "coordarrows");
             }
 
             TransformMatrix<float> scenetransonly;
@@ -470,7 +476,7 @@ namespace morph {
                 } else {
                     (*vmi)->setSceneMatrix (sceneview);
                 }
-                (*vmi)->render();
+                this->render_model (vmi->get(), profiling);
                 ++vmi;
             }
 
@@ -481,20 +487,24 @@ namespace morph {
                 // Render the title text
                 this->textModel->setSceneTranslation (v0);
                 this->textModel->setVisibleOn (this->bgcolour);
-                this->textModel->render();
+                this->render_model (this->textModel.get(), profiling, "title");
             }
 
             auto ti = this->texts.begin();
             while (ti != this->texts.end()) {
                 (*ti)->setSceneTranslation (v0);
                 (*ti)->setVisibleOn (this->bgcolour);
-                (*ti)->render();
+                this->render_model (ti->get(), profiling, "text");
                 ++ti;
             }
 
 #ifndef OWNED_MODE
             glfwSwapBuffers (this->window);
 #endif
+            if (profiling) {
+                this->render_stats.end_frame();
+                this->collect_gpu_timers();
+            }
 
 #ifdef PROFILE_RENDER
             sc::time_point renderend = sc::now();
@@ -835,6 +845,15 @@ namespace morph {
 
         void set_winsize (int _w, int _h) { this->window_w = _w; this->window_h = _h; }
 
+        /*!
+         * Render loop instrumentation. Set render_stats.enabled to true to record, for each
+         * frame, the CPU (and, where GL_TIME_ELAPSED queries are available, GPU) time spent
+         * rendering each model, with vertex and draw call counts, and the time spent in each
+         * model's reinit(). Give models a VisualModel::name to label them. See
+         * morph/RenderStats.h for queries and JSON/Chrome trace export.
+         */
+        morph::RenderStats render_stats;
+
     protected:
         //! A vector of pointers to all the morph::VisualModels (HexGridVisual,
         //! ScatterVisual, etc) which are going to be rendered in the scene.
@@ -842,6 +861,168 @@ namespace morph {
 
     private:
 
+        //! Render a VisualModel or VisualTextModel, recording its timings if profiling
+        template <typename M>
+        void render_model (M* model, const bool profiling, const std::string& name = "")
+        {
+            if (!profiling) { model->render(); return; }
+
+            std::string label = name;
+            std::size_t n_idx = 0U;
+            if constexpr (std::is_base_of_v<VisualModel<glver>, M>) {
+                if (model->name.empty() == false) { label = model->name; }
+                n_idx = model->indices_size();
+            }
+            const std::size_t mi = this->render_stats.model (model, label);
+            const bool gpu_timed = this->begin_gpu_timer();
+            sc::time_point t0 = sc::now();
+            model->render();
+            sc::time_point t1 = sc::now();
+            if (gpu_timed) { this->end_gpu_timer (mi); }
+            this->render_stats.record_render (mi, t0, t1, model->vertex_count(), n_idx, model->draw_count());
+        }
+
+        //! The uniform buffer object for the per-frame uniforms
+        GLuint frame_ubo = 0;
+        //! Whether the programs have the morph_frame uniform block (the default shaders
+        //! do; shaders loaded from files might not)
+        bool gprog_frame_block = false;
+        bool tprog_frame_block = false;
+        //! Locations of the per-frame uniforms for programs without the morph_frame block
+        morph::gl::uniform_locations<5> gprog_frame_locs = std::array<const char*, 5>{
+            "p_matrix", "light_colour", "ambient_intensity", "diffuse_position", "diffuse_intensity"
+        };
+        morph::gl::uniform_locations<1> tprog_frame_locs = std::array<const char*, 1>{ "p_matrix" };
+
+        //! Bind the programs' morph_frame blocks (where they have them) and create the buffer
+        void init_frame_uniforms()
+        {
+            this->gprog_frame_block = morph::gl::bind_frame_block (this->shaders.gprog);
+            this->tprog_frame_block = morph::gl::bind_frame_block (this->shaders.tprog);
+            if (this->frame_ubo == 0) { glGenBuffers (1, &this->frame_ubo); }
+            glBindBuffer (GL_UNIFORM_BUFFER, this->frame_ubo);
+            glBufferData (GL_UNIFORM_BUFFER, sizeof (morph::gl::frame_uniforms), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer (GL_UNIFORM_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! Upload the projection and lighting for this frame
+        void set_frame_uniforms()
+        {
+            morph::gl::frame_uniforms fu;
+            fu.p_matrix = this->projection.mat;
+            fu.light_colour = this->light_colour;
+            fu.ambient_intensity = this->ambient_intensity;
+            fu.diffuse_position = this->diffuse_position;
+            fu.diffuse_intensity = this->diffuse_intensity;
+
+            glBindBuffer (GL_UNIFORM_BUFFER, this->frame_ubo);
+            glBufferSubData (GL_UNIFORM_BUFFER, 0, sizeof (fu), &fu);
+            glBindBuffer (GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase (GL_UNIFORM_BUFFER, morph::gl::frame_block_binding, this->frame_ubo);
+
+            // Programs without the morph_frame block have ordinary uniforms
+            if (!this->gprog_frame_block) {
+                glUseProgram (this->shaders.gprog);
+                auto& loc = this->gprog_frame_locs;
+                loc.use (this->shaders.gprog);
+                if (loc[0] != -1) { glUniformMatrix4fv (loc[0], 1, GL_FALSE, fu.p_matrix.data()); }
+                if (loc[1] != -1) { glUniform3fv (loc[1], 1, fu.light_colour.data()); }
+                if (loc[2] != -1) { glUniform1f (loc[2], fu.ambient_intensity); }
+                if (loc[3] != -1) { glUniform3fv (loc[3], 1, fu.diffuse_position.data()); }
+                if (loc[4] != -1) { glUniform1f (loc[4], fu.diffuse_intensity); }
+            }
+            if (!this->tprog_frame_block) {
+                glUseProgram (this->shaders.tprog);
+                this->tprog_frame_locs.use (this->shaders.tprog);
+                if (this->tprog_frame_locs[0] != -1) {
+                    glUniformMatrix4fv (this->tprog_frame_locs[0], 1, GL_FALSE, fu.p_matrix.data());
+                }
+            }
+        }
+
+        //! Whether the GL version has GL_TIME_ELAPSED queries (desktop GL 3.3+; not GLES)
+        static constexpr bool have_gpu_timers = !morph::gl::version::gles (glver);
+
+        //! A GL_TIME_ELAPSED query awaiting its result
+        struct gpu_timer
+        {
+            GLuint query = 0;
+            unsigned long long int frame = 0U;
+            std::size_t model = 0U;
+        };
+        //! Issued queries, oldest first. They complete in order.
+        std::deque<gpu_timer> gpu_timers_pending;
+        //! Query objects available for re-use
+        std::vector<GLuint> gpu_timers_free;
+        //! The query in progress
+        GLuint gpu_timer_current = 0;
+
+        //! Start timing GPU work. Returns false if GPU timing is not available.
+        bool begin_gpu_timer()
+        {
+#ifdef GL_TIME_ELAPSED
+            if constexpr (have_gpu_timers) {
+                if (this->gpu_timers_free.empty()) {
+                    GLuint q = 0;
+                    glGenQueries (1, &q);
+                    this->gpu_timers_free.push_back (q);
+                }
+                this->gpu_timer_current = this->gpu_timers_free.back();
+                this->gpu_timers_free.pop_back();
+                glBeginQuery (GL_TIME_ELAPSED, this->gpu_timer_current);
+                return true;
+            }
+#endif
+            return false;
+        }
+
+        //! Stop timing GPU work for model mi of the current frame
+        void end_gpu_timer ([[maybe_unused]] const std::size_t mi)
+        {
+#ifdef GL_TIME_ELAPSED
+            if constexpr (have_gpu_timers) {
+                glEndQuery (GL_TIME_ELAPSED);
+                this->gpu_timers_pending.push_back ({ this->gpu_timer_current, this->render_stats.frame_number(), mi });
+                this->gpu_timer_current = 0;
+            }
+#endif
+        }
+
+        //! Pass any GPU timer results that have arrived (without waiting) to render_stats
+        void collect_gpu_timers()
+        {
+#ifdef GL_TIME_ELAPSED
+            if constexpr (have_gpu_timers) {
+                while (!this->gpu_timers_pending.empty()) {
+                    const gpu_timer& t = this->gpu_timers_pending.front();
+                    GLint available = 0;
+                    glGetQueryObjectiv (t.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (!available) { break; }
+                    GLuint64 ns = 0;
+                    glGetQueryObjectui64v (t.query, GL_QUERY_RESULT, &ns);
+                    this->render_stats.set_gpu_time (t.frame, t.model, static_cast<double>(ns) * 1e-3);
+                    this->gpu_timers_free.push_back (t.query);
+                    this->gpu_timers_pending.pop_front();
+                }
+            }
+#endif
+        }
+
+        void delete_gpu_timers()
+        {
+#ifdef GL_TIME_ELAPSED
+            if constexpr (have_gpu_timers) {
+                for (auto& t : this->gpu_timers_pending) { this->gpu_timers_free.push_back (t.query); }
+                this->gpu_timers_pending.clear();
+                if (!this->gpu_timers_free.empty()) {
+                    glDeleteQueries (static_cast<GLsizei>(this->gpu_timers_free.size()), this->gpu_timers_free.data());
+                    this->gpu_timers_free.clear();
+                }
+            }
+#endif
+        }
+
         void init_window()
         {
 #ifndef OWNED_MODE
@@ -909,6 +1090,9 @@ namespace morph {
             };
             this->shaders.tprog = morph::gl::LoadShaders (tshaders);
 
+            // The projection and lighting are passed to the shaders in a uniform buffer
+            this->init_frame_uniforms();
+
             // Now client code can set up HexGridVisuals.
             glEnable (GL_DEPTH_TEST);
 
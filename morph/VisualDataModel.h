@@ -8,6 +8,7 @@
 #include <morph/VisualModel.h>
 #include <morph/ColourMap.h>
 #include <morph/Scale.h>
+#include <morph/TripleBuffer.h>
 
 namespace morph {
 
@@ -144,6 +145,30 @@ namespace morph {
             this->reinit();
         }
 
+        /*!
+         * Show the latest scalar data that a simulation thread has published into
+         * snapshots. If there is a new frame, point scalarData at it, reinit() and return
+         * true; otherwise leave the model as it is and return false. Call this on the thread
+         * that renders. The simulation never shares its working arrays with the model, so it
+         * can carry on computing while the vertices are rebuilt.
+         */
+        bool updateFrom (TripleBuffer<std::vector<T>>& snapshots)
+        {
+            if (!snapshots.fetch()) { return false; }
+            this->scalarData = &snapshots.front();
+            this->reinit();
+            return true;
+        }
+
+        //! Show the latest vector data published into snapshots (see above)
+        bool updateFrom (TripleBuffer<std::vector<vec<T>>>& snapshots)
+        {
+            if (!snapshots.fetch()) { return false; }
+            this->vectorData = &snapshots.front();
+            this->reinit();
+            return true;
+        }
+
         void setZeroGrid (const bool _zerogrid) { this->zerogrid = _zerogrid; }
 
         //! All data models use a a colour map. Change the type/hue of this colour map
@@ -98,13 +98,19 @@ OpenGL 4.5
 namespace morph {
 
     // The default vertex shader. To study this GLSL, see Visual.vert.glsl, which has
-    // some code comments.
-    const char* defaultVtxShader = "uniform mat4 mvp_matrix;\n"
-    "uniform mat4 vp_matrix;\n"
-    "uniform mat4 m_matrix;\n"
+    // some code comments. The projection and lighting, which are the same for every model
+    // in a frame, are in the uniform block morph_frame (see morph/gl/uniforms.h).
+    const char* defaultVtxShader = "uniform mat4 m_matrix;\n"
     "uniform mat4 v_matrix;\n"
-    "uniform mat4 p_matrix;\n"
     "uniform float alpha;\n"
+    "layout(std140) uniform morph_frame\n"
+    "{\n"
+    "    highp mat4 p_matrix;\n"
+    "    highp vec3 light_colour;\n"
+    "    highp float ambient_intensity;\n"
+    "    highp vec3 diffuse_position;\n"
+    "    highp float diffuse_intensity;\n"
+    "};\n"
     "layout(location = 0) in vec4 position;\n"
     "layout(location = 1) in vec4 normalin;\n"
     "layout(location = 2) in vec3 color;\n"
@@ -137,10 +143,14 @@ namespace morph {
     "    vec4 color;\n"
     "    vec3 fragpos;\n"
     "} vertex;\n"
-    "uniform vec3 light_colour;\n"
-    "uniform float ambient_intensity;\n"
-    "uniform vec3 diffuse_position;\n"
-    "uniform float diffuse_intensity;\n"
+    "layout(std140) uniform morph_frame\n"
+    "{\n"
+    "    highp mat4 p_matrix;\n"
+    "    highp vec3 light_colour;\n"
+    "    highp float ambient_intensity;\n"
+    "    highp vec3 diffuse_position;\n"
+    "    highp float diffuse_intensity;\n"
+    "};\n"
     "out vec4 finalcolor;\n"
     "void main()\n"
     "{\n"
@@ -164,7 +174,14 @@ namespace morph {
     // Default text vertex shader. See VisText.vert.glsl
     const char* defaultTextVtxShader = "uniform mat4 m_matrix;\n"
     "uniform mat4 v_matrix;\n"
-    "uniform mat4 p_matrix;\n"
+    "layout(std140) uniform morph_frame\n"
+    "{\n"
+    "    highp mat4 p_matrix;\n"
+    "    highp vec3 light_colour;\n"
+    "    highp float ambient_intensity;\n"
+    "    highp vec3 diffuse_position;\n"
+    "    highp float diffuse_intensity;\n"
+    "};\n"
     "layout(location = 0) in vec4 position;\n"
     "layout(location = 1) in vec4 vnormal;\n"
     "layout(location = 2) in vec4 vcolor;\n"
@@ -24,11 +24,13 @@
 #include <morph/vec.h>
 #include <morph/mathconst.h>
 #include <morph/gl/util.h>
+#include <morph/gl/uniforms.h>
 #include <morph/VisualCommon.h>
 #include <morph/VisualTextModel.h>
 #include <morph/VisualFace.h>
 #include <morph/colour.h>
 #include <morph/base64.h>
+#include <morph/RenderStats.h>
 #include <iostream>
 #include <vector>
 #include <array>
@@ -38,6 +40,12 @@
 #include <memory>
 #include <functional>
 #include <cuchar>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <limits>
 
 // Switches on some changes where I carefully unbind gl buffers after calling
 // glBufferData() and rebind when changing the vertex model. Makes no difference on my
@@ -56,6 +64,10 @@ namespace morph {
     template <int>
     class Visual;
 
+    //! Forward declaration of the scratch model used by VisualModel::compute_parallel
+    template <int>
+    class VisualModelChunk;
+
     /*!
      * OpenGL model base class
      *
@@ -130,17 +142,12 @@ namespace morph {
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
             morph::gl::Util::checkError (__FILE__, __LINE__);
 
-            //std::cout << "indices.size(): " << this->indices.size() << std::endl;
-            int sz = this->indices.size() * sizeof(GLuint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-            morph::gl::Util::checkError (__FILE__, __LINE__);
+            // A new set of buffers has no storage yet
+            this->vbo_bytes.fill (0U);
 
-            // Binds data from the "C++ world" to the OpenGL shader world for
-            // "position", "normalin" and "color"
-            // (bind, buffer and set vertex array object attribute)
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            // Buffer the indices, then bind data from the "C++ world" to the OpenGL shader
+            // world for "position", "normalin" and "color"
+            this->setupBuffers();
 
 #ifdef CAREFULLY_UNBIND_AND_REBIND
             // Unbind only the vertex array (not the buffers, that causes GL_INVALID_ENUM errors)
@@ -164,11 +171,7 @@ namespace morph {
             glBindVertexArray (this->vao);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
 #endif
-            int sz = this->indices.size() * sizeof(GLuint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupBuffers();
 
 #ifdef CAREFULLY_UNBIND_AND_REBIND
             glBindVertexArray(0);
@@ -200,8 +203,7 @@ namespace morph {
             this->indices.clear();
             // NB: Do NOT call clearTexts() here! We're only updating the model itself.
             this->idx = 0U;
-            this->initializeVertices();
-            this->reinit_buffers();
+            this->initialize_and_upload();
         }
 
         //! For some models it's important to clear the texts when reinitialising. This
@@ -216,8 +218,26 @@ namespace morph {
             this->indices.clear();
             this->clearTexts();
             this->idx = 0U;
+            this->initialize_and_upload();
+        }
+
+        //! Call initializeVertices and reinit_buffers, timing them if render_stats is enabled
+        void initialize_and_upload()
+        {
+            if (this->render_stats == nullptr || !this->render_stats->enabled) {
+                this->initializeVertices();
+                this->reinit_buffers();
+                return;
+            }
+            using sc = std::chrono::steady_clock;
+            sc::time_point t0 = sc::now();
             this->initializeVertices();
+            sc::time_point t1 = sc::now();
             this->reinit_buffers();
+            sc::time_point t2 = sc::now();
+            this->render_stats->record_reinit (this, this->name,
+                                               std::chrono::duration<double, std::micro>(t1 - t0).count(),
+                                               std::chrono::duration<double, std::micro>(t2 - t1).count());
         }
 
         void reserve_vertices (std::size_t n_vertices)
@@ -228,12 +248,167 @@ namespace morph {
             this->indices.reserve (6U * n_vertices);
         }
 
+        //! Reserve memory for exactly n_vertices and n_indices. Use with the *_num_vertices()
+        //! and *_num_indices() functions to pre-size the model from its primitive counts.
+        void reserve_vertices (std::size_t n_vertices, std::size_t n_indices)
+        {
+            this->vertexPositions.reserve (3U * n_vertices);
+            this->vertexNormals.reserve (3U * n_vertices);
+            this->vertexColors.reserve (3U * n_vertices);
+            this->indices.reserve (n_indices);
+        }
+
+        /*
+         * The number of vertices and indices that each of the compute* primitive functions adds
+         * to the model. Useful for reserve_vertices().
+         */
+
+        //! Vertices added by computeSphere
+        static constexpr std::size_t sphere_num_vertices (int rings = 10, int segments = 12) { return 2 + (rings - 1) * segments; }
+        //! Indices added by computeSphere
+        static constexpr std::size_t sphere_num_indices (int rings = 10, int segments = 12) { return 6 * (rings - 1) * segments; }
+        //! Vertices added by computeTube
+        static constexpr std::size_t tube_num_vertices (int segments = 12) { return 4 * segments + 2; }
+        //! Indices added by computeTube
+        static constexpr std::size_t tube_num_indices (int segments = 12) { return 24 * segments; }
+        //! Vertices added by computeCone
+        static constexpr std::size_t cone_num_vertices (int segments = 12) { return 3 * segments + 2; }
+        //! Indices added by computeCone
+        static constexpr std::size_t cone_num_indices (int segments = 12) { return 18 * segments; }
+        //! Vertices added by computeFlatPoly
+        static constexpr std::size_t flatpoly_num_vertices (int segments = 12) { return segments + 1; }
+        //! Indices added by computeFlatPoly
+        static constexpr std::size_t flatpoly_num_indices (int segments = 12) { return 3 * segments; }
+        //! Vertices added by computeFlatQuad and by computeFlatLine (without rounded ends)
+        static constexpr std::size_t flatquad_num_vertices() { return 4; }
+        //! Indices added by computeFlatQuad and by computeFlatLine (without rounded ends)
+        static constexpr std::size_t flatquad_num_indices() { return 6; }
+        //! Vertices added by computeFlatLineRnd
+        static constexpr std::size_t flatlinernd_num_vertices (bool startcaps = true, bool endcaps = true)
+        {
+            return 4 + (startcaps ? 13 : 0) + (endcaps ? 13 : 0);
+        }
+        //! Indices added by computeFlatLineRnd
+        static constexpr std::size_t flatlinernd_num_indices (bool startcaps = true, bool endcaps = true)
+        {
+            return 6 + (startcaps ? 36 : 0) + (endcaps ? 36 : 0);
+        }
+
+        /*!
+         * Generate the geometry for \a n primitives (or groups of primitives) in parallel.
+         *
+         * \a gen is called as gen (chunk, i) for each i in [0, n). It should create item i in
+         * chunk (a morph::VisualModelChunk) by calling the chunk's compute* functions with
+         * chunk.idx as the index argument, exactly as it would create it in this model with
+         * this->idx. Each thread generates a contiguous range of items into its own chunk
+         * and the chunks are then stitched onto the end of this model's vertices and indices
+         * (with the indices offset). this->idx is advanced.
+         *
+         * The result is the same as calling gen (*this, i) for i = 0, 1, ..., n-1 in order, so
+         * gen must not depend on the order in which it is called. It must only write to the
+         * chunk that it is given.
+         */
+        template <typename G>
+        void compute_parallel (std::size_t n, G gen)
+        {
+            auto no_counts = [](std::size_t) { return std::array<std::size_t, 2>{0U, 0U}; };
+            this->compute_parallel (n, gen, no_counts);
+        }
+
+        /*!
+         * As compute_parallel (n, gen), but \a counts (i) returns the number of vertices and
+         * indices, {n_vertices, n_indices}, that gen (chunk, i) will create (see
+         * sphere_num_vertices(), etc). The counts are used to share the work evenly between
+         * threads and to allocate all the memory once, up front.
+         */
+        template <typename G, typename C>
+        void compute_parallel (std::size_t n, G gen, C counts)
+        {
+            if (n == 0U) { return; }
+
+            // Prefix sums of the per-item vertex and index counts
+            std::vector<std::size_t> vert_prefix (n + 1, 0U);
+            std::vector<std::size_t> ind_prefix (n + 1, 0U);
+            for (std::size_t i = 0; i < n; ++i) {
+                std::array<std::size_t, 2> c = counts (i);
+                vert_prefix[i + 1] = vert_prefix[i] + c[0];
+                ind_prefix[i + 1] = ind_prefix[i] + c[1];
+            }
+            const bool have_counts = vert_prefix[n] > 0U;
+
+            // Divide [0, n) into contiguous ranges, a few per thread, of similar vertex counts
+            std::size_t nthreads = std::max (1U, std::thread::hardware_concurrency());
+            std::size_t nchunks = std::min (n, 4U * nthreads);
+            std::vector<std::size_t> chunk_start (nchunks + 1, n);
+            for (std::size_t c = 0; c < nchunks; ++c) {
+                if (have_counts) {
+                    std::size_t target = (vert_prefix[n] * c) / nchunks;
+                    chunk_start[c] = std::lower_bound (vert_prefix.begin(), vert_prefix.end() - 1, target) - vert_prefix.begin();
+                } else {
+                    chunk_start[c] = (n * c) / nchunks;
+                }
+            }
+
+            // Generate each range of items into its own chunk
+            std::vector<morph::VisualModelChunk<glver>> chunks (nchunks);
+            const int nc = static_cast<int>(nchunks);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for (int c = 0; c < nc; ++c) {
+                morph::VisualModelChunk<glver>& chunk = chunks[c];
+                const std::size_t i0 = chunk_start[c];
+                const std::size_t i1 = chunk_start[c + 1];
+                if (have_counts) {
+                    chunk.reserve_vertices (vert_prefix[i1] - vert_prefix[i0], ind_prefix[i1] - ind_prefix[i0]);
+                }
+                for (std::size_t i = i0; i < i1; ++i) { gen (chunk, i); }
+            }
+
+            // Where does each chunk go in the final vectors?
+            std::vector<std::size_t> vbase (nchunks + 1, this->vertexPositions.size());
+            std::vector<std::size_t> ibase (nchunks + 1, this->indices.size());
+            std::vector<GLuint> idxbase (nchunks + 1, this->idx);
+            for (std::size_t c = 0; c < nchunks; ++c) {
+                vbase[c + 1] = vbase[c] + chunks[c].vertexPositions.size();
+                ibase[c + 1] = ibase[c] + chunks[c].indices.size();
+                idxbase[c + 1] = idxbase[c] + chunks[c].idx;
+            }
+            this->vertexPositions.resize (vbase[nchunks]);
+            this->vertexNormals.resize (vbase[nchunks]);
+            this->vertexColors.resize (vbase[nchunks]);
+            this->indices.resize (ibase[nchunks]);
+
+            // Stitch the chunks in, offsetting their indices
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for (int c = 0; c < nc; ++c) {
+                const morph::VisualModelChunk<glver>& chunk = chunks[c];
+                std::copy (chunk.vertexPositions.begin(), chunk.vertexPositions.end(), this->vertexPositions.begin() + vbase[c]);
+                std::copy (chunk.vertexNormals.begin(), chunk.vertexNormals.end(), this->vertexNormals.begin() + vbase[c]);
+                std::copy (chunk.vertexColors.begin(), chunk.vertexColors.end(), this->vertexColors.begin() + vbase[c]);
+                const GLuint offset = idxbase[c];
+                std::transform (chunk.indices.begin(), chunk.indices.end(), this->indices.begin() + ibase[c],
+                                [offset](GLuint i) { return i + offset; });
+            }
+            this->idx = idxbase[nchunks];
+        }
+
         //! A function to call initialiseVertices and postVertexInit after any necessary
         //! attributes have been set (see, for example, setting the colour maps up in
         //! VisualDataModel).
         void finalize()
         {
-            this->initializeVertices();
+            if (this->render_stats != nullptr && this->render_stats->enabled) {
+                using sc = std::chrono::steady_clock;
+                sc::time_point t0 = sc::now();
+                this->initializeVertices();
+                this->render_stats->record_reinit (this, this->name,
+                                                   std::chrono::duration<double, std::micro>(sc::now() - t0).count(), 0.0);
+            } else {
+                this->initializeVertices();
+            }
             this->postVertexInitRequired = true;
         }
 
@@ -245,27 +420,29 @@ namespace morph {
             // Execute post-vertex init at render, as GL should be available.
             if (this->postVertexInitRequired == true) { this->postVertexInit(); }
 
-            GLint prev_shader;
-            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-
             // Ensure the correct program is in play for this VisualModel
-            glUseProgram (this->get_gprog(this->parentVis));
+            const GLuint gprog = this->get_gprog(this->parentVis);
+            glUseProgram (gprog);
 
             if (!this->indices.empty()) {
                 // It is only necessary to bind the vertex array object before rendering
                 // (not the vertex buffer objects)
                 glBindVertexArray (this->vao);
 
+                // The uniform locations are looked up once for the program
+                this->uniforms.use (gprog);
+
                 // Pass this->float to GLSL so the model can have an alpha value.
-                GLint loc_a = glGetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("alpha"));
-                if (loc_a != -1) { glUniform1f (loc_a, this->alpha); }
+                if (this->uniforms[u_alpha] != -1) { glUniform1f (this->uniforms[u_alpha], this->alpha); }
 
-                GLint loc_v = glGetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("v_matrix"));
-                if (loc_v != -1) { glUniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
+                if (this->uniforms[u_v_matrix] != -1) {
+                    glUniformMatrix4fv (this->uniforms[u_v_matrix], 1, GL_FALSE, this->scenematrix.mat.data());
+                }
 
                 // Should be able to apply scaling to the model matrix
-                GLint loc_m = glGetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("m_matrix"));
-                if (loc_m != -1) { glUniformMatrix4fv (loc_m, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data()); }
+                if (this->uniforms[u_m_matrix] != -1) {
+                    glUniformMatrix4fv (this->uniforms[u_m_matrix], 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+                }
 
                 if constexpr (debug_render) {
                     std::cout << "VisualModel::render: scenematrix:\n" << scenematrix << std::endl;
@@ -273,18 +450,23 @@ namespace morph {
                 }
 
                 // Draw the triangles
-                glDrawElements (GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+                glDrawElements (GL_TRIANGLES, this->indices.size(), this->index_type, 0);
 
                 // Unbind the VAO
                 glBindVertexArray(0);
             }
             morph::gl::Util::checkError (__FILE__, __LINE__);
 
-            // Now render any VisualTextModels
-            auto ti = this->texts.begin();
-            while (ti != this->texts.end()) { (*ti)->render(); ti++; }
+            this->render_texts();
+        }
 
-            glUseProgram (prev_shader);
+        //! Render any VisualTextModels. Called at the end of render(). The text shader
+        //! program is put in use once, not once per text model.
+        void render_texts()
+        {
+            GLuint prog = 0;
+            auto ti = this->texts.begin();
+            while (ti != this->texts.end()) { (*ti)->render (prog); ti++; }
 
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
@@ -491,6 +673,24 @@ namespace morph {
         void toggleHide() { this->hide = this->hide ? false : true; }
         float hidden() const { return this->hide; }
 
+        //! The number of vertices drawn by render(), including those of the text models
+        std::size_t vertex_count() const
+        {
+            if (this->hide == true) { return 0U; }
+            std::size_t n = this->vertexPositions.size() / 3U;
+            for (const auto& t : this->texts) { n += t->vertex_count(); }
+            return n;
+        }
+
+        //! The number of draw calls made by render(), including those of the text models
+        std::size_t draw_count() const
+        {
+            if (this->hide == true) { return 0U; }
+            std::size_t n = this->indices.empty() ? 0U : 1U;
+            for (const auto& t : this->texts) { n += t->draw_count(); }
+            return n;
+        }
+
         /*
          * Methods used by Visual::savegltf()
          */
@@ -614,6 +814,31 @@ namespace morph {
         //! If true, then this VisualModel should always be viewed in a plane - it's a 2D model
         bool twodimensional = false;
 
+        //! How the vertex attributes are laid out in the GPU-side vertex buffer(s)
+        enum class vertex_layout
+        {
+            //! One buffer each for positions, normals and colours (all floats)
+            separate,
+            //! A single buffer with position, normal and colour interleaved (all floats)
+            interleaved,
+            //! Interleaved, with colours stored as normalised uint8s (28 bytes per vertex)
+            interleaved_ubyte_colour
+        };
+
+        //! The layout used when uploading vertices to the GPU. Set before finalize().
+        vertex_layout layout = vertex_layout::separate;
+
+        //! If true, upload indices as 16 bit GLushorts if the model has few enough vertices.
+        bool compact_indices = true;
+
+        //! The usage hint for the vertex buffers. Set GL_DYNAMIC_DRAW for models that are
+        //! reinit()ed frequently.
+        GLenum buffer_usage = GL_STATIC_DRAW;
+
+        //! The number of bytes of vertex and index data most recently uploaded to the GPU
+        std::size_t uploaded_bytes() const { return this->vbo_bytes[posnVBO] + this->vbo_bytes[normVBO]
+                                                    + this->vbo_bytes[colVBO] + this->vbo_bytes[idxVBO]; }
+
         //! The current indices index
         GLuint idx = 0U;
 
@@ -643,6 +868,12 @@ namespace morph {
         // Get the text shader prog id
         std::function<GLuint(morph::Visual<glver>*)> get_tprog;
 
+        //! An optional name for this model, used to label it in render statistics
+        std::string name;
+
+        //! Where to record render statistics. Set by Visual::bindmodel.
+        morph::RenderStats* render_stats = nullptr;
+
         // Setter for the parent pointer, parentVis
         void set_parent (morph::Visual<glver>* _vis)
         {
@@ -708,6 +939,15 @@ namespace morph {
         //! CPU-side data for vertex colours
         std::vector<float> vertexColors;
 
+        //! The data type of the indices in the GPU-side index buffer
+        GLenum index_type = GL_UNSIGNED_INT;
+        //! Storage for 16 bit indices, if compact_indices is true
+        std::vector<GLushort> indices16;
+        //! Storage for interleaved vertex data, if layout is not vertex_layout::separate
+        std::vector<std::uint8_t> interleaved_data;
+        //! The number of bytes allocated in the GPU-side storage for each of the vbos
+        std::array<std::size_t, numVBO> vbo_bytes = {0U, 0U, 0U, 0U};
+
         // The max and min values in the next 8 attriubutes are only computed if gltf files are going to be output by Visual::safegltf()
 
         //! Max values of 0th, 1st and 2nd coordinates in vertexPositions
@@ -728,24 +968,43 @@ namespace morph {
         //! If true, then calls to VisualModel::render should return
         bool hide = false;
 
+        //! The locations of the uniforms set in render()
+        enum uniform_idx { u_alpha, u_v_matrix, u_m_matrix };
+        morph::gl::uniform_locations<3> uniforms = std::array<const char*, 3>{ "alpha", "v_matrix", "m_matrix" };
+
         // The morph::Visual in which this model exists.
         morph::Visual<glver>* parentVis = nullptr;
 
         //! Push three floats onto the vector of floats \a vp
         void vertex_push (const float& x, const float& y, const float& z, std::vector<float>& vp)
         {
-            vec<float> vec = {x, y, z};
-            std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
+            vp.insert (vp.end(), {x, y, z});
         }
         //! Push array of 3 floats onto the vector of floats \a vp
         void vertex_push (const std::array<float, 3>& arr, std::vector<float>& vp)
         {
-            std::copy (arr.begin(), arr.end(), std::back_inserter (vp));
+            vp.insert (vp.end(), arr.begin(), arr.end());
         }
         //! Push morph::vec of 3 floats onto the vector of floats \a vp
         void vertex_push (const vec<float>& vec, std::vector<float>& vp)
         {
-            std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
+            vp.insert (vp.end(), vec.begin(), vec.end());
+        }
+
+        /*!
+         * Copy \a bytes of \a dat into the buffer currently bound to \a target. If the
+         * buffer's storage is already the right size, it is re-used (with glBufferSubData),
+         * otherwise it is (re)allocated with glBufferData.
+         */
+        void bufferData (GLenum target, VBOPos vbo, std::size_t bytes, const void* dat)
+        {
+            if (bytes > 0U && bytes == this->vbo_bytes[vbo]) {
+                glBufferSubData (target, 0, bytes, dat);
+            } else {
+                glBufferData (target, bytes, dat, this->buffer_usage);
+                this->vbo_bytes[vbo] = bytes;
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
         //! Set up a vertex buffer object - bind, buffer and set vertex array object attribute
@@ -754,7 +1013,7 @@ namespace morph {
             int sz = dat.size() * sizeof(float);
             glBindBuffer (GL_ARRAY_BUFFER, buf);
             morph::gl::Util::checkError (__FILE__, __LINE__);
-            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_STATIC_DRAW);
+            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), this->buffer_usage);
             morph::gl::Util::checkError (__FILE__, __LINE__);
             glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
             morph::gl::Util::checkError (__FILE__, __LINE__);
@@ -762,6 +1021,94 @@ namespace morph {
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
+        //! Set up one of this->vbos, re-using its storage if it's already the right size
+        void setupVBO (VBOPos vbo, std::vector<float>& dat, unsigned int bufferAttribPosition)
+        {
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[vbo]);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            this->bufferData (GL_ARRAY_BUFFER, vbo, dat.size() * sizeof(float), dat.data());
+            glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            glEnableVertexAttribArray (bufferAttribPosition);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! Pack vertexPositions, vertexNormals and vertexColors into interleaved_data,
+        //! returning the stride (bytes per vertex).
+        std::size_t packInterleaved()
+        {
+            if (this->vertexPositions.size() != this->vertexColors.size()
+                || this->vertexPositions.size() != this->vertexNormals.size()) {
+                throw std::runtime_error ("VisualModel: Interleaved layout needs vertexPositions, Colors and Normals all to have same size");
+            }
+            const bool ubyte_col = this->layout == vertex_layout::interleaved_ubyte_colour;
+            const std::size_t stride = ubyte_col ? 6U * sizeof(float) + 4U : 9U * sizeof(float);
+            const std::size_t nverts = this->vertexPositions.size() / 3U;
+            this->interleaved_data.resize (nverts * stride);
+            std::uint8_t* p = this->interleaved_data.data();
+            for (std::size_t i = 0; i < nverts; ++i, p += stride) {
+                std::memcpy (p, &this->vertexPositions[3U * i], 3U * sizeof(float));
+                std::memcpy (p + 3U * sizeof(float), &this->vertexNormals[3U * i], 3U * sizeof(float));
+                if (ubyte_col) {
+                    std::uint8_t* c = p + 6U * sizeof(float);
+                    for (unsigned int j = 0; j < 3U; ++j) {
+                        float cj = std::clamp (this->vertexColors[3U * i + j], 0.0f, 1.0f);
+                        c[j] = static_cast<std::uint8_t>(std::round (cj * 255.0f));
+                    }
+                    c[3] = 255U;
+                } else {
+                    std::memcpy (p + 6U * sizeof(float), &this->vertexColors[3U * i], 3U * sizeof(float));
+                }
+            }
+            return stride;
+        }
+
+        //! Buffer the indices and the vertex data and set the vertex array object attributes,
+        //! according to compact_indices and layout. The vertex array object must be bound.
+        void setupBuffers()
+        {
+            // Indices. Use 16 bit indices if every index will fit.
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
+            const std::size_t nverts = this->vertexPositions.size() / 3U;
+            if (this->compact_indices && nverts <= std::numeric_limits<GLushort>::max()) {
+                this->index_type = GL_UNSIGNED_SHORT;
+                this->indices16.resize (this->indices.size());
+                std::transform (this->indices.begin(), this->indices.end(), this->indices16.begin(),
+                                [](GLuint i) { return static_cast<GLushort>(i); });
+                this->bufferData (GL_ELEMENT_ARRAY_BUFFER, idxVBO, this->indices16.size() * sizeof(GLushort), this->indices16.data());
+            } else {
+                this->index_type = GL_UNSIGNED_INT;
+                this->indices16.clear();
+                this->bufferData (GL_ELEMENT_ARRAY_BUFFER, idxVBO, this->indices.size() * sizeof(GLuint), this->indices.data());
+            }
+
+            if (this->layout == vertex_layout::separate) {
+                this->setupVBO (posnVBO, this->vertexPositions, visgl::posnLoc);
+                this->setupVBO (normVBO, this->vertexNormals, visgl::normLoc);
+                this->setupVBO (colVBO, this->vertexColors, visgl::colLoc);
+                return;
+            }
+
+            // Interleaved. All three attributes come from the posnVBO buffer.
+            GLsizei stride = static_cast<GLsizei>(this->packInterleaved());
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[posnVBO]);
+            this->bufferData (GL_ARRAY_BUFFER, posnVBO, this->interleaved_data.size(), this->interleaved_data.data());
+            glVertexAttribPointer (visgl::posnLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(0));
+            glVertexAttribPointer (visgl::normLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3U * sizeof(float)));
+            if (this->layout == vertex_layout::interleaved_ubyte_colour) {
+                glVertexAttribPointer (visgl::colLoc, 3, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(6U * sizeof(float)));
+            } else {
+                glVertexAttribPointer (visgl::colLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(6U * sizeof(float)));
+            }
+            glEnableVertexAttribArray (visgl::posnLoc);
+            glEnableVertexAttribArray (visgl::normLoc);
+            glEnableVertexAttribArray (visgl::colLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            // The separate normal and colour buffers are not used in this layout
+            this->vbo_bytes[normVBO] = 0U;
+            this->vbo_bytes[colVBO] = 0U;
+        }
+
         /*!
          * Create a tube from \a start to \a end, with radius \a r and a colour which
          * transitions from the colour \a colStart to \a colEnd.
@@ -2329,4 +2676,36 @@ namespace morph {
         } // end computeFlatCircle
     };
 
+    /*!
+     * A VisualModel which has no GL resources and whose primitive-generating functions are
+     * public. VisualModel::compute_parallel() gives one of these to each thread in which to
+     * generate a part of the model's geometry.
+     */
+    template <int glver = morph::gl::version_4_1>
+    class VisualModelChunk : public VisualModel<glver>
+    {
+    public:
+        using VisualModel<glver>::vertex_push;
+        using VisualModel<glver>::computeTube;
+        using VisualModel<glver>::computeFlatQuad;
+        using VisualModel<glver>::computeFlatPoly;
+        using VisualModel<glver>::computeRing;
+        using VisualModel<glver>::computeSphere;
+        using VisualModel<glver>::computeCone;
+        using VisualModel<glver>::computeLine;
+        using VisualModel<glver>::computeFlatLine;
+        using VisualModel<glver>::computeFlatLineRnd;
+        using VisualModel<glver>::computeFlatLineP;
+        using VisualModel<glver>::computeFlatLineN;
+        using VisualModel<glver>::computeFlatDashedLine;
+        using VisualModel<glver>::computeFlatCircleLine;
+        using VisualModel<glver>::vertexPositions;
+        using VisualModel<glver>::vertexNormals;
+        using VisualModel<glver>::vertexColors;
+        using VisualModel<glver>::indices;
+        using VisualModel<glver>::ux;
+        using VisualModel<glver>::uy;
+        using VisualModel<glver>::uz;
+    };
+
 } // namespace morph
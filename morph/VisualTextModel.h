@@ -22,6 +22,7 @@
 #include <morph/vec.h>
 #include <morph/mathconst.h>
 #include <morph/gl/util.h>
+#include <morph/gl/uniforms.h>
 #include <morph/VisualCommon.h>
 #include <morph/unicode.h>
 #include <morph/VisualFace.h>
@@ -31,6 +32,8 @@
 #include <array>
 #include <map>
 #include <limits>
+#include <numeric>
+#include <algorithm>
 
 namespace morph {
 
@@ -205,47 +208,59 @@ namespace morph {
         //! Render the VisualTextModel
         void render()
         {
-            if (this->hide == true) { return; }
-
-            GLint prev_shader;
-            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+            GLuint prog = 0;
+            this->render (prog);
+        }
 
-            // Ensure the correct program is in play for this VisualModel
-            glUseProgram (this->tshaderprog);
+        //! Render the VisualTextModel. current_prog is the shader program already in use; if
+        //! it is not this model's text program, then the text program is put in use and
+        //! current_prog is updated. A sequence of text models can so share one glUseProgram.
+        void render (GLuint& current_prog)
+        {
+            if (this->hide == true) { return; }
+            // Ensure the correct program is in play for this VisualTextModel
+            if (current_prog != this->tshaderprog) {
+                glUseProgram (this->tshaderprog);
+                current_prog = this->tshaderprog;
+            }
+            if (this->draw_ranges.empty()) { return; }
 
             // Set uniforms
-            GLint loc_tc = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("textColor"));
-            if (loc_tc != -1) { glUniform3f (loc_tc, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
-            GLint loc_a = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("alpha"));
-            if (loc_a != -1) { glUniform1f (loc_a, this->alpha); }
-            GLint loc_v = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("v_matrix"));
-            if (loc_v != -1) { glUniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
-            GLint loc_m = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("m_matrix"));
-            if (loc_m != -1) { glUniformMatrix4fv (loc_m, 1, GL_FALSE, this->viewmatrix.mat.data()); }
+            this->uniforms.use (this->tshaderprog);
+            if (this->uniforms[u_textColor] != -1) {
+                glUniform3f (this->uniforms[u_textColor], this->clr_text[0], this->clr_text[1], this->clr_text[2]);
+            }
+            if (this->uniforms[u_alpha] != -1) { glUniform1f (this->uniforms[u_alpha], this->alpha); }
+            if (this->uniforms[u_v_matrix] != -1) {
+                glUniformMatrix4fv (this->uniforms[u_v_matrix], 1, GL_FALSE, this->scenematrix.mat.data());
+            }
+            if (this->uniforms[u_m_matrix] != -1) {
+                glUniformMatrix4fv (this->uniforms[u_m_matrix], 1, GL_FALSE, this->viewmatrix.mat.data());
+            }
 
             glActiveTexture (GL_TEXTURE0);
 
             // It is only necessary to bind the vertex array object before rendering
             glBindVertexArray (this->vao);
 
-            // We have a max of (2^32)-1 characters. Should be enough.
-            for (unsigned int i = 0U; i < quads.size(); ++i) {
-                // Bind the right texture for the quad.
-                glBindTexture (GL_TEXTURE_2D, this->quad_ids[i]);
-                // This is 'draw a subset of the elements from the vertex array
-                // object'. You say how many indices to draw and which base *vertex* you
-                // start from. In my scheme, I have 4 vertices for each two triangles
-                // that are constructed. Thus, I draw 6 indices, but increment the base
-                // vertex by 4 for each letter.
-                glDrawElementsBaseVertex (GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, 4*i);
+            // The indices are grouped by glyph texture (see initializeVertices), so there is
+            // one draw call for each distinct character, rather than one for every character.
+            for (const auto& r : this->draw_ranges) {
+                glBindTexture (GL_TEXTURE_2D, r.texture);
+                glDrawElements (GL_TRIANGLES, r.count, GL_UNSIGNED_INT, (void*)(r.first * sizeof(GLuint)));
             }
 
             glBindVertexArray(0);
-            glUseProgram (prev_shader);
 
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
+        //! The number of vertices drawn by render() (4 per character)
+        std::size_t vertex_count() const { return this->hide ? 0U : 4U * this->quads.size(); }
+
+        //! The number of draw calls made by render() (one per distinct character)
+        std::size_t draw_count() const { return this->hide ? 0U : this->draw_ranges.size(); }
+
         //! Set clr_text to a value suitable to be visible on the background colour bgcolour
         void setVisibleOn (const std::array<float, 4>& bgcolour)
         {
@@ -509,7 +524,20 @@ namespace morph {
                 this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
                 this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
 
-                // Two triangles per quad
+            }
+
+            // Two triangles per quad. The quads are ordered by glyph texture so that all the
+            // quads with the same texture can be drawn with one draw call.
+            std::vector<unsigned int> order (nquads);
+            std::iota (order.begin(), order.end(), 0U);
+            std::stable_sort (order.begin(), order.end(),
+                              [this](unsigned int a, unsigned int b) { return this->quad_ids[a] < this->quad_ids[b]; });
+            this->draw_ranges.clear();
+            for (unsigned int qi : order) {
+                if (this->draw_ranges.empty() || this->draw_ranges.back().texture != this->quad_ids[qi]) {
+                    this->draw_ranges.push_back ({ this->quad_ids[qi], this->indices.size(), 0 });
+                }
+                this->draw_ranges.back().count += 6;
                 // qi * 4 + 1, 2 3 or 4
                 GLuint ib = (GLuint)qi*4;
                 this->indices.push_back (ib++); // 0
@@ -636,6 +664,17 @@ namespace morph {
         enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, textureVBO, numVBO };
         //! A copy of the reference to the text shader program
         GLuint tshaderprog;
+        //! The locations of the uniforms set in render()
+        enum uniform_idx { u_textColor, u_alpha, u_v_matrix, u_m_matrix };
+        morph::gl::uniform_locations<4> uniforms = std::array<const char*, 4>{ "textColor", "alpha", "v_matrix", "m_matrix" };
+        //! A run of indices whose quads all have the same glyph texture
+        struct draw_range
+        {
+            GLuint texture = 0;
+            std::size_t first = 0;
+            GLsizei count = 0;
+        };
+        std::vector<draw_range> draw_ranges;
         //! The OpenGL Vertex Array Object
         GLuint vao;
         //! Single vbo to use as in example
@@ -1,6 +1,12 @@
 /*
  * Compute statistics using the bootstrap method.
  *
+ * The resamples are not stored. Each resample's statistic is computed on the fly from
+ * indices drawn from that resample's own random number stream, and the resamples are
+ * processed in parallel, so memory use is O(B) rather than O(B x n). Each stream is
+ * seeded from a seed and the resample's number, so the results depend only on the seed,
+ * not on the number of threads. The seed defaults to a value from std::random_device.
+ *
  * Author: Seb James
  * Date: July 2023
  */
@@ -8,6 +14,8 @@
 #pragma once
 
 #include <vector>
+#include <random>
+#include <cstdint>
 #include <morph/vec.h>
 #include <morph/vvec.h>
 
@@ -18,61 +26,108 @@ namespace morph {
 
         static constexpr bool debug_bstrap = false;
 
-        // Resample B sets from data and place them in resamples
+        // The random number engine for resample b. stream allows a statistic that needs
+        // more than one resample at a time (such as the t-test) to have independent streams.
+        static std::mt19937 resample_engine (const unsigned int seed, const unsigned int b, const unsigned int stream = 0)
+        {
+            std::seed_seq sseq { seed, b, stream };
+            return std::mt19937 (sseq);
+        }
+
+        // Draw an index in [0, n) from gen. This is Lemire's multiply-shift method, which is
+        // much faster than std::uniform_int_distribution. Its bias (at most n / 2^32) is
+        // negligible for bootstrapping.
+        static unsigned int draw_index (std::mt19937& gen, const unsigned int n)
+        {
+            return static_cast<unsigned int>((static_cast<std::uint64_t>(gen()) * n) >> 32);
+        }
+
+        // Resample B sets from data and place them in resamples. The statistics functions
+        // below don't use this; it is here for client code that needs the resamples.
         static void resample_with_replacement (const morph::vvec<T>& data,
-                                               std::vector<morph::vvec<T>>& resamples, const unsigned int B)
+                                               std::vector<morph::vvec<T>>& resamples, const unsigned int B,
+                                               const unsigned int seed = std::random_device{}())
         {
-            unsigned int data_n = data.size();
+            const unsigned int data_n = data.size();
             resamples.resize (B);
-            for (unsigned int i = 0; i < B; ++i) {
-                morph::vvec<T> resample (data_n);
-                morph::vvec<unsigned int> randindices (data_n);
-                randindices.randomize (0, data_n);
+            const int iB = static_cast<int>(B);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int i = 0; i < iB; ++i) {
+                std::mt19937 gen = bootstrap<T>::resample_engine (seed, i);
+                resamples[i].resize (data_n);
                 for (unsigned int j = 0; j < data_n; ++j) {
-                    resample[j] = data[randindices[j]];
+                    resamples[i][j] = data[bootstrap<T>::draw_index (gen, data_n)];
                 }
-                resamples[i] = resample;
             }
         }
 
-        // Compute a bootstapped standard error of the mean of the data with B resamples
-        static T error_of_mean (const morph::vvec<T>& data, const unsigned int B)
+        // For each of B resamples of data, compute the mean and the (n-1) variance, placing
+        // them in means and variances. The resamples are never stored; each is accumulated
+        // (with Welford's algorithm) as its values are drawn.
+        static void resample_moments (const morph::vvec<T>& data, const unsigned int B,
+                                      morph::vvec<T>& means, morph::vvec<T>& variances,
+                                      const unsigned int seed, const unsigned int stream = 0)
         {
-            std::vector<morph::vvec<T>> resamples;
-            morph::bootstrap<T>::resample_with_replacement (data, resamples, B);
-            morph::vvec<T> r_mean (B, T{0});
-            for (unsigned int i = 0; i < B; ++i) {
-                r_mean[i] = resamples[i].mean();
+            const unsigned int data_n = data.size();
+            means.resize (B);
+            variances.resize (B);
+            const int iB = static_cast<int>(B);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int i = 0; i < iB; ++i) {
+                std::mt19937 gen = bootstrap<T>::resample_engine (seed, i, stream);
+                T mean = T{0};
+                T m2 = T{0};
+                for (unsigned int j = 0; j < data_n; ++j) {
+                    T x = data[bootstrap<T>::draw_index (gen, data_n)];
+                    T d = x - mean;
+                    mean += d / static_cast<T>(j + 1);
+                    m2 += d * (x - mean);
+                }
+                means[i] = mean;
+                variances[i] = data_n > 1 ? m2 / static_cast<T>(data_n - 1) : T{0};
             }
+        }
+
+        // Compute a bootstapped standard error of the mean of the data with B resamples
+        static T error_of_mean (const morph::vvec<T>& data, const unsigned int B,
+                                const unsigned int seed = std::random_device{}())
+        {
+            morph::vvec<T> r_mean;
+            morph::vvec<T> r_var;
+            morph::bootstrap<T>::resample_moments (data, B, r_mean, r_var, seed);
             // Standard error is the standard deviation of the resample means
             return r_mean.std();
         }
         // std::vector version of error_of_mean
-        static T error_of_mean (const std::vector<T>& data, const unsigned int B)
+        static T error_of_mean (const std::vector<T>& data, const unsigned int B,
+                                const unsigned int seed = std::random_device{}())
         {
             morph::vvec<T> vdata;
             vdata.set_from (data);
-            return bootstrap<T>::error_of_mean (vdata, B);
+            return bootstrap<T>::error_of_mean (vdata, B, seed);
         }
 
         // Compute a bootstapped standard error of the SD of the data with B resamples
-        static T error_of_std (const morph::vvec<T>& data, const unsigned int B)
+        static T error_of_std (const morph::vvec<T>& data, const unsigned int B,
+                               const unsigned int seed = std::random_device{}())
         {
-            std::vector<morph::vvec<T>> resamples;
-            morph::bootstrap<T>::resample_with_replacement (data, resamples, B);
-            morph::vvec<T> r_std (B, T{0});
-            for (unsigned int i = 0; i < B; ++i) {
-                r_std[i] = resamples[i].std();
-            }
+            morph::vvec<T> r_mean;
+            morph::vvec<T> r_var;
+            morph::bootstrap<T>::resample_moments (data, B, r_mean, r_var, seed);
             // Standard error of the statistic is the standard deviation of the resampled statistic
-            return r_std.std();
+            return r_var.sqrt().std();
         }
         // std::vector version of error_of_std
-        static T error_of_std (const std::vector<T>& data, const unsigned int B)
+        static T error_of_std (const std::vector<T>& data, const unsigned int B,
+                               const unsigned int seed = std::random_device{}())
         {
             morph::vvec<T> vdata;
             vdata.set_from (data);
-            return bootstrap<T>::error_of_std (vdata, B);
+            return bootstrap<T>::error_of_std (vdata, B, seed);
         }
 
         // Compute a bootstrapped two sample t statistic as per algorithm 16.2
@@ -98,7 +153,8 @@ namespace morph {
         // Cognitive and Developmental Systems, vol. 10, no. 3, pp. 823-836, Sept. 2018, doi:
         // 10.1109/TCDS.2018.2797426.
         static morph::vec<T, 2> ttest_equalityofmeans (const morph::vvec<T>& _zdata,
-                                                       const morph::vvec<T>& _ydata, const unsigned int B)
+                                                       const morph::vvec<T>& _ydata, const unsigned int B,
+                                                       const unsigned int seed = std::random_device{}())
         {
             // Ensure that the group which we name zdata is the larger one.
             morph::vvec<T> zdata = _zdata;
@@ -138,36 +194,17 @@ namespace morph {
                 std::cout << "ytilda mean: " << ytilda.mean() << std::endl;
             }
 
-            // Resample from the shifted (tilda) distributions:
-            std::vector<morph::vvec<T>> zstar;
-            bootstrap<T>::resample_with_replacement (ztilda, zstar, B);
-            if constexpr (debug_bstrap) {
-                std::cout << "zstar size after resample: " << zstar.size() << std::endl;
-            }
-            std::vector<morph::vvec<T>> ystar;
-            bootstrap<T>::resample_with_replacement (ytilda, ystar, B);
-
-            // Create vectors of the means of these resamples:
-            morph::vvec<T> zstarmeans (B, T{0});
-            morph::vvec<T> ystarmeans (B, T{0});
-
-            for (unsigned int i = 0; i < B; ++i) {
-                zstarmeans[i] = zstar[i].mean();
-                ystarmeans[i] = ystar[i].mean();
-            }
+            // Resample from the shifted (tilda) distributions, computing the mean and variance
+            // of each resample (z and y resamples use separate random number streams):
+            morph::vvec<T> zstarmeans;
+            morph::vvec<T> zvariances;
+            bootstrap<T>::resample_moments (ztilda, B, zstarmeans, zvariances, seed, 0);
+            morph::vvec<T> ystarmeans;
+            morph::vvec<T> yvariances;
+            bootstrap<T>::resample_moments (ytilda, B, ystarmeans, yvariances, seed, 1);
 
             if constexpr (debug_bstrap) {
                 std::cout << "zstarmeans of size " << zstarmeans.size() << " and content: " << zstarmeans << std::endl;
-            }
-
-            // Compute the variances.
-            morph::vvec<T> zvariances (B, T{0});
-            morph::vvec<T> yvariances (B, T{0});
-            for (unsigned int i = 0; i < B; ++i) {
-                zvariances[i] = (zstar[i]-zstarmeans[i]).pow(2).sum() / (n-1);
-                yvariances[i] = (ystar[i]-ystarmeans[i]).pow(2).sum() / (m-1);
-            }
-            if constexpr (debug_bstrap) {
                 std::cout << "zvariances: " << zvariances << std::endl;
             }
 
@@ -191,13 +228,14 @@ namespace morph {
         }
         // std::vector version of ttest_equalityofmeans()
         static morph::vec<T, 2> ttest_equalityofmeans (const std::vector<T>& _zdata,
-                                                       const std::vector<T>& _ydata, const unsigned int B)
+                                                       const std::vector<T>& _ydata, const unsigned int B,
+                                                       const unsigned int seed = std::random_device{}())
         {
             morph::vvec<T> vzdata;
             vzdata.set_from (_zdata);
             morph::vvec<T> vydata;
             vydata.set_from (_ydata);
-            return bootstrap<T>::ttest_equalityofmeans (vzdata, vydata, B);
+            return bootstrap<T>::ttest_equalityofmeans (vzdata, vydata, B, seed);
         }
     };
 }
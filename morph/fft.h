@@ -0,0 +1,72 @@
+/*
+ * A simple radix-2 fast Fourier transform, used by vvec::convolve() for wide kernels.
+ */
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <utility>
+#include <stdexcept>
+#include <morph/mathconst.h>
+
+namespace morph {
+
+    template <typename F>
+    struct fft
+    {
+        //! Transform a in place. a.size() must be a power of 2. The inverse transform is
+        //! normalised (by 1/a.size()) so that transform (a, true) undoes transform (a).
+        static void transform (std::vector<std::complex<F>>& a, const bool inverse = false)
+        {
+            const std::size_t n = a.size();
+            if (n == 0U) { return; }
+            if ((n & (n - 1U)) != 0U) { throw std::runtime_error ("fft::transform: size must be a power of 2"); }
+
+            // Bit reversal permutation
+            for (std::size_t i = 1U, j = 0U; i < n; ++i) {
+                std::size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1) { j ^= bit; }
+                j ^= bit;
+                if (i < j) { std::swap (a[i], a[j]); }
+            }
+
+            // Butterflies. The twiddle factors are computed directly for each stage (rather
+            // than by repeated multiplication) to keep the rounding error small.
+            std::vector<std::complex<F>> w (n / 2U);
+            for (std::size_t len = 2U; len <= n; len <<= 1) {
+                const std::size_t half = len / 2U;
+                const F ang = (inverse ? F{1} : F{-1}) * morph::mathconst<F>::two_pi / static_cast<F>(len);
+                for (std::size_t k = 0U; k < half; ++k) { w[k] = std::polar (F{1}, ang * static_cast<F>(k)); }
+                for (std::size_t i = 0U; i < n; i += len) {
+                    for (std::size_t k = 0U; k < half; ++k) {
+                        std::complex<F> u = a[i + k];
+                        std::complex<F> v = fft<F>::mul (a[i + k + half], w[k]);
+                        a[i + k] = u + v;
+                        a[i + k + half] = u - v;
+                    }
+                }
+            }
+
+            if (inverse) {
+                const F scale = F{1} / static_cast<F>(n);
+                for (auto& ai : a) { ai *= scale; }
+            }
+        }
+
+        //! Complex multiplication without the inf/nan handling of std::complex's operator*,
+        //! which is much slower (and not needed for finite data).
+        static std::complex<F> mul (const std::complex<F>& a, const std::complex<F>& b)
+        {
+            return std::complex<F> (a.real() * b.real() - a.imag() * b.imag(),
+                                    a.real() * b.imag() + a.imag() * b.real());
+        }
+
+        //! The smallest power of 2 that is >= n
+        static std::size_t size_for (const std::size_t n)
+        {
+            std::size_t p = 1U;
+            while (p < n) { p <<= 1; }
+            return p;
+        }
+    };
+}
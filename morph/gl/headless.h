@@ -0,0 +1,239 @@
+/*!
+ * \file
+ *
+ * A headless OpenGL context with an offscreen framebuffer, for rendering a morph::Visual with
+ * no window and no display (on a cluster node, for example). The context comes from EGL. The
+ * Mesa 'surfaceless' platform is used if it is available, as it needs neither a display nor a
+ * GPU device (Mesa then renders on the CPU with llvmpipe). Otherwise the default EGL display
+ * is used.
+ *
+ * Use with a morph::Visual compiled in OWNED_MODE, with win_t set to void:
+ *
+ *   #define OWNED_MODE 1
+ *   namespace morph { using win_t = void; }
+ *   #include <morph/gl/headless.h>
+ *   #include <morph/Visual.h>
+ *
+ *   morph::gl::headless<> ctx (1024, 768);
+ *   morph::Visual<> v;
+ *   v.set_winsize (1024, 768);
+ *   v.init (nullptr);
+ *   // ...add models...
+ *   v.render();
+ *   ctx.resolve();
+ *   v.saveImage ("frame.png");
+ *
+ * Each headless object has its own context. To render in several threads, make one per
+ * thread and call make_current() on it in its thread. To render in several processes, create
+ * the headless object after the process has been forked.
+ */
+#pragma once
+
+#ifndef USE_GLEW
+# ifdef __OSX__
+#  include <OpenGL/gl3.h>
+# else
+#  include <GL3/gl3.h>
+#  include <GL/glext.h>
+# endif
+#endif
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+
+namespace morph {
+    namespace gl {
+
+        template <int glver = morph::gl::version_4_1>
+        struct headless
+        {
+            /*!
+             * Create the EGL context, make it current and create a framebuffer of width w and
+             * height h pixels, which is left bound for drawing. If samples is greater than 0,
+             * the framebuffer is multisampled and resolve() must be called before reading
+             * pixels.
+             */
+            headless (const int w, const int h, const int samples = 0)
+                : width (w)
+                , height (h)
+                , n_samples (samples)
+            {
+                this->init_context();
+                this->make_current();
+                this->init_framebuffers();
+            }
+
+            ~headless()
+            {
+                if (this->egl_dpy == EGL_NO_DISPLAY) { return; }
+                if (eglGetCurrentContext() == this->egl_ctx) {
+                    glDeleteFramebuffers (2, this->fbo);
+                    glDeleteRenderbuffers (3, this->rbo);
+                }
+                eglMakeCurrent (this->egl_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                if (this->egl_ctx != EGL_NO_CONTEXT) { eglDestroyContext (this->egl_dpy, this->egl_ctx); }
+                eglTerminate (this->egl_dpy);
+            }
+
+            headless (const headless&) = delete;
+            headless& operator= (const headless&) = delete;
+
+            //! Make this context current in the calling thread and bind its framebuffer for drawing
+            void make_current()
+            {
+                if (eglMakeCurrent (this->egl_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, this->egl_ctx) == EGL_FALSE) {
+                    throw std::runtime_error ("morph::gl::headless: Failed to eglMakeCurrent");
+                }
+                if (this->fbo[draw_fbo] != 0) { this->bind(); }
+            }
+
+            //! Bind the framebuffer that is rendered into for both drawing and reading
+            void bind()
+            {
+                glBindFramebuffer (GL_FRAMEBUFFER, this->fbo[draw_fbo]);
+                glViewport (0, 0, this->width, this->height);
+            }
+
+            /*!
+             * Make the rendered image available to glReadPixels (and so to
+             * Visual::saveImage). With a multisampled framebuffer, this blits it into a
+             * single sampled framebuffer which is bound for reading; otherwise it does
+             * nothing.
+             */
+            void resolve()
+            {
+                if (this->n_samples == 0) { return; }
+                glBindFramebuffer (GL_READ_FRAMEBUFFER, this->fbo[draw_fbo]);
+                glBindFramebuffer (GL_DRAW_FRAMEBUFFER, this->fbo[resolve_fbo]);
+                glBlitFramebuffer (0, 0, this->width, this->height, 0, 0, this->width, this->height,
+                                   GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer (GL_DRAW_FRAMEBUFFER, this->fbo[draw_fbo]);
+                glBindFramebuffer (GL_READ_FRAMEBUFFER, this->fbo[resolve_fbo]);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! The EGL vendor and version and the GL renderer, for logging
+            std::string describe() const
+            {
+                std::string s = std::string ("EGL ") + eglQueryString (this->egl_dpy, EGL_VENDOR) + " "
+                + eglQueryString (this->egl_dpy, EGL_VERSION);
+                const GLubyte* r = glGetString (GL_RENDERER);
+                if (r != nullptr) { s += std::string (", ") + reinterpret_cast<const char*>(r); }
+                return s;
+            }
+
+            const int width;
+            const int height;
+            const int n_samples;
+
+        private:
+            void init_context()
+            {
+                // Prefer Mesa's surfaceless platform, which needs no display and no GPU
+                const char* client_ext = eglQueryString (EGL_NO_DISPLAY, EGL_EXTENSIONS);
+                if (client_ext != nullptr && std::strstr (client_ext, "EGL_MESA_platform_surfaceless") != nullptr) {
+                    auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress ("eglGetPlatformDisplayEXT"));
+                    if (get_platform_display != nullptr) {
+                        this->egl_dpy = get_platform_display (EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+                    }
+                }
+                if (this->egl_dpy == EGL_NO_DISPLAY) { this->egl_dpy = eglGetDisplay (EGL_DEFAULT_DISPLAY); }
+                if (this->egl_dpy == EGL_NO_DISPLAY) {
+                    throw std::runtime_error ("morph::gl::headless: No EGL display");
+                }
+                if (eglInitialize (this->egl_dpy, nullptr, nullptr) == EGL_FALSE) {
+                    throw std::runtime_error ("morph::gl::headless: Failed to eglInitialize");
+                }
+
+                const char* dpy_ext = eglQueryString (this->egl_dpy, EGL_EXTENSIONS);
+                if (dpy_ext == nullptr || std::strstr (dpy_ext, "EGL_KHR_surfaceless_context") == nullptr) {
+                    throw std::runtime_error ("morph::gl::headless: EGL_KHR_surfaceless_context is not supported");
+                }
+
+                constexpr bool gles = morph::gl::version::gles (glver);
+                // No surfaces are made (rendering is into a framebuffer object), so any surface type will do
+                const EGLint config_attribs[] = {
+                    EGL_SURFACE_TYPE, 0,
+                    EGL_RENDERABLE_TYPE, (gles ? EGL_OPENGL_ES3_BIT : EGL_OPENGL_BIT),
+                    EGL_NONE
+                };
+                EGLConfig cfg;
+                EGLint count = 0;
+                if (eglChooseConfig (this->egl_dpy, config_attribs, &cfg, 1, &count) == EGL_FALSE || count < 1) {
+                    throw std::runtime_error ("morph::gl::headless: Failed to eglChooseConfig");
+                }
+                if (eglBindAPI (gles ? EGL_OPENGL_ES_API : EGL_OPENGL_API) == EGL_FALSE) {
+                    throw std::runtime_error ("morph::gl::headless: Failed to eglBindAPI");
+                }
+
+                const EGLint profile = morph::gl::version::compat (glver)
+                                       ? EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT : EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT;
+                const EGLint ctx_attribs[] = {
+                    EGL_CONTEXT_MAJOR_VERSION, morph::gl::version::major (glver),
+                    EGL_CONTEXT_MINOR_VERSION, morph::gl::version::minor (glver),
+                    (gles ? EGL_NONE : EGL_CONTEXT_OPENGL_PROFILE_MASK), profile,
+                    EGL_NONE
+                };
+                this->egl_ctx = eglCreateContext (this->egl_dpy, cfg, EGL_NO_CONTEXT, ctx_attribs);
+                if (this->egl_ctx == EGL_NO_CONTEXT) {
+                    throw std::runtime_error ("morph::gl::headless: Failed to create an OpenGL "
+                                              + morph::gl::version::vstring (glver) + " context");
+                }
+            }
+
+            void init_framebuffers()
+            {
+                glGenFramebuffers (2, this->fbo);
+                glGenRenderbuffers (3, this->rbo);
+
+                glBindRenderbuffer (GL_RENDERBUFFER, this->rbo[colour_rbo]);
+                glRenderbufferStorageMultisample (GL_RENDERBUFFER, this->n_samples, GL_RGBA8, this->width, this->height);
+                glBindRenderbuffer (GL_RENDERBUFFER, this->rbo[depth_rbo]);
+                glRenderbufferStorageMultisample (GL_RENDERBUFFER, this->n_samples, GL_DEPTH_COMPONENT24, this->width, this->height);
+                glBindFramebuffer (GL_FRAMEBUFFER, this->fbo[draw_fbo]);
+                glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->rbo[colour_rbo]);
+                glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->rbo[depth_rbo]);
+                this->check_complete();
+
+                if (this->n_samples > 0) {
+                    glBindRenderbuffer (GL_RENDERBUFFER, this->rbo[resolve_rbo]);
+                    glRenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, this->width, this->height);
+                    glBindFramebuffer (GL_FRAMEBUFFER, this->fbo[resolve_fbo]);
+                    glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->rbo[resolve_rbo]);
+                    this->check_complete();
+                }
+                glBindRenderbuffer (GL_RENDERBUFFER, 0);
+                this->bind();
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            void check_complete()
+            {
+                GLenum status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+                if (status != GL_FRAMEBUFFER_COMPLETE) {
+                    throw std::runtime_error ("morph::gl::headless: Framebuffer is incomplete (status "
+                                              + std::to_string (status) + ")");
+                }
+            }
+
+            EGLDisplay egl_dpy = EGL_NO_DISPLAY;
+            EGLContext egl_ctx = EGL_NO_CONTEXT;
+
+            static constexpr unsigned int draw_fbo = 0;
+            static constexpr unsigned int resolve_fbo = 1;
+            GLuint fbo[2] = { 0, 0 };
+
+            static constexpr unsigned int colour_rbo = 0;
+            static constexpr unsigned int depth_rbo = 1;
+            static constexpr unsigned int resolve_rbo = 2;
+            GLuint rbo[3] = { 0, 0, 0 };
+        };
+
+    } // namespace gl
+} // namespace morph
@@ -0,0 +1,365 @@
+#pragma once
+
+/*
+ * GPU parallel reductions over the float data in a Shader Storage Buffer Object.
+ *
+ * morph::gl::reduce holds a set of compute shader programs which find the range (min and
+ * max), the sum, the argmax or the histogram of the first n floats in an SSBO. Each is a
+ * workgroup shared memory tree reduction: every workgroup reduces a grid-strided share of
+ * the data to one partial result and (for min/max, sum and argmax) a second, single
+ * workgroup pass reduces the partials. Only the result (a few bytes, or the histogram's
+ * bins) is read back to the CPU, so this is the thing to use in place of ssbo_get_range(),
+ * which maps and reads the whole buffer.
+ *
+ * Usage, with a current GL context:
+ *
+ *   morph::gl::reduce<morph::gl::version_4_5> red;
+ *   red.init();
+ *   morph::range<float> r = red.minmax (my_ssbo.name, N);
+ *
+ * The reductions bind the source buffer and a scratch buffer to the shader storage binding
+ * points binding_in and binding_out (set these before init() if your own shaders use 6 and
+ * 7) and leave their own program in use, so call use() on your program afterwards.
+ *
+ * NaNs are ignored by all the reductions. The cpu_* functions are reference
+ * implementations which give the same answers, for validation.
+ *
+ * Note: You have to include GL3/gl3.h/GL/glext.h/GLEW3/gl31.h etc for the GL types and
+ * functions BEFORE including this file.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <span>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <morph/range.h>
+#include <morph/vvec.h>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+
+namespace morph {
+    namespace gl {
+
+        template <int glver>
+        struct reduce
+        {
+            // Invocations per workgroup. OpenGL ES only guarantees 128.
+            static constexpr unsigned int wg_size = morph::gl::version::gles (glver) ? 128u : 256u;
+            // The most workgroups in a first pass, which is also the most partial results
+            static constexpr unsigned int max_groups = 256u;
+            // The most bins that histogram() can count (in shared memory)
+            static constexpr unsigned int max_bins = 1024u;
+
+            // The shader storage binding points used for the source and the scratch buffers
+            unsigned int binding_in = 6;
+            unsigned int binding_out = 7;
+
+            reduce() {}
+            reduce (const reduce&) = delete;
+            reduce& operator= (const reduce&) = delete;
+            ~reduce()
+            {
+                if (this->scratch_name) { glDeleteBuffers (1, &this->scratch_name); }
+                if (this->bins_name) { glDeleteBuffers (1, &this->bins_name); }
+            }
+
+            // Compile the reduction programs and make the scratch buffers. Requires a current
+            // GL context which supports compute shaders.
+            void init()
+            {
+                // The GLES preamble's default float precision is mediump, which is not enough
+                const std::string head = std::string (morph::gl::version::shaderpreamble (glver))
+                + "precision highp float;\n"
+                + "#define WG " + std::to_string (wg_size) + "u\n"
+                + "#define BIN_IN " + std::to_string (this->binding_in) + "\n"
+                + "#define BIN_OUT " + std::to_string (this->binding_out) + "\n"
+                + "#define MAX_BINS " + std::to_string (max_bins) + "u\n"
+                + "#define FLT_BIG 3.402823466e+38\n"
+                + "layout (local_size_x = WG) in;\n"
+                + "layout (std430, binding = BIN_IN) readonly buffer InBlock { float data[]; };\n"
+                + "uniform uint n;\n";
+                this->load (this->prog_minmax, head + minmax_src);
+                this->load (this->prog_sum, head + sum_src);
+                this->load (this->prog_argmax, head + argmax_src);
+                this->load (this->prog_histo, head + histo_src);
+
+                // Room for max_groups partial results of the largest type (argmax's)
+                glGenBuffers (1, &this->scratch_name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->scratch_name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, max_groups * 2 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+                glGenBuffers (1, &this->bins_name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->bins_name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, max_bins * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            // The range of the first n floats in the SSBO src_name. With no (non-NaN) data,
+            // the range is that of range::search_init().
+            morph::range<float> minmax (const GLuint src_name, const unsigned int n)
+            {
+                morph::range<float> r;
+                r.search_init();
+                float res[2] = { r.min, r.max };
+                this->run (this->prog_minmax, src_name, n, res, sizeof(res));
+                if (res[0] <= res[1]) {
+                    r.min = res[0];
+                    r.max = res[1];
+                }
+                return r;
+            }
+
+            // The sum of the first n floats in the SSBO src_name
+            float sum (const GLuint src_name, const unsigned int n)
+            {
+                float res = 0.0f;
+                this->run (this->prog_sum, src_name, n, &res, sizeof(res));
+                return res;
+            }
+
+            // The maximum of the first n floats in src_name and its index (the first, if the
+            // maximum occurs more than once). The index is n if there are no (non-NaN) data.
+            std::pair<float, unsigned int> argmax (const GLuint src_name, const unsigned int n)
+            {
+                struct { float v; unsigned int i; } res = { std::numeric_limits<float>::lowest(), n };
+                this->run (this->prog_argmax, src_name, n, &res, sizeof(res));
+                return { res.v, (res.i < n ? res.i : n) };
+            }
+
+            // Count the first n floats in src_name into nbins equal bins spanning [lo, hi]. A
+            // value equal to hi goes in the last bin; values outside [lo, hi] are not counted.
+            morph::vvec<unsigned int> histogram (const GLuint src_name, const unsigned int n,
+                                                 const unsigned int nbins, const float lo, const float hi)
+            {
+                if (nbins == 0 || nbins > max_bins) {
+                    throw std::runtime_error ("morph::gl::reduce::histogram: nbins must be in [1, "
+                                              + std::to_string (max_bins) + "]");
+                }
+                if (!(hi > lo)) { throw std::runtime_error ("morph::gl::reduce::histogram: hi must be greater than lo"); }
+
+                morph::vvec<unsigned int> bins (nbins, 0u);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->bins_name);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, nbins * sizeof(unsigned int), bins.data());
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, this->binding_in, src_name);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, this->binding_out, this->bins_name);
+
+                this->prog_histo.use();
+                this->prog_histo.set_uniform ("n", n);
+                this->prog_histo.set_uniform ("nbins", nbins);
+                this->prog_histo.set_uniform ("lo", lo);
+                this->prog_histo.set_uniform ("hi", hi);
+                this->prog_histo.set_uniform ("scale", static_cast<float>(nbins) / (hi - lo));
+                if (n > 0) { this->prog_histo.dispatch (groups_for (n), 1, 1); }
+
+                this->read_result (this->bins_name, bins.data(), nbins * sizeof(unsigned int));
+                return bins;
+            }
+
+            // CPU reference implementations, which follow the GPU algorithms' conventions
+            static morph::range<float> cpu_minmax (std::span<const float> d)
+            {
+                morph::range<float> r;
+                r.search_init();
+                for (float x : d) { if (!std::isnan (x)) { r.update (x); } }
+                return r;
+            }
+
+            static float cpu_sum (std::span<const float> d)
+            {
+                double s = 0.0;
+                for (float x : d) { if (!std::isnan (x)) { s += x; } }
+                return static_cast<float>(s);
+            }
+
+            static std::pair<float, unsigned int> cpu_argmax (std::span<const float> d)
+            {
+                std::pair<float, unsigned int> m = { std::numeric_limits<float>::lowest(), static_cast<unsigned int>(d.size()) };
+                for (unsigned int i = 0; i < d.size(); ++i) {
+                    if (!std::isnan (d[i]) && (m.second == d.size() || d[i] > m.first)) { m = { d[i], i }; }
+                }
+                return m;
+            }
+
+            static morph::vvec<unsigned int> cpu_histogram (std::span<const float> d, const unsigned int nbins,
+                                                            const float lo, const float hi)
+            {
+                morph::vvec<unsigned int> bins (nbins, 0u);
+                const float scale = static_cast<float>(nbins) / (hi - lo);
+                for (float x : d) {
+                    if (!(x >= lo && x <= hi)) { continue; } // also rejects NaN
+                    unsigned int b = static_cast<unsigned int>((x - lo) * scale);
+                    ++bins[std::min (b, nbins - 1u)];
+                }
+                return bins;
+            }
+
+        private:
+            // The number of workgroups for a first pass over n elements
+            static GLuint groups_for (const unsigned int n)
+            {
+                return std::max (1u, std::min (max_groups, (n + wg_size - 1u) / wg_size));
+            }
+
+            void load (morph::gl::compute_shaderprog<glver>& prog, const std::string& src)
+            {
+                prog.load_shaders ({ { GL_COMPUTE_SHADER, "", src.c_str(), 0 } });
+                if (prog.prog_id == 0) { throw std::runtime_error ("morph::gl::reduce: failed to build a reduction program"); }
+            }
+
+            // Run a two pass tree reduction and read back its result, which is partial[0]
+            void run (morph::gl::compute_shaderprog<glver>& prog, const GLuint src_name, const unsigned int n,
+                      void* result, const std::size_t result_bytes)
+            {
+                if (n == 0) { return; } // result keeps its initial (empty) value
+                if (this->scratch_name == 0) { throw std::runtime_error ("morph::gl::reduce: call init() first"); }
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, this->binding_in, src_name);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, this->binding_out, this->scratch_name);
+                prog.use();
+                const GLuint ngroups = groups_for (n);
+                prog.set_uniform ("n", n);
+                prog.set_uniform ("first_pass", 1u);
+                prog.dispatch (ngroups, 1, 1);
+                if (ngroups > 1) {
+                    prog.set_uniform ("n", static_cast<unsigned int>(ngroups));
+                    prog.set_uniform ("first_pass", 0u);
+                    prog.dispatch (1, 1, 1);
+                }
+                this->read_result (this->scratch_name, result, result_bytes);
+            }
+
+            // Copy the first nbytes of buffer buf_name into dst
+            void read_result (const GLuint buf_name, void* dst, const std::size_t nbytes)
+            {
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, buf_name);
+                const void* p = glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, nbytes, GL_MAP_READ_BIT);
+                if (p == nullptr) {
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                    throw std::runtime_error ("morph::gl::reduce: failed to map the result buffer");
+                }
+                std::memcpy (dst, p, nbytes);
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            morph::gl::compute_shaderprog<glver> prog_minmax;
+            morph::gl::compute_shaderprog<glver> prog_sum;
+            morph::gl::compute_shaderprog<glver> prog_argmax;
+            morph::gl::compute_shaderprog<glver> prog_histo;
+            GLuint scratch_name = 0;
+            GLuint bins_name = 0;
+
+            // The GLSL bodies. Each follows the head made in init(). In the first pass, each
+            // invocation reduces data[i] for a grid stride of i; in the second, the partials.
+            static constexpr const char* minmax_src =
+            "layout (std430, binding = BIN_OUT) buffer OutBlock { vec2 partial[]; };\n"
+            "uniform uint first_pass;\n"
+            "shared vec2 s[WG];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    vec2 acc = vec2(FLT_BIG, -FLT_BIG);\n"
+            "    for (uint i = gl_GlobalInvocationID.x; i < n; i += gl_NumWorkGroups.x * WG) {\n"
+            "        vec2 v = first_pass != 0u ? vec2(data[i]) : partial[i];\n"
+            "        if (!isnan (v.x)) { acc = vec2(min (acc.x, v.x), max (acc.y, v.y)); }\n"
+            "    }\n"
+            "    s[t] = acc;\n"
+            "    memoryBarrierShared();\n"
+            "    barrier();\n"
+            "    for (uint k = WG / 2u; k > 0u; k >>= 1) {\n"
+            "        if (t < k) { s[t] = vec2(min (s[t].x, s[t + k].x), max (s[t].y, s[t + k].y)); }\n"
+            "        memoryBarrierShared();\n"
+            "        barrier();\n"
+            "    }\n"
+            "    if (t == 0u) { partial[gl_WorkGroupID.x] = s[0]; }\n"
+            "}\n";
+
+            static constexpr const char* sum_src =
+            "layout (std430, binding = BIN_OUT) buffer OutBlock { float partial[]; };\n"
+            "uniform uint first_pass;\n"
+            "shared float s[WG];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    float acc = 0.0;\n"
+            "    for (uint i = gl_GlobalInvocationID.x; i < n; i += gl_NumWorkGroups.x * WG) {\n"
+            "        float v = first_pass != 0u ? data[i] : partial[i];\n"
+            "        if (!isnan (v)) { acc += v; }\n"
+            "    }\n"
+            "    s[t] = acc;\n"
+            "    memoryBarrierShared();\n"
+            "    barrier();\n"
+            "    for (uint k = WG / 2u; k > 0u; k >>= 1) {\n"
+            "        if (t < k) { s[t] += s[t + k]; }\n"
+            "        memoryBarrierShared();\n"
+            "        barrier();\n"
+            "    }\n"
+            "    if (t == 0u) { partial[gl_WorkGroupID.x] = s[0]; }\n"
+            "}\n";
+
+            // Ties go to the lower index, so the result is the first maximum
+            static constexpr const char* argmax_src =
+            "struct vi { float v; uint i; };\n"
+            "layout (std430, binding = BIN_OUT) buffer OutBlock { vi partial[]; };\n"
+            "uniform uint first_pass;\n"
+            "shared float sv[WG];\n"
+            "shared uint si[WG];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    float av = -FLT_BIG;\n"
+            "    uint ai = 0xffffffffu;\n"
+            "    for (uint i = gl_GlobalInvocationID.x; i < n; i += gl_NumWorkGroups.x * WG) {\n"
+            "        float v = first_pass != 0u ? data[i] : partial[i].v;\n"
+            "        uint j = first_pass != 0u ? i : partial[i].i;\n"
+            "        if (!isnan (v) && j != 0xffffffffu && (ai == 0xffffffffu || v > av || (v == av && j < ai))) { av = v; ai = j; }\n"
+            "    }\n"
+            "    sv[t] = av;\n"
+            "    si[t] = ai;\n"
+            "    memoryBarrierShared();\n"
+            "    barrier();\n"
+            "    for (uint k = WG / 2u; k > 0u; k >>= 1) {\n"
+            "        if (t < k && si[t + k] != 0xffffffffu\n"
+            "            && (si[t] == 0xffffffffu || sv[t + k] > sv[t] || (sv[t + k] == sv[t] && si[t + k] < si[t]))) {\n"
+            "            sv[t] = sv[t + k];\n"
+            "            si[t] = si[t + k];\n"
+            "        }\n"
+            "        memoryBarrierShared();\n"
+            "        barrier();\n"
+            "    }\n"
+            "    if (t == 0u) { partial[gl_WorkGroupID.x] = vi(sv[0], si[0]); }\n"
+            "}\n";
+
+            // Each workgroup counts into shared memory, then adds its counts to the bins
+            static constexpr const char* histo_src =
+            "layout (std430, binding = BIN_OUT) buffer OutBlock { uint bins[]; };\n"
+            "uniform uint nbins;\n"
+            "uniform float lo;\n"
+            "uniform float hi;\n"
+            "uniform float scale;\n"
+            "shared uint s[MAX_BINS];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    for (uint b = t; b < nbins; b += WG) { s[b] = 0u; }\n"
+            "    memoryBarrierShared();\n"
+            "    barrier();\n"
+            "    for (uint i = gl_GlobalInvocationID.x; i < n; i += gl_NumWorkGroups.x * WG) {\n"
+            "        float x = data[i];\n"
+            "        if (x >= lo && x <= hi) { atomicAdd (s[min (uint((x - lo) * scale), nbins - 1u)], 1u); }\n"
+            "    }\n"
+            "    memoryBarrierShared();\n"
+            "    barrier();\n"
+            "    for (uint b = t; b < nbins; b += WG) { if (s[b] > 0u) { atomicAdd (bins[b], s[b]); } }\n"
+            "}\n";
+        };
+
+    } // namespace gl
+} // namespace morph
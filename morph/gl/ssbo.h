@@ -3,6 +3,11 @@
 /*
  * Common code for SSBO interactions in morph programs
  *
+ * ssbo and the setup_ssbo/copy functions use ordinary, synchronously mapped buffers. With
+ * OpenGL 4.4 there are also persistent_ssbo (a persistently mapped buffer with a zero-copy
+ * std::span view) and ssbo_readback (fenced, double or triple buffered readback that
+ * doesn't stall the GPU).
+ *
  * Note: You have to include GL3/gl3.h/GL/glext.h/GLEW3/gl31.h etc for the GL types and
  * functions BEFORE including this file.
  *
@@ -10,6 +15,13 @@
  */
 
 #include <cuchar>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include <morph/vec.h>
 #include <morph/vvec.h>
 #include <morph/range.h>
@@ -37,31 +49,34 @@ namespace morph {
             void init()
             {
                 glGenBuffers (1, &this->name);
-                this->copy_to_gpu();
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, N * sizeof(T), this->data.data(), GL_DYNAMIC_DRAW);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
             }
 
-            // Copy the data in the morph::vec data over to the GPU
+            // Copy the data in the morph::vec data over to the GPU. The buffer's storage was
+            // allocated in init(), so this only updates its contents.
             void copy_to_gpu()
             {
                 glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->name);
                 morph::gl::Util::checkError (__FILE__, __LINE__);
-                glBufferData (GL_SHADER_STORAGE_BUFFER, N * sizeof(T), this->data.data(), GL_STATIC_DRAW);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, N * sizeof(T), this->data.data());
                 morph::gl::Util::checkError (__FILE__, __LINE__);
                 glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
                 morph::gl::Util::checkError (__FILE__, __LINE__);
             }
 
-            // Map the GPU memory to CPU space, then copy the values into this->data. NB: it's a
-            // performance hit to *copy* to the mapped data to our morph::vec, because the data is
-            // *already in CPU accessible memory* after glMapBufferRange().
-            // However, in case you need it, here it is.
+            // Map the GPU memory to CPU space, then copy the values into this->data. This waits
+            // for the GPU to finish writing the buffer. To read back without waiting, use an
+            // ssbo_readback (or a persistent_ssbo, if you don't need a copy at all).
             void copy_from_gpu()
             {
                 glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->name);
                 morph::gl::Util::checkError (__FILE__, __LINE__);
-                T* cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N*sizeof(T), GL_MAP_READ_BIT));
+                const T* cpuptr = static_cast<const T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N*sizeof(T), GL_MAP_READ_BIT));
                 morph::gl::Util::checkError (__FILE__, __LINE__);
-                for (unsigned int i = 0; i < N; ++i) { this->data[i] = cpuptr[i]; }
+                std::memcpy (this->data.data(), cpuptr, N * sizeof(T));
                 glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
                 glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
                 morph::gl::Util::checkError (__FILE__, __LINE__);
@@ -114,12 +129,26 @@ namespace morph {
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
+        // Copy nbytes of data into the SSBO that is bound to GL_SHADER_STORAGE_BUFFER. If the
+        // buffer is already that size, only its contents are updated; its storage is
+        // (re)allocated only if its size has to change.
+        inline void buffer_ssbo_data (const void* data, const GLsizeiptr nbytes)
+        {
+            GLint64 cur_size = 0;
+            glGetBufferParameteri64v (GL_SHADER_STORAGE_BUFFER, GL_BUFFER_SIZE, &cur_size);
+            if (cur_size == static_cast<GLint64>(nbytes)) {
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, nbytes, data);
+            } else {
+                glBufferData (GL_SHADER_STORAGE_BUFFER, nbytes, data, GL_DYNAMIC_DRAW);
+            }
+        }
+
         // Copy data to an existing SSBO
         template<typename T>
         void copy_vvec_to_ssbo (const GLuint target_index, const unsigned int ssbo_id, const morph::vvec<T>& data)
         {
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, target_index, ssbo_id);
-            glBufferData (GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(T), data.data(), GL_STATIC_DRAW);
+            buffer_ssbo_data (data.data(), data.size() * sizeof(T));
             glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
@@ -128,7 +157,7 @@ namespace morph {
         void copy_vvec_to_ssbo (const GLuint target_index, const unsigned int ssbo_id, const morph::vvec<T>& data)
         {
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, target_index, ssbo_id);
-            glBufferData (GL_SHADER_STORAGE_BUFFER, N * sizeof(T), data.data(), GL_STATIC_DRAW);
+            buffer_ssbo_data (data.data(), N * sizeof(T));
             glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
@@ -142,10 +171,11 @@ namespace morph {
         void ssbo_copy_to_vvec (const unsigned int ssbo_idx, const unsigned int ssbo_name, morph::vvec<T>& cpu_side)
         {
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, ssbo_idx, ssbo_name);
-            // Really, it's crazy to *copy* because the data is *already in CPU
-            // accessible memory* after glMapBufferRange. BUT here's the copy:
-            T* cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, cpu_side.size()*sizeof(T), GL_MAP_READ_BIT));
-            for (unsigned int i = 0; i < cpu_side.size(); ++i) { cpu_side[i] = cpuptr[i]; }
+            // This copy, and the wait for the GPU that mapping implies, can be avoided with a
+            // persistent_ssbo (for a zero-copy view) or an ssbo_readback (to read back without
+            // waiting).
+            const T* cpuptr = static_cast<const T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, cpu_side.size()*sizeof(T), GL_MAP_READ_BIT));
+            std::memcpy (cpu_side.data(), cpuptr, cpu_side.size() * sizeof(T));
             glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
             glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
             morph::gl::Util::checkError (__FILE__, __LINE__);
@@ -155,16 +185,17 @@ namespace morph {
         void ssbo_copy_to_vec (const unsigned int ssbo_idx, const unsigned int ssbo_name, morph::vec<T, N>& cpu_side)
         {
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, ssbo_idx, ssbo_name);
-            // Really, it's crazy to *copy* because the data is *already in CPU
-            // accessible memory* after glMapBufferRange. BUT here's the copy:
-            T* cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N*sizeof(T), GL_MAP_READ_BIT));
-            for (unsigned int i = 0; i < N; ++i) { cpu_side[i] = cpuptr[i]; }
+            // See ssbo_copy_to_vvec
+            const T* cpuptr = static_cast<const T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N*sizeof(T), GL_MAP_READ_BIT));
+            std::memcpy (cpu_side.data(), cpuptr, N * sizeof(T));
             glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
             glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
-        // Find the range of the data in the given Shader Storage Buffer Object
+        // Find the range of the data in the given Shader Storage Buffer Object. This maps and
+        // scans the whole buffer on the CPU; for large float buffers, reduce::minmax() in
+        // morph/gl/reduce.h finds the range on the GPU and reads back only the result.
         //
         // ssbo_idx: The Index of the Shader Storage Buffer Object that we're reading from
         // ssbo_name: The name (really a number) of the Shader Storage Buffer Object that we're reading from
@@ -183,5 +214,280 @@ namespace morph {
             return r;
         }
 
+        // Insert a fence into the GL command stream after the commands issued so far,
+        // replacing (and deleting) any earlier fence in sync. The commands are flushed, so that
+        // the fence is sure to be reached, however long a client later waits for it.
+        inline void fence_insert (GLsync& sync)
+        {
+            if (sync != nullptr) { glDeleteSync (sync); }
+            sync = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+
+        // Wait up to timeout_ns nanoseconds for the GPU to reach the fence sync (0 to just
+        // check). Returns true if the fence has been reached, or if there is no fence.
+        inline bool fence_wait (GLsync& sync, const GLuint64 timeout_ns)
+        {
+            if (sync == nullptr) { return true; }
+            GLenum rtn = glClientWaitSync (sync, 0, timeout_ns);
+            if (rtn == GL_WAIT_FAILED) { throw std::runtime_error ("morph::gl::fence_wait: glClientWaitSync failed"); }
+            if (rtn == GL_TIMEOUT_EXPIRED) { return false; }
+            glDeleteSync (sync);
+            sync = nullptr;
+            return true;
+        }
+
+        // Wait as long as it takes
+        static constexpr GLuint64 fence_forever = 0xffffffffffffffffULL;
+
+#ifdef GL_MAP_PERSISTENT_BIT // Immutable, persistently mapped storage needs OpenGL 4.4 (or ARB_buffer_storage)
+
+        /*!
+         * An SSBO with immutable storage (glBufferStorage) that stays mapped into CPU
+         * accessible memory for as long as it exists. The mapping is coherent, so nothing is
+         * copied in either direction: view() is a std::span onto the buffer's own memory,
+         * through which the CPU reads what shaders wrote and writes what shaders will read.
+         *
+         * The CPU and the GPU must take turns. After dispatching work that writes the buffer,
+         * call fence(); once wait() returns (or ready() returns true) the results can be read
+         * through view(). Likewise, fence and wait before writing to memory that a shader
+         * may still be reading. To keep the GPU busy while the CPU works, use two or more
+         * buffers in turn.
+         *
+         * @tparam index: The binding index of the buffer, used in the GLSL
+         * @tparam T: The type of the data in the SSBO
+         * @tparam N: The number of elements of type T in the SSBO
+         */
+        template <unsigned int index, typename T, std::size_t N>
+        struct persistent_ssbo
+        {
+            // The name of the buffer, generated with glGenBuffers()
+            unsigned int name = 0;
+
+            persistent_ssbo() {}
+            // The OpenGL context must be current when a persistent_ssbo is destroyed
+            ~persistent_ssbo() { this->release(); }
+            persistent_ssbo (const persistent_ssbo&) = delete;
+            persistent_ssbo& operator= (const persistent_ssbo&) = delete;
+
+            // Create the buffer (optionally with initial contents), map it and bind it to index
+            void init (const T* initial = nullptr)
+            {
+                this->release();
+                glGenBuffers (1, &this->name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->name);
+                glBufferStorage (GL_SHADER_STORAGE_BUFFER, N * sizeof(T), initial, persistent_ssbo::flags);
+                this->cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N * sizeof(T), persistent_ssbo::flags));
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                if (this->cpuptr == nullptr) {
+                    throw std::runtime_error ("morph::gl::persistent_ssbo: Failed to map the buffer");
+                }
+                this->bind();
+            }
+
+            // Bind the buffer to its index (init() does this; call it again if something else
+            // has been bound to the same index)
+            void bind() const { glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->name); }
+
+            // The buffer's memory. Don't access it while the GPU may be using it (see fence()).
+            std::span<T, N> view() { return std::span<T, N> (this->cpuptr, N); }
+            std::span<const T, N> view() const { return std::span<const T, N> (this->cpuptr, N); }
+
+            // Fence the commands issued so far, which may write (or read) the buffer
+            void fence()
+            {
+                // Make shader writes to the buffer visible through the mapping
+                glMemoryBarrier (GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+                morph::gl::fence_insert (this->sync);
+            }
+            // True if the GPU has passed the last fence. Does not block.
+            bool ready() { return morph::gl::fence_wait (this->sync, 0); }
+            // Block until the GPU has passed the last fence
+            void wait() { morph::gl::fence_wait (this->sync, morph::gl::fence_forever); }
+
+            // The range of the data, read in place (call wait() first)
+            morph::range<T> get_range() const
+            {
+                morph::range<T> r;
+                r.search_init();
+                for (const T& v : this->view()) { r.update (v); }
+                return r;
+            }
+
+            // Unmap and delete the buffer
+            void release()
+            {
+                if (this->sync != nullptr) {
+                    glDeleteSync (this->sync);
+                    this->sync = nullptr;
+                }
+                if (this->name != 0) {
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->name);
+                    glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                    glDeleteBuffers (1, &this->name);
+                    this->name = 0;
+                    this->cpuptr = nullptr;
+                }
+            }
+
+        private:
+            static constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            T* cpuptr = nullptr;
+            GLsync sync = nullptr;
+        };
+
+        /*!
+         * Asynchronous readback of SSBO data through a ring of depth persistently mapped
+         * buffers (2 for double buffering, 3 for triple buffering).
+         *
+         * request() queues a GPU-side copy of (part of) an SSBO into the next free buffer in the
+         * ring, followed by a fence, and returns at once, so the GPU can carry on with later
+         * work (the next simulation step, say) while the copy completes. The readbacks come
+         * out in the order they were requested: ready() says whether the oldest has landed
+         * without blocking, front() is a zero-copy view of it (waiting for it if necessary) and
+         * pop() hands its buffer back to the ring.
+         *
+         * ssbo_readback<float> rb;
+         * rb.init (n, 2);
+         * for (step...) {
+         *     prog.dispatch (...);
+         *     if (!rb.request (ssbo_name, step)) { use (rb.front()); rb.pop(); rb.request (ssbo_name, step); }
+         *     while (rb.ready()) { use (rb.front()); rb.pop(); }
+         * }
+         */
+        template <typename T>
+        struct ssbo_readback
+        {
+            ssbo_readback() {}
+            // The OpenGL context must be current when an ssbo_readback is destroyed
+            ~ssbo_readback() { this->release(); }
+            ssbo_readback (const ssbo_readback&) = delete;
+            ssbo_readback& operator= (const ssbo_readback&) = delete;
+
+            // Set up depth buffers, each of n elements of type T
+            void init (const std::size_t n, const unsigned int depth = 3)
+            {
+                this->release();
+                if (n == 0 || depth == 0) { throw std::runtime_error ("morph::gl::ssbo_readback: n and depth must be non-zero"); }
+                this->n_elements = n;
+                this->slots.resize (depth);
+                constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                for (unsigned int i = 0; i < depth; ++i) {
+                    glGenBuffers (1, &this->slots[i].name);
+                    glBindBuffer (GL_COPY_WRITE_BUFFER, this->slots[i].name);
+                    // Hint that the buffer should be in client memory, as it's only for reading back
+                    glBufferStorage (GL_COPY_WRITE_BUFFER, n * sizeof(T), nullptr, flags | GL_CLIENT_STORAGE_BIT);
+                    this->slots[i].cpuptr = static_cast<const T*>(glMapBufferRange (GL_COPY_WRITE_BUFFER, 0, n * sizeof(T), flags));
+                    if (this->slots[i].cpuptr == nullptr) {
+                        glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                        throw std::runtime_error ("morph::gl::ssbo_readback: Failed to map a buffer");
+                    }
+                    this->free_slots.push_back (i);
+                }
+                glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            /*!
+             * Queue a copy of n elements of the SSBO src_name, starting from element first,
+             * with a tag (a step number, say) to identify it. Returns false, having done
+             * nothing, if all the buffers are in use: consume one with front() and pop() and
+             * try again.
+             */
+            bool request (const GLuint src_name, const std::uint64_t tag = 0, const std::size_t first = 0)
+            {
+                if (this->free_slots.empty()) { return false; }
+                const unsigned int si = this->free_slots.back();
+                this->free_slots.pop_back();
+                slot& sl = this->slots[si];
+                // Make shader writes to the source visible to the copy
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_COPY_READ_BUFFER, src_name);
+                glBindBuffer (GL_COPY_WRITE_BUFFER, sl.name);
+                glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, first * sizeof(T), 0, this->n_elements * sizeof(T));
+                glBindBuffer (GL_COPY_READ_BUFFER, 0);
+                glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                morph::gl::fence_insert (sl.sync);
+                sl.tag = tag;
+                this->in_flight.push_back (si);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                return true;
+            }
+
+            // The number of readbacks that have been requested and not yet popped
+            std::size_t pending() const { return this->in_flight.size(); }
+
+            // True if there is a readback and the oldest one has landed. Does not block.
+            bool ready()
+            {
+                if (this->in_flight.empty()) { return false; }
+                return morph::gl::fence_wait (this->slots[this->in_flight.front()].sync, 0);
+            }
+
+            // The oldest readback's data, in place. Waits for the copy to land if necessary.
+            // The view is valid until pop() is called.
+            std::span<const T> front()
+            {
+                if (this->in_flight.empty()) { throw std::runtime_error ("morph::gl::ssbo_readback: No readback is pending"); }
+                slot& sl = this->slots[this->in_flight.front()];
+                morph::gl::fence_wait (sl.sync, morph::gl::fence_forever);
+                return std::span<const T> (sl.cpuptr, this->n_elements);
+            }
+
+            // The tag that was given to request() for the oldest readback
+            std::uint64_t front_tag() const
+            {
+                if (this->in_flight.empty()) { throw std::runtime_error ("morph::gl::ssbo_readback: No readback is pending"); }
+                return this->slots[this->in_flight.front()].tag;
+            }
+
+            // Finish with the oldest readback, returning its buffer to the ring
+            void pop()
+            {
+                if (this->in_flight.empty()) { return; }
+                const unsigned int si = this->in_flight.front();
+                this->in_flight.pop_front();
+                // In case the data was never looked at
+                morph::gl::fence_wait (this->slots[si].sync, morph::gl::fence_forever);
+                this->free_slots.push_back (si);
+            }
+
+            // Unmap and delete the buffers
+            void release()
+            {
+                for (auto& sl : this->slots) {
+                    if (sl.sync != nullptr) { glDeleteSync (sl.sync); }
+                    if (sl.name != 0) {
+                        glBindBuffer (GL_COPY_WRITE_BUFFER, sl.name);
+                        glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+                        glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                        glDeleteBuffers (1, &sl.name);
+                    }
+                }
+                this->slots.clear();
+                this->in_flight.clear();
+                this->free_slots.clear();
+                this->n_elements = 0;
+            }
+
+        private:
+            struct slot
+            {
+                GLuint name = 0;
+                const T* cpuptr = nullptr;
+                GLsync sync = nullptr;
+                std::uint64_t tag = 0;
+            };
+            std::vector<slot> slots;
+            // Indices into slots of the readbacks in flight, oldest first, and of the free buffers
+            std::deque<unsigned int> in_flight;
+            std::vector<unsigned int> free_slots;
+            std::size_t n_elements = 0;
+        };
+
+#endif // GL_MAP_PERSISTENT_BIT
+
     } // gl
 } // morph
@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+ * Uniform location caching and the per-frame uniform buffer shared by the programs of a
+ * morph::Visual.
+ *
+ * Note: You have to include GL3/gl3.h/GL/glext.h etc for the GL types and functions BEFORE
+ * including this file.
+ */
+
+#include <array>
+#include <cstddef>
+
+namespace morph {
+    namespace gl {
+
+        /*!
+         * The locations of N uniforms in a shader program. They are looked up (with
+         * glGetUniformLocation) the first time use() is called for a program, and again only
+         * if the program changes. Index with the position of the name in names.
+         */
+        template <std::size_t N>
+        struct uniform_locations
+        {
+            uniform_locations (const std::array<const char*, N>& _names) : names (_names) { this->loc.fill (-1); }
+
+            //! Make sure that the locations are those for prog
+            void use (const GLuint prog)
+            {
+                if (prog == this->program) { return; }
+                for (std::size_t i = 0; i < N; ++i) {
+                    this->loc[i] = glGetUniformLocation (prog, static_cast<const GLchar*>(this->names[i]));
+                }
+                this->program = prog;
+            }
+
+            GLint operator[] (const std::size_t i) const { return this->loc[i]; }
+
+            std::array<const char*, N> names;
+            std::array<GLint, N> loc;
+            GLuint program = 0;
+        };
+
+        /*!
+         * The data that are the same for every model in a frame: the projection and the
+         * lighting. In the default shaders these are a std140 uniform block called
+         * morph_frame:
+         *
+         * layout(std140) uniform morph_frame
+         * {
+         *     highp mat4 p_matrix;
+         *     highp vec3 light_colour;
+         *     highp float ambient_intensity;
+         *     highp vec3 diffuse_position;
+         *     highp float diffuse_intensity;
+         * };
+         *
+         * The members are laid out here to match std140 (a float can follow a vec3).
+         */
+        struct frame_uniforms
+        {
+            std::array<float, 16> p_matrix;
+            std::array<float, 3> light_colour;
+            float ambient_intensity;
+            std::array<float, 3> diffuse_position;
+            float diffuse_intensity;
+        };
+        static_assert (sizeof (frame_uniforms) == 96, "frame_uniforms must match the std140 layout of morph_frame");
+
+        //! The name of the uniform block for frame_uniforms
+        static constexpr const char* frame_block_name = "morph_frame";
+        //! The uniform buffer binding point used for frame_uniforms
+        static constexpr GLuint frame_block_binding = 0;
+
+        //! If prog has the morph_frame uniform block, bind it to frame_block_binding and
+        //! return true. Shader programs without the block return false.
+        inline bool bind_frame_block (const GLuint prog)
+        {
+            GLuint bi = glGetUniformBlockIndex (prog, static_cast<const GLchar*>(frame_block_name));
+            if (bi == GL_INVALID_INDEX) { return false; }
+            glUniformBlockBinding (prog, bi, frame_block_binding);
+            return true;
+        }
+
+    } // namespace gl
+} // namespace morph
@@ -1,5 +1,9 @@
 /*
  * A histogram class for a 2D histogram on a HexGrid.
+ *
+ * Build it in one go from a vvec of coordinates, or construct it empty and accumulate data
+ * in chunks with add() or add_parallel(). Partial histograms on the same HexGrid (from
+ * other threads, say) can be combined with merge().
  */
 #pragma once
 
@@ -7,6 +11,8 @@
 #include <morph/vvec.h>
 #include <morph/HexGrid.h>
 #include <utility>
+#include <vector>
+#include <stdexcept>
 
 namespace morph {
 
@@ -16,33 +22,100 @@ namespace morph {
         // Data is a vvec of coordinates. data[2] is ignored. hg is a hex grid, assumed to be in
         // same coordinate frame as data.
         hexyhisto (const morph::vvec<morph::vec<T>>& data, HexGrid* hg)
+            : hexyhisto (hg)
         {
-            unsigned int n = hg->num();
-            this->counts.resize(n, 0);
-            this->proportions.resize(n, T{0});
-
-            // For each coordinate, add it to a hex
-            for (const morph::vec<T, 3>& datum : data) {
-                if (datum[2] < 0.0f) { continue; }
-                // if datum is in a hex hi, then counts[hi->vg] += T{1};
-                auto hi = hg->findHexNearest (datum.less_one_dim());
-
-                // dist from hi to datum:
-                morph::vec<T> hipos = { hi->x, hi->y, 0 };
-                T _d = (hipos - datum).length();
-                if (_d <= hg->getv()) {
-                    counts[hi->vi] += T{1};
-                    //std::cout << "crossing at " << datum << " has nearest hex: " << hi->outputXY() << " for which count = " << counts[hi->vi] << std::endl;
-                    this->datacount++;
-                }
-            }
-            this->proportions = counts.as_float();
-            this->proportions /= this->datacount;
+            this->add (data);
             // Now just plot hexyhisto::proportions on your HexGrid. Simples.
         }
 
+        // An empty histogram on the HexGrid hg. Add data with add() or add_parallel()
+        hexyhisto (HexGrid* _hg)
+        {
+            this->hg = _hg;
+            this->tally.assign (_hg->num(), 0U);
+            this->update();
+        }
+
+        // Add the coordinates in data to the histogram. Coordinates with a negative z
+        // component are skipped, as are those that are not inside a hex.
+        void add (const morph::vvec<morph::vec<T>>& data)
+        {
+            for (const morph::vec<T, 3>& datum : data) { this->count (datum); }
+            this->update();
+        }
+
+        // As add(), but count the data with several threads, each into its own
+        // sub-histogram. The sub-histograms are then summed.
+        void add_parallel (const morph::vvec<morph::vec<T>>& data)
+        {
+            const long long int nd = static_cast<long long int>(data.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+            {
+                hexyhisto<T> sub (this->hg);
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+                for (long long int i = 0; i < nd; ++i) { sub.count (data[i]); }
+#ifdef _OPENMP
+#pragma omp critical (morph_hexyhisto_add_parallel)
+#endif
+                this->add_tallies (sub);
+            }
+            this->update();
+        }
+
+        // Add the counts in other, which must be on the same HexGrid, to this histogram
+        void merge (const hexyhisto<T>& other)
+        {
+            if (other.hg != this->hg) {
+                throw std::runtime_error ("hexyhisto::merge: Histograms are on different HexGrids");
+            }
+            this->add_tallies (other);
+            this->update();
+        }
+
         T datacount = T{0}; // how many elements were there in data?
         morph::vvec<T> counts;
         morph::vvec<T> proportions;
+
+    protected:
+        HexGrid* hg = nullptr;
+        // Exact counts for each hex and the total count (counts/datacount are made from these)
+        std::vector<unsigned long long int> tally;
+        unsigned long long int n_data = 0U;
+
+        // Count one coordinate (without updating counts and proportions)
+        void count (const morph::vec<T, 3>& datum)
+        {
+            if (datum[2] < 0.0f) { return; }
+            // if datum is in a hex hi, then counts[hi->vg] += T{1};
+            auto hi = this->hg->findHexNearest (datum.less_one_dim());
+
+            // dist from hi to datum:
+            morph::vec<T> hipos = { hi->x, hi->y, 0 };
+            T _d = (hipos - datum).length();
+            if (_d <= this->hg->getv()) {
+                ++this->tally[hi->vi];
+                ++this->n_data;
+            }
+        }
+
+        void add_tallies (const hexyhisto<T>& other)
+        {
+            for (std::size_t i = 0; i < this->tally.size(); ++i) { this->tally[i] += other.tally[i]; }
+            this->n_data += other.n_data;
+        }
+
+        // Recompute counts, datacount and proportions from the tallies
+        void update()
+        {
+            this->counts.resize (this->tally.size());
+            for (std::size_t i = 0; i < this->tally.size(); ++i) { this->counts[i] = static_cast<T>(this->tally[i]); }
+            this->datacount = static_cast<T>(this->n_data);
+            this->proportions = counts.as_float();
+            if (this->n_data > 0U) { this->proportions /= this->datacount; }
+        }
     };
 }
@@ -1,5 +1,16 @@
 /*
  * A histogram class
+ *
+ * A histo can be built in one go from a container of data, or it can be used as an
+ * accumulator to which data are added in chunks with add() (or add_parallel()) and to
+ * which partial histograms (from other threads, say) are combined with merge().
+ *
+ * The bins of an accumulating histo are either fixed (construct with min, max and the
+ * number of bins; data outside the range are counted in underflow and overflow) or they
+ * are auto-ranging. An auto-ranging histo takes its initial range from the first data
+ * added. If later data fall outside the range, the bin width is doubled (keeping the
+ * number of bins) until they fit. Each new bin is exactly two old bins, so no counts are
+ * approximated when the range grows.
  */
 #pragma once
 
@@ -8,54 +19,309 @@
 #include <morph/range.h>
 #include <morph/MathAlgo.h>
 #include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
 
 namespace morph {
 
     template <typename T=float>
     struct histo
     {
+        //! Make a histogram of data with n bins which span the range of data.
         template < template <typename, typename> typename Container,
                    typename Allocator=std::allocator<T> >
         histo (const Container<T, Allocator>& data, std::size_t n)
         {
-            this->bins.resize (n, T{0});
-            this->binedges.resize (n + 1U, T{0});
-            this->counts.resize (n, T{0});
-            this->proportions.resize (n, T{0});
-            this->datacount = static_cast<T>(data.size());
-
-            // Compute bin widths from range of data and n.
-            morph::range<T> maximini = morph::MathAlgo::maxmin (data);
-            this->max = maximini.max;
-            this->min = maximini.min;
-            this->range = max - min;
-            this->binwidth = this->range / static_cast<T>(n);
-            for (std::size_t i = 0; i < n; ++i) {
-                // bins[i] = min + i*bw + bw/2 but do the additions after the loop
-                this->bins[i] = i * this->binwidth;
-                this->binedges[i + 1U] = (i + 1U) * this->binwidth;
+            this->init (n);
+            this->add (data);
+        }
+
+        //! An empty, auto-ranging histogram with n bins. The first data added set the range.
+        explicit histo (std::size_t n) { this->init (n); }
+
+        //! An empty histogram with n bins which are fixed to span [_min, _max]
+        histo (T _min, T _max, std::size_t n)
+        {
+            if (!(_max > _min)) { throw std::runtime_error ("histo: max must be greater than min"); }
+            this->init (n);
+            this->auto_range = false;
+            this->binlo = _min;
+            this->binwidth = (_max - _min) / static_cast<T>(n);
+            this->cover (_max);
+            this->have_bins = true;
+            this->update();
+        }
+
+        //! Add the data in [first, last) to the histogram. NaNs are ignored.
+        template <typename It>
+        void add (It first, It last)
+        {
+            if (first == last) { return; }
+            if (this->auto_range) {
+                T lo = std::numeric_limits<T>::max();
+                T hi = std::numeric_limits<T>::lowest();
+                for (It di = first; di != last; ++di) {
+                    if (!std::isfinite (*di)) { continue; }
+                    lo = std::min (lo, static_cast<T>(*di));
+                    hi = std::max (hi, static_cast<T>(*di));
+                }
+                if (lo <= hi) { this->expand_to (lo, hi); }
+            }
+            for (It di = first; di != last; ++di) { this->count (*di); }
+            this->update();
+        }
+
+        //! Add all the data in the container data to the histogram
+        template <typename C>
+        void add (const C& data) { this->add (std::begin (data), std::end (data)); }
+
+        /*!
+         * Add the data in the random access container data to the histogram, using several
+         * threads. Each thread counts a part of data into its own sub-histogram (with the
+         * same bins as this one) and the sub-histograms are then summed.
+         */
+        template <typename C>
+        void add_parallel (const C& data)
+        {
+            const long long int nd = static_cast<long long int>(data.size());
+            if (nd == 0) { return; }
+            if (this->auto_range) {
+                T lo = std::numeric_limits<T>::max();
+                T hi = std::numeric_limits<T>::lowest();
+#ifdef _OPENMP
+#pragma omp parallel for reduction(min:lo) reduction(max:hi)
+#endif
+                for (long long int i = 0; i < nd; ++i) {
+                    if (!std::isfinite (data[i])) { continue; }
+                    lo = std::min (lo, static_cast<T>(data[i]));
+                    hi = std::max (hi, static_cast<T>(data[i]));
+                }
+                if (lo <= hi) { this->expand_to (lo, hi); }
+            }
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+            {
+                histo<T> sub = this->empty_copy();
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+                for (long long int i = 0; i < nd; ++i) { sub.count (data[i]); }
+#ifdef _OPENMP
+#pragma omp critical (morph_histo_add_parallel)
+#endif
+                this->add_tallies (sub);
+            }
+            this->update();
+        }
+
+        /*!
+         * Add the counts from other, which must have the same number of bins, to this
+         * histogram. The merge is exact if the two have the same bins (which is the case for
+         * fixed range histos with the same range, or if other was made with empty_copy()).
+         * Otherwise, this histogram is first grown (if it is auto-ranging) to cover the range
+         * of other, and then each of other's bins is counted into the bin of this histo which
+         * contains its centre.
+         */
+        void merge (const histo<T>& other)
+        {
+            if (other.tally.size() != this->tally.size()) {
+                throw std::runtime_error ("histo::merge: histograms have different numbers of bins");
+            }
+            if (!other.have_bins) { this->add_tallies (other); this->update(); return; }
+
+            if (!this->have_bins) {
+                this->binlo = other.binlo;
+                this->binwidth = other.binwidth;
+                this->have_bins = true;
+            } else if (this->auto_range) {
+                this->expand_to (other.binlo, other.binhi());
             }
-            this->bins += (this->min + (this->binwidth/T{2}));
-            this->binedges += this->min;
 
-            // Compute counts
-            for (auto datum : data) {
-                int idx = static_cast<int>(std::floor(((datum - this->min)/this->range)*n));
-                if (idx > -1) {
-                    counts[idx] += T{1};
+            if (this->binlo == other.binlo && this->binwidth == other.binwidth) {
+                this->add_tallies (other);
+            } else {
+                histo<T> resampled = this->empty_copy();
+                resampled.n_data = other.n_data;
+                resampled.n_under = other.n_under;
+                resampled.n_over = other.n_over;
+                resampled.min = other.min;
+                resampled.max = other.max;
+                for (std::size_t i = 0; i < other.tally.size(); ++i) {
+                    if (other.tally[i] == 0U) { continue; }
+                    T centre = other.binlo + (static_cast<T>(i) + T{0.5}) * other.binwidth;
+                    if (centre < resampled.binlo) {
+                        resampled.n_under += other.tally[i];
+                    } else if (centre > resampled.binhi()) {
+                        resampled.n_over += other.tally[i];
+                    } else {
+                        resampled.tally[resampled.bin_of (centre)] += other.tally[i];
+                    }
                 }
+                this->add_tallies (resampled);
             }
-            this->proportions = counts/this->datacount;
+            this->update();
+        }
+
+        //! Return an empty histogram with the same bins as this one. Its range is fixed.
+        histo<T> empty_copy() const
+        {
+            histo<T> h (this->tally.size());
+            h.auto_range = false;
+            h.binlo = this->binlo;
+            h.binwidth = this->binwidth;
+            h.have_bins = this->have_bins;
+            h.update();
+            return h;
         }
 
+        //! If true, the bins grow to accommodate data outside their range. Set false by
+        //! the (min, max, n) constructor.
+        bool auto_range = true;
+
         T min = T{0}; // min value in data
         T max = T{0}; // max value in data
         T range = T{0}; // range of data
         T datacount = T{0}; // how many elements were there in data?
         T binwidth = T{0}; // Width of each bin
+        T underflow = T{0}; // How many data fell below the lowest bin edge (fixed range only)
+        T overflow = T{0}; // How many data fell above the highest bin edge (fixed range only)
         morph::vvec<T> bins; // centres of bins
         morph::vvec<T> binedges;
         morph::vvec<T> counts;
         morph::vvec<T> proportions;
+
+    protected:
+        //! The exact counts in each bin (counts is computed from these)
+        std::vector<unsigned long long int> tally;
+        unsigned long long int n_data = 0U;
+        unsigned long long int n_under = 0U;
+        unsigned long long int n_over = 0U;
+        //! The lower edge of the first bin
+        T binlo = T{0};
+        //! False until the bin range has been set
+        bool have_bins = false;
+
+        void init (std::size_t n)
+        {
+            if (n == 0U) { throw std::runtime_error ("histo: Need at least one bin"); }
+            this->tally.assign (n, 0U);
+            this->update();
+        }
+
+        //! The upper edge of the last bin
+        T binhi() const { return this->binlo + static_cast<T>(this->tally.size()) * this->binwidth; }
+
+        //! The bin for x, which must be in [binlo, binhi]. binhi goes in the last bin.
+        std::size_t bin_of (T x) const
+        {
+            std::size_t i = static_cast<std::size_t>((x - this->binlo) / this->binwidth);
+            if (i >= this->tally.size()) { return this->tally.size() - 1U; }
+            // Agree with the bin edges (computed as in update()) if x is within rounding of one
+            if (i > 0U && x < i * this->binwidth + this->binlo) { --i; }
+            if (i + 1U < this->tally.size() && x >= (i + 1U) * this->binwidth + this->binlo) { ++i; }
+            return i;
+        }
+
+        //! Count one datum into the tallies (without updating counts, proportions, etc)
+        void count (T x)
+        {
+            if (std::isnan (x)) { return; }
+            if (this->n_data == 0U || x < this->min) { this->min = x; }
+            if (this->n_data == 0U || x > this->max) { this->max = x; }
+            ++this->n_data;
+            if (!this->have_bins || x < this->binlo) {
+                ++this->n_under;
+            } else if (x > this->binhi()) {
+                ++this->n_over;
+            } else {
+                ++this->tally[this->bin_of (x)];
+            }
+        }
+
+        //! Add other's tallies to ours. other must have the same bins.
+        void add_tallies (const histo<T>& other)
+        {
+            if (other.n_data == 0U) { return; }
+            for (std::size_t i = 0; i < this->tally.size(); ++i) { this->tally[i] += other.tally[i]; }
+            if (this->n_data == 0U || other.min < this->min) { this->min = other.min; }
+            if (this->n_data == 0U || other.max > this->max) { this->max = other.max; }
+            this->n_data += other.n_data;
+            this->n_under += other.n_under;
+            this->n_over += other.n_over;
+        }
+
+        /*!
+         * Widen the bins by the least amount needed for binhi() to reach hi. (hi - lo) / n can
+         * round down, leaving the data maximum just above binhi(), where it would be counted as
+         * overflow.
+         */
+        void cover (T hi)
+        {
+            while (this->binhi() < hi) {
+                this->binwidth = std::nextafter (this->binwidth, std::numeric_limits<T>::max());
+            }
+        }
+
+        //! Grow the bins (doubling their width each time) until they cover [lo, hi]
+        void expand_to (T lo, T hi)
+        {
+            const std::size_t n = this->tally.size();
+            if (!this->have_bins) {
+                this->binlo = lo;
+                this->binwidth = (hi - lo) / static_cast<T>(n);
+                if (!(this->binwidth > T{0})) {
+                    // All the data have the same value; give it a bin width of 1/n
+                    this->binlo = lo - T{0.5};
+                    this->binwidth = T{1} / static_cast<T>(n);
+                }
+                this->cover (hi);
+                this->have_bins = true;
+                return;
+            }
+            while (lo < this->binlo) {
+                // Grow downwards. Old bin i becomes part of new bin (n + i) / 2
+                std::vector<unsigned long long int> newtally (n, 0U);
+                for (std::size_t i = 0; i < n; ++i) { newtally[(n + i) / 2U] += this->tally[i]; }
+                this->tally.swap (newtally);
+                this->binlo -= static_cast<T>(n) * this->binwidth;
+                this->binwidth *= T{2};
+            }
+            while (hi > this->binhi()) {
+                // Grow upwards. Old bin i becomes part of new bin i / 2
+                std::vector<unsigned long long int> newtally (n, 0U);
+                for (std::size_t i = 0; i < n; ++i) { newtally[i / 2U] += this->tally[i]; }
+                this->tally.swap (newtally);
+                this->binwidth *= T{2};
+            }
+        }
+
+        //! Recompute the public bins, binedges, counts, proportions, etc from the tallies
+        void update()
+        {
+            const std::size_t n = this->tally.size();
+            this->bins.resize (n);
+            this->binedges.resize (n + 1U);
+            this->counts.resize (n);
+            this->binedges[0] = T{0};
+            for (std::size_t i = 0; i < n; ++i) {
+                // bins[i] = min + i*bw + bw/2 but do the additions after the loop
+                this->bins[i] = i * this->binwidth;
+                this->binedges[i + 1U] = (i + 1U) * this->binwidth;
+                this->counts[i] = static_cast<T>(this->tally[i]);
+            }
+            this->bins += (this->binlo + (this->binwidth/T{2}));
+            this->binedges += this->binlo;
+
+            this->range = this->max - this->min;
+            this->datacount = static_cast<T>(this->n_data);
+            this->underflow = static_cast<T>(this->n_under);
+            this->overflow = static_cast<T>(this->n_over);
+            this->proportions = this->datacount > T{0} ? this->counts / this->datacount : this->counts;
+        }
     };
 }
@@ -10,6 +10,8 @@
 #pragma once
 
 #include <morph/vvec.h>
+#include <morph/nn/gemm.h>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <ostream>
@@ -94,6 +96,48 @@ namespace morph {
             //! z = sum(w.in) + b. Final output written into *out is the sigmoid(z). Size N.
             morph::vvec<T> z;
 
+            /*
+             * Minibatch members. In the minibatch code path, each layer of neurons is
+             * held as a (batch_size x layer size) row-major matrix, so that the
+             * feedforward and backprop computations become matrix multiplications.
+             */
+
+            //! The number of samples in a minibatch. 0 if the minibatch path is not set up.
+            unsigned int batch_size = 0U;
+            //! Pointers to the minibatch input matrices. Element i is batch_size x m_i.
+            std::vector<morph::vvec<T>*> ins_b;
+            //! Pointer to the minibatch output matrix. Size batch_size x N.
+            morph::vvec<T>* out_b = nullptr;
+            //! Minibatch activations. Size batch_size x N.
+            morph::vvec<T> z_b;
+            //! Minibatch errors in the input layers. Element i is batch_size x m_i.
+            std::vector<morph::vvec<T>> deltas_b;
+
+            //! Set up the minibatch code path. \a _ins_b and \a _out_b must be
+            //! allocated by the caller (and must correspond to ins and out).
+            void setBatch (std::vector<morph::vvec<T>*> _ins_b, morph::vvec<T>* _out_b, unsigned int _batch_size)
+            {
+                if (_ins_b.size() != this->ins.size()) {
+                    throw std::runtime_error ("setBatch: Wrong number of minibatch input layers");
+                }
+                this->batch_size = _batch_size;
+                this->ins_b = _ins_b;
+                this->out_b = _out_b;
+                for (unsigned int i = 0; i < this->ins.size(); ++i) {
+                    if (this->ins_b[i]->size() != this->batch_size * this->ins[i]->size()) {
+                        throw std::runtime_error ("setBatch: Minibatch input layer has wrong size");
+                    }
+                }
+                if (this->out_b->size() != this->batch_size * this->N) {
+                    throw std::runtime_error ("setBatch: Minibatch output layer has wrong size");
+                }
+                this->z_b.resize (this->batch_size * this->N, T{0});
+                this->deltas_b.resize (this->ins.size());
+                for (unsigned int i = 0; i < this->ins.size(); ++i) {
+                    this->deltas_b[i].resize (this->batch_size * this->ins[i]->size(), T{0});
+                }
+            }
+
             //! Output as a string
             std::string str() const
             {
@@ -136,18 +180,17 @@ namespace morph {
 
                 // Loop over input populations:
                 for (unsigned int i = 0; i < this->ins.size(); ++i) {
-                    // A morph::vvec for a 'part of w'
-                    morph::vvec<T>* _in = this->ins[i];
-                    unsigned int m = _in->size();// Size m[i]
-                    morph::vvec<T> wpart(m);
-                    // Get weights, outputs and biases iterators
+                    const morph::vvec<T>& _in = *this->ins[i];
+                    unsigned int m = _in.size();// Size m[i]
+                    // Get weights iterator
                     auto witer = this->ws[i].begin();
                     // Carry out an N sized for loop computing each output
                     for (unsigned int j = 0; j < this->N; ++j) { // Each output
-                        // Copy part of weights to wpart (M elements):
-                        std::copy (witer, witer+m, wpart.begin());
-                        // Compute/accumulate dot product with input
-                        this->z[j] += wpart.dot (*ins[i]);
+                        // Compute/accumulate dot product of the jth row of weights with
+                        // input (without copying the row)
+                        T dp = T{0};
+                        for (unsigned int k = 0; k < m; ++k) { dp += witer[k] * _in[k]; }
+                        this->z[j] += dp;
                         // Move to the next part of the weight matrix for the next loop
                         witer += m;
                     }
@@ -255,6 +298,97 @@ namespace morph {
                     }
                 }
             }
+
+            //! Minibatch feed-forward compute. For each sample in the batch, computes the
+            //! same as feedforward(), as the matrix product z_b = in_b . w^T + b.
+            void feedforward_batch()
+            {
+                const int B = static_cast<int>(this->batch_size);
+                const int _N = static_cast<int>(this->N);
+                for (unsigned int i = 0; i < this->ins_b.size(); ++i) {
+                    const int m = static_cast<int>(this->ins[i]->size());
+                    // z_b (B x N) (+)= in_b (B x m) . w^T (w is N x m)
+                    gemm::nt<T> (B, _N, m, T{1}, this->ins_b[i]->data(), this->ws[i].data(),
+                                 (i == 0 ? T{0} : T{1}), this->z_b.data());
+                }
+                // Add biases and apply the transfer function
+                T* zb = this->z_b.data();
+                T* ob = this->out_b->data();
+                const T* bb = this->b.data();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (int s = 0; s < B; ++s) {
+                    for (int j = 0; j < _N; ++j) {
+                        const int sj = s * _N + j;
+                        zb[sj] += bb[j];
+                        ob[sj] = T{1} / (T{1} + std::exp(-zb[sj]));
+                    }
+                }
+            }
+
+            /*!
+             * Minibatch backprop, equivalent to backprop(const FeedForwardConn&).
+             */
+            void backprop_batch (const FeedForwardConn& conn_nxt)
+            {
+                unsigned int idx = 0;
+                unsigned int idx_max = conn_nxt.ins_b.size();
+                for (unsigned int i = 0; i < idx_max; ++i) {
+                    if (conn_nxt.ins_b[i] == this->out_b) {
+                        idx = i;
+                        break;
+                    }
+                }
+                this->backprop_batch (conn_nxt.deltas_b[idx]);
+            }
+
+            /*!
+             * Minibatch backprop. \a delta_l_nxt_b is batch_size x N and holds the errors
+             * of the output neurons for each sample. Computes deltas_b for each sample and
+             * sets nabla_ws and nabla_b to the *mean* of the per-sample gradients over the
+             * minibatch (i.e. the gradient of the mean cost).
+             */
+            void backprop_batch (const morph::vvec<T>& delta_l_nxt_b)
+            {
+                if (delta_l_nxt_b.size() != this->out_b->size()) {
+                    std::stringstream ee;
+                    ee << "backprop_batch: Mismatched size. delta_l_nxt_b size: "
+                       << delta_l_nxt_b.size() << ", out_b size: " << this->out_b->size();
+                    throw std::runtime_error (ee.str());
+                }
+
+                const int B = static_cast<int>(this->batch_size);
+                const int _N = static_cast<int>(this->N);
+                const T oneoverB = T{1} / static_cast<T>(this->batch_size);
+
+                for (unsigned int idx = 0; idx < this->ins_b.size(); ++idx) {
+                    const int m = static_cast<int>(this->ins[idx]->size());
+                    // deltas_b (B x m) = delta_l_nxt_b (B x N) . w (N x m)
+                    gemm::nn<T> (B, m, _N, T{1}, delta_l_nxt_b.data(), this->ws[idx].data(),
+                                 T{0}, this->deltas_b[idx].data());
+                    // Hadamard product with sigmoid_prime of the input, which is in (1 - in)
+                    T* db = this->deltas_b[idx].data();
+                    const T* ib = this->ins_b[idx]->data();
+                    const int Bm = B * m;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                    for (int k = 0; k < Bm; ++k) { db[k] *= ib[k] * (T{1} - ib[k]); }
+
+                    // nabla_w (N x m) = (1/B) delta_l_nxt_b^T (N x B) . in_b (B x m)
+                    gemm::tn<T> (_N, m, B, oneoverB, delta_l_nxt_b.data(), ib,
+                                 T{0}, this->nabla_ws[idx].data());
+                }
+
+                // nabla_b is the mean over the batch of delta_l_nxt_b
+                this->nabla_b.zero();
+                const T* dn = delta_l_nxt_b.data();
+                for (int s = 0; s < B; ++s) {
+                    for (int j = 0; j < _N; ++j) { this->nabla_b[j] += dn[s * _N + j]; }
+                }
+                this->nabla_b *= oneoverB;
+            }
         };
 
         //! Stream operator
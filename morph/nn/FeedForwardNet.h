@@ -18,6 +18,8 @@
 #include <ostream>
 #include <map>
 #include <limits>
+#include <algorithm>
+#include <stdexcept>
 
 namespace morph {
     namespace nn {
@@ -130,6 +132,42 @@ namespace morph {
                 return numMatches;
             }
 
+            //! Evaluate against the Mnist test image set using the minibatch code path. Call
+            //! setBatchSize() first. Any final partial minibatch is evaluated on the per-sample
+            //! path.
+            unsigned int evaluate_batch (const std::multimap<unsigned char, morph::vvec<float>>& testData, int num=10000)
+            {
+                if (this->batch_size == 0U) { throw std::runtime_error ("evaluate_batch: Call setBatchSize() first"); }
+                const unsigned int n_in = this->neurons.front().size();
+                const unsigned int n_out = this->neurons.back().size();
+                unsigned int numMatches = 0;
+                std::vector<unsigned int> keys (this->batch_size, 0U);
+                unsigned int s = 0;
+                int count = 0;
+                for (auto img : testData) {
+                    if (count >= num) { break; }
+                    ++count;
+                    keys[s] = static_cast<unsigned int>(img.first);
+                    std::copy (img.second.begin(), img.second.end(), this->neurons_b.front().begin() + s * n_in);
+                    if (++s < this->batch_size) { continue; }
+                    s = 0;
+                    this->feedforward_batch();
+                    auto ob = this->neurons_b.back().begin();
+                    for (unsigned int i = 0; i < this->batch_size; ++i) {
+                        auto mx = std::max_element (ob + i * n_out, ob + (i + 1) * n_out);
+                        if (static_cast<unsigned int>(mx - (ob + i * n_out)) == keys[i]) { ++numMatches; }
+                    }
+                }
+                // Remaining partial minibatch
+                for (unsigned int i = 0; i < s; ++i) {
+                    std::copy (this->neurons_b.front().begin() + i * n_in,
+                               this->neurons_b.front().begin() + (i + 1) * n_in, this->neurons.front().begin());
+                    this->feedforward();
+                    if (this->neurons.back().argmax() == keys[i]) { ++numMatches; }
+                }
+                return numMatches;
+            }
+
             //! Determine the error gradients by the backpropagation method. NB: Call
             //! computeCost() first
             void backprop()
@@ -156,6 +194,81 @@ namespace morph {
                 }
             }
 
+            /*!
+             * Set up the minibatch code path for minibatches of \a _batch_size samples.
+             * This allocates a (batch_size x layer size) matrix for each layer of neurons
+             * and wires up the connections to use them. No further allocation is carried
+             * out by feedforward_batch(), computeCost_batch() or backprop_batch().
+             */
+            void setBatchSize (unsigned int _batch_size)
+            {
+                this->batch_size = _batch_size;
+                this->neurons_b.clear();
+                for (auto& nl : this->neurons) {
+                    this->neurons_b.emplace_back (this->batch_size * nl.size(), T{0});
+                }
+                auto nb = this->neurons_b.begin();
+                for (auto& c : this->connections) {
+                    auto nb_in = nb++;
+                    c.setBatch (std::vector<morph::vvec<T>*>{&*nb_in}, &*nb, this->batch_size);
+                }
+                this->delta_out_b.resize (this->neurons_b.back().size(), T{0});
+                this->desiredOutput_b.resize (this->neurons_b.back().size(), T{0});
+            }
+
+            /*!
+             * Copy batch_size inputs and desired outputs, starting from index \a start in
+             * \a theInputs and \a theOutputs, into the first and last minibatch layers.
+             */
+            void setInputBatch (const std::vector<morph::vvec<T>>& theInputs,
+                                const std::vector<morph::vvec<T>>& theOutputs, unsigned int start = 0)
+            {
+                if (start + this->batch_size > theInputs.size() || start + this->batch_size > theOutputs.size()) {
+                    throw std::runtime_error ("setInputBatch: Not enough inputs/outputs for a full minibatch");
+                }
+                const unsigned int n_in = this->neurons.front().size();
+                const unsigned int n_out = this->neurons.back().size();
+                for (unsigned int s = 0; s < this->batch_size; ++s) {
+                    std::copy (theInputs[start + s].begin(), theInputs[start + s].end(),
+                               this->neurons_b.front().begin() + s * n_in);
+                    std::copy (theOutputs[start + s].begin(), theOutputs[start + s].end(),
+                               this->desiredOutput_b.begin() + s * n_out);
+                }
+            }
+
+            //! Update the network's minibatch outputs from its minibatch inputs
+            void feedforward_batch()
+            {
+                for (auto& c : this->connections) { c.feedforward_batch(); }
+            }
+
+            //! Compute delta_out_b for the minibatch, returning the mean cost over the samples
+            T computeCost_batch()
+            {
+                const morph::vvec<T>& out_b = this->neurons_b.back();
+                T sos = T{0};
+                for (unsigned int k = 0; k < out_b.size(); ++k) {
+                    const T diff = out_b[k] - this->desiredOutput_b[k];
+                    this->delta_out_b[k] = diff * out_b[k] * (T{1} - out_b[k]);
+                    sos += diff * diff;
+                }
+                this->cost = T{0.5} * sos / static_cast<T>(this->batch_size);
+                return this->cost;
+            }
+
+            //! Minibatch version of backprop(). Each connection's nabla_ws and nabla_b will
+            //! hold the mean gradients over the minibatch. Call computeCost_batch() first.
+            void backprop_batch()
+            {
+                auto citer = this->connections.end();
+                --citer; // Now points at output layer
+                citer->backprop_batch (this->delta_out_b);
+                for (;citer != this->connections.begin();) {
+                    auto citer_closertooutput = citer--;
+                    citer->backprop_batch (citer_closertooutput->deltas_b[0]);
+                }
+            }
+
             //! Set up an input along with desired output
             void setInput (const morph::vvec<T>& theInput, const morph::vvec<T>& theOutput)
             {
@@ -205,6 +318,15 @@ namespace morph {
             morph::vvec<T> delta_out;
             //! The desired output of the network
             morph::vvec<T> desiredOutput;
+
+            //! The number of samples in a minibatch. Set with setBatchSize().
+            unsigned int batch_size = 0U;
+            //! Minibatch neuron layers. Each is a (batch_size x layer size) row-major matrix.
+            std::list<morph::vvec<T>> neurons_b;
+            //! The error (dC/dz) of the output layer for each sample in the minibatch
+            morph::vvec<T> delta_out_b;
+            //! The desired outputs of the network for each sample in the minibatch
+            morph::vvec<T> desiredOutput_b;
         };
 
         template <typename T>
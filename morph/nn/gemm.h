@@ -0,0 +1,133 @@
+/*!
+ * \file
+ *
+ * Simple, cache-blocked and OpenMP-parallel dense matrix multiplications for the
+ * minibatch code paths in FeedForwardConn and FeedForwardNet. Matrices are stored
+ * row-major in contiguous memory (usually the data of a morph::vvec<T>).
+ *
+ * Each function computes C = alpha * op(A) * op(B) + beta * C where C is M x N. If beta
+ * is 0, C is overwritten (and need not be initialised). The functions don't allocate
+ * memory.
+ *
+ * \date October 2026
+ */
+#pragma once
+
+namespace morph {
+    namespace nn {
+        namespace gemm {
+
+            //! Rows of C processed per (parallel) block
+            constexpr int block_rows = 16;
+            //! Size of the inner (summed) dimension processed per block, chosen so that a
+            //! block of A and B rows stays in L1/L2 cache
+            constexpr int block_inner = 256;
+
+            //! Scale rows [i0, i1) of the M x N matrix C by beta
+            template <typename T>
+            void scale_rows (int i0, int i1, int N, T beta, T* C)
+            {
+                for (int i = i0; i < i1; ++i) {
+                    T* Ci = C + static_cast<long long int>(i) * N;
+                    if (beta == T{0}) {
+                        for (int j = 0; j < N; ++j) { Ci[j] = T{0}; }
+                    } else if (beta != T{1}) {
+                        for (int j = 0; j < N; ++j) { Ci[j] *= beta; }
+                    }
+                }
+            }
+
+            /*!
+             * C = alpha * A * B^T + beta * C, where A is M x K and B is N x K. Both A and B
+             * are traversed along contiguous rows, so each element of C is a dot product
+             * of two contiguous vectors.
+             */
+            template <typename T>
+            void nt (int M, int N, int K, T alpha, const T* A, const T* B, T beta, T* C)
+            {
+                const int nblocks = (M + block_rows - 1) / block_rows;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (int ib = 0; ib < nblocks; ++ib) {
+                    const int i0 = ib * block_rows;
+                    const int i1 = (i0 + block_rows) < M ? (i0 + block_rows) : M;
+                    scale_rows (i0, i1, N, beta, C);
+                    for (int k0 = 0; k0 < K; k0 += block_inner) {
+                        const int k1 = (k0 + block_inner) < K ? (k0 + block_inner) : K;
+                        for (int j = 0; j < N; ++j) {
+                            const T* Bj = B + static_cast<long long int>(j) * K;
+                            for (int i = i0; i < i1; ++i) {
+                                const T* Ai = A + static_cast<long long int>(i) * K;
+                                T s = T{0};
+#ifdef _OPENMP
+#pragma omp simd reduction(+:s)
+#endif
+                                for (int k = k0; k < k1; ++k) { s += Ai[k] * Bj[k]; }
+                                C[static_cast<long long int>(i) * N + j] += alpha * s;
+                            }
+                        }
+                    }
+                }
+            }
+
+            //! C = alpha * A * B + beta * C, where A is M x K and B is K x N.
+            template <typename T>
+            void nn (int M, int N, int K, T alpha, const T* A, const T* B, T beta, T* C)
+            {
+                const int nblocks = (M + block_rows - 1) / block_rows;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (int ib = 0; ib < nblocks; ++ib) {
+                    const int i0 = ib * block_rows;
+                    const int i1 = (i0 + block_rows) < M ? (i0 + block_rows) : M;
+                    scale_rows (i0, i1, N, beta, C);
+                    for (int k0 = 0; k0 < K; k0 += block_inner) {
+                        const int k1 = (k0 + block_inner) < K ? (k0 + block_inner) : K;
+                        for (int i = i0; i < i1; ++i) {
+                            T* Ci = C + static_cast<long long int>(i) * N;
+                            const T* Ai = A + static_cast<long long int>(i) * K;
+                            for (int k = k0; k < k1; ++k) {
+                                const T a = alpha * Ai[k];
+                                const T* Bk = B + static_cast<long long int>(k) * N;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                                for (int j = 0; j < N; ++j) { Ci[j] += a * Bk[j]; }
+                            }
+                        }
+                    }
+                }
+            }
+
+            //! C = alpha * A^T * B + beta * C, where A is K x M and B is K x N.
+            template <typename T>
+            void tn (int M, int N, int K, T alpha, const T* A, const T* B, T beta, T* C)
+            {
+                const int nblocks = (M + block_rows - 1) / block_rows;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (int ib = 0; ib < nblocks; ++ib) {
+                    const int i0 = ib * block_rows;
+                    const int i1 = (i0 + block_rows) < M ? (i0 + block_rows) : M;
+                    scale_rows (i0, i1, N, beta, C);
+                    for (int k = 0; k < K; ++k) {
+                        const T* Ak = A + static_cast<long long int>(k) * M;
+                        const T* Bk = B + static_cast<long long int>(k) * N;
+                        for (int i = i0; i < i1; ++i) {
+                            const T a = alpha * Ak[i];
+                            T* Ci = C + static_cast<long long int>(i) * N;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                            for (int j = 0; j < N; ++j) { Ci[j] += a * Bk[j]; }
+                        }
+                    }
+                }
+            }
+
+        } // namespace gemm
+    } // namespace nn
+} // namespace morph
@@ -0,0 +1,262 @@
+/*!
+ * \file
+ *
+ * Kernels which apply a 4x4 transformation matrix (column major, as in
+ * morph::TransformMatrix::mat) to many points at once, and which compose two 4x4 matrices.
+ * TransformMatrix and Quaternion provide the user-facing batch APIs; these are the loops
+ * behind them.
+ *
+ * For float data on x86 the kernels use SSE (and AVX for the structure-of-arrays kernel, if
+ * the compiler targets it, e.g. with -march=native or -mavx). The matrix columns (or elements)
+ * are loaded into registers once, before the loop over the points. The sums are evaluated in
+ * the same order as in TransformMatrix's operator*, so results differ from it at most by the
+ * rounding of any multiply-adds that the compiler fuses. Other types, and non-x86 builds, use
+ * the scalar loops, which the compiler is free to vectorize.
+ *
+ * \date 2026
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE__) || defined(_M_X64)
+# include <immintrin.h>
+# define MORPH_SIMD_TRANSFORM_SSE 1
+#endif
+
+namespace morph {
+    namespace simd_transform {
+
+        static_assert (sizeof (vec<float, 3>) == 3 * sizeof (float), "vec<float, 3> must be three packed floats");
+        static_assert (sizeof (vec<float, 4>) == 4 * sizeof (float), "vec<float, 4> must be four packed floats");
+
+        //! Points per OpenMP thread's share of work in blocked()
+        constexpr std::size_t block_size = 65536;
+
+        /*!
+         * Call f(i0, count) over [0, n) in blocks of block_size, in parallel with OpenMP. Short
+         * runs are done on the calling thread. The kernels below are memory bound for large
+         * point clouds, so spreading them over cores is where most of the remaining speed is.
+         */
+        template <typename F>
+        void blocked (const std::size_t n, F f)
+        {
+            if (n < 2 * block_size) {
+                f (std::size_t{0}, n);
+                return;
+            }
+            const long long nb = static_cast<long long>((n + block_size - 1) / block_size);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (long long b = 0; b < nb; ++b) {
+                const std::size_t i0 = static_cast<std::size_t>(b) * block_size;
+                f (i0, std::min (block_size, n - i0));
+            }
+        }
+
+        //! r = a * b for column major 4x4 matrices a, b and r. r may be a or b.
+        template <typename Flt>
+        void mat4_mul (const Flt* a, const Flt* b, Flt* r)
+        {
+#ifdef MORPH_SIMD_TRANSFORM_SSE
+            if constexpr (std::is_same_v<Flt, float>) {
+                // The columns of a stay in registers; each column of r is a weighted sum of them
+                const __m128 a0 = _mm_loadu_ps (a);
+                const __m128 a1 = _mm_loadu_ps (a + 4);
+                const __m128 a2 = _mm_loadu_ps (a + 8);
+                const __m128 a3 = _mm_loadu_ps (a + 12);
+                // Read all of b before writing r, which may alias it
+                const __m128 b0 = _mm_loadu_ps (b);
+                const __m128 b1 = _mm_loadu_ps (b + 4);
+                const __m128 b2 = _mm_loadu_ps (b + 8);
+                const __m128 b3 = _mm_loadu_ps (b + 12);
+                // Column j of r is sum_k a_k * b[4j+k], summed left to right as in the scalar loop
+                auto col = [a0, a1, a2, a3](const __m128 bj) {
+                    __m128 s = _mm_add_ps (_mm_mul_ps (a0, _mm_shuffle_ps (bj, bj, 0x00)),
+                                           _mm_mul_ps (a1, _mm_shuffle_ps (bj, bj, 0x55)));
+                    s = _mm_add_ps (s, _mm_mul_ps (a2, _mm_shuffle_ps (bj, bj, 0xaa)));
+                    return _mm_add_ps (s, _mm_mul_ps (a3, _mm_shuffle_ps (bj, bj, 0xff)));
+                };
+                _mm_storeu_ps (r, col (b0));
+                _mm_storeu_ps (r + 4, col (b1));
+                _mm_storeu_ps (r + 8, col (b2));
+                _mm_storeu_ps (r + 12, col (b3));
+                return;
+            }
+#endif
+            Flt rs[16];
+            for (int j = 0; j < 4; ++j) {
+                for (int i = 0; i < 4; ++i) {
+                    rs[4*j+i] = a[i] * b[4*j] + a[4+i] * b[4*j+1] + a[8+i] * b[4*j+2] + a[12+i] * b[4*j+3];
+                }
+            }
+            for (int k = 0; k < 16; ++k) { r[k] = rs[k]; }
+        }
+
+        //! out[i] = (m * (in[i], 1)).xyz for n points. out may be in.
+        template <typename Flt>
+        void points3 (const Flt* m, const vec<Flt, 3>* in, vec<Flt, 3>* out, const std::size_t n)
+        {
+#ifdef MORPH_SIMD_TRANSFORM_SSE
+            if constexpr (std::is_same_v<Flt, float>) {
+                const __m128 c0 = _mm_loadu_ps (m);
+                const __m128 c1 = _mm_loadu_ps (m + 4);
+                const __m128 c2 = _mm_loadu_ps (m + 8);
+                const __m128 c3 = _mm_loadu_ps (m + 12);
+                const float* pi = reinterpret_cast<const float*>(in);
+                float* po = reinterpret_cast<float*>(out);
+                for (std::size_t i = 0; i < n; ++i, pi += 3, po += 3) {
+                    __m128 s = _mm_add_ps (_mm_mul_ps (c0, _mm_set1_ps (pi[0])), _mm_mul_ps (c1, _mm_set1_ps (pi[1])));
+                    s = _mm_add_ps (_mm_add_ps (s, _mm_mul_ps (c2, _mm_set1_ps (pi[2]))), c3);
+                    // Store exactly three floats, so that out may alias in
+                    _mm_storel_pi (reinterpret_cast<__m64*>(po), s);
+                    _mm_store_ss (po + 2, _mm_movehl_ps (s, s));
+                }
+                return;
+            }
+#endif
+            for (std::size_t i = 0; i < n; ++i) {
+                const Flt x = in[i][0];
+                const Flt y = in[i][1];
+                const Flt z = in[i][2];
+                out[i][0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+                out[i][1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+                out[i][2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+            }
+        }
+
+        //! out[i] = m * (in[i], 1) for n points
+        template <typename Flt>
+        void points3to4 (const Flt* m, const vec<Flt, 3>* in, vec<Flt, 4>* out, const std::size_t n)
+        {
+#ifdef MORPH_SIMD_TRANSFORM_SSE
+            if constexpr (std::is_same_v<Flt, float>) {
+                const __m128 c0 = _mm_loadu_ps (m);
+                const __m128 c1 = _mm_loadu_ps (m + 4);
+                const __m128 c2 = _mm_loadu_ps (m + 8);
+                const __m128 c3 = _mm_loadu_ps (m + 12);
+                const float* pi = reinterpret_cast<const float*>(in);
+                float* po = reinterpret_cast<float*>(out);
+                for (std::size_t i = 0; i < n; ++i, pi += 3, po += 4) {
+                    __m128 s = _mm_add_ps (_mm_mul_ps (c0, _mm_set1_ps (pi[0])), _mm_mul_ps (c1, _mm_set1_ps (pi[1])));
+                    s = _mm_add_ps (_mm_add_ps (s, _mm_mul_ps (c2, _mm_set1_ps (pi[2]))), c3);
+                    _mm_storeu_ps (po, s);
+                }
+                return;
+            }
+#endif
+            for (std::size_t i = 0; i < n; ++i) {
+                const Flt x = in[i][0];
+                const Flt y = in[i][1];
+                const Flt z = in[i][2];
+                out[i][0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+                out[i][1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+                out[i][2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+                out[i][3] = m[3] * x + m[7] * y + m[11] * z + m[15];
+            }
+        }
+
+        //! out[i] = m * in[i] for n homogeneous points. out may be in.
+        template <typename Flt>
+        void points4 (const Flt* m, const vec<Flt, 4>* in, vec<Flt, 4>* out, const std::size_t n)
+        {
+#ifdef MORPH_SIMD_TRANSFORM_SSE
+            if constexpr (std::is_same_v<Flt, float>) {
+                const __m128 c0 = _mm_loadu_ps (m);
+                const __m128 c1 = _mm_loadu_ps (m + 4);
+                const __m128 c2 = _mm_loadu_ps (m + 8);
+                const __m128 c3 = _mm_loadu_ps (m + 12);
+                const float* pi = reinterpret_cast<const float*>(in);
+                float* po = reinterpret_cast<float*>(out);
+                for (std::size_t i = 0; i < n; ++i, pi += 4, po += 4) {
+                    __m128 s = _mm_add_ps (_mm_mul_ps (c0, _mm_set1_ps (pi[0])), _mm_mul_ps (c1, _mm_set1_ps (pi[1])));
+                    s = _mm_add_ps (s, _mm_mul_ps (c2, _mm_set1_ps (pi[2])));
+                    s = _mm_add_ps (s, _mm_mul_ps (c3, _mm_set1_ps (pi[3])));
+                    _mm_storeu_ps (po, s);
+                }
+                return;
+            }
+#endif
+            for (std::size_t i = 0; i < n; ++i) {
+                const Flt x = in[i][0];
+                const Flt y = in[i][1];
+                const Flt z = in[i][2];
+                const Flt w = in[i][3];
+                out[i][0] = m[0] * x + m[4] * y + m[8] * z + m[12] * w;
+                out[i][1] = m[1] * x + m[5] * y + m[9] * z + m[13] * w;
+                out[i][2] = m[2] * x + m[6] * y + m[10] * z + m[14] * w;
+                out[i][3] = m[3] * x + m[7] * y + m[11] * z + m[15] * w;
+            }
+        }
+
+        /*!
+         * The structure-of-arrays version of points3: (xo, yo, zo)[i] = (m * (xi, yi, zi, 1)[i]).xyz
+         * for n points. The outputs may be the inputs. Each of the twelve matrix elements that
+         * are needed is broadcast into its own register and 8 (AVX) or 4 (SSE) points are
+         * transformed per iteration.
+         */
+        template <typename Flt>
+        void points_soa (const Flt* m, const Flt* xi, const Flt* yi, const Flt* zi,
+                         Flt* xo, Flt* yo, Flt* zo, const std::size_t n)
+        {
+            std::size_t i = 0;
+#ifdef MORPH_SIMD_TRANSFORM_SSE
+            if constexpr (std::is_same_v<Flt, float>) {
+# ifdef __AVX__
+                const __m256 m0 = _mm256_set1_ps (m[0]), m4 = _mm256_set1_ps (m[4]), m8 = _mm256_set1_ps (m[8]), m12 = _mm256_set1_ps (m[12]);
+                const __m256 m1 = _mm256_set1_ps (m[1]), m5 = _mm256_set1_ps (m[5]), m9 = _mm256_set1_ps (m[9]), m13 = _mm256_set1_ps (m[13]);
+                const __m256 m2 = _mm256_set1_ps (m[2]), m6 = _mm256_set1_ps (m[6]), m10 = _mm256_set1_ps (m[10]), m14 = _mm256_set1_ps (m[14]);
+                const std::size_t nv = n & ~std::size_t{7}; // whole blocks of 8
+                for (; i < nv; i += 8) {
+                    const __m256 x = _mm256_loadu_ps (xi + i);
+                    const __m256 y = _mm256_loadu_ps (yi + i);
+                    const __m256 z = _mm256_loadu_ps (zi + i);
+                    __m256 rx = _mm256_add_ps (_mm256_mul_ps (m0, x), _mm256_mul_ps (m4, y));
+                    __m256 ry = _mm256_add_ps (_mm256_mul_ps (m1, x), _mm256_mul_ps (m5, y));
+                    __m256 rz = _mm256_add_ps (_mm256_mul_ps (m2, x), _mm256_mul_ps (m6, y));
+                    rx = _mm256_add_ps (_mm256_add_ps (rx, _mm256_mul_ps (m8, z)), m12);
+                    ry = _mm256_add_ps (_mm256_add_ps (ry, _mm256_mul_ps (m9, z)), m13);
+                    rz = _mm256_add_ps (_mm256_add_ps (rz, _mm256_mul_ps (m10, z)), m14);
+                    _mm256_storeu_ps (xo + i, rx);
+                    _mm256_storeu_ps (yo + i, ry);
+                    _mm256_storeu_ps (zo + i, rz);
+                }
+# else
+                const __m128 m0 = _mm_set1_ps (m[0]), m4 = _mm_set1_ps (m[4]), m8 = _mm_set1_ps (m[8]), m12 = _mm_set1_ps (m[12]);
+                const __m128 m1 = _mm_set1_ps (m[1]), m5 = _mm_set1_ps (m[5]), m9 = _mm_set1_ps (m[9]), m13 = _mm_set1_ps (m[13]);
+                const __m128 m2 = _mm_set1_ps (m[2]), m6 = _mm_set1_ps (m[6]), m10 = _mm_set1_ps (m[10]), m14 = _mm_set1_ps (m[14]);
+                const std::size_t nv = n & ~std::size_t{3}; // whole blocks of 4
+                for (; i < nv; i += 4) {
+                    const __m128 x = _mm_loadu_ps (xi + i);
+                    const __m128 y = _mm_loadu_ps (yi + i);
+                    const __m128 z = _mm_loadu_ps (zi + i);
+                    __m128 rx = _mm_add_ps (_mm_mul_ps (m0, x), _mm_mul_ps (m4, y));
+                    __m128 ry = _mm_add_ps (_mm_mul_ps (m1, x), _mm_mul_ps (m5, y));
+                    __m128 rz = _mm_add_ps (_mm_mul_ps (m2, x), _mm_mul_ps (m6, y));
+                    rx = _mm_add_ps (_mm_add_ps (rx, _mm_mul_ps (m8, z)), m12);
+                    ry = _mm_add_ps (_mm_add_ps (ry, _mm_mul_ps (m9, z)), m13);
+                    rz = _mm_add_ps (_mm_add_ps (rz, _mm_mul_ps (m10, z)), m14);
+                    _mm_storeu_ps (xo + i, rx);
+                    _mm_storeu_ps (yo + i, ry);
+                    _mm_storeu_ps (zo + i, rz);
+                }
+# endif
+            }
+#endif
+            // The scalar loop does the remainder (or everything, if there's no SIMD path)
+            for (; i < n; ++i) {
+                const Flt x = xi[i];
+                const Flt y = yi[i];
+                const Flt z = zi[i];
+                xo[i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+                yo[i] = m[1] * x + m[5] * y + m[9] * z + m[13];
+                zo[i] = m[2] * x + m[6] * y + m[10] * z + m[14];
+            }
+        }
+
+    } // namespace simd_transform
+} // namespace morph
@@ -0,0 +1,241 @@
+/*!
+ * \file
+ *
+ * A single pass, SAX-style scanner for XML text held in memory. No document tree is built;
+ * instead the scanner calls back for each start tag and each end tag. Element names and
+ * attribute values are passed as std::string_views into the text, so scanning allocates
+ * nothing per element. It understands enough XML for SVG files written by Inkscape and
+ * Illustrator: the declaration, comments, processing instructions, DOCTYPE (with an internal
+ * subset), CDATA, self-closing tags and single or double quoted attribute values. Text content
+ * is skipped.
+ *
+ * \date 2026
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+    namespace xml_sax {
+
+        //! One attribute of an element. value is the raw text between the quotes.
+        struct attribute
+        {
+            std::string_view name;
+            std::string_view value;
+        };
+
+        //! A start tag, as passed to the start callback of scan()
+        struct element
+        {
+            //! The tag name, including any namespace prefix, e.g. "path" or "sodipodi:namedview"
+            std::string_view name;
+            //! The attributes in document order
+            const std::vector<attribute>* attributes = nullptr;
+            //! The nesting depth. The document's root element has depth 0.
+            unsigned int depth = 0;
+
+            //! Return the attribute called n, or nullptr if there is no such attribute
+            const attribute* find (std::string_view n) const
+            {
+                for (const attribute& a : *this->attributes) { if (a.name == n) { return &a; } }
+                return nullptr;
+            }
+            //! The raw value of attribute n, or an empty string_view if there is no such attribute
+            std::string_view value (std::string_view n) const
+            {
+                const attribute* a = this->find (n);
+                return a == nullptr ? std::string_view{} : a->value;
+            }
+        };
+
+        //! Replace the entity and character references (&amp; &#x41; etc) in s
+        inline std::string unescape (std::string_view s)
+        {
+            std::string out;
+            out.reserve (s.size());
+            std::size_t i = 0;
+            while (i < s.size()) {
+                std::size_t amp = s.find ('&', i);
+                if (amp == std::string_view::npos) { out.append (s.substr (i)); break; }
+                out.append (s.substr (i, amp - i));
+                std::size_t semi = s.find (';', amp);
+                if (semi == std::string_view::npos) { out.append (s.substr (amp)); break; }
+                std::string_view ent = s.substr (amp + 1, semi - amp - 1);
+                if (ent == "amp") { out += '&'; }
+                else if (ent == "lt") { out += '<'; }
+                else if (ent == "gt") { out += '>'; }
+                else if (ent == "quot") { out += '"'; }
+                else if (ent == "apos") { out += '\''; }
+                else if (ent.size() > 1 && ent[0] == '#') {
+                    // A character reference; written out as UTF-8
+                    std::uint32_t cp = 0;
+                    bool hex = (ent[1] == 'x' || ent[1] == 'X');
+                    for (std::size_t j = hex ? 2 : 1; j < ent.size(); ++j) {
+                        char c = ent[j];
+                        if (c >= '0' && c <= '9') { cp = cp * (hex ? 16 : 10) + static_cast<std::uint32_t>(c - '0'); }
+                        else if (hex && c >= 'a' && c <= 'f') { cp = cp * 16 + static_cast<std::uint32_t>(c - 'a' + 10); }
+                        else if (hex && c >= 'A' && c <= 'F') { cp = cp * 16 + static_cast<std::uint32_t>(c - 'A' + 10); }
+                    }
+                    if (cp < 0x80) {
+                        out += static_cast<char>(cp);
+                    } else if (cp < 0x800) {
+                        out += static_cast<char>(0xc0 | (cp >> 6));
+                        out += static_cast<char>(0x80 | (cp & 0x3f));
+                    } else if (cp < 0x10000) {
+                        out += static_cast<char>(0xe0 | (cp >> 12));
+                        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                        out += static_cast<char>(0x80 | (cp & 0x3f));
+                    } else {
+                        out += static_cast<char>(0xf0 | (cp >> 18));
+                        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+                        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                        out += static_cast<char>(0x80 | (cp & 0x3f));
+                    }
+                } else {
+                    // Not an entity that we know; leave it as it was
+                    out.append (s.substr (amp, semi - amp + 1));
+                }
+                i = semi + 1;
+            }
+            return out;
+        }
+
+        //! Unescape s only if it contains a '&', otherwise copy it
+        inline std::string to_string (std::string_view s)
+        {
+            return s.find ('&') == std::string_view::npos ? std::string (s) : unescape (s);
+        }
+
+        //! Throw a std::runtime_error saying what went wrong and where
+        [[noreturn]] inline void fail (const char* what, std::size_t pos)
+        {
+            std::stringstream ee;
+            ee << "xml_sax: " << what << " at character " << pos;
+            throw std::runtime_error (ee.str());
+        }
+
+        constexpr bool is_space (char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+        /*!
+         * Scan the XML in text from start to end. For each start tag, on_start (const element&)
+         * is called. For each end tag, on_end (std::string_view name, unsigned int depth) is
+         * called, with the same depth as the matching start. A self-closing tag gives on_start
+         * then on_end. Throws std::runtime_error if the markup is malformed.
+         */
+        template <typename StartFn, typename EndFn>
+        void scan (std::string_view text, StartFn&& on_start, EndFn&& on_end)
+        {
+            std::vector<attribute> attrs;
+            unsigned int depth = 0;
+            const std::size_t n = text.size();
+            std::size_t i = 0;
+
+            // Advance i past the next occurrence of term, which must exist
+            auto skip_past = [&text, &i](std::string_view term, const char* what)
+            {
+                std::size_t e = text.find (term, i);
+                if (e == std::string_view::npos) { fail (what, i); }
+                i = e + term.size();
+            };
+            // Read a name (tag or attribute) starting at i
+            auto read_name = [&text, &i, n]()
+            {
+                std::size_t s = i;
+                while (i < n && !is_space (text[i]) && text[i] != '>' && text[i] != '/' && text[i] != '=') { ++i; }
+                return text.substr (s, i - s);
+            };
+            auto skip_space = [&text, &i, n]() { while (i < n && is_space (text[i])) { ++i; } };
+
+            while (i < n) {
+                // Text content is skipped
+                std::size_t lt = text.find ('<', i);
+                if (lt == std::string_view::npos) { break; }
+                i = lt + 1;
+                if (i >= n) { fail ("unterminated tag", lt); }
+
+                if (text[i] == '?') { // declaration or processing instruction
+                    skip_past ("?>", "unterminated processing instruction");
+
+                } else if (text[i] == '!') {
+                    if (text.compare (i, 3, "!--") == 0) {
+                        i += 3;
+                        skip_past ("-->", "unterminated comment");
+                    } else if (text.compare (i, 8, "![CDATA[") == 0) {
+                        i += 8;
+                        skip_past ("]]>", "unterminated CDATA section");
+                    } else { // <!DOCTYPE ... [ internal subset ] >
+                        int brackets = 0;
+                        char quote = '\0';
+                        for (++i; i < n; ++i) {
+                            char c = text[i];
+                            if (quote != '\0') { if (c == quote) { quote = '\0'; } }
+                            else if (c == '"' || c == '\'') { quote = c; }
+                            else if (c == '[') { ++brackets; }
+                            else if (c == ']') { --brackets; }
+                            else if (c == '>' && brackets <= 0) { break; }
+                        }
+                        if (i >= n) { fail ("unterminated <! declaration", lt); }
+                        ++i;
+                    }
+
+                } else if (text[i] == '/') { // end tag
+                    ++i;
+                    std::string_view name = read_name();
+                    skip_past (">", "unterminated end tag");
+                    if (depth == 0) { fail ("unmatched end tag", lt); }
+                    --depth;
+                    on_end (name, depth);
+
+                } else { // start tag
+                    element e;
+                    e.name = read_name();
+                    if (e.name.empty()) { fail ("empty tag name", lt); }
+                    e.depth = depth;
+                    attrs.clear();
+                    bool self_closing = false;
+                    for (;;) {
+                        skip_space();
+                        if (i >= n) { fail ("unterminated start tag", lt); }
+                        if (text[i] == '>') { ++i; break; }
+                        if (text[i] == '/') {
+                            if (i + 1 >= n || text[i + 1] != '>') { fail ("expected '>' after '/'", i); }
+                            i += 2;
+                            self_closing = true;
+                            break;
+                        }
+                        attribute a;
+                        a.name = read_name();
+                        if (a.name.empty()) { fail ("malformed attribute", i); }
+                        skip_space();
+                        if (i >= n || text[i] != '=') { fail ("expected '=' after attribute name", i); }
+                        ++i;
+                        skip_space();
+                        if (i >= n || (text[i] != '"' && text[i] != '\'')) { fail ("expected a quoted attribute value", i); }
+                        const char quote = text[i++];
+                        std::size_t close = text.find (quote, i);
+                        if (close == std::string_view::npos) { fail ("unterminated attribute value", i); }
+                        a.value = text.substr (i, close - i);
+                        i = close + 1;
+                        attrs.push_back (a);
+                    }
+                    e.attributes = &attrs;
+                    on_start (e);
+                    if (self_closing) {
+                        on_end (e.name, depth);
+                    } else {
+                        ++depth;
+                    }
+                }
+            }
+            if (depth != 0) { fail ("unclosed elements at end of text", n); }
+        }
+
+    } // namespace xml_sax
+} // namespace morph
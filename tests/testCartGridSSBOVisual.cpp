@@ -0,0 +1,144 @@
+/*
+ * Test CartGridSSBOVisual, which draws data straight from an SSBO that a compute shader
+ * writes. Renders in a headless (EGL) OpenGL 4.5 context (Mesa's llvmpipe will do) and checks
+ * the colours of the rendered pixels against the colour map.
+ */
+
+#define OWNED_MODE 1
+namespace morph { using win_t = void; }
+#include <morph/gl/headless.h>
+#include <morph/Visual.h>
+#include <morph/CartGrid.h>
+#include <morph/CartGridSSBOVisual.h>
+#include <morph/gl/compute_shaderprog.h>
+#include <morph/gl/ssbo.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// data[i] = a for the left half of the grid, b for the right half. The grid is w elements wide.
+const char* compute_src = "#version 450\n"
+    "layout (local_size_x = 64) in;\n"
+    "layout (std430, binding = 1) buffer DataBlock { float data[]; };\n"
+    "uniform uint n;\n"
+    "uniform uint w;\n"
+    "uniform float a;\n"
+    "uniform float b;\n"
+    "void main()\n"
+    "{\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if (i < n) { data[i] = (i % w) < w / 2u ? a : b; }\n"
+    "}\n";
+
+static constexpr int width = 200;
+static constexpr int height = 200;
+
+// The colour of the pixel at x, y in the rendered image
+std::array<int, 3> pixel (int x, int y)
+{
+    std::array<std::uint8_t, 4> p = {0, 0, 0, 0};
+    glReadPixels (x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, p.data());
+    return { p[0], p[1], p[2] };
+}
+
+// Is pixel (x, y) the colour that cm gives for t?
+bool is_colour (const morph::ColourMap<float>& cm, float t, int x, int y)
+{
+    std::array<float, 3> c = cm.convert (t);
+    std::array<int, 3> p = pixel (x, y);
+    for (unsigned int j = 0; j < 3; ++j) {
+        if (std::abs (p[j] - static_cast<int>(std::round (c[j] * 255.0f))) > 2) {
+            std::cerr << "Pixel (" << x << "," << y << ") is " << p[0] << "," << p[1] << "," << p[2]
+                      << "; expected the colour for " << t << ": " << c[0] * 255.0f << "," << c[1] * 255.0f << "," << c[2] * 255.0f << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    int rtn = 0;
+    try {
+        morph::gl::headless<morph::gl::version_4_5> ctx (width, height);
+        morph::Visual<morph::gl::version_4_5> v;
+        v.set_winsize (width, height);
+        v.init (nullptr);
+        v.showCoordArrows = false;
+        v.showTitle = false;
+        v.setSceneTransZ (-1.0f); // The grid fills the view
+
+        morph::CartGrid cg (0.01f, 0.01f, 2.0f, 2.0f);
+        cg.setBoundaryOnOuterEdge();
+        const unsigned int n = cg.num();
+        const unsigned int w = static_cast<unsigned int>(cg.widthnum());
+
+        // The data live only on the GPU
+        morph::vvec<float> zeros (n, 0.0f);
+        unsigned int data_name = 0;
+        morph::gl::setup_ssbo (1, data_name, zeros);
+
+        morph::gl::compute_shaderprog<morph::gl::version_4_5> prog;
+        prog.load_shaders ({ { GL_COMPUTE_SHADER, "", compute_src, 0 } });
+
+        morph::vec<float> offset = { 0.0f, 0.0f, 0.0f };
+        auto gv = std::make_unique<morph::CartGridSSBOVisual<morph::gl::version_4_5>> (&cg, offset);
+        v.bindmodel (gv);
+        gv->setBuffer (data_name);
+        gv->cm.setType (morph::ColourMapType::Viridis);
+        gv->colourScale.compute_autoscale (0.0f, 2.0f);
+        gv->finalize();
+        auto gvp = v.addVisualModel (gv);
+
+        auto compute = [&](float a, float b) {
+            prog.use();
+            prog.set_uniform ("n", n);
+            prog.set_uniform ("w", w);
+            prog.set_uniform ("a", a);
+            prog.set_uniform ("b", b);
+            prog.dispatch ((n + 63) / 64, 1, 1);
+        };
+        const int xl = width / 4;
+        const int xr = 3 * width / 4;
+        const int y = height / 2;
+
+        compute (0.5f, 1.5f);
+        v.render();
+        ctx.resolve();
+        if (!is_colour (gvp->cm, 0.25f, xl, y) || !is_colour (gvp->cm, 0.75f, xr, y)) { --rtn; }
+        ctx.bind();
+
+        // New data in the buffer are shown with no upload from the CPU
+        compute (2.0f, 0.0f);
+        v.render();
+        ctx.resolve();
+        if (!is_colour (gvp->cm, 1.0f, xl, y) || !is_colour (gvp->cm, 0.0f, xr, y)) { --rtn; }
+        ctx.bind();
+
+        // A change of colour map is picked up at the next render
+        gvp->cm.setType (morph::ColourMapType::Greyscale);
+        v.render();
+        ctx.resolve();
+        if (!is_colour (gvp->cm, 1.0f, xl, y) || !is_colour (gvp->cm, 0.0f, xr, y)) { --rtn; }
+        ctx.bind();
+
+        // A scale that would have to autoscale is an error
+        gvp->colourScale.reset();
+        gvp->colourScale.do_autoscale = true;
+        try {
+            v.render();
+            std::cerr << "Render with an autoscaling colourScale did not throw\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+
+        glDeleteBuffers (1, &data_name);
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
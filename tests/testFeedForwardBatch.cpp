@@ -0,0 +1,99 @@
+/*
+ * Check that the minibatch (matrix multiplication) code path in morph::nn::FeedForwardNet
+ * gives the same outputs, costs and gradients as the per-sample code path.
+ */
+
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+
+    // A network with more than one hidden layer, and layer sizes which are not multiples
+    // of the gemm block sizes
+    std::vector<unsigned int> layer_spec = {37, 21, 9, 4};
+    morph::nn::FeedForwardNet<double> ff (layer_spec);
+
+    constexpr unsigned int batch = 19;
+    std::vector<morph::vvec<double>> ins (batch);
+    std::vector<morph::vvec<double>> outs (batch);
+    for (unsigned int s = 0; s < batch; ++s) {
+        ins[s].resize (layer_spec.front());
+        ins[s].randomize();
+        outs[s].resize (layer_spec.back());
+        outs[s].randomize();
+    }
+
+    // Per-sample path. Accumulate the mean gradients.
+    std::vector<std::vector<morph::vvec<double>>> mean_nabla_ws;
+    std::vector<morph::vvec<double>> mean_nabla_b;
+    for (auto& c : ff.connections) {
+        mean_nabla_ws.push_back (c.nabla_ws);
+        for (auto& nw : mean_nabla_ws.back()) { nw.zero(); }
+        mean_nabla_b.push_back (c.nabla_b);
+        mean_nabla_b.back().zero();
+    }
+    std::vector<morph::vvec<double>> outputs (batch);
+    double mean_cost = 0.0;
+    for (unsigned int s = 0; s < batch; ++s) {
+        ff.setInput (ins[s], outs[s]);
+        ff.feedforward();
+        mean_cost += ff.computeCost() / batch;
+        ff.backprop();
+        outputs[s] = ff.neurons.back();
+        unsigned int ci = 0;
+        for (auto& c : ff.connections) {
+            for (unsigned int i = 0; i < c.nabla_ws.size(); ++i) { mean_nabla_ws[ci][i] += c.nabla_ws[i] / batch; }
+            mean_nabla_b[ci] += c.nabla_b / batch;
+            ++ci;
+        }
+    }
+
+    // Minibatch path
+    ff.setBatchSize (batch);
+    ff.setInputBatch (ins, outs);
+    ff.feedforward_batch();
+    double batch_cost = ff.computeCost_batch();
+    ff.backprop_batch();
+
+    constexpr double tol = 1e-12;
+
+    if (std::abs (batch_cost - mean_cost) > tol) {
+        std::cerr << "Cost mismatch: " << batch_cost << " vs " << mean_cost << std::endl;
+        --rtn;
+    }
+
+    const unsigned int n_out = layer_spec.back();
+    for (unsigned int s = 0; s < batch; ++s) {
+        for (unsigned int j = 0; j < n_out; ++j) {
+            if (std::abs (ff.neurons_b.back()[s * n_out + j] - outputs[s][j]) > tol) {
+                std::cerr << "Output mismatch for sample " << s << std::endl;
+                --rtn;
+            }
+        }
+    }
+
+    unsigned int ci = 0;
+    for (auto& c : ff.connections) {
+        for (unsigned int i = 0; i < c.nabla_ws.size(); ++i) {
+            double maxdiff = (c.nabla_ws[i] - mean_nabla_ws[ci][i]).abs().max();
+            if (maxdiff > tol) {
+                std::cerr << "nabla_w mismatch in connection " << ci << ": " << maxdiff << std::endl;
+                --rtn;
+            }
+        }
+        double maxdiff = (c.nabla_b - mean_nabla_b[ci]).abs().max();
+        if (maxdiff > tol) {
+            std::cerr << "nabla_b mismatch in connection " << ci << ": " << maxdiff << std::endl;
+            --rtn;
+        }
+        ++ci;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,144 @@
+/*
+ * Test morph::HexView against the morph::Hexes in HexGrid::hexen, and the ShapeAnalysis
+ * functions which now iterate over HexViews. Also reports the memory footprint per hex.
+ */
+
+#include <morph/HexGrid.h>
+#include <morph/HexView.h>
+#include <morph/ShapeAnalysis.h>
+#include <iostream>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+    hg.setEllipticalBoundary (1.0f, 0.7f);
+    hg.computeDistanceToBoundary();
+    std::cout << "Number of hexes in grid: " << hg.num() << std::endl;
+
+    // Every Hex accessor has its HexView equivalent
+    unsigned int nviews = 0;
+    for (morph::HexView hv : morph::hexviews (hg)) {
+        const morph::Hex& h = *hg.vhexen[hv.vi];
+        ++nviews;
+        if (h.vi != hv.vi || h.di != hv.di()
+            || h.x != hv.x() || h.y != hv.y() || h.ri != hv.ri() || h.gi != hv.gi() || h.bi != hv.bi()
+            || std::abs (h.r - hv.r()) > 1e-6f || std::abs (h.phi - hv.phi()) > 1e-6f
+            || h.position() != hv.position() || h.distToBoundary != hv.distToBoundary()
+            || h.getFlags() != hv.getFlags() || h.onBoundary() != hv.onBoundary()
+            || h.boundaryHex() != hv.boundaryHex() || h.insideBoundary() != hv.insideBoundary()
+            || h.outputRG() != hv.outputRG()) {
+            std::cerr << "HexView " << hv.vi << " differs from its Hex\n";
+            --rtn;
+            break;
+        }
+        for (unsigned short ni = 0; ni < 6; ++ni) {
+            if (h.has_neighbour (ni) != hv.has_neighbour (ni)
+                || (h.has_neighbour (ni) && h.get_neighbour (ni)->vi != hv.get_neighbour (ni).vi)
+                || (h.get_vertex_coord (ni) - hv.get_vertex_coord (ni)).length() > 1e-6f) {
+                std::cerr << "HexView " << hv.vi << " neighbour/vertex " << ni << " differs from its Hex\n";
+                --rtn;
+            }
+        }
+        if (h.has_ne() != hv.has_ne() || (h.has_ne() && h.ne->vi != hv.ne().vi)
+            || h.has_nsw() != hv.has_nsw() || (h.has_nsw() && h.nsw->vi != hv.nsw().vi)) {
+            std::cerr << "HexView " << hv.vi << " named neighbours differ from its Hex\n";
+            --rtn;
+        }
+    }
+    if (nviews != hg.num()) { std::cerr << "hexviews has " << nviews << " views\n"; --rtn; }
+
+    // ShapeAnalysis gives the same contour map as a loop over the Hexes, and fills in the d_
+    // vectors of a grid with no boundary.
+    morph::HexGrid hg2 (0.05f, 2.0f, 0.0f);
+    std::vector<float> f (hg2.num());
+    for (auto h : hg2.hexen) { f[h.vi] = std::sin (6.0f * h.x) * std::cos (4.0f * h.y); }
+    std::vector<float> cmap = morph::ShapeAnalysis<float>::get_contour_map_flag_nonorm (&hg2, f, 0.1f, 1.0f);
+    for (auto h : hg2.hexen) {
+        float expected = 0.0f;
+        if (!h.onBoundary() && f[h.vi] >= 0.1f) {
+            for (unsigned short ni = 0; ni < 6; ++ni) {
+                if (h.has_neighbour (ni) && f[h.get_neighbour (ni)->vi] < 0.1f) { expected = 1.0f; }
+            }
+        }
+        if (cmap[h.vi] != expected) {
+            std::cerr << "Contour map differs at hex " << h.vi << "\n";
+            --rtn;
+            break;
+        }
+    }
+
+    // get_contours on a fresh grid with no boundary (whose vhexen is empty) gives the same hexes
+    // as a loop over the Hexes, and leaves vhexen alone
+    morph::HexGrid hg3 (0.05f, 2.0f, 0.0f);
+    std::vector<std::vector<float>> fields (2, std::vector<float> (hg3.num()));
+    for (auto h : hg3.hexen) {
+        fields[0][h.vi] = std::sin (6.0f * h.x) * std::cos (4.0f * h.y);
+        fields[1][h.vi] = std::cos (3.0f * h.x + 2.0f * h.y);
+    }
+    std::vector<std::list<morph::Hex>> contours = morph::ShapeAnalysis<float>::get_contours (&hg3, fields, 0.6f);
+    if (!hg3.vhexen.empty()) { std::cerr << "get_contours changed vhexen\n"; --rtn; }
+    for (unsigned int i = 0; i < 2; ++i) {
+        float minf = 1e7f;
+        float maxf = -1e7f;
+        for (auto h : hg3.hexen) {
+            if (!h.onBoundary()) {
+                for (unsigned int j = 0; j < 2; ++j) {
+                    minf = std::min (minf, fields[j][h.vi]);
+                    maxf = std::max (maxf, fields[j][h.vi]);
+                }
+            }
+        }
+        auto nf = [&](unsigned int vi) { return (fields[i][vi] - minf) * (1.0f / (maxf - minf)); };
+        std::vector<unsigned int> expected;
+        for (auto h : hg3.hexen) {
+            if (nf (h.vi) < 0.6f) { continue; }
+            bool edge = h.onBoundary();
+            for (unsigned short ni = 0; ni < 6; ++ni) {
+                if (h.has_neighbour (ni) && nf (h.get_neighbour (ni)->vi) < 0.6f) { edge = true; }
+            }
+            if (edge) { expected.push_back (h.vi); }
+        }
+        std::vector<unsigned int> got;
+        for (const morph::Hex& h : contours[i]) { got.push_back (h.vi); }
+        std::cout << "Contour " << i << " has " << got.size() << " hexes" << std::endl;
+        if (got != expected || got.empty()) {
+            std::cerr << "get_contours differs for field " << i << " (" << got.size() << " hexes, expected " << expected.size() << ")\n";
+            --rtn;
+        }
+    }
+
+    // Memory footprint per hex (the Hexes and the d_ vectors are both resident, with or without
+    // HexViews) and the cost of a flags-and-neighbours sweep over each
+    std::cout << "Bytes per hex: Hex in hexen (Hex + list node + vhexen pointer): "
+              << morph::HexView::hex_bytes_per_hex << "; d_ vectors: " << morph::HexView::hot_bytes_per_hex
+              << "; resident in total: " << morph::HexView::resident_bytes_per_hex << std::endl;
+
+    constexpr unsigned int reps = 20;
+    unsigned int count_hex = 0;
+    unsigned int count_view = 0;
+    auto t0 = steady_clock::now();
+    for (unsigned int i = 0; i < reps; ++i) {
+        for (const morph::Hex& h : hg.hexen) { if (!h.onBoundary() && h.has_ne() && h.ne->boundaryHex()) { ++count_hex; } }
+    }
+    auto t1 = steady_clock::now();
+    for (unsigned int i = 0; i < reps; ++i) {
+        for (morph::HexView h : morph::hexviews (hg)) { if (!h.onBoundary() && h.has_ne() && h.ne().boundaryHex()) { ++count_view; } }
+    }
+    auto t2 = steady_clock::now();
+    if (count_hex != count_view) { std::cerr << "Sweeps disagree\n"; --rtn; }
+    std::cout << "Flags/neighbour sweep: hexen " << duration<double>(t1 - t0).count() * 1e3 / reps
+              << " ms; hexviews " << duration<double>(t2 - t1).count() * 1e3 / reps << " ms" << std::endl;
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
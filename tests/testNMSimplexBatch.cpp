@@ -0,0 +1,109 @@
+/*
+ * Test the lock-step, multi-start driver for the Nelder Mead Simplex algorithm on the Rosenbrock
+ * banana function. Each simplex in the batch should give exactly the same result as the same
+ * simplex run on its own.
+ */
+
+#include "morph/NM_Simplex.h"
+#include "morph/NM_Simplex_batch.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <cmath>
+
+// Here's the Rosenbrock banana function
+FLT banana (const morph::vvec<FLT>& x)
+{
+    FLT a = 1.0;
+    FLT b = 100.0;
+    FLT rtn = ((a-x[0])*(a-x[0])) + (b * (x[1]-(x[0]*x[0])) * (x[1]-(x[0]*x[0])));
+    return rtn;
+}
+
+// Run a single simplex the traditional way
+void run_serial (morph::NM_Simplex<FLT>& simp)
+{
+    while (simp.state != morph::NM_Simplex_State::ReadyToStop) {
+        if (simp.state == morph::NM_Simplex_State::NeedToComputeThenOrder) {
+            for (unsigned int i = 0; i <= simp.n; ++i) { simp.values[i] = banana (simp.vertices[i]); }
+            simp.order();
+        } else if (simp.state == morph::NM_Simplex_State::NeedToOrder) {
+            simp.order();
+        } else if (simp.state == morph::NM_Simplex_State::NeedToComputeReflection) {
+            simp.apply_reflection (banana (simp.xr));
+        } else if (simp.state == morph::NM_Simplex_State::NeedToComputeExpansion) {
+            simp.apply_expansion (banana (simp.xe));
+        } else if (simp.state == morph::NM_Simplex_State::NeedToComputeContraction) {
+            simp.apply_contraction (banana (simp.xc));
+        }
+    }
+}
+
+// Make the initial simplex for start number i
+morph::NM_Simplex<FLT> make_simplex (unsigned int i)
+{
+    FLT off = static_cast<FLT>(i) * FLT{0.3} - FLT{1};
+    morph::vvec<morph::vvec<FLT>> i_vertices;
+    i_vertices.push_back (morph::vvec<FLT>{{ FLT{0.7} + off, FLT{0.0} }});
+    i_vertices.push_back (morph::vvec<FLT>{{ FLT{0.0}, FLT{0.6} - off }});
+    i_vertices.push_back (morph::vvec<FLT>{{ FLT{-0.6} + off, FLT{-1.0} + off }});
+    morph::NM_Simplex<FLT> simp (i_vertices);
+    simp.termination_threshold = std::numeric_limits<FLT>::epsilon();
+    simp.too_many_operations = 10000;
+    return simp;
+}
+
+int main()
+{
+    int rtn = 0;
+    constexpr unsigned int K = 8;
+
+    // Run K simplexes one after the other
+    std::vector<morph::NM_Simplex<FLT>> serial;
+    for (unsigned int i = 0; i < K; ++i) {
+        serial.push_back (make_simplex (i));
+        run_serial (serial.back());
+    }
+
+    // Now run them in lock-step with a scalar objective (evaluated in parallel)
+    morph::NM_Simplex_batch<FLT> batch;
+    for (unsigned int i = 0; i < K; ++i) { batch.add (make_simplex (i)); }
+    batch.run (banana);
+
+    // And with the vectorised objective hook
+    morph::NM_Simplex_batch<FLT> batch2;
+    for (unsigned int i = 0; i < K; ++i) { batch2.add (make_simplex (i)); }
+    batch2.run_batch ([](const morph::vvec<morph::vvec<FLT>>& pts, morph::vvec<FLT>& vals)
+                      {
+                          for (unsigned int i = 0; i < pts.size(); ++i) { vals[i] = banana (pts[i]); }
+                      });
+
+    if (!batch.finished() || !batch2.finished()) {
+        std::cerr << "Batch did not finish\n";
+        --rtn;
+    }
+
+    for (unsigned int i = 0; i < K; ++i) {
+        if (serial[i].best_vertex() != batch.simplexes[i].best_vertex()
+            || serial[i].best_value() != batch.simplexes[i].best_value()
+            || serial[i].operation_count != batch.simplexes[i].operation_count) {
+            std::cerr << "Simplex " << i << ": batched result " << batch.simplexes[i].best_vertex()
+                      << " differs from serial result " << serial[i].best_vertex() << std::endl;
+            --rtn;
+        }
+        if (batch2.simplexes[i].best_vertex() != batch.simplexes[i].best_vertex()) {
+            std::cerr << "Simplex " << i << ": run_batch result differs from run result\n";
+            --rtn;
+        }
+    }
+
+    morph::vvec<FLT> thebest = batch.best_vertex();
+    std::cout << "Best of " << K << " starts after " << batch.rounds << " rounds: (" << thebest
+              << ") has value " << batch.best_value() << std::endl;
+    if (std::abs(thebest[0] - FLT{1}) >= FLT{1e-3} || std::abs(thebest[1] - FLT{1}) >= FLT{1e-3}) {
+        std::cerr << "Best vertex is not near (1,1)\n";
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,83 @@
+/*
+ * Test the ring buffer, percentiles and exports of morph::RenderStats (without any GL; the
+ * timings are fed in as morph::Visual would).
+ */
+
+#include <morph/RenderStats.h>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+    using sc = std::chrono::steady_clock;
+
+    morph::RenderStats rs (10);
+    int model_a = 0;
+    int model_b = 0;
+
+    // 25 frames; only the last 10 are kept. Model a's render takes 1 + (frame % 10) us.
+    for (unsigned int f = 0; f < 25; ++f) {
+        if (f == 3) { rs.record_reinit (&model_b, "", 5.0, 7.0); }
+        rs.begin_frame();
+        sc::time_point t0 = sc::now();
+        std::size_t ma = rs.model (&model_a, "a");
+        rs.record_render (ma, t0, t0 + std::chrono::microseconds (1 + (f % 10)), 100, 300, 1);
+        std::size_t mb = rs.model (&model_b);
+        rs.record_render (mb, t0, t0, 20, 60, 2);
+        // GPU time for model a, arriving one frame late
+        if (f > 0) { rs.set_gpu_time (rs.frame_number() - 1U, ma, 2.0); }
+        rs.end_frame();
+    }
+
+    if (rs.size() != 10U || rs[0].frame != 15U || rs.latest().frame != 24U) {
+        std::cerr << "Ring buffer holds the wrong frames\n";
+        --rtn;
+    }
+    if (rs.latest().vertices != 120U || rs.latest().draw_calls != 3U) {
+        std::cerr << "Frame vertex/draw call totals wrong\n";
+        --rtn;
+    }
+    // Model b was unnamed, so gets a generated name, the same on each frame
+    if (rs[0].models[1].name != rs.latest().models[1].name || rs[0].models[1].name.empty()) {
+        std::cerr << "Unnamed model's label is not stable\n";
+        --rtn;
+    }
+
+    double p50 = rs.percentile (50.0, morph::render_metric::cpu, "a");
+    double p99 = rs.percentile (99.0, morph::render_metric::cpu, "a");
+    if (std::abs (p50 - 5.0) > 1e-6 || std::abs (p99 - 10.0) > 1e-6) {
+        std::cerr << "Model a render time p50 " << p50 << " (expect 5), p99 " << p99 << " (expect 10)\n";
+        --rtn;
+    }
+    // The last frame's GPU time has not arrived yet
+    if (rs.latest().gpu_us >= 0.0 || rs[0].gpu_us != 2.0 || rs.percentile (50.0, morph::render_metric::gpu) != 2.0) {
+        std::cerr << "GPU times recorded wrongly\n";
+        --rtn;
+    }
+    if (rs.percentile (50.0, morph::render_metric::draw_calls) != 3.0) {
+        std::cerr << "Draw call percentile wrong\n";
+        --rtn;
+    }
+    // The reinit at frame 3 has left the buffer
+    if (rs.percentile (100.0, morph::render_metric::reinit) != 0.0) {
+        std::cerr << "Stale reinit time is still in the buffer\n";
+        --rtn;
+    }
+
+    nlohmann::json j = rs.to_json();
+    if (j["frames"].size() != 10U || j["frames"][9]["models"][0]["name"] != "a") {
+        std::cerr << "JSON export is wrong\n";
+        --rtn;
+    }
+    nlohmann::json t = rs.to_chrome_trace();
+    // Per frame: the frame, model a on the CPU, model a on the GPU (except the last frame)
+    if (t["traceEvents"].size() != 10U * 2U + 9U) {
+        std::cerr << "Chrome trace has " << t["traceEvents"].size() << " events\n";
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,176 @@
+/*
+ * Test morph::Sweep: expansion of grid and random designs into config overrides, and a
+ * concurrent run of a small shell script 'simulation' with output streaming, retries,
+ * timeouts and the manifest.
+ */
+
+#include <morph/Sweep.h>
+#include <morph/Config.h>
+#include <nlohmann/json.hpp>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <set>
+#include <filesystem>
+#include <stdexcept>
+
+// The 'simulation': Reads its result directory and parameter x from its -co: arguments,
+// writes x to the result directory and fails (once) if x is 3, (always) if x is 4 and
+// hangs if x is 5.
+const std::string script =
+    "for a in \"$@\"; do case $a in -co:logpath=*) d=${a#-co:logpath=};; -co:x=*) x=${a#-co:x=};; esac; done\n"
+    "echo \"x is $x, OMP_NUM_THREADS is $OMP_NUM_THREADS\"\n"
+    "echo \"to stderr\" >&2\n"
+    "echo $x > $d/result.txt\n"
+    "if [ \"$x\" = 3 ] && [ ! -e $d/tried ]; then touch $d/tried; exit 3; fi\n"
+    "if [ \"$x\" = 4 ]; then exit 4; fi\n"
+    "if [ \"$x\" = 5 ]; then exec sleep 30; fi\n"
+    "exit 0\n";
+
+int main()
+{
+    int rtn = 0;
+
+    // Grid expansion
+    morph::Config gc;
+    gc.root = nlohmann::json::parse (R"({
+        "program" : "/bin/sh",
+        "design" : "grid",
+        "parameters" : { "a" : [ 1, 2, 3 ], "b" : { "min" : 1, "max" : 100, "num" : 3, "log" : true } },
+        "fixed" : { "steps" : 10 }
+    })");
+    morph::Sweep grid (gc);
+    if (grid.runs.size() != 9) {
+        std::cerr << "Grid design gave " << grid.runs.size() << " runs, not 9\n";
+        --rtn;
+    } else {
+        // b varies fastest
+        if (grid.runs[0].overrides.at("a") != "1" || grid.runs[1].overrides.at("b") != "10.0"
+            || grid.runs[8].overrides.at("a") != "3" || grid.runs[8].overrides.at("b") != "100.0") {
+            std::cerr << "Grid design gave the wrong values: " << grid.runs[1].overrides.at("b") << "\n";
+            --rtn;
+        }
+        if (grid.fixed.at("steps") != "10" || grid.runs[3].result_path != "sweep/run_0003") {
+            std::cerr << "Grid design fixed parameters or result path wrong\n";
+            --rtn;
+        }
+    }
+
+    // Random expansion, which is reproducible with a seed and within the ranges
+    morph::Config rc;
+    rc.root = nlohmann::json::parse (R"({
+        "program" : "/bin/sh",
+        "design" : "random",
+        "samples" : 50,
+        "seed" : 7,
+        "parameters" : { "c" : { "min" : 0.5, "max" : 2.0 }, "name" : [ "p", "q" ] }
+    })");
+    morph::Sweep rnd (rc);
+    morph::Sweep rnd2 (rc);
+    std::set<std::string> names;
+    for (unsigned int i = 0; i < rnd.runs.size(); ++i) {
+        double c = std::stod (rnd.runs[i].overrides.at("c"));
+        names.insert (rnd.runs[i].overrides.at("name"));
+        if (c < 0.5 || c > 2.0 || rnd.runs[i].overrides != rnd2.runs[i].overrides) {
+            std::cerr << "Random design sample " << i << " is wrong\n";
+            --rtn;
+            break;
+        }
+    }
+    if (rnd.runs.size() != 50 || names.size() != 2) {
+        std::cerr << "Random design has the wrong number of samples or choices\n";
+        --rtn;
+    }
+
+    // Settings can be overridden, as for any Config
+    rc.config_overrides["samples"] = "5";
+    morph::Sweep rnd3 (rc);
+    if (rnd3.runs.size() != 5) {
+        std::cerr << "Override of samples was not applied\n";
+        --rtn;
+    }
+
+    // A real (if small) sweep
+    const std::string outdir = "testSweep_out";
+    std::filesystem::remove_all (outdir);
+    morph::Config sc;
+    sc.root["program"] = "/bin/sh";
+    sc.root["args"] = { "-c", script, "sim" };
+    sc.root["design"] = "grid";
+    sc.root["parameters"]["x"] = { 1, 2, 3, 4, 5, 6 };
+    sc.root["outdir"] = outdir;
+    sc.root["max_concurrent"] = 3;
+    sc.root["threads_per_run"] = 1;
+    sc.root["retries"] = 1;
+    sc.root["timeout"] = 2.0;
+    morph::Sweep sw (sc);
+
+    unsigned int n_stdout = 0;
+    unsigned int n_finished = 0;
+    sw.on_output = [&n_stdout](const morph::SweepRun&, const std::string& text, bool from_stderr) {
+        if (!from_stderr && text.find ("x is") != std::string::npos) { ++n_stdout; }
+    };
+    sw.on_finished = [&n_finished](const morph::SweepRun&) { ++n_finished; };
+
+    unsigned int n_failed = sw.run();
+    std::cout << "Sweep of " << sw.runs.size() << " runs: " << n_failed << " failed\n";
+    for (const auto& r : sw.runs) {
+        std::cout << "  run " << r.index << " x=" << r.overrides.at("x") << ": " << r.status << ", exit code "
+                  << r.exit_code << ", " << r.attempts << " attempt(s), " << r.attempt_seconds.back() << " s\n";
+    }
+
+    // x=4 fails twice and x=5 times out twice. x=3 fails once, then succeeds.
+    if (n_failed != 2 || sw.runs[3].status != "failed" || sw.runs[3].exit_code != 4
+        || sw.runs[4].status != "timeout" || sw.runs[2].status != "ok" || sw.runs[2].attempts != 2
+        || sw.runs[0].attempts != 1 || sw.runs[3].attempts != 2) {
+        std::cerr << "Sweep outcomes are wrong\n";
+        --rtn;
+    }
+    // One "x is" per attempt: 6 runs + 3 retries
+    if (n_stdout != 9 || n_finished != 6) {
+        std::cerr << "Got " << n_stdout << " stdout chunks and " << n_finished << " finished runs\n";
+        --rtn;
+    }
+
+    // Each run wrote to its result directory, and its output was logged
+    for (const auto& r : sw.runs) {
+        std::ifstream f (r.result_path + "/result.txt");
+        std::string x;
+        f >> x;
+        if (x != r.overrides.at("x")) {
+            std::cerr << "Run " << r.index << " did not get its result path or parameter\n";
+            --rtn;
+        }
+        std::ifstream o (r.stdout_path);
+        std::string line;
+        std::getline (o, line);
+        if (line != "x is " + x + ", OMP_NUM_THREADS is 1") {
+            std::cerr << "Run " << r.index << " stdout log has '" << line << "'\n";
+            --rtn;
+        }
+    }
+
+    // The manifest
+    std::ifstream mf (outdir + "/manifest.json");
+    nlohmann::json m = nlohmann::json::parse (mf);
+    if (m["n_runs"] != 6 || m["n_ok"] != 4 || m["runs"].size() != 6
+        || m["runs"][2]["attempts"] != 2 || m["runs"][4]["status"] != "timeout"
+        || m["runs"][0]["parameters"]["x"] != "1") {
+        std::cerr << "Manifest is wrong:\n" << m.dump (4) << "\n";
+        --rtn;
+    }
+
+    // A non-executable program is an error
+    sc.root["program"] = "/no/such/program";
+    morph::Sweep bad (sc);
+    try {
+        bad.run();
+        std::cerr << "Sweep ran a program that doesn't exist\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::filesystem::remove_all (outdir);
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
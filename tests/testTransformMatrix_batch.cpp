@@ -0,0 +1,148 @@
+/*
+ * Test the batch point transforms of TransformMatrix and Quaternion against their one point at
+ * a time equivalents, and time them (a microbenchmark of the SIMD kernels in
+ * morph/simd_transform.h).
+ */
+
+#include <morph/TransformMatrix.h>
+#include <morph/Quaternion.h>
+#include <morph/mathconst.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+// True if a and b agree to within a relative tolerance
+template <std::size_t N>
+bool close (const morph::vec<float, N>& a, const morph::vec<float, N>& b)
+{
+    return (a - b).length() <= 1e-5f * std::max (1.0f, b.length());
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // A transform with translation, rotation and perspective so that every element matters
+    morph::TransformMatrix<float> tm;
+    tm.perspective (50.0f, 1.3f, 0.1f, 100.0f);
+    tm.translate (0.5f, -1.0f, -4.0f);
+    morph::Quaternion<float> q;
+    morph::vec<float> axis = { 1.0f, 2.0f, 3.0f };
+    axis.renormalize();
+    q.rotate (axis, 0.7f);
+    tm.rotate (q);
+
+    // Composition agrees with a double precision reference
+    morph::TransformMatrix<float> tm2;
+    tm2.translate (1.0f, 2.0f, 3.0f);
+    tm2.rotate (q);
+    morph::TransformMatrix<float> tm3 = tm * tm2;
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            double ref = 0.0;
+            for (int k = 0; k < 4; ++k) { ref += static_cast<double>(tm.mat[4*k+i]) * tm2.mat[4*j+k]; }
+            if (std::abs (tm3.mat[4*j+i] - ref) > 1e-5 * std::max (1.0, std::abs (ref))) {
+                std::cerr << "Matrix product element " << (4*j+i) << " is " << tm3.mat[4*j+i] << " not " << ref << "\n";
+                --rtn;
+            }
+        }
+    }
+    morph::TransformMatrix<float> tm4 = tm;
+    tm4 *= tm2;
+    if (tm4 != tm3) { std::cerr << "operator*= differs from operator*\n"; --rtn; }
+
+    // An odd number of points exercises the SIMD remainder loops
+    constexpr std::size_t N = 1000003;
+    morph::vvec<morph::vec<float, 3>> p3 (N);
+    morph::vvec<morph::vec<float, 4>> p4 (N);
+    morph::vvec<float> xs (N), ys (N), zs (N);
+    for (std::size_t i = 0; i < N; ++i) {
+        p3[i].randomize (-10.0f, 10.0f);
+        p4[i] = p3[i].plus_one_dim (1.0f);
+        p4[i][3] = 0.5f + static_cast<float>(i % 7);
+        xs[i] = p3[i][0];
+        ys[i] = p3[i][1];
+        zs[i] = p3[i][2];
+    }
+
+    morph::vvec<morph::vec<float, 3>> o3 (N);
+    morph::vvec<morph::vec<float, 4>> o4 (N);
+    morph::vvec<float> xo (N), yo (N), zo (N);
+
+    tm.transform_points (p3.data(), o3.data(), N);
+    tm.transform_points (p3.data(), o4.data(), N);
+    tm.transform_points (xs.data(), ys.data(), zs.data(), xo.data(), yo.data(), zo.data(), N);
+    unsigned int nbad = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        morph::vec<float, 4> ref = tm * p3[i];
+        if (!close (o4[i], ref) || !close (o3[i], ref.less_one_dim())
+            || !close (morph::vec<float, 3>{ xo[i], yo[i], zo[i] }, ref.less_one_dim())) { ++nbad; }
+    }
+    tm.transform_points (p4.data(), o4.data(), N);
+    for (std::size_t i = 0; i < N; ++i) { if (!close (o4[i], tm * p4[i])) { ++nbad; } }
+
+    // In place, on the containers
+    morph::vvec<morph::vec<float, 3>> inplace = p3;
+    tm.transform_points (inplace);
+    for (std::size_t i = 0; i < N; ++i) { if (inplace[i] != o3[i]) { ++nbad; } }
+    if (nbad > 0) { std::cerr << nbad << " points were transformed wrongly\n"; --rtn; }
+
+    // Quaternion rotations agree with q v q*
+    morph::vvec<morph::vec<float, 3>> r3 = p3;
+    q.rotate_points (r3);
+    nbad = 0;
+    for (std::size_t i = 0; i < N; i += 101) {
+        morph::Quaternion<float> v (0.0f, p3[i][0], p3[i][1], p3[i][2]);
+        morph::Quaternion<float> qvq = q * v * q.conjugate();
+        morph::vec<float, 3> ref = { qvq.x, qvq.y, qvq.z };
+        if (!close (r3[i], ref) || !close (q * p3[i], ref)) { ++nbad; }
+    }
+    if (nbad > 0) { std::cerr << nbad << " points were rotated wrongly\n"; --rtn; }
+
+    // Nothing to do is fine
+    tm.transform_points (static_cast<const morph::vec<float, 3>*>(nullptr), static_cast<morph::vec<float, 3>*>(nullptr), 0);
+
+    // Timings. Accumulate a result so that the loops can't be optimised away.
+    constexpr unsigned int reps = 10;
+    float acc = 0.0f;
+    auto t0 = steady_clock::now();
+    for (unsigned int r = 0; r < reps; ++r) {
+        for (std::size_t i = 0; i < N; ++i) { o4[i] = tm * p3[i]; }
+        acc += o4[r][0];
+    }
+    auto t1 = steady_clock::now();
+    for (unsigned int r = 0; r < reps; ++r) {
+        tm.transform_points (p3.data(), o4.data(), N);
+        acc += o4[r][0];
+    }
+    auto t2 = steady_clock::now();
+    for (unsigned int r = 0; r < reps; ++r) {
+        tm.transform_points (p3.data(), o3.data(), N);
+        acc += o3[r][0];
+    }
+    auto t3 = steady_clock::now();
+    for (unsigned int r = 0; r < reps; ++r) {
+        tm.transform_points (xs.data(), ys.data(), zs.data(), xo.data(), yo.data(), zo.data(), N);
+        acc += xo[r];
+    }
+    auto t4 = steady_clock::now();
+    morph::TransformMatrix<float> chain;
+    for (unsigned int r = 0; r < reps * 100000; ++r) { chain *= tm2; }
+    auto t5 = steady_clock::now();
+    acc += chain.mat[0];
+
+    auto ms = [reps](auto a, auto b) { return duration<double>(b - a).count() * 1e3 / reps; };
+    std::cout << N << " points (ms per pass): operator* loop " << ms (t0, t1)
+              << "; transform_points vec3->vec4 " << ms (t1, t2)
+              << "; vec3->vec3 " << ms (t2, t3)
+              << "; SoA " << ms (t3, t4) << "\n";
+    std::cout << "4x4 composition: " << duration<double>(t5 - t4).count() * 1e9 / (reps * 100000) << " ns (" << acc << ")\n";
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,93 @@
+/*
+ * Test morph::TripleBuffer with a writer thread that publishes frames as fast as it can and
+ * a slower reader. Every frame that the reader sees must be whole (never a mix of two
+ * frames) and newer than the last one it saw.
+ */
+
+#include <morph/TripleBuffer.h>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+int main()
+{
+    int rtn = 0;
+
+    // Nothing published yet
+    morph::TripleBuffer<int> tbi;
+    if (tbi.fetch() || tbi.has_new()) {
+        std::cerr << "Fetched a frame before any was published\n";
+        --rtn;
+    }
+    // Two publications before a fetch: the reader gets the later, the earlier is dropped
+    tbi.publish (1);
+    tbi.publish (2);
+    if (!tbi.fetch() || tbi.front() != 2 || tbi.dropped() != 1U || tbi.published() != 2U) {
+        std::cerr << "Expected to fetch the latest frame, dropping one\n";
+        --rtn;
+    }
+    if (tbi.fetch() || tbi.front() != 2) {
+        std::cerr << "A second fetch should find nothing new and leave the front alone\n";
+        --rtn;
+    }
+
+    // Each frame is a vector filled with its frame number
+    constexpr std::size_t n = 10000;
+    constexpr unsigned int n_frames = 2000;
+    morph::TripleBuffer<std::vector<unsigned int>> tb (std::vector<unsigned int>(n, 0U));
+
+    std::atomic<bool> writing = true;
+    std::thread writer ([&tb, &writing]() {
+        for (unsigned int f = 1; f <= n_frames; ++f) {
+            std::vector<unsigned int>& b = tb.back();
+            for (auto& e : b) { e = f; }
+            tb.publish();
+        }
+        writing = false;
+    });
+
+    unsigned int last_seen = 0;
+    unsigned int n_fetched = 0;
+    bool done = false;
+    while (!done) {
+        // Read writing before fetching, so that the last frame is always fetched
+        done = !writing;
+        if (!tb.fetch()) {
+            std::this_thread::yield();
+            continue;
+        }
+        ++n_fetched;
+        const std::vector<unsigned int>& fr = tb.front();
+        unsigned int f = fr[0];
+        for (auto e : fr) {
+            if (e != f) {
+                std::cerr << "Torn frame: " << e << " in frame " << f << std::endl;
+                --rtn;
+                break;
+            }
+        }
+        if (f <= last_seen) {
+            std::cerr << "Frame " << f << " is not newer than " << last_seen << std::endl;
+            --rtn;
+        }
+        last_seen = f;
+        // A slow reader
+        std::this_thread::sleep_for (std::chrono::microseconds (50));
+    }
+    writer.join();
+
+    if (last_seen != n_frames) {
+        std::cerr << "The last frame seen was " << last_seen << ", not " << n_frames << std::endl;
+        --rtn;
+    }
+    if (tb.published() != n_frames || n_fetched + tb.dropped() != n_frames) {
+        std::cerr << "Published " << tb.published() << ", fetched " << n_fetched
+                  << ", dropped " << tb.dropped() << std::endl;
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -34,6 +34,24 @@ int main()
         --rtn;
     }
 
+    // With a given seed, the resampling should be repeatable (whatever the number of threads)
+    double eom_a = morph::bootstrap<double>::error_of_mean (normally_distributed, 512, 42);
+    double eom_b = morph::bootstrap<double>::error_of_mean (normally_distributed, 512, 42);
+    if (eom_a != eom_b) {
+        std::cerr << "error_of_mean with a fixed seed is not repeatable\n";
+        --rtn;
+    }
+
+    // The standard error of the standard deviation of normally distributed data is about
+    // sigma / sqrt(2(n-1)) (here, sigma is 1)
+    double eos = morph::bootstrap<double>::error_of_std (normally_distributed, 2000);
+    double eos_expected = 1.0 / std::sqrt (2.0 * (num_samples - 1));
+    std::cout << "Bootstrapped error of std: " << eos << " (expect about " << eos_expected << ")\n";
+    if (std::abs (eos - eos_expected) > 0.2 * eos_expected) {
+        std::cerr << "Test of error_of_std failed\n";
+        --rtn;
+    }
+
     // Now test the t-test 100 times:
     int n = 0;
     int sig_diff_fails = 0;
@@ -0,0 +1,118 @@
+/*
+ * Test the GPU reductions in morph/gl/reduce.h against their CPU reference implementations,
+ * in a headless (EGL) OpenGL 4.5 context. With no GPU, Mesa's llvmpipe software renderer
+ * provides the context.
+ */
+
+#include <GL3/gl3.h>
+#include <GL/glext.h>
+
+#include <morph/gl/headless.h>
+#include <morph/gl/ssbo.h>
+#include <morph/gl/reduce.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+template <typename R>
+int compare (R& red, const GLuint name, const morph::vvec<float>& d, const unsigned int n)
+{
+    int rtn = 0;
+    std::span<const float> s (d.data(), n);
+
+    morph::range<float> r = red.minmax (name, n);
+    morph::range<float> rc = R::cpu_minmax (s);
+    if (r.min != rc.min || r.max != rc.max) {
+        std::cerr << "n=" << n << ": minmax " << r << " != " << rc << "\n";
+        --rtn;
+    }
+
+    float sm = red.sum (name, n);
+    float smc = R::cpu_sum (s);
+    if (std::abs (sm - smc) > 1e-4f * std::max (1.0f, std::abs (smc))) {
+        std::cerr << "n=" << n << ": sum " << sm << " != " << smc << "\n";
+        --rtn;
+    }
+
+    auto am = red.argmax (name, n);
+    auto amc = R::cpu_argmax (s);
+    if (am != amc) {
+        std::cerr << "n=" << n << ": argmax " << am.first << "@" << am.second << " != " << amc.first << "@" << amc.second << "\n";
+        --rtn;
+    }
+
+    morph::vvec<unsigned int> h = red.histogram (name, n, 37, -0.5f, 0.75f);
+    morph::vvec<unsigned int> hc = R::cpu_histogram (s, 37, -0.5f, 0.75f);
+    if (h != hc) {
+        std::cerr << "n=" << n << ": histogram " << h << " != " << hc << "\n";
+        --rtn;
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    try {
+        morph::gl::headless<morph::gl::version_4_5> ctx (16, 16);
+        std::cout << ctx.describe() << std::endl;
+
+        morph::gl::reduce<morph::gl::version_4_5> red;
+        red.init();
+
+        constexpr unsigned int N = 1000003; // Not a multiple of the workgroup size
+        morph::vvec<float> d (N);
+        d.randomize (-1.0f, 1.0f);
+        d[12345] = 3.0f;  // The maximum, twice; argmax gives the first
+        d[999999] = 3.0f;
+        d[777] = -2.0f;
+        d[4321] = std::numeric_limits<float>::quiet_NaN(); // NaNs are ignored
+
+        unsigned int name = 0;
+        morph::gl::setup_ssbo (1, name, d);
+
+        // Sizes which exercise one workgroup, one pass of several and two passes
+        for (unsigned int n : { 1u, 100u, 256u, 5000u, 65537u, N }) { rtn += compare (red, name, d, n); }
+        if (red.argmax (name, N).second != 12345u) { std::cerr << "argmax did not give the first maximum\n"; --rtn; }
+
+        // Nothing to reduce
+        if (red.argmax (name, 0).second != 0 || red.sum (name, 0) != 0.0f || red.minmax (name, 0).min <= red.minmax (name, 0).max) {
+            std::cerr << "Empty reductions are wrong\n";
+            --rtn;
+        }
+
+        // Compare the time to find the range on the GPU with ssbo_get_range's copy to the CPU
+        constexpr unsigned int reps = 20;
+        float acc_gpu = 0.0f;
+        float acc_cpu = 0.0f;
+        auto t0 = steady_clock::now();
+        for (unsigned int i = 0; i < reps; ++i) { acc_gpu += red.minmax (name, N).max; }
+        auto t1 = steady_clock::now();
+        for (unsigned int i = 0; i < reps; ++i) { acc_cpu += morph::gl::ssbo_get_range<float> (1, name, N).max; }
+        auto t2 = steady_clock::now();
+        if (acc_gpu != acc_cpu) { std::cerr << "reduce::minmax and ssbo_get_range disagree\n"; --rtn; }
+        std::cout << "range of " << N << " floats: reduce::minmax " << duration<double>(t1 - t0).count() * 1e3 / reps
+                  << " ms; ssbo_get_range " << duration<double>(t2 - t1).count() * 1e3 / reps << " ms\n";
+
+        try {
+            red.histogram (name, N, 0, 0.0f, 1.0f);
+            std::cerr << "histogram accepted 0 bins\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+
+        glDeleteBuffers (1, &name);
+        morph::gl::Util::checkError (__FILE__, __LINE__);
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,157 @@
+/*
+ * Test HexGrid::saveCompact/loadCompact and the grid cache, HexGrid::initCached.
+ */
+
+#include "morph/HexGrid.h"
+#include "morph/BezCoord.h"
+#include "morph/mathconst.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cmath>
+#include <unistd.h>
+
+// Do the domains and the Hexes of the two grids match?
+int compare_grids (const morph::HexGrid& hg1, const morph::HexGrid& hg2)
+{
+    if (hg1.num() != hg2.num() || hg1.d_x != hg2.d_x || hg1.d_y != hg2.d_y
+        || hg1.d_ri != hg2.d_ri || hg1.d_gi != hg2.d_gi || hg1.d_bi != hg2.d_bi
+        || hg1.d_ne != hg2.d_ne || hg1.d_nne != hg2.d_nne || hg1.d_nnw != hg2.d_nnw
+        || hg1.d_nw != hg2.d_nw || hg1.d_nsw != hg2.d_nsw || hg1.d_nse != hg2.d_nse
+        || hg1.d_flags != hg2.d_flags || hg1.d_distToBoundary != hg2.d_distToBoundary) {
+        std::cerr << "The d_ vectors differ\n";
+        return -1;
+    }
+    if (hg1.bhexen.size() != hg2.bhexen.size() || hg2.vhexen.size() != hg2.num()) {
+        std::cerr << "bhexen or vhexen differ\n";
+        return -1;
+    }
+    auto h1 = hg1.hexen.begin();
+    auto h2 = hg2.hexen.begin();
+    for (; h1 != hg1.hexen.end() && h2 != hg2.hexen.end(); ++h1, ++h2) {
+        if (h1->vi != h2->vi || h1->ri != h2->ri || h1->gi != h2->gi || h1->x != h2->x || h1->y != h2->y
+            || h1->getFlags() != h2->getFlags()
+            || (h2->has_ne() && h2->ne->vi != h1->ne->vi) || (h2->has_nsw() && h2->nsw->vi != h1->nsw->vi)) {
+            std::cerr << "Hex " << h1->vi << " differs\n";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// A circular boundary of radius r, with points spaced by about step
+std::vector<morph::BezCoord<float>> circle (const float r, const float step)
+{
+    std::vector<morph::BezCoord<float>> bpoints;
+    const int n = static_cast<int>(morph::mathconst<float>::two_pi * r / step);
+    for (int i = 0; i < n; ++i) {
+        float phi = morph::mathconst<float>::two_pi * i / n;
+        bpoints.push_back (morph::BezCoord<float> (morph::vec<float, 2>({ r * std::cos (phi), r * std::sin (phi) + 0.1f })));
+    }
+    return bpoints;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    char tmpl[] = "/tmp/testhexgrid_cache_XXXXXX";
+    if (mkdtemp (tmpl) == nullptr) {
+        std::cerr << "Failed to make a temporary directory\n";
+        return -1;
+    }
+    const std::string dir (tmpl);
+    const std::string cachedir = dir + "/cache/hexgrid";
+
+    // A grid built the usual way
+    morph::HexGrid hg1 (0.02f, 3.0f, 0.0f);
+    std::vector<morph::BezCoord<float>> bp = circle (1.0f, 0.01f);
+    hg1.setBoundary (bp);
+
+    // Round trip through a compact file
+    hg1.saveCompact (dir + "/hg1.bin");
+    morph::HexGrid hg2;
+    hg2.loadCompact (dir + "/hg1.bin");
+    if (compare_grids (hg1, hg2) != 0) {
+        std::cerr << "Loaded grid differs from saved grid\n";
+        --rtn;
+    }
+
+    // The first initCached builds the grid and the second loads it
+    morph::HexGrid hg3;
+    bp = circle (1.0f, 0.01f);
+    bool cached = hg3.initCached (0.02f, 3.0f, bp, true, cachedir);
+    if (cached || compare_grids (hg1, hg3) != 0) {
+        std::cerr << "First initCached failed\n";
+        --rtn;
+    }
+    const std::vector<morph::BezCoord<float>> bp_built = bp;
+    // z is not part of the cache key, so a grid loaded from the cache keeps its own z
+    morph::HexGrid hg4 (0.05f, 0.5f, 2.0f);
+    bp = circle (1.0f, 0.01f);
+    cached = hg4.initCached (0.02f, 3.0f, bp, true, cachedir);
+    if (!cached || compare_grids (hg1, hg4) != 0) {
+        std::cerr << "Second initCached did not load the same grid\n";
+        --rtn;
+    }
+    if (hg4.getz() != 2.0f) {
+        std::cerr << "initCached changed z to " << hg4.getz() << std::endl;
+        --rtn;
+    }
+    // The boundary points are offset in the same way whether the grid was built or loaded
+    bool same_bp = bp.size() == bp_built.size();
+    for (std::size_t i = 0; same_bp && i < bp.size(); ++i) {
+        same_bp = bp[i].x() == bp_built[i].x() && bp[i].y() == bp_built[i].y();
+    }
+    if (!same_bp || hg4.originalBoundaryCentroid != hg3.originalBoundaryCentroid) {
+        std::cerr << "initCached offset the boundary differently when loading from the cache\n";
+        --rtn;
+    }
+
+    // A different hex size is a different grid
+    morph::HexGrid hg5;
+    bp = circle (1.0f, 0.01f);
+    cached = hg5.initCached (0.025f, 3.0f, bp, true, cachedir);
+    if (cached || hg5.num() == hg1.num()) {
+        std::cerr << "A different grid came from the cache\n";
+        --rtn;
+    }
+
+    // A file with an out of range neighbour index is rejected
+    {
+        std::fstream f (dir + "/hg1.bin", std::ios::binary | std::ios::in | std::ios::out);
+        // d_ne is followed by the 5 other neighbour vectors and d_flags
+        const std::size_t n = hg1.num();
+        f.seekp (static_cast<std::streamoff>(f.seekg (0, std::ios::end).tellg())
+                 - static_cast<std::streamoff>(n * (6 * sizeof (int) + sizeof (unsigned int))));
+        const int bad = static_cast<int>(n) + 5;
+        f.write (reinterpret_cast<const char*>(&bad), sizeof (bad));
+    }
+    try {
+        morph::HexGrid hg7;
+        hg7.loadCompact (dir + "/hg1.bin");
+        std::cerr << "Loaded a file with a bad neighbour index\n";
+        --rtn;
+    } catch (const std::exception&) {
+        // Expected
+    }
+
+    // A truncated file is rejected (and the grid rebuilt)
+    if (truncate ((dir + "/hg1.bin").c_str(), 100) != 0) { --rtn; }
+    morph::HexGrid hg6;
+    try {
+        hg6.loadCompact (dir + "/hg1.bin");
+        std::cerr << "Loaded a truncated file\n";
+        --rtn;
+    } catch (const std::exception&) {
+        // Expected
+    }
+
+    std::string cmd = "rm -rf " + dir;
+    if (std::system (cmd.c_str()) != 0) { std::cerr << "Failed to clean up " << dir << std::endl; }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,121 @@
+/*
+ * Test HexGrid::initFromBoundary, which builds a grid directly from a boundary, against the
+ * grid made by applying the same boundary to a large hexagonal grid with setBoundary.
+ */
+
+#include "morph/HexGrid.h"
+#include "morph/ReadCurves.h"
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+// The number of hexes that are in one grid but not the other
+unsigned int compare_grids (const morph::HexGrid& hg1, const morph::HexGrid& hg2)
+{
+    std::set<std::pair<int, int>> s1;
+    std::set<std::pair<int, int>> s2;
+    for (auto h : hg1.hexen) { s1.insert ({ h.ri, h.gi }); }
+    for (auto h : hg2.hexen) { s2.insert ({ h.ri, h.gi }); }
+    unsigned int n_diff = 0;
+    for (auto p : s1) { if (s2.count (p) == 0) { ++n_diff; } }
+    for (auto p : s2) { if (s1.count (p) == 0) { ++n_diff; } }
+    return n_diff;
+}
+
+// Check that the d_ vectors and the Hexes agree, that neighbour relations are reciprocal and
+// that every hex that is not a boundary hex has all six neighbours.
+int check_grid (const morph::HexGrid& hg)
+{
+    int rtn = 0;
+    const int n = static_cast<int>(hg.num());
+    if (hg.d_x.size() != hg.num() || hg.d_ne.size() != hg.num() || hg.vhexen.size() != hg.num()) {
+        std::cerr << "d_ vectors are the wrong size\n";
+        return -1;
+    }
+    int i = 0;
+    for (auto h : hg.hexen) {
+        if (static_cast<int>(h.vi) != i || static_cast<int>(h.di) != i
+            || hg.d_ri[i] != h.ri || hg.d_gi[i] != h.gi || hg.d_x[i] != h.x || hg.d_y[i] != h.y
+            || hg.d_flags[i] != h.getFlags() || hg.vhexen[i]->vi != h.vi) {
+            std::cerr << "Hex " << i << " does not match its d_ entries\n";
+            --rtn;
+        }
+        if (h.has_ne() != (hg.d_ne[i] >= 0) || (h.has_ne() && static_cast<int>(h.ne->vi) != hg.d_ne[i])) {
+            std::cerr << "Hex " << i << " ne neighbour mismatch\n";
+            --rtn;
+        }
+        if (!h.testFlags (HEX_IS_BOUNDARY) && !h.testFlags (HEX_HAS_NEIGHB_ALL)) {
+            std::cerr << "Hex " << i << " is inside but lacks a neighbour\n";
+            --rtn;
+        }
+        ++i;
+    }
+    for (i = 0; i < n; ++i) {
+        if ((hg.d_ne[i] >= 0 && hg.d_nw[hg.d_ne[i]] != i)
+            || (hg.d_nne[i] >= 0 && hg.d_nsw[hg.d_nne[i]] != i)
+            || (hg.d_nnw[i] >= 0 && hg.d_nse[hg.d_nnw[i]] != i)) {
+            std::cerr << "Hex " << i << " has a neighbour relation that is not reciprocal\n";
+            --rtn;
+        }
+    }
+    if (hg.bhexen.empty()) {
+        std::cerr << "No boundary hexes\n";
+        --rtn;
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // An ellipse
+    morph::HexGrid hg1 (0.01f, 3.0f, 0.0f);
+    hg1.setEllipticalBoundary (1.0f, 0.7f);
+    morph::HexGrid hg2;
+    hg2.initEllipticalBoundary (0.01f, 1.0f, 0.7f);
+    unsigned int n_diff = compare_grids (hg1, hg2);
+    std::cout << "Ellipse: setBoundary gives " << hg1.num() << " hexes, initFromBoundary gives "
+              << hg2.num() << "; " << n_diff << " differ\n";
+    // Allow for ties in finding the nearest hex to a boundary point
+    if (n_diff > hg1.num() / 1000) { --rtn; }
+    rtn += check_grid (hg2);
+
+    // An off-centre circle, not recentred
+    morph::HexGrid hg3 (0.02f, 4.0f, 0.0f);
+    hg3.setCircularBoundary (0.6f, { 0.3f, -0.2f }, false);
+    morph::HexGrid hg4;
+    hg4.initCircularBoundary (0.02f, 0.6f, { 0.3f, -0.2f }, false);
+    n_diff = compare_grids (hg3, hg4);
+    std::cout << "Circle: setBoundary gives " << hg3.num() << " hexes, initFromBoundary gives "
+              << hg4.num() << "; " << n_diff << " differ\n";
+    if (n_diff > hg3.num() / 1000) { --rtn; }
+    rtn += check_grid (hg4);
+    // findHexAt works from the first hex, which is not at the origin in hg4
+    auto hf = hg4.findHexAt ({ 15, 0, 0 });
+    if (hf == hg4.hexen.end() || hf->ri != 15 || hf->gi != 0) {
+        std::cerr << "findHexAt failed\n";
+        --rtn;
+    }
+
+    // A boundary read from an SVG file
+    try {
+        morph::ReadCurves r ("../../tests/trial.svg");
+        morph::HexGrid hg5 (0.02f, 7.0f, 0.0f);
+        hg5.setBoundary (r.getCorticalPath());
+        morph::HexGrid hg6;
+        hg6.initFromBoundary (0.02f, r.getCorticalPath());
+        n_diff = compare_grids (hg5, hg6);
+        std::cout << "trial.svg: setBoundary gives " << hg5.num() << " hexes, initFromBoundary gives "
+                  << hg6.num() << "; " << n_diff << " differ\n";
+        if (n_diff > hg5.num() / 100) { --rtn; }
+        rtn += check_grid (hg6);
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception reading trial.svg: " << e.what() << std::endl;
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,115 @@
+/*
+ * Test morph::histo as a one-shot histogram and as an accumulator (chunked add, parallel add
+ * and merge).
+ */
+
+#include <morph/histo.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::vvec<double> data (10000);
+    data.randomizeN (3.0, 2.0);
+
+    // One shot. The counts should include every datum (including the max)
+    morph::histo<double> h1 (data, 20);
+    if (h1.counts.sum() != static_cast<double>(data.size()) || h1.datacount != static_cast<double>(data.size())) {
+        std::cerr << "One shot histo counted " << h1.counts.sum() << " of " << data.size() << std::endl;
+        --rtn;
+    }
+    if (h1.binedges.front() != h1.min || std::abs (h1.binedges.back() - h1.max) > 1e-9) {
+        std::cerr << "One shot histo bins don't span the data\n";
+        --rtn;
+    }
+
+    // Fixed range, added in chunks, should equal fixed range added all at once
+    morph::histo<double> hf_all (-5.0, 11.0, 32);
+    hf_all.add (data);
+    morph::histo<double> hf_chunks (-5.0, 11.0, 32);
+    for (std::size_t i = 0; i < data.size(); i += 1000) {
+        hf_chunks.add (data.begin() + i, data.begin() + i + 1000);
+    }
+    if (hf_all.counts != hf_chunks.counts || hf_all.underflow != hf_chunks.underflow || hf_all.overflow != hf_chunks.overflow) {
+        std::cerr << "Fixed range histo: chunked add differs from single add\n";
+        --rtn;
+    }
+    if (hf_all.counts.sum() + hf_all.underflow + hf_all.overflow != static_cast<double>(data.size())) {
+        std::cerr << "Fixed range histo lost data\n";
+        --rtn;
+    }
+
+    // Auto-ranging, starting from a narrow first chunk, then growing. Each bin of the result
+    // should hold the data that lie within its edges. Data that lie right on an edge (the
+    // extremes of the first chunk may do) could be in either neighbouring bin.
+    morph::histo<double> ha (16);
+    for (std::size_t i = 0; i < data.size(); i += 500) {
+        ha.add (data.begin() + i, data.begin() + i + 500);
+    }
+    const double edge_tol = 1e-9;
+    for (std::size_t b = 0; b < ha.counts.size(); ++b) {
+        double inside = 0.0;
+        double on_edge = 0.0;
+        for (auto d : data) {
+            if (d > ha.binedges[b] + edge_tol && d < ha.binedges[b + 1] - edge_tol) {
+                inside += 1.0;
+            } else if (std::abs (d - ha.binedges[b]) <= edge_tol || std::abs (d - ha.binedges[b + 1]) <= edge_tol) {
+                on_edge += 1.0;
+            }
+        }
+        if (ha.counts[b] < inside || ha.counts[b] > inside + on_edge) {
+            std::cerr << "Auto-ranging histo bin " << b << " has count " << ha.counts[b] << ", expected " << inside
+                      << " (+" << on_edge << " on the edges)" << std::endl;
+            --rtn;
+        }
+    }
+    if (ha.counts.sum() != static_cast<double>(data.size())) {
+        std::cerr << "Auto-ranging histo lost data\n";
+        --rtn;
+    }
+    if (ha.min != data.min() || ha.max != data.max()) {
+        std::cerr << "Auto-ranging histo has wrong data min/max\n";
+        --rtn;
+    }
+
+    // Parallel add should equal serial add
+    morph::histo<double> hp (16);
+    hp.add_parallel (data);
+    morph::histo<double> hs (16);
+    hs.add (data);
+    if (hp.counts != hs.counts || hp.binedges != hs.binedges || hp.datacount != hs.datacount) {
+        std::cerr << "add_parallel differs from add\n";
+        --rtn;
+    }
+
+    // Merge of sub-histograms with the same bins is exact
+    morph::histo<double> hm (-5.0, 11.0, 32);
+    morph::histo<double> part1 = hm.empty_copy();
+    morph::histo<double> part2 = hm.empty_copy();
+    part1.add (data.begin(), data.begin() + 4000);
+    part2.add (data.begin() + 4000, data.end());
+    hm.merge (part1);
+    hm.merge (part2);
+    if (hm.counts != hf_all.counts || hm.datacount != hf_all.datacount) {
+        std::cerr << "Merged histo differs from single histo\n";
+        --rtn;
+    }
+
+    // Merging two independently auto-ranged histos conserves the data count
+    morph::histo<double> hx (10);
+    morph::histo<double> hy (10);
+    hx.add (data.begin(), data.begin() + 100);
+    hy.add (data.begin() + 100, data.end());
+    hx.merge (hy);
+    if (hx.counts.sum() + hx.underflow + hx.overflow != static_cast<double>(data.size())) {
+        std::cerr << "Merge of auto-ranging histos lost data\n";
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
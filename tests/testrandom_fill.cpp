@@ -0,0 +1,127 @@
+/*
+ * Test the fast engines (xoshiro256pp, philox4x32), the fill() methods of the Rand classes
+ * and the reproducible parallel fills in morph/Random.h
+ */
+
+#include "morph/Random.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <cmath>
+#include <array>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+template <typename T>
+bool check_moments (const morph::vvec<T>& v, const T mean, const T sd, const std::string& what)
+{
+    const T m = v.mean();
+    const T s = v.std();
+    const T tol = T{5} * sd / std::sqrt (static_cast<T>(v.size()));
+    if (std::abs (m - mean) > tol || std::abs (s - sd) > T{0.01} * sd) {
+        std::cerr << what << ": mean " << m << " (expected " << mean << "), sd " << s
+                  << " (expected " << sd << ")\n";
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // xoshiro256++ from the state {1,2,3,4} first returns rotl(1+4, 23) + 1
+    morph::xoshiro256pp x ({ 1, 2, 3, 4 });
+    if (x() != 41943041ULL) {
+        std::cerr << "xoshiro256pp gave the wrong first output\n";
+        --rtn;
+    }
+    // Jumped streams differ
+    morph::xoshiro256pp x0 (42, 0);
+    morph::xoshiro256pp x1 (42, 1);
+    if (x0 == x1 || x0() == x1()) {
+        std::cerr << "xoshiro256pp streams 0 and 1 are the same\n";
+        --rtn;
+    }
+
+    // Philox4x32-10 known answer (from the Random123 test vectors)
+    std::array<std::uint32_t, 4> ph = morph::philox4x32::block ({ 0, 0, 0, 0 }, { 0, 0 });
+    if (ph != std::array<std::uint32_t, 4>{ 0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU, 0x9b00dbd8U }) {
+        std::cerr << "philox4x32 gave the wrong block: " << std::hex << ph[0] << " " << ph[1]
+                  << " " << ph[2] << " " << ph[3] << std::dec << std::endl;
+        --rtn;
+    }
+    // discard jumps to the same place as stepping
+    morph::philox4x32 p1 (7, 3);
+    morph::philox4x32 p2 (7, 3);
+    for (int i = 0; i < 37; ++i) { p1(); }
+    p2.discard (37);
+    if (p1 != p2 || p1() != p2() || p2.position() != 38U) {
+        std::cerr << "philox4x32::discard failed\n";
+        --rtn;
+    }
+
+    // The engines work with the Rand classes
+    morph::RandUniform<double, morph::xoshiro256pp> rux (1);
+    double xd = rux.get();
+    if (xd < 0.0 || xd >= 1.0) { --rtn; }
+
+    constexpr std::size_t n = 1000001; // odd, to test the last of the Box-Muller pairs
+
+    // Uniform fill
+    morph::RandUniform<float, morph::xoshiro256pp> ruf (-2.0f, 3.0f, 1);
+    morph::vvec<float> vf (n, 100.0f);
+    ruf.fill (vf);
+    if (vf.min() < -2.0f || vf.max() >= 3.0f) {
+        std::cerr << "Uniform fill out of range\n";
+        --rtn;
+    }
+    if (!check_moments (vf, 0.5f, 5.0f / std::sqrt (12.0f), "Uniform float fill")) { --rtn; }
+
+    // Normal fill, float and double, with std and morph engines
+    morph::RandNormal<float, std::mt19937> rnf (1.0f, 2.0f, 1);
+    rnf.fill (vf);
+    if (!check_moments (vf, 1.0f, 2.0f, "Normal float fill")) { --rtn; }
+    morph::RandNormal<double, morph::philox4x32> rnd (-1.0, 0.5, 2);
+    morph::vvec<double> vd (n, 0.0);
+    rnd.fill (vd);
+    if (!check_moments (vd, -1.0, 0.5, "Normal double fill")) { --rtn; }
+
+    // Log normal fill: the log is normal
+    morph::RandLogNormal<double, morph::xoshiro256pp> rln (0.5, 0.25, 3);
+    rln.fill (vd);
+    if (vd.min() <= 0.0) { --rtn; }
+    vd.log_inplace();
+    if (!check_moments (vd, 0.5, 0.25, "Log normal fill")) { --rtn; }
+
+    // Parallel fills are reproducible, whatever the number of threads
+    morph::vvec<float> pa (n, 0.0f);
+    morph::vvec<float> pb (n, 0.0f);
+    morph::parallel_normal_fill (pa, 1234, 5);
+#ifdef _OPENMP
+    int nt = omp_get_max_threads();
+    omp_set_num_threads (nt > 1 ? 1 : 3);
+#endif
+    morph::parallel_normal_fill (pb, 1234, 5);
+#ifdef _OPENMP
+    omp_set_num_threads (nt);
+#endif
+    if (pa != pb) {
+        std::cerr << "parallel_normal_fill is not reproducible\n";
+        --rtn;
+    }
+    if (!check_moments (pa, 0.0f, 1.0f, "Parallel normal fill")) { --rtn; }
+    morph::parallel_normal_fill (pb, 1234, 6);
+    if (pa == pb) {
+        std::cerr << "parallel_normal_fill streams 5 and 6 are the same\n";
+        --rtn;
+    }
+    morph::vvec<double> pd (n, 0.0);
+    morph::parallel_uniform_fill (pd, 99, 0, 10.0, 20.0);
+    if (pd.min() < 10.0 || pd.max() >= 20.0 || !check_moments (pd, 15.0, 10.0 / std::sqrt (12.0), "Parallel uniform fill")) {
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,138 @@
+/*
+ * Test RD_Base checkpoints: a model restored from a checkpoint continues exactly as the
+ * original did, including the random numbers it draws, and bad checkpoints are rejected.
+ */
+
+#include <morph/RD_Base.h>
+#include <morph/Random.h>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+
+// Fisher's equation with noise, stepped with the IMEX integrator (which has a history)
+struct RD_NoisyFisher : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> noise;
+    std::vector<std::vector<float>> history;
+    morph::RandNormal<float, morph::xoshiro256pp> rng{0.0f, 0.01f};
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->noise);
+        this->register_checkpoint ("/u", this->u);
+        this->register_checkpoint ("/history", this->history);
+        this->register_checkpoint_text ("/rng", this->rng);
+    }
+    void init()
+    {
+        for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+            this->u[hi] = std::exp (-(this->hg->d_x[hi] * this->hg->d_x[hi] + this->hg->d_y[hi] * this->hg->d_y[hi]) / 0.02f);
+        }
+    }
+    void step()
+    {
+        this->stepCount++;
+        this->step_imex ({ &this->u }, { 0.1f }, [](const std::vector<std::vector<float>>& y, std::vector<std::vector<float>>& R) {
+            for (unsigned int hi = 0; hi < y[0].size(); ++hi) { R[0][hi] = y[0][hi] * (1.0f - y[0][hi]); }
+        });
+        // Draw some numbers with get(), so that the distribution's state matters too
+        for (unsigned int hi = 0; hi < this->nhex; ++hi) { this->u[hi] += this->rng.get(); }
+        if (this->stepCount % 10 == 0) { this->history.push_back ({ this->u[0], this->sim_time }); }
+    }
+    void setup (float ellipse_a)
+    {
+        this->svgpath = "";
+        this->ellipse_a = ellipse_a;
+        this->ellipse_b = 0.3f;
+        this->hextohex_d = 0.02f;
+        this->hexspan = 2.0f;
+        this->allocate();
+        this->set_dt (0.01f);
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+    const std::string ckpath = "./testrd_checkpoint.ckp";
+
+    RD_NoisyFisher rd1;
+    rd1.setup (0.5f);
+    rd1.init();
+    for (int i = 0; i < 55; ++i) { rd1.step(); }
+    rd1.checkpoint (ckpath);
+    for (int i = 0; i < 55; ++i) { rd1.step(); }
+    rd1.checkpoint_wait();
+
+    // A second model, in a different state, restored from the checkpoint
+    RD_NoisyFisher rd2;
+    rd2.setup (0.5f);
+    rd2.set_dt (0.5f);
+    rd2.restore_checkpoint (ckpath);
+    if (rd2.stepCount != 55 || rd2.get_dt() != 0.01f || rd2.history.size() != 5) {
+        std::cerr << "Restored step count, dt or history are wrong\n";
+        --rtn;
+    }
+    for (int i = 0; i < 55; ++i) { rd2.step(); }
+    if (rd2.u != rd1.u || rd2.history != rd1.history || rd2.sim_time != rd1.sim_time || rd2.stepCount != rd1.stepCount) {
+        std::cerr << "The restored model did not follow the original\n";
+        --rtn;
+    }
+
+    // Checkpoints written one after another (the second while the first may still be writing)
+    rd1.checkpoint (ckpath + "1");
+    rd1.step();
+    rd1.checkpoint (ckpath + "2");
+    rd1.checkpoint_wait();
+    rd2.restore_checkpoint (ckpath + "2");
+    if (rd2.u != rd1.u || rd2.stepCount != rd1.stepCount) {
+        std::cerr << "The second of two back to back checkpoints is wrong\n";
+        --rtn;
+    }
+
+    // A model on a different grid
+    RD_NoisyFisher rd3;
+    rd3.setup (0.6f);
+    try {
+        rd3.restore_checkpoint (ckpath);
+        std::cerr << "Restored a checkpoint onto a different grid\n";
+        --rtn;
+    } catch (const std::runtime_error& e) {
+        std::cout << "As expected: " << e.what() << "\n";
+    }
+
+    // A model with more state than the checkpoint holds
+    std::vector<float> extra;
+    rd2.register_checkpoint ("/extra", extra);
+    try {
+        rd2.restore_checkpoint (ckpath);
+        std::cerr << "Restored a checkpoint that is missing some state\n";
+        --rtn;
+    } catch (const std::runtime_error& e) {
+        std::cout << "As expected: " << e.what() << "\n";
+    }
+
+    // A truncated checkpoint
+    {
+        std::ifstream fi (ckpath, std::ios::binary);
+        std::vector<char> content ((std::istreambuf_iterator<char>(fi)), std::istreambuf_iterator<char>());
+        std::ofstream fo (ckpath + "t", std::ios::binary);
+        fo.write (content.data(), content.size() / 2);
+    }
+    try {
+        rd1.restore_checkpoint (ckpath + "t");
+        std::cerr << "Restored a truncated checkpoint\n";
+        --rtn;
+    } catch (const std::runtime_error& e) {
+        std::cout << "As expected: " << e.what() << "\n";
+    }
+
+    for (auto suffix : { "", "1", "2", "t" }) { std::remove ((ckpath + suffix).c_str()); }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,129 @@
+/*
+ * Test RD_Base's ensemble mode: that the ensemble laplacian gives each member the result that
+ * compute_laplace gives for that member alone, and that members can be extracted and
+ * dropped from an ensemble variable.
+ */
+
+#include <morph/RD_Base.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+
+// A minimal RD system, to get at the RD_Base methods
+struct RD_Test : public morph::RD_Base<float>
+{
+    std::vector<float> F;
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_ensemble_variable (this->F);
+    }
+    void init() { this->noiseify_ensemble_variable (this->F, 0.5f, 1.0f); }
+    void step() {}
+};
+
+int main()
+{
+    int rtn = 0;
+
+    RD_Test rd;
+    rd.svgpath = "";
+    rd.ellipse_a = 0.5f;
+    rd.ellipse_b = 0.3f;
+    rd.hextohex_d = 0.02f;
+    rd.hexspan = 2.0f;
+    // An ensemble size that is not a multiple of any SIMD width
+    rd.ensemble_size = 13;
+    rd.allocate();
+    rd.init();
+    const unsigned int E = rd.ensemble_size;
+    if (rd.F.size() != rd.nhex * E) {
+        std::cerr << "Ensemble variable has the wrong size\n";
+        return -1;
+    }
+
+    // The sums may be rounded differently (with fused multiply-adds, say), so allow for
+    // rounding in the terms, which are the field values scaled by 2/3d^2
+    const float tol = 1e-5f / (rd.get_d() * rd.get_d());
+
+    std::vector<float> lapF (rd.F.size(), 0.0f);
+    rd.compute_laplace_ensemble (rd.F, lapF);
+
+    // Each member's laplacian, and its round trip through get/set_ensemble_member
+    std::vector<float> f;
+    std::vector<float> lap1 (rd.nhex, 0.0f);
+    std::vector<float> F2 (rd.F.size(), 0.0f);
+    for (unsigned int m = 0; m < E; ++m) {
+        rd.get_ensemble_member (rd.F, m, f);
+        rd.compute_laplace (f, lap1);
+        for (unsigned int hi = 0; hi < rd.nhex; ++hi) {
+            if (std::abs (lap1[hi] - lapF[hi * E + m]) > tol) {
+                std::cerr << "Member " << m << " hex " << hi << ": laplacian " << lapF[hi * E + m]
+                          << " should be " << lap1[hi] << "\n";
+                --rtn;
+                break;
+            }
+        }
+        rd.set_ensemble_member (F2, m, f);
+    }
+    if (F2 != rd.F) {
+        std::cerr << "get/set_ensemble_member did not round trip\n";
+        --rtn;
+    }
+
+    // Members should differ from each other
+    std::vector<float> f0, f1;
+    rd.get_ensemble_member (rd.F, 0, f0);
+    rd.get_ensemble_member (rd.F, 1, f1);
+    if (f0 == f1) {
+        std::cerr << "Members 0 and 1 have the same noise\n";
+        --rtn;
+    }
+
+    // Drop all but members 1, 4 and 12
+    std::vector<unsigned int> keep = { 1, 4, 12 };
+    std::vector<float> params (E);
+    for (unsigned int m = 0; m < E; ++m) { params[m] = static_cast<float>(m); }
+    std::vector<float> F_old = rd.F;
+    rd.compact_ensemble_variable (rd.F, keep);
+    rd.compact_ensemble_variable (params, keep);
+    rd.ensemble_size = keep.size();
+    if (rd.F.size() != rd.nhex * keep.size() || params != std::vector<float>({ 1.0f, 4.0f, 12.0f })) {
+        std::cerr << "compact_ensemble_variable gave the wrong sizes or parameters\n";
+        --rtn;
+    }
+    for (unsigned int k = 0; k < keep.size(); ++k) {
+        rd.get_ensemble_member (rd.F, k, f);
+        for (unsigned int hi = 0; hi < rd.nhex; ++hi) {
+            if (f[hi] != F_old[hi * E + keep[k]]) {
+                std::cerr << "Kept member " << keep[k] << " has the wrong values\n";
+                --rtn;
+                break;
+            }
+        }
+    }
+
+    // The laplacian of the compacted ensemble
+    lapF.assign (rd.F.size(), 0.0f);
+    rd.compute_laplace_ensemble (rd.F, lapF);
+    rd.get_ensemble_member (rd.F, 2, f);
+    rd.compute_laplace (f, lap1);
+    for (unsigned int hi = 0; hi < rd.nhex; ++hi) {
+        if (std::abs (lap1[hi] - lapF[hi * 3 + 2]) > tol) {
+            std::cerr << "Laplacian of the compacted ensemble is wrong\n";
+            --rtn;
+            break;
+        }
+    }
+
+    // keep must be in ascending order
+    try {
+        rd.compact_ensemble_variable (rd.F, { 2, 0 });
+        std::cerr << "compact_ensemble_variable accepted members out of order\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
@@ -0,0 +1,162 @@
+/*
+ * Test RD_Base's adaptive (Dormand-Prince) and IMEX integrators on Fisher's equation,
+ * du/dt = D del^2 u + u (1 - u), against a fixed step 4th order Runge-Kutta solution with a
+ * small dt.
+ */
+
+#include <morph/RD_Base.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+struct RD_Fisher : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    float D = 0.1f;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+    }
+    // A smooth bump, off centre
+    void init()
+    {
+        for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+            const float x = this->hg->d_x[hi] - 0.1f;
+            const float y = this->hg->d_y[hi];
+            this->u[hi] = std::exp (-(x * x + y * y) / 0.02f);
+        }
+        this->sim_time = 0.0f;
+        this->stats.reset();
+    }
+    void reaction (const std::vector<std::vector<float>>& y, std::vector<std::vector<float>>& R)
+    {
+        for (unsigned int hi = 0; hi < this->nhex; ++hi) { R[0][hi] = y[0][hi] * (1.0f - y[0][hi]); }
+    }
+    void derivative (const std::vector<std::vector<float>>& y, std::vector<std::vector<float>>& dydt)
+    {
+        std::vector<float> lap (this->nhex);
+        this->compute_laplace (y[0], lap);
+        for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+            dydt[0][hi] = this->D * lap[hi] + y[0][hi] * (1.0f - y[0][hi]);
+        }
+    }
+    // Classic 4th order Runge-Kutta
+    void step()
+    {
+        std::vector<std::vector<float>> y = { this->u }, k1 (1), k2 (1), k3 (1), k4 (1);
+        for (auto k : { &k1, &k2, &k3, &k4 }) { (*k)[0].resize (this->nhex); }
+        auto axpy = [this](const std::vector<float>& a, const std::vector<float>& k, float h) {
+            std::vector<std::vector<float>> r = { a };
+            for (unsigned int hi = 0; hi < this->nhex; ++hi) { r[0][hi] += h * k[hi]; }
+            return r;
+        };
+        this->derivative (y, k1);
+        this->derivative (axpy (this->u, k1[0], this->dt / 2.0f), k2);
+        this->derivative (axpy (this->u, k2[0], this->dt / 2.0f), k3);
+        this->derivative (axpy (this->u, k3[0], this->dt), k4);
+        for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+            this->u[hi] += this->dt / 6.0f * (k1[0][hi] + 2.0f * (k2[0][hi] + k3[0][hi]) + k4[0][hi]);
+        }
+        this->sim_time += this->dt;
+    }
+    auto rhs()
+    {
+        return [this](const std::vector<std::vector<float>>& y, std::vector<std::vector<float>>& dydt) { this->derivative (y, dydt); };
+    }
+    auto rfn()
+    {
+        return [this](const std::vector<std::vector<float>>& y, std::vector<std::vector<float>>& R) { this->reaction (y, R); };
+    }
+};
+
+float maxdiff (const std::vector<float>& a, const std::vector<float>& b)
+{
+    float md = 0.0f;
+    for (unsigned int i = 0; i < a.size(); ++i) { md = std::max (md, std::abs (a[i] - b[i])); }
+    return md;
+}
+
+int main()
+{
+    int rtn = 0;
+    constexpr float T = 1.0f;
+
+    RD_Fisher rd;
+    rd.svgpath = "";
+    rd.ellipse_a = 0.5f;
+    rd.ellipse_b = 0.3f;
+    rd.hextohex_d = 0.02f;
+    rd.hexspan = 2.0f;
+    rd.allocate();
+
+    // The largest stable explicit step is about 2.8 / (8 D / d^2) = 0.0014, so use 0.0005
+    rd.init();
+    rd.set_dt (0.0005f);
+    while (rd.sim_time < T - 0.00025f) { rd.step(); }
+    const std::vector<float> u_ref = rd.u;
+    std::cout << "Reference: " << std::round (T / 0.0005f) << " RK4 steps\n";
+
+    // Adaptive steps, with the last step shortened to land on T
+    rd.init();
+    rd.set_dt (0.0001f);
+    while (rd.sim_time < T) {
+        if (rd.sim_time + rd.get_dt() > T) { rd.set_dt (T - rd.sim_time); }
+        rd.step_adaptive ({ &rd.u }, rd.rhs());
+    }
+    float err = maxdiff (rd.u, u_ref);
+    std::cout << "step_adaptive: " << rd.stats.accepted << " steps, " << rd.stats.rejected
+              << " rejected, dt " << rd.stats.dt_min << " to " << rd.stats.dt_max << "; max error " << err << "\n";
+    // After the first step, each attempt reuses the last stage of the one before (FSAL)
+    if (err > 1e-3f || rd.stats.accepted >= 2000
+        || rd.stats.rhs_evals != 1 + 6 * (rd.stats.accepted + rd.stats.rejected)) { --rtn; }
+    // If the variables are changed between steps, the derivative is evaluated afresh
+    {
+        rd.init();
+        const std::vector<float> u0 = rd.u;
+        rd.set_dt (0.001f);
+        rd.step_adaptive ({ &rd.u }, rd.rhs());
+        const std::vector<float> u1 = rd.u;
+        const unsigned long long evals = rd.stats.rhs_evals;
+        rd.u = u0;
+        rd.set_dt (0.001f);
+        rd.step_adaptive ({ &rd.u }, rd.rhs());
+        // The same step from the same start, so it costs the same as the first one
+        if (rd.stats.rhs_evals != 2 * evals || rd.u != u1) {
+            std::cerr << "step_adaptive reused a stale derivative\n";
+            --rtn;
+        }
+    }
+
+    // IMEX, with steps 36 times larger than the explicit stability limit
+    for (float dt : { 0.05f, 0.01f }) {
+        rd.init();
+        rd.imex_restart();
+        rd.set_dt (dt);
+        while (rd.sim_time < T - dt / 2.0f) { rd.step_imex ({ &rd.u }, { rd.D }, rd.rfn()); }
+        err = maxdiff (rd.u, u_ref);
+        std::cout << "step_imex, dt = " << dt << ": " << rd.stats.accepted << " steps, "
+                  << rd.stats.cg_iterations << " CG iterations (max " << rd.stats.cg_iterations_max
+                  << " in one solve); max error " << err << "\n";
+        // Crank-Nicolson/Adams-Bashforth is second order
+        const float err_tol = dt > 0.02f ? 5e-3f : 2e-4f;
+        if (!(err < err_tol) || rd.stats.cg_solves != rd.stats.accepted || rd.stats.cg_failures > 0) { --rtn; }
+    }
+
+    // An implicit diffusion solve on its own: (1 - c L) x = b, checked by applying (1 - c L)
+    std::vector<float> b = u_ref;
+    std::vector<float> x (rd.nhex, 0.0f);
+    rd.cg_tol = 1e-6f;
+    rd.solve_implicit_diffusion (0.01f, b, x);
+    std::vector<float> lapx (rd.nhex);
+    rd.compute_laplace (x, lapx);
+    for (unsigned int hi = 0; hi < rd.nhex; ++hi) { lapx[hi] = x[hi] - 0.01f * lapx[hi]; }
+    err = maxdiff (lapx, b);
+    std::cout << "solve_implicit_diffusion: residual " << rd.stats.cg_residual << ", max error " << err << "\n";
+    if (err > 1e-4f) { --rtn; }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
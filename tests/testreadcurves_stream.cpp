@@ -0,0 +1,160 @@
+/*
+ * Test the SVG path data tokenizer in morph::ReadCurves::parseD, and read a scaled up SVG,
+ * made from the paths in the test SVGs, checking that every layer comes out as its path data
+ * parse on its own. Reports the read rate.
+ */
+
+#include <morph/ReadCurves.h>
+#include <morph/xml_sax.h>
+#include <morph/BezCurvePath.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+// The control points of all the curves in p
+morph::vvec<morph::vec<float, 2>> controls (const morph::BezCurvePath<float>& p)
+{
+    morph::vvec<morph::vec<float, 2>> rtn;
+    rtn.push_back (p.initialCoordinate);
+    for (const auto& c : p.curves) {
+        for (auto v : c.getControls()) { rtn.push_back (v); }
+    }
+    return rtn;
+}
+
+// Check that d parses to the control points expected (the first is the initial coordinate)
+int check_parse (const std::string& d, const morph::vvec<morph::vec<float, 2>>& expected, unsigned int ncurves)
+{
+    morph::BezCurvePath<float> p = morph::ReadCurves::parseD (d);
+    if (p.curves.size() != ncurves || controls (p) != expected) {
+        std::cerr << "Path data \"" << d << "\" gave " << p.curves.size() << " curves: " << controls (p) << "\n";
+        return -1;
+    }
+    return 0;
+}
+
+// True if parsing d throws
+bool parse_throws (const std::string& d)
+{
+    try {
+        morph::ReadCurves::parseD (d);
+    } catch (const std::exception&) {
+        return true;
+    }
+    std::cerr << "Path data \"" << d << "\" was expected to throw\n";
+    return false;
+}
+
+// All the d attributes of the <path>s in the SVG file at svgpath
+std::vector<std::string> path_data (const std::string& svgpath)
+{
+    std::ifstream f (svgpath);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string text = ss.str();
+    std::vector<std::string> ds;
+    morph::xml_sax::scan (text,
+                          [&ds](const morph::xml_sax::element& e) {
+                              if (e.name == "path" && e.find ("d") != nullptr) { ds.push_back (std::string (e.value ("d"))); }
+                          },
+                          [](std::string_view, unsigned int) {});
+    return ds;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Separators: commas, whitespace, the sign of the next number and the '.' of the next number
+    rtn += check_parse ("M1,2L3-4", { {1,2}, {1,2}, {3,-4} }, 1);
+    rtn += check_parse ("M.5.5\n\t1.5.5", { {0.5f,0.5f}, {0.5f,0.5f}, {1.5f,0.5f} }, 1);
+    // Relative commands, exponents, a leading '+', h, v (a zero v is dropped) and z
+    rtn += check_parse ("m 10 10 l 1e1-5 h+2 v0 v-3 z",
+                        { {10,10}, {10,10}, {20,5}, {20,5}, {22,5}, {22,5}, {22,2}, {22,2}, {10,10} }, 4);
+    // Repeated parameters for c; implicit lineto after M
+    rtn += check_parse ("M0 0c1 1 2 2 3 3 4 4 5 5 6 6",
+                        { {0,0}, {0,0}, {1,1}, {2,2}, {3,3}, {3,3}, {7,7}, {8,8}, {9,9} }, 2);
+    rtn += check_parse ("M0,0 10,0 10,10", { {0,0}, {0,0}, {10,0}, {10,0}, {10,10} }, 2);
+    // S reflects the previous cubic's second control point, or uses the current point
+    rtn += check_parse ("M0 0 C1 0 2 1 2 2 S3 4 4 4",
+                        { {0,0}, {0,0}, {1,0}, {2,1}, {2,2}, {2,2}, {2,3}, {3,4}, {4,4} }, 2);
+    rtn += check_parse ("M0 0 S1 1 2 2", { {0,0}, {0,0}, {0,0}, {1,1}, {2,2} }, 1);
+    // Malformed or unsupported path data
+    if (!parse_throws ("M0 0 C1 2 3")) { --rtn; }
+    if (!parse_throws ("M0 0 L1")) { --rtn; }
+    if (!parse_throws ("M0 0 L1 x")) { --rtn; }
+    if (!parse_throws ("M0 0 Q1 1 2 2")) { --rtn; }
+    if (!parse_throws ("M0 0 A1 1 0 0 1 2 2")) { --rtn; }
+
+    // Scale up: many layers, each a copy of one of the paths in the test SVGs
+    std::vector<std::string> ds = path_data ("../../tests/trial.svg");
+    std::vector<std::string> ds2 = path_data ("../../tests/whiskerbarrels_withcentres.svg");
+    if (ds.empty() || ds2.empty()) {
+        std::cerr << "Failed to read paths from the test SVGs\n";
+        return -1;
+    }
+    ds.insert (ds.end(), ds2.begin(), ds2.end());
+
+    constexpr unsigned int nlayers = 20000;
+    const std::string bigsvg = "./testreadcurves_stream.svg";
+    {
+        std::ofstream f (bigsvg);
+        f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!-- Made by testreadcurves_stream -->\n"
+          << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"
+          << "<g id=\"cortex\">\n  <path d=\"" << ds[0] << "\"/>\n</g>\n"
+          << "<g id=\"_x33_mm\">\n  <line x1=\"267\" y1=\"513\" x2=\"365.7\" y2=\"513\"/>\n</g>\n";
+        for (unsigned int i = 0; i < nlayers; ++i) {
+            f << "<g id=\"region" << i << "\">\n  <path class=\"st0\" d=\"" << ds[i % ds.size()] << "\"/>\n</g>\n";
+        }
+        f << "</svg>\n";
+    }
+
+    try {
+        auto t0 = steady_clock::now();
+        morph::ReadCurves r (bigsvg);
+        auto t1 = steady_clock::now();
+
+        std::list<morph::BezCurvePath<float>> regions = r.getEnclosedRegions();
+        if (regions.size() != nlayers) {
+            std::cerr << "Read " << regions.size() << " regions, not " << nlayers << "\n";
+            --rtn;
+        }
+        // The curves' control points are unscaled; initialCoordinate is scaled
+        auto reference = [&r](const std::string& d) {
+            morph::BezCurvePath<float> ref = morph::ReadCurves::parseD (d);
+            ref.initialCoordinate *= r.getScale_mmpersvg();
+            return controls (ref);
+        };
+        if (controls (r.getCorticalPath()) != reference (ds[0])) {
+            std::cerr << "Cortical path differs\n";
+            --rtn;
+        }
+        unsigned int i = 0;
+        unsigned int nbad = 0;
+        for (const auto& reg : regions) {
+            if (reg.name != "region" + std::to_string (i) || controls (reg) != reference (ds[i % ds.size()])) { ++nbad; }
+            ++i;
+        }
+        if (nbad > 0) { std::cerr << nbad << " regions differ from their path data\n"; --rtn; }
+
+        std::ifstream f (bigsvg, std::ios::binary | std::ios::ate);
+        double mb = static_cast<double>(f.tellg()) / 1e6;
+        double s = duration<double>(t1 - t0).count();
+        std::cout << "Read " << nlayers << " layers, " << mb << " MB, in " << s << " s (" << mb / s << " MB/s)" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception reading " << bigsvg << ": " << e.what() << std::endl;
+        --rtn;
+    }
+    std::remove (bigsvg.c_str());
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
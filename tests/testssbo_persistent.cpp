@@ -0,0 +1,147 @@
+/*
+ * Test the persistently mapped SSBOs and the asynchronous SSBO readback in morph/gl/ssbo.h,
+ * with a compute shader run in a headless (EGL) OpenGL 4.5 context. With no GPU, Mesa's
+ * llvmpipe software renderer provides the context.
+ */
+
+#include <GL3/gl3.h>
+#include <GL/glext.h>
+
+#include <morph/gl/headless.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+#include <morph/gl/ssbo.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+// out[i] = in[i] * k + i
+const char* compute_src = "#version 450\n"
+    "layout (local_size_x = 64) in;\n"
+    "layout (std430, binding = 1) buffer InBlock { float a[]; };\n"
+    "layout (std430, binding = 2) buffer OutBlock { float b[]; };\n"
+    "uniform float k;\n"
+    "void main()\n"
+    "{\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    b[i] = a[i] * k + float(i);\n"
+    "}\n";
+
+static constexpr std::size_t N = 64 * 1024;
+
+// Check that out[i] == in[i] * k + i for all i
+template <typename S>
+bool check (const S& out, float k, const char* what)
+{
+    for (std::size_t i = 0; i < N; ++i) {
+        const float expected = 0.5f * static_cast<float>(i % 100) * k + static_cast<float>(i);
+        if (out[i] != expected) {
+            std::cerr << what << ": element " << i << " is " << out[i] << ", expected " << expected << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    int rtn = 0;
+    try {
+        morph::gl::headless<morph::gl::version_4_5> ctx (16, 16);
+        std::cout << ctx.describe() << std::endl;
+
+        morph::gl::compute_shaderprog<morph::gl::version_4_5> prog;
+        prog.load_shaders ({ { GL_COMPUTE_SHADER, "", compute_src, 0 } });
+        prog.use();
+
+        // Persistent input and output. The input is written in place through its view.
+        morph::gl::persistent_ssbo<1, float, N> in_ssbo;
+        morph::gl::persistent_ssbo<2, float, N> out_ssbo;
+        in_ssbo.init();
+        out_ssbo.init();
+        std::span<float, N> in = in_ssbo.view();
+        for (std::size_t i = 0; i < N; ++i) { in[i] = 0.5f * static_cast<float>(i % 100); }
+
+        prog.set_uniform ("k", 2.0f);
+        prog.dispatch (N / 64, 1, 1);
+        out_ssbo.fence();
+        out_ssbo.wait();
+        if (!check (out_ssbo.view(), 2.0f, "persistent_ssbo")) { --rtn; }
+        auto r = out_ssbo.get_range();
+        float expected_max = 0.0f;
+        for (std::size_t i = 0; i < N; ++i) { expected_max = std::max (expected_max, in[i] * 2.0f + static_cast<float>(i)); }
+        if (r.min != 0.0f || r.max != expected_max) {
+            std::cerr << "persistent_ssbo::get_range gave " << r.min << " to " << r.max << "\n";
+            --rtn;
+        }
+
+        // Asynchronous readback, double buffered. Each step's result is tagged with its k.
+        morph::gl::ssbo_readback<float> rb;
+        rb.init (N, 2);
+        constexpr unsigned int steps = 50;
+        unsigned int n_read = 0;
+        auto consume = [&]() {
+            const float k = static_cast<float>(rb.front_tag());
+            if (!check (rb.front(), k, "ssbo_readback")) { --rtn; }
+            rb.pop();
+            ++n_read;
+        };
+        auto t0 = steady_clock::now();
+        for (unsigned int s = 0; s < steps; ++s) {
+            prog.set_uniform ("k", static_cast<float>(s));
+            prog.dispatch (N / 64, 1, 1);
+            if (!rb.request (out_ssbo.name, s)) {
+                consume();
+                rb.request (out_ssbo.name, s);
+            }
+            while (rb.ready()) { consume(); }
+        }
+        while (rb.pending() > 0) { consume(); }
+        auto t1 = steady_clock::now();
+        if (n_read != steps) {
+            std::cerr << "Read back " << n_read << " of " << steps << " steps\n";
+            --rtn;
+        }
+
+        // The same with the classic, synchronous, copying readback
+        unsigned int out_name = 0;
+        morph::vvec<float> host (N, 0.0f);
+        morph::gl::setup_ssbo (2, out_name, host);
+        auto t2 = steady_clock::now();
+        for (unsigned int s = 0; s < steps; ++s) {
+            prog.set_uniform ("k", static_cast<float>(s));
+            prog.dispatch (N / 64, 1, 1);
+            morph::gl::ssbo_copy_to_vvec (2, out_name, host);
+            if (!check (host, static_cast<float>(s), "ssbo_copy_to_vvec")) { --rtn; break; }
+        }
+        auto t3 = steady_clock::now();
+        std::cout << steps << " steps with ssbo_readback: " << duration<double>(t1 - t0).count() * 1e3
+                  << " ms; with ssbo_copy_to_vvec: " << duration<double>(t3 - t2).count() * 1e3 << " ms\n";
+
+        // copy_vvec_to_ssbo updates in place when the size is unchanged and reallocates when not
+        morph::vvec<float> upload (N, 1.0f);
+        morph::gl::copy_vvec_to_ssbo (2, out_name, upload);
+        morph::gl::ssbo_copy_to_vvec (2, out_name, host);
+        if (host != upload) { std::cerr << "copy_vvec_to_ssbo (same size) failed\n"; --rtn; }
+        upload.resize (2 * N, 3.0f);
+        morph::gl::copy_vvec_to_ssbo (2, out_name, upload);
+        host.resize (2 * N);
+        morph::gl::ssbo_copy_to_vvec (2, out_name, host);
+        if (host != upload) { std::cerr << "copy_vvec_to_ssbo (new size) failed\n"; --rtn; }
+        glDeleteBuffers (1, &out_name);
+
+        morph::gl::Util::checkError (__FILE__, __LINE__);
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "Test success" << std::endl; }
+    return rtn;
+}
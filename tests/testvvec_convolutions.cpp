@@ -1,5 +1,30 @@
 #include <morph/vvec.h>
 
+// The original, direct implementation of vvec::convolve, to check the faster code paths against
+template <typename S>
+morph::vvec<S> reference_convolve (const morph::vvec<S>& data, const morph::vvec<S>& kernel,
+                                   const typename morph::vvec<S>::wrapdata wrap)
+{
+    int _n = data.size();
+    morph::vvec<S> rtn(_n);
+    int kw = kernel.size();
+    int khw = kw/2;
+    int khwr = kw%2;
+    int zki = khwr ? khw : khw-1;
+    for (int i = 0; i < _n; ++i) {
+        S sum = S{0};
+        for (int j = 0; j<kw; ++j) {
+            int ii = i+j-zki;
+            ii += ii < 0 && wrap==morph::vvec<S>::wrapdata::wrap ? _n : 0;
+            ii -= ii >= _n && wrap==morph::vvec<S>::wrapdata::wrap ? _n : 0;
+            if (ii < 0 || ii >= _n) { continue; }
+            sum += data[ii] * kernel[j];
+        }
+        rtn[i] = sum;
+    }
+    return rtn;
+}
+
 int main()
 {
     int rtn = 0;
@@ -23,5 +48,61 @@ int main()
     if (r1 != r1expct) { rtn -= 1; }
     if (r2 != r2expct) { rtn -= 1; }
 
+    // Compare the direct (interior/edge split) and FFT paths with the reference for odd and
+    // even kernels, kernels wider than the data, and both wrap modes
+    using wd = morph::vvec<double>::wrapdata;
+    for (int n : {1, 7, 100, 1000}) {
+        morph::vvec<double> data (n);
+        data.randomize();
+        for (int kw : {1, 2, 5, 8, 63, 64, 101, 400, 1500}) {
+            morph::vvec<double> kernel (kw);
+            kernel.randomize();
+            for (wd w : {wd::none, wd::wrap}) {
+                morph::vvec<double> ref = reference_convolve (data, kernel, w);
+                double scale = std::max (1.0, ref.abs().max());
+                double d_direct = (data.convolve_direct (kernel, w) - ref).abs().max() / scale;
+                double d_auto = (data.convolve (kernel, w) - ref).abs().max() / scale;
+                double d_fft = (data.convolve_fft (kernel, w) - ref).abs().max() / scale;
+                morph::vvec<double> inplace = data;
+                inplace.convolve_inplace (kernel, w);
+                double d_inplace = (inplace - ref).abs().max() / scale;
+                if (d_direct > 1e-14 || d_auto > 1e-12 || d_inplace > 1e-12 || d_fft > 1e-12) {
+                    std::cout << "n=" << n << " kw=" << kw << (w == wd::wrap ? " wrap" : "")
+                              << ": relative errors direct " << d_direct << ", convolve " << d_auto
+                              << ", inplace " << d_inplace << ", fft " << d_fft << std::endl;
+                    rtn -= 1;
+                }
+            }
+        }
+    }
+
+    // Also in single precision (the FFT is computed in double precision)
+    morph::vvec<float> fdata (5000);
+    fdata.randomize();
+    morph::vvec<float> fkernel (257);
+    fkernel.randomize();
+    morph::vvec<float> fref = reference_convolve (fdata, fkernel, morph::vvec<float>::wrapdata::wrap);
+    float fdiff = (fdata.convolve_fft (fkernel, morph::vvec<float>::wrapdata::wrap) - fref).abs().max() / fref.abs().max();
+    if (fdiff > 1e-5f) {
+        std::cout << "float FFT convolve relative error " << fdiff << std::endl;
+        rtn -= 1;
+    }
+
+    // The recursive Gaussian should be close to the (wide) convolved Gaussian
+    morph::vvec<double> trace (3000);
+    trace.randomize();
+    for (double sigma : {0.8, 3.0, 40.0}) {
+        for (wd w : {wd::none, wd::wrap}) {
+            morph::vvec<double> g = trace.smooth_gauss (sigma, 8, w);
+            morph::vvec<double> gr = trace.smooth_gauss_recursive (sigma, w);
+            double d = (g - gr).abs().max();
+            if (d > 5e-4) {
+                std::cout << "smooth_gauss_recursive (sigma=" << sigma << (w == wd::wrap ? ", wrap" : "")
+                          << ") differs from smooth_gauss by " << d << std::endl;
+                rtn -= 1;
+            }
+        }
+    }
+
     return rtn;
 }